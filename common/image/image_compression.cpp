@@ -1,6 +1,10 @@
 #include "image_compression.hpp"
 #include "image.hpp"
 
+#include <algorithm>
+#include <atomic>
+#include <thread>
+
 namespace
 {
 
@@ -32,6 +36,20 @@ const std::string PREFIX_ETC1 = "ETC1";
 const std::string PREFIX_ETC2 = "ETC2";
 const std::string PREFIX_ASTC = "ASTC";
 
+// Block rows are handed out to the threads in chunks of about this many blocks
+const UInt32 BLOCKS_PER_CHUNK = 1024;
+// Below this many blocks in total, starting threads costs more than it saves
+const UInt32 MIN_BLOCKS_FOR_THREADS = 4096;
+
+UInt32 UncompressionThreadCount = 0;
+
+struct BlockRowChunk
+{
+    const pat::BlockRowJob *job;
+    UInt32 begin;
+    UInt32 end;
+};
+
 }
 
 namespace pat
@@ -123,6 +141,10 @@ bool Uncompress(const Image &input, Image &output)
     {
         return UncompressFromETC1(input, output);
     }
+    else if (IsETC2Compression(input_format))
+    {
+        return UncompressFromETC2(input, output);
+    }
     else if (IsASTCCompression(input_format))
     {
         return UncompressFromASTC(input, output);
@@ -180,4 +202,77 @@ bool ImageCompressionFormat::CompressUncompress(const Image &input, Image &outpu
     return Compress(input, temp) && Uncompress(temp, output);
 }
 
+void SetUncompressionThreadCount(UInt32 count)
+{
+    UncompressionThreadCount = count;
+}
+
+UInt32 GetUncompressionThreadCount()
+{
+    if (UncompressionThreadCount)
+        return UncompressionThreadCount;
+    return std::max(1u, std::thread::hardware_concurrency());
+}
+
+void RunBlockRowJobs(const std::vector<BlockRowJob> &jobs)
+{
+    std::vector<BlockRowChunk> chunks;
+    UInt32 totalBlocks = 0;
+    for (const BlockRowJob &job : jobs)
+    {
+        if (job.rows == 0 || !job.decode)
+            continue;
+        const UInt32 rowsPerChunk = std::max(1u, BLOCKS_PER_CHUNK / std::max(1u, job.blocksPerRow));
+        for (UInt32 begin = 0; begin < job.rows; begin += rowsPerChunk)
+        {
+            const BlockRowChunk chunk = { &job, begin, std::min(job.rows, begin + rowsPerChunk) };
+            chunks.push_back(chunk);
+        }
+        totalBlocks += job.rows * job.blocksPerRow;
+    }
+
+    UInt32 threadCount = std::min<UInt32>(GetUncompressionThreadCount(), chunks.size());
+    if (totalBlocks < MIN_BLOCKS_FOR_THREADS)
+        threadCount = 1;
+
+    std::atomic<size_t> next(0);
+    auto worker = [&chunks, &next]() {
+        for (size_t i = next++; i < chunks.size(); i = next++)
+            chunks[i].job->decode(chunks[i].begin, chunks[i].end);
+    };
+
+    std::vector<std::thread> threads;
+    for (UInt32 i = 1; i < threadCount; ++i)
+        threads.push_back(std::thread(worker));
+    worker();
+    for (std::thread &thread : threads)
+        thread.join();
+}
+
+bool UncompressLevels(const std::vector<const Image *> &input, const std::vector<Image *> &output)
+{
+    if (input.size() != output.size())
+    {
+        PAT_DEBUG_LOG("Mismatched level count to uncompress : %d vs %d\n", (int)input.size(), (int)output.size());
+        return false;
+    }
+
+    std::vector<BlockRowJob> jobs(input.size());
+    for (size_t i = 0; i < input.size(); ++i)
+    {
+        const UInt32 format = input[i]->Format();
+        if (IsETC1Compression(format) || IsETC2Compression(format))
+        {
+            if (PrepareETCUncompression(*input[i], *output[i], jobs[i]) == false)
+                return false;
+        }
+        else if (Uncompress(*input[i], *output[i]) == false)
+        {
+            return false;
+        }
+    }
+    RunBlockRowJobs(jobs);
+    return true;
+}
+
 }
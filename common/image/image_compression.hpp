@@ -3,6 +3,10 @@
 
 #include "base/base.hpp"
 
+#include <functional>
+#include <string>
+#include <vector>
+
 namespace pat
 {
 
@@ -44,12 +48,38 @@ bool CanCompressAs(UInt32 format, UInt32 type, const std::string &option);
 bool Uncompress(const Image &input, Image &output);
 bool Compress(const Image &input, Image &output, const std::string &option);
 
+///////////////////////////////////////////////////////////////
+// Block-parallel uncompression
+///////////////////////////////////////////////////////////////
+
+// The uncompression of one image, split into rows of blocks. decode(begin, end)
+// may be called from several threads at once for disjoint ranges of rows.
+struct BlockRowJob
+{
+    BlockRowJob() : rows(0), blocksPerRow(0) {}
+
+    UInt32 rows;
+    UInt32 blocksPerRow;
+    std::function<void(UInt32, UInt32)> decode;
+};
+
+// Number of threads used for uncompression, 0 means one per hardware thread
+void SetUncompressionThreadCount(UInt32 count);
+UInt32 GetUncompressionThreadCount();
+
+// Runs the jobs to completion, sharing out their block rows between the threads
+void RunBlockRowJobs(const std::vector<BlockRowJob> &jobs);
+
+// Uncompress several images at once, e.g. all the mipmap levels of a texture,
+// so that the small levels don't each pay for their own threads
+bool UncompressLevels(const std::vector<const Image *> &input, const std::vector<Image *> &output);
+
 ///////////////////////////////////////////////////////////////
 // ETC compression
 ///////////////////////////////////////////////////////////////
 
-// ETC1 uncompression is always supported; ETC1 compression is supported when MALI texture tool can be found in $PATH
-// ETC2 compression and uncompression are supported when MALI texture tool can be found is $PATH
+// ETC1 and ETC2 uncompression are always supported; ETC1 compression is supported when MALI texture tool can be found in $PATH
+// ETC2 compression is supported when MALI texture tool can be found is $PATH
 extern const char * ETC_COMPRESSION_TOOL;
 bool SupportETC1Compression();
 bool SupportETC1Uncompression();
@@ -68,6 +98,11 @@ bool UncompressFromETC1(const Image &input, Image &output);
 
 // only support alpha depth to be 1 or 8
 bool CompressAsETC2(const Image &input, Image &output, UInt32 alphaDepth);
+// Uncompress to GL_RGB for the RGB8 formats and GL_RGBA for the alpha formats, GL_UNSIGNED_BYTE
+bool UncompressFromETC2(const Image &input, Image &output);
+
+// Allocates the output of an ETC1/ETC2 uncompression and sets up the job that fills it in
+bool PrepareETCUncompression(const Image &input, Image &output, BlockRowJob &job);
 
 ///////////////////////////////////////////////////////////////
 // ASTC compression
@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <cstring>
 #include <GLES2/gl2.h>
 #include <GLES2/gl2ext.h>
@@ -25,32 +26,28 @@ const unsigned char ModifierIndexTable[] = {
     2, 3, 1, 0,
 };
 
-const unsigned char PixelXOffset[] = {
-    0, 0, 0, 0,
-    1, 1, 1, 1,
-    2, 2, 2, 2,
-    3, 3, 3, 3,
+// Distances used by the ETC2 T and H modes
+const int DistanceTable[] = {
+    3, 6, 11, 16, 23, 32, 41, 64,
 };
 
-const unsigned char PixelYOffset[] = {
-    0, 1, 2, 3,
-    0, 1, 2, 3,
-    0, 1, 2, 3,
-    0, 1, 2, 3,
-};
-
-const unsigned char FlipTable1[] = {
-    0, 0, 0, 0,
-    0, 0, 0, 0,
-    1, 1, 1, 1,
-    1, 1, 1, 1,
-};
-
-const unsigned char FlipTable2[] = {
-    0, 0, 1, 1,
-    0, 0, 1, 1,
-    0, 0, 1, 1,
-    0, 0, 1, 1,
+const int AlphaModifierTable[] = {
+    -3, -6,  -9, -15, 2, 5, 8, 14,
+    -3, -7, -10, -13, 2, 6, 9, 12,
+    -2, -5,  -8, -13, 1, 4, 7, 12,
+    -2, -4,  -6, -13, 1, 3, 5, 12,
+    -3, -6,  -8, -12, 2, 5, 7, 11,
+    -3, -7,  -9, -11, 2, 6, 8, 10,
+    -4, -7,  -8, -11, 3, 6, 7, 10,
+    -3, -5,  -8, -11, 2, 4, 7, 10,
+    -2, -6,  -8, -10, 1, 5, 7, 9,
+    -2, -5,  -8, -10, 1, 4, 7, 9,
+    -2, -4,  -8, -10, 1, 3, 7, 9,
+    -2, -5,  -7, -10, 1, 4, 6, 9,
+    -3, -4,  -7, -10, 2, 3, 6, 9,
+    -1, -2,  -3, -10, 0, 1, 2, 9,
+    -4, -6,  -8,  -9, 3, 5, 7, 8,
+    -3, -5,  -7,  -9, 2, 4, 6, 8,
 };
 
 // Convert 3-bit two-complement number to signed byte
@@ -62,19 +59,28 @@ char ToSignedGLubyte(unsigned char input)
         return input;
 }
 
+unsigned char Extend4to8Bits(unsigned char input)
+{
+    return (input << 4) + input;
+}
+
 unsigned char Extend5to8Bits(unsigned char input)
 {
     return (input << 3) + ((input & 0x1C) >> 2);
 }
 
-unsigned char Extend4to8Bits(unsigned char input)
+unsigned char Extend6to8Bits(unsigned char input)
 {
-    return (input << 4) + input;
+    return (input << 2) | (input >> 4);
+}
+
+unsigned char Extend7to8Bits(unsigned char input)
+{
+    return (input << 1) | (input >> 6);
 }
 
-unsigned char Clamp(unsigned char a, int b)
+unsigned char Clamp(int c)
 {
-    int c = a + b;
     if (c < 0)
         return 0;
     else if (c > 0xFF)
@@ -83,90 +89,323 @@ unsigned char Clamp(unsigned char a, int b)
         return static_cast<unsigned char>(c);
 }
 
-void SetPixel(unsigned char *dest, unsigned char r, unsigned char g, unsigned char b, int modifier, int x, int y, int width, int height)
+// A block is decoded into a 4x4 tile of pixels, stored row by row with the
+// same channel count as the output image, so that it can be written out
+// with one copy per row
+const int MaxTileSize = 4 * 4 * 4;
+
+// Pixels are addressed in the order the indices are stored in: i = x * 4 + y.
+// The pixel index is 2 bits, the high bit is in the upper half of the word.
+struct PixelIndices
 {
-    if (x >= width || y >= height)
-        return;
+    explicit PixelIndices(const unsigned char *src)
+        : word((static_cast<unsigned int>(src[4]) << 24) | (src[5] << 16) | (src[6] << 8) | src[7])
+    {}
+
+    unsigned int operator[](int i) const
+    {
+        return (((word >> (i + 16)) & 0x01) << 1) | ((word >> i) & 0x01);
+    }
+
+    unsigned int word;
+};
+
+// Builds the four colours of a subblock, in pixel index order. If alphaMode
+// is set, the ETC2 punchthrough rules for non-opaque blocks apply.
+void SubblockPalette(const unsigned char base[3], unsigned char codeWord, bool alphaMode, unsigned char palette[4][4])
+{
+    const int *modifierTable = ModifierTable + 4 * codeWord;
+    for (int index = 0; index < 4; ++index)
+    {
+        int modifier = modifierTable[ModifierIndexTable[index]];
+        if (alphaMode && (index & 0x01) == 0)
+            modifier = 0;
+        palette[index][0] = Clamp(base[0] + modifier);
+        palette[index][1] = Clamp(base[1] + modifier);
+        palette[index][2] = Clamp(base[2] + modifier);
+        palette[index][3] = 0xFF;
+    }
+    if (alphaMode)
+        memset(palette[2], 0, 4);
+}
+
+// Individual and differential modes: 2 subblocks with a palette of 4 each,
+// split vertically or horizontally depending on the flip bit
+template <int Channels>
+void DecodeSubblocks(const unsigned char *src, const unsigned char base[2][3], bool alphaMode, unsigned char *tile)
+{
+    unsigned char palette[2][4][4];
+    SubblockPalette(base[0], src[3] >> 5, alphaMode, palette[0]);
+    SubblockPalette(base[1], (src[3] & 0x1C) >> 2, alphaMode, palette[1]);
+
+    const bool flipbit = src[3] & 0x01;
+    const PixelIndices indices(src);
+    for (int x = 0; x < 4; ++x)
+    {
+        for (int y = 0; y < 4; ++y)
+        {
+            const int part = flipbit ? (y >> 1) : (x >> 1);
+            memcpy(tile + (y * 4 + x) * Channels, palette[part][indices[x * 4 + y]], Channels);
+        }
+    }
+}
+
+// T and H modes: one palette of 4 colours for the whole block
+template <int Channels>
+void DecodePaletteBlock(const unsigned char *src, unsigned char palette[4][4], bool alphaMode, unsigned char *tile)
+{
+    for (int index = 0; index < 4; ++index)
+        palette[index][3] = 0xFF;
+    if (alphaMode)
+        memset(palette[2], 0, 4);
+
+    const PixelIndices indices(src);
+    for (int x = 0; x < 4; ++x)
+    {
+        for (int y = 0; y < 4; ++y)
+        {
+            memcpy(tile + (y * 4 + x) * Channels, palette[indices[x * 4 + y]], Channels);
+        }
+    }
+}
+
+void SetPaletteColor(unsigned char *color, const unsigned char base[3], int distance)
+{
+    color[0] = Clamp(base[0] + distance);
+    color[1] = Clamp(base[1] + distance);
+    color[2] = Clamp(base[2] + distance);
+}
 
-    dest += (width * y + x) * 3;
-    dest[0] = Clamp(r, modifier);
-    dest[1] = Clamp(g, modifier);
-    dest[2] = Clamp(b, modifier);
+template <int Channels>
+void DecodeTMode(const unsigned char *src, bool alphaMode, unsigned char *tile)
+{
+    const unsigned char color1[3] = {
+        Extend4to8Bits(((src[0] >> 1) & 0x0C) | (src[0] & 0x03)),
+        Extend4to8Bits(src[1] >> 4),
+        Extend4to8Bits(src[1] & 0x0F),
+    };
+    const unsigned char color2[3] = {
+        Extend4to8Bits(src[2] >> 4),
+        Extend4to8Bits(src[2] & 0x0F),
+        Extend4to8Bits(src[3] >> 4),
+    };
+    const int distance = DistanceTable[((src[3] >> 1) & 0x06) | (src[3] & 0x01)];
+
+    unsigned char palette[4][4];
+    SetPaletteColor(palette[0], color1, 0);
+    SetPaletteColor(palette[1], color2, distance);
+    SetPaletteColor(palette[2], color2, 0);
+    SetPaletteColor(palette[3], color2, -distance);
+    DecodePaletteBlock<Channels>(src, palette, alphaMode, tile);
 }
 
-void DecodeBlock(const unsigned char *src, unsigned char *dest, int x, int y, int width, int height)
+template <int Channels>
+void DecodeHMode(const unsigned char *src, bool alphaMode, unsigned char *tile)
 {
-    unsigned char buffer[8];
-    memcpy(buffer, src, sizeof(unsigned char) * 8);
+    const unsigned char r1 = (src[0] >> 3) & 0x0F;
+    const unsigned char g1 = ((src[0] & 0x07) << 1) | ((src[1] >> 4) & 0x01);
+    const unsigned char b1 = (src[1] & 0x08) | ((src[1] & 0x03) << 1) | (src[2] >> 7);
+    const unsigned char r2 = (src[2] >> 3) & 0x0F;
+    const unsigned char g2 = ((src[2] & 0x07) << 1) | (src[3] >> 7);
+    const unsigned char b2 = (src[3] >> 3) & 0x0F;
+
+    // The lowest bit of the distance index is implied by the order of the two base colours
+    const int order = ((r1 << 8) | (g1 << 4) | b1) >= ((r2 << 8) | (g2 << 4) | b2) ? 1 : 0;
+    const int distance = DistanceTable[(src[3] & 0x04) | ((src[3] & 0x01) << 1) | order];
+
+    const unsigned char color1[3] = { Extend4to8Bits(r1), Extend4to8Bits(g1), Extend4to8Bits(b1) };
+    const unsigned char color2[3] = { Extend4to8Bits(r2), Extend4to8Bits(g2), Extend4to8Bits(b2) };
+
+    unsigned char palette[4][4];
+    SetPaletteColor(palette[0], color1, distance);
+    SetPaletteColor(palette[1], color1, -distance);
+    SetPaletteColor(palette[2], color2, distance);
+    SetPaletteColor(palette[3], color2, -distance);
+    DecodePaletteBlock<Channels>(src, palette, alphaMode, tile);
+}
 
-    const bool diffbit = buffer[3] & 0x02;
-    const bool flipbit = buffer[3] & 0x01;
+// Planar mode: colours are interpolated from the origin, horizontal and vertical colours
+template <int Channels>
+void DecodePlanarMode(const unsigned char *src, unsigned char *tile)
+{
+    const int o[3] = {
+        Extend6to8Bits((src[0] >> 1) & 0x3F),
+        Extend7to8Bits(((src[0] & 0x01) << 6) | ((src[1] >> 1) & 0x3F)),
+        Extend6to8Bits(((src[1] & 0x01) << 5) | (src[2] & 0x18) | ((src[2] & 0x03) << 1) | (src[3] >> 7)),
+    };
+    const int h[3] = {
+        Extend6to8Bits(((src[3] >> 1) & 0x3E) | (src[3] & 0x01)),
+        Extend7to8Bits(src[4] >> 1),
+        Extend6to8Bits(((src[4] & 0x01) << 5) | (src[5] >> 3)),
+    };
+    const int v[3] = {
+        Extend6to8Bits(((src[5] & 0x07) << 3) | (src[6] >> 5)),
+        Extend7to8Bits(((src[6] & 0x1F) << 2) | (src[7] >> 6)),
+        Extend6to8Bits(src[7] & 0x3F),
+    };
+
+    for (int y = 0; y < 4; ++y)
+    {
+        for (int x = 0; x < 4; ++x)
+        {
+            unsigned char *pixel = tile + (y * 4 + x) * Channels;
+            for (int c = 0; c < 3; ++c)
+                pixel[c] = Clamp((x * (h[c] - o[c]) + y * (v[c] - o[c]) + 4 * o[c] + 2) >> 2);
+            if (Channels == 4)
+                pixel[3] = 0xFF;
+        }
+    }
+}
 
-    unsigned char R[2], G[2], B[2];
-    if (diffbit)
+// ETC1 does not define what happens when a differential colour overflows;
+// the wrap-around here is kept for compatibility with earlier versions
+template <int Channels>
+void DecodeETC1Block(const unsigned char *src, unsigned char *tile)
+{
+    unsigned char base[2][3];
+    if (src[3] & 0x02)
     {
-        const unsigned char _R1 = (buffer[0] & 0xF8) >> 3;
-        const char _dR2 = ToSignedGLubyte(buffer[0] & 0x07);
-        const unsigned char _G1 = (buffer[1] & 0xF8) >> 3;
-        const char _dG2 = ToSignedGLubyte(buffer[1] & 0x07);
-        const unsigned char _B1 = (buffer[2] & 0xF8) >> 3;
-        const char _dB2 = ToSignedGLubyte(buffer[2] & 0x07);
-        const unsigned char _R2 = _R1 + _dR2;
-        const unsigned char _G2 = _G1 + _dG2;
-        const unsigned char _B2 = _B1 + _dB2;
-        R[0] = Extend5to8Bits(_R1);
-        R[1] = Extend5to8Bits(_R2);
-        G[0] = Extend5to8Bits(_G1);
-        G[1] = Extend5to8Bits(_G2);
-        B[0] = Extend5to8Bits(_B1);
-        B[1] = Extend5to8Bits(_B2);
+        for (int c = 0; c < 3; ++c)
+        {
+            const unsigned char c1 = (src[c] & 0xF8) >> 3;
+            const unsigned char c2 = c1 + ToSignedGLubyte(src[c] & 0x07);
+            base[0][c] = Extend5to8Bits(c1);
+            base[1][c] = Extend5to8Bits(c2);
+        }
     }
     else
     {
-        const unsigned char _R1 = (buffer[0] & 0xF0) >> 4;
-        const unsigned char _R2 = buffer[0] & 0x0F;
-        const unsigned char _G1 = (buffer[1] & 0xF0) >> 4;
-        const unsigned char _G2 = buffer[1] & 0x0F;
-        const unsigned char _B1 = (buffer[2] & 0xF0) >> 4;
-        const unsigned char _B2 = buffer[2] & 0x0F; 
-        R[0] = Extend4to8Bits(_R1);
-        R[1] = Extend4to8Bits(_R2);
-        G[0] = Extend4to8Bits(_G1);
-        G[1] = Extend4to8Bits(_G2);
-        B[0] = Extend4to8Bits(_B1);
-        B[1] = Extend4to8Bits(_B2);       
+        for (int c = 0; c < 3; ++c)
+        {
+            base[0][c] = Extend4to8Bits((src[c] & 0xF0) >> 4);
+            base[1][c] = Extend4to8Bits(src[c] & 0x0F);
+        }
     }
+    DecodeSubblocks<Channels>(src, base, false, tile);
+}
 
-    unsigned char codeWord1 = buffer[3] >> 5;
-    unsigned char codeWord2 = (buffer[3] & 0x1C) >> 2;
-    const int *modifierTable1 = ModifierTable + 4 * codeWord1;
-    const int *modifierTable2 = ModifierTable + 4 * codeWord2;
+// ETC2 colour block. With punchthrough alpha the differential bit is the
+// opaque bit instead, and the individual mode is not available.
+template <int Channels>
+void DecodeETC2Block(const unsigned char *src, bool punchthrough, unsigned char *tile)
+{
+    const bool diffbit = src[3] & 0x02;
+    if (!punchthrough && !diffbit)
+    {
+        DecodeETC1Block<Channels>(src, tile);
+        return;
+    }
 
-    x = x << 2;
-    y = y << 2;
+    const bool alphaMode = punchthrough && !diffbit;
+    int c1[3], c2[3];
+    for (int c = 0; c < 3; ++c)
+    {
+        c1[c] = (src[c] & 0xF8) >> 3;
+        c2[c] = c1[c] + ToSignedGLubyte(src[c] & 0x07);
+    }
 
-    for (int i = 0; i < 16; ++i)
+    if (c2[0] < 0 || c2[0] > 31)
+    {
+        DecodeTMode<Channels>(src, alphaMode, tile);
+    }
+    else if (c2[1] < 0 || c2[1] > 31)
+    {
+        DecodeHMode<Channels>(src, alphaMode, tile);
+    }
+    else if (c2[2] < 0 || c2[2] > 31)
+    {
+        DecodePlanarMode<Channels>(src, tile);
+    }
+    else
     {
-        unsigned char index = 0;
-        if (i < 8)
+        unsigned char base[2][3];
+        for (int c = 0; c < 3; ++c)
         {
-            index = ((buffer[5] >> i) & 0x01) << 1;
-            index += ((buffer[7] >> i) & 0x01);
+            base[0][c] = Extend5to8Bits(c1[c]);
+            base[1][c] = Extend5to8Bits(c2[c]);
         }
-        else
+        DecodeSubblocks<Channels>(src, base, alphaMode, tile);
+    }
+}
+
+// EAC alpha block, written into the alpha channel of an RGBA tile
+void DecodeEACAlphaBlock(const unsigned char *src, unsigned char *tile)
+{
+    const int baseCodeWord = src[0];
+    const int multiplier = src[1] >> 4;
+    const int *modifierTable = AlphaModifierTable + 8 * (src[1] & 0x0F);
+    unsigned long long indices = 0;
+    for (int i = 2; i < 8; ++i)
+        indices = (indices << 8) | src[i];
+
+    for (int x = 0; x < 4; ++x)
+    {
+        for (int y = 0; y < 4; ++y)
         {
-            index = ((buffer[4] >> (i - 8)) & 0x01) << 1;
-            index += ((buffer[6] >> (i - 8)) & 0x01);
+            const int index = (indices >> (45 - 3 * (x * 4 + y))) & 0x07;
+            tile[(y * 4 + x) * 4 + 3] = Clamp(baseCodeWord + modifierTable[index] * multiplier);
         }
+    }
+}
 
-        index = ModifierIndexTable[index];
-        const unsigned char partIndex = (!flipbit) ? FlipTable1[i] : FlipTable2[i];
-        const int modifier = (partIndex == 0) ? modifierTable1[index] :
-            modifierTable2[index];
+void StoreTile(const unsigned char *tile, int channels, unsigned char *dest, int x, int y, int width, int height)
+{
+    const int columns = std::min(4, width - x);
+    const int rows = std::min(4, height - y);
+    const int rowSize = columns * channels;
+    dest += (y * width + x) * channels;
+    for (int j = 0; j < rows; ++j)
+    {
+        memcpy(dest, tile + j * 4 * channels, rowSize);
+        dest += width * channels;
+    }
+}
+
+enum BlockKind
+{
+    ETC1_RGB,
+    ETC2_RGB,
+    ETC2_RGB_A1,
+    ETC2_RGBA_EAC,
+};
+
+void DecodeBlock(BlockKind kind, const unsigned char *src, unsigned char *tile)
+{
+    switch (kind)
+    {
+    case ETC1_RGB:
+        DecodeETC1Block<3>(src, tile);
+        break;
+    case ETC2_RGB:
+        DecodeETC2Block<3>(src, false, tile);
+        break;
+    case ETC2_RGB_A1:
+        DecodeETC2Block<4>(src, true, tile);
+        break;
+    case ETC2_RGBA_EAC:
+        DecodeETC2Block<4>(src + 8, false, tile);
+        DecodeEACAlphaBlock(src, tile);
+        break;
+    }
+}
 
-        SetPixel(dest, R[partIndex], G[partIndex], B[partIndex],
-                 modifier, x + PixelXOffset[i],
-                 y + PixelYOffset[i], width, height);
+void DecodeBlockRows(BlockKind kind, const unsigned char *srcData, unsigned char *destData,
+                     int width, int height, unsigned int begin, unsigned int end)
+{
+    const int blockSize = (kind == ETC2_RGBA_EAC) ? 16 : 8;
+    const int channels = (kind == ETC1_RGB || kind == ETC2_RGB) ? 3 : 4;
+    const int blockCountX = (width + 3) / 4;
+    unsigned char tile[MaxTileSize];
+
+    const unsigned char *src = srcData + begin * blockCountX * blockSize;
+    for (unsigned int j = begin; j < end; ++j)
+    {
+        for (int i = 0; i < blockCountX; ++i)
+        {
+            DecodeBlock(kind, src, tile);
+            StoreTile(tile, channels, destData, i * 4, j * 4, width, height);
+            src += blockSize;
+        }
     }
 }
 
@@ -194,7 +433,7 @@ bool SupportETC2Compression()
 
 bool SupportETC2Uncompression()
 {
-    return SupportETC1Compression();
+    return true;
 }
 
 bool IsETC1Compression(UInt32 format)
@@ -218,34 +457,90 @@ bool CanCompressAsETC2(UInt32 format, UInt32 type)
         type == GL_UNSIGNED_BYTE;
 }
 
-bool UncompressFromETC1(const Image &input, Image &output)
+bool PrepareETCUncompression(const Image &input, Image &output, BlockRowJob &job)
 {
     const UInt32 format = input.Format();
-    PAT_DEBUG_ASSERT(IsETC1Compression(format), "Unexpected format for ETC1 uncompress : %d\n", format);
-    if (IsETC1Compression(format) == false)
+    BlockKind kind = ETC1_RGB;
+    UInt32 outputFormat = GL_RGB;
+    switch (format)
+    {
+    case GL_ETC1_RGB8_OES:
+        kind = ETC1_RGB;
+        break;
+    case GL_COMPRESSED_RGB8_ETC2:
+    case GL_COMPRESSED_SRGB8_ETC2:
+        kind = ETC2_RGB;
+        break;
+    case GL_COMPRESSED_RGB8_PUNCHTHROUGH_ALPHA1_ETC2:
+    case GL_COMPRESSED_SRGB8_PUNCHTHROUGH_ALPHA1_ETC2:
+        kind = ETC2_RGB_A1;
+        outputFormat = GL_RGBA;
+        break;
+    case GL_COMPRESSED_RGBA8_ETC2_EAC:
+    case GL_COMPRESSED_SRGB8_ALPHA8_ETC2_EAC:
+        kind = ETC2_RGBA_EAC;
+        outputFormat = GL_RGBA;
+        break;
+    default:
+        PAT_DEBUG_LOG("Unexpected format for ETC uncompress : %d\n", format);
         return false;
+    }
 
     const unsigned int width = input.Width();
     const unsigned int height = input.Height();
-    const int blockCountX = (width + 3) / 4;
-    const int blockCountY = (height + 3) / 4;
+    const unsigned int blockCountX = (width + 3) / 4;
+    const unsigned int blockCountY = (height + 3) / 4;
+    const unsigned int blockSize = (kind == ETC2_RGBA_EAC) ? 16 : 8;
+    const unsigned int channels = (outputFormat == GL_RGB) ? 3 : 4;
     const unsigned char *srcData = input.Data();
     unsigned int destSize = 0;
     unsigned char *destData = NULL;
+    job = BlockRowJob();
     if (srcData)
     {
-        destSize = width * height * 3;
-        destData = new unsigned char[destSize];
-        for (int j = 0; j < blockCountY; ++j)
+        if (input.DataSize() < blockCountX * blockCountY * blockSize)
         {
-            for (int i = 0; i < blockCountX; ++i)
-            {
-                DecodeBlock(srcData, destData, i, j, width, height); 
-                srcData += 8;
-            }
+            PAT_DEBUG_LOG("Too little data for ETC uncompress : %d bytes for %dx%d\n", input.DataSize(), width, height);
+            return false;
         }
+
+        destSize = width * height * channels;
+        destData = new unsigned char[destSize];
+        job.rows = blockCountY;
+        job.blocksPerRow = blockCountX;
+        job.decode = [=](UInt32 begin, UInt32 end) {
+            DecodeBlockRows(kind, srcData, destData, width, height, begin, end);
+        };
     }
-    output.Set(width, height, GL_RGB, GL_UNSIGNED_BYTE, destSize, destData, false, true); 
+    output.Set(width, height, outputFormat, GL_UNSIGNED_BYTE, destSize, destData, false, true);
+    return true;
+}
+
+bool UncompressFromETC1(const Image &input, Image &output)
+{
+    const UInt32 format = input.Format();
+    PAT_DEBUG_ASSERT(IsETC1Compression(format), "Unexpected format for ETC1 uncompress : %d\n", format);
+    if (IsETC1Compression(format) == false)
+        return false;
+
+    std::vector<BlockRowJob> jobs(1);
+    if (PrepareETCUncompression(input, output, jobs[0]) == false)
+        return false;
+    RunBlockRowJobs(jobs);
+    return true;
+}
+
+bool UncompressFromETC2(const Image &input, Image &output)
+{
+    const UInt32 format = input.Format();
+    PAT_DEBUG_ASSERT(IsETC2Compression(format), "Unexpected format for ETC2 uncompress : %d\n", format);
+    if (IsETC2Compression(format) == false)
+        return false;
+
+    std::vector<BlockRowJob> jobs(1);
+    if (PrepareETCUncompression(input, output, jobs[0]) == false)
+        return false;
+    RunBlockRowJobs(jobs);
     return true;
 }
 
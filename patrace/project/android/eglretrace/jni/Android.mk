@@ -157,12 +157,17 @@ LOCAL_SRC_FILES     := \
     common/in_file_ra.cpp \
     common/in_file.cpp \
     common/out_file.cpp \
+    common/trace_chunk.cpp \
+    common/read_ahead.cpp \
+    common/timeline.cpp \
+    common/results_file.cpp \
     common/memoryinfo.cpp \
     common/call_parser.cpp \
     common/image.cpp \
     common/image_bmp.cpp \
     common/image_png.cpp \
     common/image_pnm.cpp \
+    common/pixel_convert.cpp \
     common/base64.cpp \
     common/gl_extension_supported.cpp \
     common/library.cpp
@@ -222,9 +227,14 @@ LOCAL_SRC_FILES     := \
     ../../thirdparty/hwcpipe/vendor/arm/pmu/pmu_counter.cpp \
     ../../thirdparty/hwcpipe/vendor/arm/pmu/pmu_profiler.cpp \
     dispatch/eglproc_retrace.cpp \
+    dispatch/eglproc_null.cpp \
+    dispatch/eglproc_null_auto.cpp \
     dispatch/eglproc_auto.cpp \
     fastforwarder/fastforwarder.cpp \
     retracer/retracer.cpp \
+    retracer/call_samples.cpp \
+    retracer/footprint.cpp \
+    retracer/gpu_timer.cpp \
     retracer/retrace_api.cpp \
     retracer/retrace_gles_auto.cpp \
     retracer/afrc_enum.cpp \
@@ -254,6 +264,7 @@ LOCAL_SRC_FILES     := \
     ../../common/eglstate/common.cpp \
     tool/glsl_utils.cpp \
     tool/glsl_parser.cpp \
+    tool/glsl_cache.cpp \
     tool/glsl_lookup.cpp \
     specs/pa_func_to_version.cpp \
     ../project/android/eglretrace/jni/NativeAPI.cpp
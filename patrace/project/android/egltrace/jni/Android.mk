@@ -114,10 +114,14 @@ LOCAL_SRC_FILES     := \
     common/in_file_mt.cpp \
     common/in_file_ra.cpp \
     common/out_file.cpp \
+    common/trace_chunk.cpp \
+    common/read_ahead.cpp \
+    common/timeline.cpp \
     common/image.cpp \
     common/image_bmp.cpp \
     common/image_png.cpp \
     common/image_pnm.cpp \
+    common/pixel_convert.cpp \
     common/gl_extension_supported.cpp \
     common/library.cpp
 
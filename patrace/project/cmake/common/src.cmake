@@ -16,10 +16,16 @@ set(SRC_COMMON
     ${SRC_ROOT}/common/in_file_mt.cpp
     ${SRC_ROOT}/common/in_file_ra.cpp
     ${SRC_ROOT}/common/out_file.cpp
+    ${SRC_ROOT}/common/trace_chunk.cpp
+    ${SRC_ROOT}/common/trace_scan.cpp
+    ${SRC_ROOT}/common/read_ahead.cpp
+    ${SRC_ROOT}/common/results_file.cpp
+    ${SRC_ROOT}/common/timeline.cpp
     ${SRC_ROOT}/common/image.cpp
     ${SRC_ROOT}/common/image_png.cpp
     ${SRC_ROOT}/common/image_bmp.cpp
     ${SRC_ROOT}/common/image_pnm.cpp
+    ${SRC_ROOT}/common/pixel_convert.cpp
     ${SRC_ROOT}/common/base64.cpp
     ${SRC_ROOT}/common/library.cpp
     ${SRC_ROOT}/common/gl_extension_supported.cpp
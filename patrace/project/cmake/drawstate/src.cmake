@@ -15,8 +15,13 @@ set(SRC_MM
     ${SRC_ROOT}/dispatch/eglproc_auto.hpp
     ${SRC_ROOT}/dispatch/eglproc_auto.cpp
     ${SRC_ROOT}/dispatch/eglproc_retrace.cpp
+    ${SRC_ROOT}/dispatch/eglproc_null.cpp
+    ${SRC_ROOT}/dispatch/eglproc_null_auto.cpp
     ${SRC_ROOT}/drawstate/drawstate.cpp
     ${SRC_ROOT}/retracer/retracer.cpp
+    ${SRC_ROOT}/retracer/call_samples.cpp
+    ${SRC_ROOT}/retracer/footprint.cpp
+    ${SRC_ROOT}/retracer/gpu_timer.cpp
     ${SRC_ROOT}/retracer/retrace_api.cpp
     ${SRC_ROOT}/retracer/retrace_gles_auto.cpp
     ${SRC_ROOT}/retracer/afrc_enum.cpp
@@ -43,6 +48,7 @@ set_source_files_properties(
     ${SRC_ROOT}/common/call_parser.cpp
     ${SRC_ROOT}/dispatch/eglproc_auto.hpp
     ${SRC_ROOT}/dispatch/eglproc_auto.cpp
+    ${SRC_ROOT}/dispatch/eglproc_null_auto.cpp
     ${SRC_ROOT}/retracer/retrace_gles_auto.cpp
     PROPERTIES
         GENERATED True
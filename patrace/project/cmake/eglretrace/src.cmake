@@ -12,7 +12,12 @@ set(SRC_EGLRETRACE
     ${SRC_ROOT}/dispatch/eglproc_auto.hpp
     ${SRC_ROOT}/dispatch/eglproc_auto.cpp
     ${SRC_ROOT}/dispatch/eglproc_retrace.cpp
+    ${SRC_ROOT}/dispatch/eglproc_null.cpp
+    ${SRC_ROOT}/dispatch/eglproc_null_auto.cpp
     ${SRC_ROOT}/retracer/retracer.cpp
+    ${SRC_ROOT}/retracer/call_samples.cpp
+    ${SRC_ROOT}/retracer/footprint.cpp
+    ${SRC_ROOT}/retracer/gpu_timer.cpp
     ${SRC_ROOT}/retracer/retrace_api.cpp
     ${SRC_ROOT}/retracer/retrace_gles_auto.cpp
     ${SRC_ROOT}/retracer/retrace_egl.cpp
@@ -38,6 +43,7 @@ set(SRC_EGLRETRACE
 set_source_files_properties (
     ${SRC_ROOT}/dispatch/eglproc_auto.hpp
     ${SRC_ROOT}/dispatch/eglproc_auto.cpp
+    ${SRC_ROOT}/dispatch/eglproc_null_auto.cpp
     ${SRC_ROOT}/retracer/retrace_gles_auto.cpp
     PROPERTIES
         GENERATED True
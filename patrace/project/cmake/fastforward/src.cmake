@@ -31,8 +31,13 @@ set(SRC_FASTFORWARD
     ${SRC_ROOT}/dispatch/eglproc_auto.hpp
     ${SRC_ROOT}/dispatch/eglproc_auto.cpp
     ${SRC_ROOT}/dispatch/eglproc_retrace.cpp
+    ${SRC_ROOT}/dispatch/eglproc_null.cpp
+    ${SRC_ROOT}/dispatch/eglproc_null_auto.cpp
     ${SRC_ROOT}/fastforwarder/fastforwarder.cpp
     ${SRC_ROOT}/retracer/retracer.cpp
+    ${SRC_ROOT}/retracer/call_samples.cpp
+    ${SRC_ROOT}/retracer/footprint.cpp
+    ${SRC_ROOT}/retracer/gpu_timer.cpp
     ${SRC_ROOT}/retracer/afrc_enum.cpp
     ${SRC_ROOT}/retracer/retrace_api.cpp
     ${SRC_ROOT}/retracer/retrace_gles_auto.cpp
@@ -60,6 +65,7 @@ set(SRC_FASTFORWARD
     ${SRC_ROOT}/common/call_parser.cpp
     ${SRC_ROOT}/tool/glsl_utils.cpp
     ${SRC_ROOT}/tool/glsl_parser.cpp
+    ${SRC_ROOT}/tool/glsl_cache.cpp
     ${SRC_ROOT}/tool/glsl_lookup.cpp
     ${SRC_ROOT}/specs/pa_func_to_version.cpp
 )
@@ -67,6 +73,7 @@ set(SRC_FASTFORWARD
 set_source_files_properties(
     ${SRC_ROOT}/dispatch/eglproc_auto.hpp
     ${SRC_ROOT}/dispatch/eglproc_auto.cpp
+    ${SRC_ROOT}/dispatch/eglproc_null_auto.cpp
     ${SRC_ROOT}/retracer/retrace_gles_auto.cpp
     ${SRC_ROOT}/specs/pa_func_to_version.cpp
     PROPERTIES
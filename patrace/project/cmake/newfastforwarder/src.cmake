@@ -12,6 +12,8 @@ set(SRC_NEWFASTFORWARDER
     ${SRC_ROOT}/dispatch/eglproc_auto.hpp
     ${SRC_ROOT}/dispatch/eglproc_auto.cpp
     ${SRC_ROOT}/dispatch/eglproc_retrace.cpp
+    ${SRC_ROOT}/dispatch/eglproc_null.cpp
+    ${SRC_ROOT}/dispatch/eglproc_null_auto.cpp
     ${SRC_ROOT}/newfastforwarder/newfastforwad.cpp
     ${SRC_ROOT}/newfastforwarder/parser.cpp
 #    ${SRC_ROOT}/newfastforwarder/retrace_api.cpp
@@ -25,6 +27,7 @@ set(SRC_NEWFASTFORWARDER
 set_source_files_properties (
     ${SRC_ROOT}/dispatch/eglproc_auto.hpp
     ${SRC_ROOT}/dispatch/eglproc_auto.cpp
+    ${SRC_ROOT}/dispatch/eglproc_null_auto.cpp
     ${SRC_ROOT}/newfastforwarder/parse_gles.cpp
     PROPERTIES
         GENERATED True
@@ -8,4 +8,27 @@ set(SRC_UNITTEST
     ${SRC_UNITTEST_DIR}/context_test.cpp
     ${SRC_UNITTEST_DIR}/system_test.cpp
     ${SRC_UNITTEST_DIR}/image_test.cpp
+    ${SRC_UNITTEST_DIR}/results_file_test.cpp
+    ${SRC_UNITTEST_DIR}/callset_test.cpp
+    ${SRC_UNITTEST_DIR}/trace_chunk_test.cpp
+    ${SRC_UNITTEST_DIR}/out_file_test.cpp
+    ${SRC_UNITTEST_DIR}/read_ahead_test.cpp
+    ${SRC_UNITTEST_DIR}/trace_scan_test.cpp
+)
+
+# Tool sources under test, built like the tools themselves
+set(SRC_UNITTEST_TOOL
+    ${SRC_UNITTEST_DIR}/dedup_state_test.cpp
+    ${SRC_ROOT}/tool/dedup_state.cpp
+    ${SRC_ROOT}/tool/parse_interface.cpp
+    ${SRC_ROOT}/tool/glsl_parser.cpp
+    ${SRC_ROOT}/tool/glsl_cache.cpp
+    ${SRC_ROOT}/tool/glsl_lookup.cpp
+    ${SRC_ROOT}/tool/glsl_utils.cpp
+    ${SRC_ROOT}/tool/trace_interface.cpp
+    ${SRC_ROOT}/tool/utils.cpp
+    ${SRC_ROOT}/common/analysis_utility.cpp
+    ${SRC_ROOT}/common/call_parser.cpp
+    ${SRC_ROOT}/common/trace_model.cpp
+    ${SRC_ROOT}/specs/pa_func_to_version.cpp
 )
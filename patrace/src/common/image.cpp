@@ -38,17 +38,8 @@ namespace image {
 
 void Image::writePixelData(const char* filename)
 {
-    std::ofstream file;
-    file.open(filename);
-    int total_bytes = width * height * channels;
-
-    unsigned char* pixel_ptr = pixels;
-    for (int i = 0; i < total_bytes; i++)
-    {
-        file << *pixel_ptr;
-        pixel_ptr++;
-    }
-
+    std::ofstream file(filename, std::ofstream::binary);
+    file.write((const char *)pixels, width * height * channels);
     file.close();
 }
 
@@ -29,6 +29,7 @@
 #include <stdint.h>
 
 #include "image.hpp"
+#include "pixel_convert.hpp"
 
 
 namespace image {
@@ -58,21 +59,13 @@ struct InfoHeader {
     uint32_t biClrImportant;
 };
 
-struct Pixel {
-    uint8_t rgbBlue;
-    uint8_t rgbGreen;
-    uint8_t rgbRed;
-    uint8_t rgbAlpha;
-};
-
-
 bool
 Image::writeBMP(const char *filename) const {
     assert(channels == 4);
 
     struct FileHeader bmfh;
     struct InfoHeader bmih;
-    unsigned x, y;
+    unsigned y;
 
     bmfh.bfType = 0x4d42;
     bmfh.bfSize = 14 + 40 + height*width*4;
@@ -102,34 +95,17 @@ Image::writeBMP(const char *filename) const {
     stream.write((const char *)&bmih, 40);
 
     unsigned stride = width*4;
+    unsigned char *row = new unsigned char[stride];
 
-    if (flipped) {
-        for (y = 0; y < height; ++y) {
-            const unsigned char *ptr = pixels + y * stride;
-            for (x = 0; x < width; ++x) {
-                struct Pixel pixel;
-                pixel.rgbRed   = ptr[x*4 + 0];
-                pixel.rgbGreen = ptr[x*4 + 1];
-                pixel.rgbBlue  = ptr[x*4 + 2];
-                pixel.rgbAlpha = ptr[x*4 + 3];
-                stream.write((const char *)&pixel, 4);
-            }
-        }
-    } else {
-        y = height;
-        while (y--) {
-            const unsigned char *ptr = pixels + y * stride;
-            for (x = 0; x < width; ++x) {
-                struct Pixel pixel;
-                pixel.rgbRed   = ptr[x*4 + 0];
-                pixel.rgbGreen = ptr[x*4 + 1];
-                pixel.rgbBlue  = ptr[x*4 + 2];
-                pixel.rgbAlpha = ptr[x*4 + 3];
-                stream.write((const char *)&pixel, 4);
-            }
-        }
+    // BMP rows are stored bottom-up
+    for (y = 0; y < height; ++y) {
+        const unsigned char *ptr = pixels + (flipped ? y : height - 1 - y) * stride;
+        swapRedBlue(ptr, row, width);
+        stream.write((const char *)row, stride);
     }
 
+    delete [] row;
+
     stream.close();
 
     return true;
@@ -198,11 +198,55 @@ void InFileBase::setFrameRange(unsigned startFrame, unsigned endFrame, int tid,
     mBeginFrame = startFrame;
     mEndFrame = endFrame;
     mTraceTid = tid;
+}
+
+void InFileBase::lookupFrameFuncs()
+{
     eglSwapBuffers_id = NameToExId("eglSwapBuffers");
     eglSwapBuffersWithDamageKHR_id = NameToExId("eglSwapBuffersWithDamageKHR");
-    eglSwapBuffersWithDamageEXT_id = NameToExId("eglSwapBuffersWithDamageKHR");
+    eglSwapBuffersWithDamageEXT_id = NameToExId("eglSwapBuffersWithDamageEXT");
     eglCreatePbufferSurface_id = NameToExId("eglCreatePbufferSurface");
     eglDestroySurface_id = NameToExId("eglDestroySurface");
 }
 
+InFileBase::FrameEvent InFileBase::getFrameEvent(const BCall& call, char* src)
+{
+    FrameEvent event;
+    event.tid = call.tid;
+    if (call.funcId == eglSwapBuffers_id || call.funcId == eglSwapBuffersWithDamageKHR_id || call.funcId == eglSwapBuffersWithDamageEXT_id)
+    {
+        event.type = FrameEvent::SWAP;
+        event.surface = getDpySurface(src);
+    }
+    else if (call.funcId == eglCreatePbufferSurface_id)
+    {
+        event.type = FrameEvent::CREATE_PBUFFER;
+        event.surface = getCreatePbufferSurfaceRet(src);
+    }
+    else if (call.funcId == eglDestroySurface_id)
+    {
+        event.type = FrameEvent::DESTROY_SURFACE;
+        event.surface = getDpySurface(src);
+    }
+    return event;
+}
+
+bool InFileBase::isFrameEnd(const FrameEvent& event, int tid, std::set<int>& pbuffers)
+{
+    switch (event.type)
+    {
+    case FrameEvent::SWAP:
+        return ((int)event.tid == tid || tid == -1) && pbuffers.count(event.surface) == 0;
+    case FrameEvent::CREATE_PBUFFER:
+        pbuffers.insert(event.surface);
+        break;
+    case FrameEvent::DESTROY_SURFACE:
+        pbuffers.erase(event.surface);
+        break;
+    case FrameEvent::NONE:
+        break;
+    }
+    return false;
+}
+
 } // namespace common
@@ -2,6 +2,7 @@
 #define _IN_FILE_HPP_
 
 #include <fstream>
+#include <set>
 #include <string>
 #include <vector>
 
@@ -60,6 +61,22 @@ public:
 
     void setFrameRange(unsigned startFrame, unsigned endFrame, int tid, bool preload, bool keep_all = false);
 
+    /// What a call means for counting frames: a swap, or a pbuffer surface
+    /// being created or a surface destroyed
+    struct FrameEvent
+    {
+        enum Type { NONE, SWAP, CREATE_PBUFFER, DESTROY_SURFACE };
+        Type type = NONE;
+        int surface = 0;
+        unsigned tid = 0;
+    };
+    /// Read the frame event of the call, with src pointing to its arguments
+    FrameEvent getFrameEvent(const BCall& call, char* src);
+    /// Whether the event ends a frame: a swap on the thread, or on any thread
+    /// for -1, unless it is on a pbuffer surface. Every event must be passed
+    /// in trace order, so that pbuffers can keep track of those surfaces.
+    static bool isFrameEnd(const FrameEvent& event, int tid, std::set<int>& pbuffers);
+
     inline int getMaxSigId() const { return mMaxSigId; }
     inline const std::vector<std::string>& getFuncNames() const { return mExIdToName; }
 
@@ -68,6 +85,7 @@ protected:
     bool parseHeader(BHeaderV2 hdrV2, Json::Value &value);
     bool parseHeader(BHeaderV3 hdrV3, Json::Value &value);
     bool checkJsonMembers(Json::Value &root);
+    void lookupFrameFuncs();
 
     bool                mIsOpen = false;
     bool                mMultithread = false;
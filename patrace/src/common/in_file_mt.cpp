@@ -1,6 +1,7 @@
 #include <common/in_file_mt.hpp>
 #include <common/memoryinfo.hpp>
 #include <common/trace_limits.hpp>
+#include <common/timeline.hpp>
 
 #include "json/writer.h"
 #include "json/reader.h"
@@ -21,6 +22,15 @@ void InFile::rollback()
         DBG_LOG("No checkpoint set - not able to rollback!\n");
         abort();
     }
+    if (mRecording || mPredecoded.size())
+    {
+        // Replay from the record; the file position stays at the end of the
+        // range, where reading resumes once the record is used up.
+        mRecording = false;
+        mPredecodedPos = 0;
+        mFrameNo = mBeginFrame;
+        return;
+    }
     mPreloadedChunks.push_front(mCurrentChunk);
     while (mFreeChunks.size())
     {
@@ -35,32 +45,113 @@ void InFile::rollback()
     mChunkEnd = mCurrentChunk->data() + mCurrentChunk->size();
 }
 
-// Read another uncompressed memory chunk from the memory mapped file
+// Read another uncompressed memory chunk from the memory mapped file, or
+// from the read-ahead buffers
 bool InFile::readChunk(std::vector<char> *buf)
 {
-    if (mCompressedRemaining < 4) { return false; }
-    size_t compressedLength = *(unsigned*)mCompressedSource;
-    mCompressedRemaining -= 4;
-    mCompressedSource += 4;
-    if ((int64_t)compressedLength <= mCompressedRemaining)
-    {
-        size_t uncompressedLength = 0;
-        if (!snappy::GetUncompressedLength(mCompressedSource, compressedLength, &uncompressedLength))
+    const char *src = mCompressedSource;
+    size_t remaining = mCompressedRemaining;
+    long long offset = mCompressedSource - mCompressedBuffer;
+    if (mReadAhead)
+    {
+        // Gather the chunk, which may span several buffers
+        mStreamedChunk.resize(4);
+        size_t size = mReadAhead->Read(mStreamedChunk.data(), 4);
+        unsigned word;
+        memcpy(&word, mStreamedChunk.data(), sizeof(word));
+        if (size == 4 && word != 0)
         {
-            DBG_LOG("Failed to parse chunk of size %u - file is corrupt - aborting!\n", (unsigned)compressedLength);
-            abort();
+            const size_t rest = (word & ~CHUNK_CHECKSUM_FLAG) + ((word & CHUNK_CHECKSUM_FLAG) ? CHUNK_CHECKSUM_SIZE : 0);
+            // A damaged length must not make us allocate more than the file
+            // holds; parseChunk() reports the chunk as truncated then.
+            if ((long long)rest <= mCompressedSize - mStreamOffset - 4)
+            {
+                mStreamedChunk.resize(4 + rest);
+                size += mReadAhead->Read(mStreamedChunk.data() + 4, rest);
+            }
         }
-        buf->resize(uncompressedLength);
-        if (!snappy::RawUncompress(mCompressedSource, compressedLength, buf->data()))
+        if (mReadAhead->error() && size < mStreamedChunk.size())
         {
-            DBG_LOG("Failed to decompress chunk of size %u - file is corrupt - aborting!\n", (unsigned)compressedLength);
+            DBG_LOG("Failed to read chunk at offset %lld: %s - %s!\n", mStreamOffset, strerror(mReadAhead->error()), mSalvage ? "stopping here" : "aborting");
+            if (mSalvage) return false;
             abort();
         }
-        mCompressedSource += compressedLength;
-        mCompressedRemaining -= compressedLength;
+        src = mStreamedChunk.data();
+        remaining = size;
+        offset = mStreamOffset;
+    }
+
+    ChunkRef chunk;
+    const ChunkStatus status = parseChunk(src, remaining, chunk, mVerifyChecksums);
+    if (status == CHUNK_END)
+    {
+        return false;
+    }
+    if (status == CHUNK_TRUNCATED)
+    {
+        DBG_LOG("Chunk at offset %lld is truncated - ignoring the rest of the file\n", offset);
+        return false;
+    }
+    if (status != CHUNK_OK)
+    {
+        DBG_LOG("Chunk at offset %lld has a %s - file is corrupt - %s!\n", offset, chunkStatusName(status), mSalvage ? "stopping here" : "aborting");
+        if (mSalvage) return false;
+        abort();
+    }
+
+    size_t uncompressedLength = 0;
+    if (!snappy::GetUncompressedLength(chunk.data, chunk.length, &uncompressedLength))
+    {
+        DBG_LOG("Failed to parse chunk of size %u - file is corrupt - %s!\n", (unsigned)chunk.length, mSalvage ? "stopping here" : "aborting");
+        if (mSalvage) return false;
+        abort();
+    }
+    buf->resize(uncompressedLength);
+    if (!snappy::RawUncompress(chunk.data, chunk.length, buf->data()))
+    {
+        DBG_LOG("Failed to decompress chunk of size %u - file is corrupt - %s!\n", (unsigned)chunk.length, mSalvage ? "stopping here" : "aborting");
+        if (mSalvage) return false;
+        abort();
+    }
+    if (mReadAhead)
+    {
+        mStreamOffset += chunk.frameLength;
         return true;
     }
-    return false;
+    mCompressedSource += chunk.frameLength;
+    mCompressedRemaining -= chunk.frameLength;
+    return true;
+}
+
+// Read just the file header and the JSON area into mHeaderBuffer, and point
+// mCompressedBuffer at it, as if the start of the file was mapped.
+bool InFile::readHeaderBytes()
+{
+    mHeaderBuffer.resize(std::max(sizeof(BHeaderV2), sizeof(BHeaderV3)));
+    ssize_t size = pread(mFd, mHeaderBuffer.data(), mHeaderBuffer.size(), 0);
+    if (size < (ssize_t)sizeof(BHeaderV3))
+    {
+        DBG_LOG("Failed to read the header of %s\n", mFileName.c_str());
+        return false;
+    }
+    const BHeaderV3 *hdr = (const BHeaderV3*)mHeaderBuffer.data();
+    if (hdr->magicNo == 0x20122012 && (hdr->version == HEADER_VERSION_3 || hdr->version == HEADER_VERSION_4))
+    {
+        if (hdr->jsonFileEnd < (long long)sizeof(BHeaderV3) || hdr->jsonFileEnd > mCompressedSize)
+        {
+            DBG_LOG("Error: %s has an invalid header!\n", mFileName.c_str());
+            return false;
+        }
+        const size_t headerSize = hdr->jsonFileEnd;
+        mHeaderBuffer.resize(headerSize);
+        if (pread(mFd, mHeaderBuffer.data(), headerSize, 0) != (ssize_t)headerSize)
+        {
+            DBG_LOG("Failed to read the header of %s\n", mFileName.c_str());
+            return false;
+        }
+    }
+    mCompressedBuffer = mHeaderBuffer.data();
+    return true;
 }
 
 bool InFile::Open(const char* name, bool readHeaderAndExit)
@@ -83,14 +174,26 @@ bool InFile::Open(const char* name, bool readHeaderAndExit)
         return false;
     }
     mCompressedSize = mCompressedRemaining = sb.st_size;
-    mCompressedBuffer = (char*)mmap(nullptr, sb.st_size, PROT_READ, MAP_PRIVATE, mFd, 0);
-    if (mCompressedBuffer == MAP_FAILED)
+    if (mUseReadAhead)
     {
-        DBG_LOG("Failed to mmap %s: %s\n", mFileName.c_str(), strerror(errno));
-        close(mFd);
-        return false;
+        // Only read the header here; the chunks are streamed after it
+        if (!readHeaderBytes())
+        {
+            close(mFd);
+            return false;
+        }
+    }
+    else
+    {
+        mCompressedBuffer = (char*)mmap(nullptr, sb.st_size, PROT_READ, MAP_PRIVATE, mFd, 0);
+        if (mCompressedBuffer == MAP_FAILED)
+        {
+            DBG_LOG("Failed to mmap %s: %s\n", mFileName.c_str(), strerror(errno));
+            close(mFd);
+            return false;
+        }
+        madvise(mCompressedBuffer, sb.st_size, MADV_SEQUENTIAL);
     }
-    madvise(mCompressedBuffer, sb.st_size, MADV_SEQUENTIAL);
 
     // Read Base Header that is common for all header versions
     common::BHeader* header = (common::BHeader*)mCompressedBuffer;
@@ -141,7 +244,18 @@ bool InFile::Open(const char* name, bool readHeaderAndExit)
         return true;
     }
 
+    if (mUseReadAhead)
+    {
+        mStreamOffset = mCompressedSource - mCompressedBuffer;
+        mReadAhead.reset(new ReadAhead);
+        if (!mReadAhead->Open(mFileName.c_str(), mStreamOffset, mDirectIO))
+        {
+            return false;
+        }
+    }
+
     // Read first chunk
+    mChunksBegin = mCompressedSource;
     mCurrentChunk = new std::vector<char>;
     mPrevChunk = new std::vector<char>;
     if (!readChunk(mCurrentChunk))
@@ -153,12 +267,15 @@ bool InFile::Open(const char* name, bool readHeaderAndExit)
     mChunkEnd = mCurrentChunk->data() + mCurrentChunk->size();
 
     ReadSigBook();
+    mFirstCallOffset = mPtr - mCurrentChunk->data();
     return true;
 }
 
 void InFile::PreloadFrames(int frames_to_read, int tid)
 {
+    TimelineScope scope("Preload frames", "io");
     int frames_read = 0;
+    std::set<int> pbuffers = mPbufferSurfaces; // as they will be when the calls read ahead are reached
     std::vector<char> *newchunk = new std::vector<char>;
     mCheckpointOffset = mPtr - mCurrentChunk->data();
     while (readChunk(newchunk) && frames_read < frames_to_read)
@@ -170,28 +287,12 @@ void InFile::PreloadFrames(int frames_to_read, int tid)
         while (ptr < newchunk->data() + newchunk->size())
         {
             const common::BCall& call = *(common::BCall*)ptr;
-            if (call.funcId == eglCreatePbufferSurface_id)
-            {
-                mPbufferSurfaces.insert(getCreatePbufferSurfaceRet(ptr + sizeof(common::BCall_vlen)));
-            }
-            if ((call.tid == tid || tid == -1) && (call.funcId == eglSwapBuffers_id || call.funcId == eglSwapBuffersWithDamageKHR_id || call.funcId == eglSwapBuffersWithDamageEXT_id))
+            const unsigned int callLen = mExIdToLen[call.funcId];
+            char *src = ptr + (callLen == 0 ? sizeof(common::BCall_vlen) : sizeof(common::BCall));
+            if (isFrameEnd(getFrameEvent(call, src), tid, pbuffers))
             {
-                char *src;
-                const unsigned callLen = mExIdToLen[call.funcId];
-                if (callLen == 0)
-                {
-                    src = ptr + sizeof(common::BCall_vlen);
-                }
-                else
-                {
-                    src = ptr + sizeof(common::BCall);
-                }
-                if (mPbufferSurfaces.count(getDpySurface(src))==0)
-                {
-                    frames_read++;
-                }
+                frames_read++;
             }
-            unsigned int callLen = mExIdToLen[call.funcId];
             if (callLen == 0)
             {
                 ptr += reinterpret_cast<common::BCall_vlen*>(ptr)->toNext;
@@ -210,6 +311,17 @@ bool InFile::GetNextCall(void*& fptr, common::BCall_vlen& call, char*& src)
 {
     if (mFrameNo >= mEndFrame) return false; // we're done!
 
+    if (mPredecodedPos < mPredecoded.size())
+    {
+        const PredecodedCall& c = mPredecoded[mPredecodedPos++];
+        fptr = c.fptr;
+        call = c.call;
+        mDataPtr = src = c.src;
+        mFrameNo += (int)c.newFrame;
+        curCallNo++;
+        return true;
+    }
+
     if (mPtr + sizeof(common::BCall) > mChunkEnd) // read more data?
     {
         if (mPreloadedChunks.size() > 0)
@@ -229,6 +341,7 @@ bool InFile::GetNextCall(void*& fptr, common::BCall_vlen& call, char*& src)
         }
         else
         {
+            TimelineScope scope("Decompress chunk", "io");
             if (!readChunk(mPrevChunk)) return false;
             std::swap(mPrevChunk, mCurrentChunk);
         }
@@ -262,28 +375,26 @@ bool InFile::GetNextCall(void*& fptr, common::BCall_vlen& call, char*& src)
     fptr = mExIdToFunc[call.funcId];
 
     // Count frames and check if we are done or need to start preloading
-    if ((tmp.tid == mTraceTid || mTraceTid == -1) && (tmp.funcId == eglSwapBuffers_id || call.funcId == eglSwapBuffersWithDamageKHR_id || call.funcId == eglSwapBuffersWithDamageEXT_id))
+    const bool record = mRecording;
+    bool newFrame = false;
+    if (isFrameEnd(getFrameEvent(tmp, src), mTraceTid, mPbufferSurfaces))
     {
-        if (mPbufferSurfaces.count(getDpySurface(src))==0)
+        mFrameNo++;
+        newFrame = true;
+        if (mFrameNo >= mBeginFrame && mPreload)
         {
-            mFrameNo++;
-            if (mFrameNo >= mBeginFrame && mPreload)
-            {
-                // The below count does not include frames still remaining to be read in the current chunk, so we might possibly
-                // be reading more chunks than we need here. Still room to optimize more.
-                PreloadFrames(mEndFrame - mBeginFrame, mTraceTid);
-            }
+            // The below count does not include frames still remaining to be read in the current chunk, so we might possibly
+            // be reading more chunks than we need here. Still room to optimize more.
+            PreloadFrames(mEndFrame - mBeginFrame, mTraceTid);
+            // Calls keep pointing into chunk memory, so only record if we keep it all
+            mRecording = mPredecode && mKeepAll;
         }
     }
 
-    if (tmp.funcId == eglCreatePbufferSurface_id)
+    if (record)
     {
-        mPbufferSurfaces.insert(getCreatePbufferSurfaceRet(src));
-    }
-
-    if (tmp.funcId == eglDestroySurface_id)
-    {
-        mPbufferSurfaces.erase(getDpySurface(src));
+        const PredecodedCall c = { fptr, src, call, newFrame };
+        mPredecoded.push_back(c);
     }
 
     curCallNo++;
@@ -293,7 +404,16 @@ bool InFile::GetNextCall(void*& fptr, common::BCall_vlen& call, char*& src)
 void InFile::Close()
 {
     if (!mIsOpen) return;
-    munmap(mCompressedBuffer, mCompressedSize);
+    if (mUseReadAhead)
+    {
+        mReadAhead.reset();
+        mHeaderBuffer.clear();
+        mStreamedChunk.clear();
+    }
+    else
+    {
+        munmap(mCompressedBuffer, mCompressedSize);
+    }
     close(mFd); mFd = 0;
     mIsOpen = false;
     mPreload = false;
@@ -301,6 +421,9 @@ void InFile::Close()
     for (auto* b : mFreeChunks) delete b;
     mPreloadedChunks.clear();
     mFreeChunks.clear();
+    mPredecoded.clear();
+    mPredecodedPos = 0;
+    mRecording = false;
     delete mCurrentChunk; mCurrentChunk = nullptr;
     delete mPrevChunk; mPrevChunk = nullptr;
     mExIdToName.clear();
@@ -358,6 +481,7 @@ void InFile::ReadSigBook()
         mExIdToLen[id] = gApiInfo.NameToLen(name);
         mExIdToFunc[id] = gApiInfo.NameToFptr(name);
     }
+    lookupFrameFuncs();
 }
 
 } // namespace
@@ -5,9 +5,12 @@
 #include <common/api_info.hpp>
 #include <common/os_time.hpp>
 #include <common/in_file.hpp>
+#include <common/trace_chunk.hpp>
+#include <common/read_ahead.hpp>
 
 #include <snappy.h>
 #include <deque>
+#include <memory>
 #include <set>
 
 namespace common {
@@ -24,6 +27,24 @@ public:
 
     void rollback();
 
+    /// Record the calls of the preloaded frame range as they are first read, and
+    /// serve them from this record after each rollback instead of parsing the
+    /// chunks again. Only used when looping, since it needs all chunks kept.
+    void setPredecode(bool enable) { mPredecode = enable; }
+
+    /// Compare chunk checksums, where the file has them, as chunks are read.
+    /// Must be set before Open().
+    void setVerifyChecksums(bool enable) { mVerifyChecksums = enable; }
+
+    /// Treat a truncated or damaged chunk as the end of the trace instead of
+    /// aborting, so that what was captured before a crash can be played.
+    void setSalvage(bool enable) { mSalvage = enable; }
+
+    /// Stream the chunks through a ReadAhead instead of memory mapping the
+    /// file, optionally with direct I/O. Must be set before Open().
+    void setReadAhead(bool enable, bool direct = false) { mUseReadAhead = enable; mDirectIO = direct; }
+    const ReadAhead* readAhead() const { return mReadAhead.get(); }
+
     long memoryUsed()
     {
         long s = 0;
@@ -31,15 +52,35 @@ public:
         if (mPrevChunk) s += mPrevChunk->size();
         for (const auto* c : mPreloadedChunks) s += c->size();
         for (const auto* c : mFreeChunks) s += c->size();
+        if (mReadAhead) s += mReadAhead->memoryUsed();
         return s;
     }
 
     int curCallNo = -1;
 
+    /// For tools that scan the whole file themselves: the compressed chunks
+    /// following the header, and the offset of the first call in the first
+    /// chunk once it is uncompressed, since the sig book comes before it.
+    /// Not available with setReadAhead().
+    const char* chunksBegin() const { return mChunksBegin; }
+    const char* chunksEnd() const { return mCompressedBuffer + mCompressedSize; }
+    size_t firstCallOffset() const { return mFirstCallOffset; }
+    int callLength(unsigned short id) const { return mExIdToLen[id]; }
+
 private:
     void ReadSigBook();
     void PreloadFrames(int frames_to_read, int tid);
     bool readChunk(std::vector<char> *buf);
+    bool readHeaderBytes();
+
+    /// Call header, data pointer and dispatch target of an already parsed call
+    struct PredecodedCall
+    {
+        void* fptr;
+        char* src;
+        common::BCall_vlen call;
+        bool newFrame;
+    };
 
     std::deque<std::vector<char>*> mPreloadedChunks;
     /// The free list is used for loop tracing.
@@ -60,8 +101,24 @@ private:
     int64_t mCompressedSize = 0;
     char *mCompressedBuffer = nullptr;
     char *mCompressedSource = nullptr;
+    char *mChunksBegin = nullptr;
+    size_t mFirstCallOffset = 0;
     int mFrameNo = 0;
     int mFd = 0;
+
+    bool mPredecode = false;
+    bool mVerifyChecksums = false;
+    bool mSalvage = false;
+
+    bool mUseReadAhead = false;
+    bool mDirectIO = false;
+    std::unique_ptr<ReadAhead> mReadAhead;
+    std::vector<char> mHeaderBuffer; // instead of the mapping when streaming
+    std::vector<char> mStreamedChunk;
+    long long mStreamOffset = 0;     // of the next chunk when streaming
+    bool mRecording = false;
+    std::vector<PredecodedCall> mPredecoded;
+    size_t mPredecodedPos = 0;
 };
 
 }
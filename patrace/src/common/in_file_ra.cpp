@@ -1,4 +1,5 @@
 #include <common/in_file_ra.hpp>
+#include <common/trace_chunk.hpp>
 #include <libgen.h> // basename()
 #include <sstream>
 
@@ -210,6 +211,12 @@ bool InFileRA::CreateRAFile(const char* name, const std::string& target)
     while ( !inStream.eof() )
     {
         unsigned int compressedLength = ReadCompressedLength(inStream);
+        if (compressedLength == 0)
+        {
+            break; // end of file, or of the chunks in an unfinalized mapped file
+        }
+        const bool hasChecksum = (compressedLength & CHUNK_CHECKSUM_FLAG) != 0;
+        compressedLength &= ~CHUNK_CHECKSUM_FLAG;
         size_t uncompressedLength = 0;
         if (compressedLength)
         {
@@ -222,6 +229,10 @@ bool InFileRA::CreateRAFile(const char* name, const std::string& target)
         }
 
         inStream.read(compressedCache, compressedLength);
+        if (hasChecksum)
+        {
+            inStream.ignore(CHUNK_CHECKSUM_SIZE);
+        }
         if (!snappy::GetUncompressedLength(compressedCache, (size_t)compressedLength, &uncompressedLength) && compressedLength > 0)
         {
             DBG_LOG("Failed to parse chunk of size %u - file corrupt - aborting!\n", compressedLength);
@@ -302,6 +313,7 @@ void InFileRA::ReadSigBook()
         mExIdToLen[id] = gApiInfo.NameToLen(name);
         mExIdToFunc[id] = gApiInfo.NameToFptr(name);
     }
+    lookupFrameFuncs();
 }
 
 void InFileRA::copySigBook(std::vector<std::string> &sigbook)
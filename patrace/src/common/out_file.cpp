@@ -1,6 +1,12 @@
 #include <common/out_file.hpp>
 
+#include <algorithm>
+#include <atomic>
 #include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include <common/os.hpp>
 #include <common/api_info.hpp>
 #include <common/pa_exception.h>
@@ -52,7 +58,8 @@ bool OutFile::Open(const char* name, bool writeSigBook, const std::vector<std::s
         mStream = nullptr;
     }
 
-    mStream = fopen(name, "wb");
+    // mmap needs the file to be readable as well
+    mStream = fopen(name, mMapped ? "w+b" : "wb");
     if (!mStream) {
         DBG_LOG("Failed to open file %s: %s\n", name, strerror(errno));
         return false;
@@ -76,6 +83,12 @@ bool OutFile::Open(const char* name, bool writeSigBook, const std::vector<std::s
         DBG_LOG("json file end wrong\n");
         mHeader.jsonFileEnd = jsonEnd; // is this more robust than calculating it beforehand, assuming all bytes we have is header+jsonMaxLength?
     }
+    if (mMapped)
+    {
+        fflush(mStream);
+        mMapOffset = mHeader.jsonFileEnd;
+        mMapPos = 0;
+    }
 
     CreateCache(SNAPPY_CHUNK_SIZE);
     if (writeSigBook)
@@ -95,6 +108,17 @@ void OutFile::Close()
         return;
 
     Flush();
+    if (mMapped && mMap)
+    {
+        // Cut off the unused part of the last segment
+        munmap(mMap, mMapSize);
+        mMap = nullptr;
+        mMapSize = 0;
+        if (ftruncate(fileno(mStream), mMapOffset + mMapPos) != 0)
+        {
+            DBG_LOG("Failed to truncate %s: %s\n", mFileName.c_str(), strerror(errno));
+        }
+    }
     fseek(mStream, 0, SEEK_SET);
     filewrite((char*)&mHeader, sizeof(BHeaderV3));
 
@@ -117,14 +141,130 @@ void OutFile::Flush()
     if (len == 0)
         return;
 
+    if (mMapped)
+    {
+        FlushMapped(len);
+        mCacheP = mCache;
+        return;
+    }
+
     size_t compressedLen;
     ::snappy::RawCompress(mCache, len, mCompressedCache, &compressedLen);
-    WriteCompressedLength((unsigned int)compressedLen);
-    filewrite(mCompressedCache, compressedLen);
+    if (mChunkChecksums)
+    {
+        WriteCompressedLength((unsigned int)compressedLen | CHUNK_CHECKSUM_FLAG);
+        filewrite(mCompressedCache, compressedLen);
+        WriteChecksum(xxHash64(mCompressedCache, compressedLen));
+    }
+    else
+    {
+        WriteCompressedLength((unsigned int)compressedLen);
+        filewrite(mCompressedCache, compressedLen);
+    }
     fflush(mStream);
     mCacheP = mCache;
 }
 
+void OutFile::FlushMapped(unsigned int len)
+{
+    const size_t maxFrameLen = 4 + snappy::MaxCompressedLength(len) + CHUNK_CHECKSUM_SIZE;
+    if (!mMap || mMapPos + maxFrameLen > mMapSize)
+        MapSegment(maxFrameLen);
+
+    // Compress straight into the file
+    char* frame = mMap + mMapPos;
+    size_t compressedLen;
+    ::snappy::RawCompress(mCache, len, frame + 4, &compressedLen);
+    unsigned int word = (unsigned int)compressedLen;
+    size_t frameLen = 4 + compressedLen;
+    if (mChunkChecksums)
+    {
+        unsigned long long sum = xxHash64(frame + 4, compressedLen);
+        for (unsigned i = 0; i < CHUNK_CHECKSUM_SIZE; i++, sum >>= 8)
+            frame[frameLen + i] = sum & 0xff;
+        word |= CHUNK_CHECKSUM_FLAG;
+        frameLen += CHUNK_CHECKSUM_SIZE;
+    }
+
+    // Publish the chunk. Until its length word is written, readers see zero
+    // there and take it as the end of the trace.
+    std::atomic_thread_fence(std::memory_order_release);
+    for (unsigned i = 0; i < 4; i++, word >>= 8)
+        frame[i] = word & 0xff;
+    mMapPos += frameLen;
+}
+
+void OutFile::MapSegment(size_t needed)
+{
+    const int fd = fileno(mStream);
+    const long long end = mMapOffset + mMapPos;
+    if (mMap)
+        munmap(mMap, mMapSize);
+    mMap = nullptr;
+
+    // Start at the page holding the end of the last chunk
+    const long long page = sysconf(_SC_PAGESIZE);
+    mMapOffset = end - end % page;
+    mMapPos = end - mMapOffset;
+    mMapSize = std::max<size_t>(MAPPED_SEGMENT_SIZE, mMapPos + needed);
+    mMapSize = (mMapSize + page - 1) / page * page;
+
+    // Allocate the blocks up front, so that running out of space fails here
+    // and not with a SIGBUS on a later write to the mapping.
+#ifdef __APPLE__
+    int err = ftruncate(fd, mMapOffset + mMapSize) ? errno : 0;
+#else
+    int err = posix_fallocate(fd, mMapOffset, mMapSize);
+#endif
+    if (err)
+    {
+        DBG_LOG("Failed to allocate %u bytes at %lld in %s: %s\n", (unsigned)mMapSize, mMapOffset, mFileName.c_str(), strerror(err));
+        os::abort();
+    }
+    mMap = (char*)mmap(nullptr, mMapSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, mMapOffset);
+    if (mMap == MAP_FAILED)
+    {
+        DBG_LOG("Failed to map %s: %s\n", mFileName.c_str(), strerror(errno));
+        os::abort();
+    }
+}
+
+bool OutFile::Finalize(const char* name)
+{
+    int fd = open(name, O_RDWR);
+    if (fd == -1)
+    {
+        DBG_LOG("Failed to open %s: %s\n", name, strerror(errno));
+        return false;
+    }
+    struct stat sb;
+    BHeaderV3 header;
+    if (fstat(fd, &sb) == -1 || pread(fd, &header, sizeof(header), 0) != (ssize_t)sizeof(header)
+        || header.magicNo != 0x20122012 || header.version < HEADER_VERSION_3)
+    {
+        DBG_LOG("%s is not a trace file that can be finalized\n", name);
+        close(fd);
+        return false;
+    }
+
+    // Walk the chunk lengths up to the first zero one, which is where the
+    // writer stopped
+    long long pos = header.jsonFileEnd;
+    unsigned int word = 0;
+    while (pos + 4 <= (long long)sb.st_size && pread(fd, &word, sizeof(word), pos) == (ssize_t)sizeof(word) && word != 0)
+    {
+        pos += 4 + (word & ~CHUNK_CHECKSUM_FLAG) + ((word & CHUNK_CHECKSUM_FLAG) ? CHUNK_CHECKSUM_SIZE : 0);
+    }
+    bool ok = true;
+    if (word == 0 && pos < (long long)sb.st_size)
+    {
+        DBG_LOG("Cutting %lld unused bytes off %s\n", (long long)sb.st_size - pos, name);
+        ok = ftruncate(fd, pos) == 0;
+    }
+    close(fd);
+    return ok;
+}
+
 void OutFile::FlushHeader()
 {
     long curP = ftell(mStream);
@@ -7,10 +7,12 @@
 
 #include <common/file_format.hpp>
 #include <common/os_string.hpp>
+#include <common/trace_chunk.hpp>
 
 namespace common {
 
 #define SNAPPY_CHUNK_SIZE (1*1024*1024)
+#define MAPPED_SEGMENT_SIZE (64*1024*1024)
 
 class OutFile {
 public:
@@ -23,6 +25,22 @@ public:
     void Flush();
     void WriteHeader(const char* buf, unsigned int len, bool verbose = true);
 
+    /// Follow each chunk with a checksum of its compressed data, so that
+    /// damage can be detected and the intact part of a file recovered.
+    void setChunkChecksums(bool enable) { mChunkChecksums = enable; }
+
+    /// Write chunks into memory mapped, pre-allocated segments of the file
+    /// instead of through stdio. A chunk is published by writing its length
+    /// word last, and the rest of the segment stays zero, which readers take
+    /// as the end of the trace. What was written survives the app crashing
+    /// without any flushing; only a power loss can lose it. Must be set
+    /// before Open().
+    void setMapped(bool enable) { mMapped = enable; }
+
+    /// Cut the unused, pre-allocated end off a file written with setMapped()
+    /// whose writer never got to Close() it. Other files are left alone.
+    static bool Finalize(const char* name);
+
     inline void Write(const void* buf, unsigned int len) {
         if (len == 0 || !mIsOpen)
             return;
@@ -75,6 +93,13 @@ private:
         }
     }
 
+    void WriteChecksum(unsigned long long sum) {
+        unsigned char buf[CHUNK_CHECKSUM_SIZE];
+        for (unsigned i = 0; i < sizeof(buf); i++, sum >>= 8)
+            buf[i] = sum & 0xff;
+        filewrite((char*)buf, sizeof(buf));
+    }
+
     void WriteCompressedLength(unsigned int len) {
         unsigned char buf[4];
         buf[0] = len & 0xff; len >>= 8;
@@ -86,11 +111,23 @@ private:
 
     void FlushHeader();
 
+    void FlushMapped(unsigned int len);
+    void MapSegment(size_t needed);
+
     void WriteSigBook(const std::vector<std::string> *sigbook, bool write_timestamp = false);
 
     os::String AutogenTraceFileName();
 
     bool                mIsOpen;
+    bool                mChunkChecksums = false;
+    bool                mMapped = false;
+
+    // Current segment when mapped. mMapOffset is the file offset it starts
+    // at, mMapPos where the next chunk goes within it.
+    char*               mMap = nullptr;
+    size_t              mMapSize = 0;
+    long long           mMapOffset = 0;
+    size_t              mMapPos = 0;
     FILE*               mStream = nullptr;
 
     char*               mCache;
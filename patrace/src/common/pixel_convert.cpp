@@ -0,0 +1,288 @@
+#include "pixel_convert.hpp"
+
+#include <stdint.h>
+#include <string.h>
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define PIXEL_CONVERT_NEON
+#include <arm_neon.h>
+#elif defined(__SSE2__) || defined(_M_X64)
+#define PIXEL_CONVERT_SSE2
+#include <emmintrin.h>
+#endif
+
+
+namespace image {
+
+namespace {
+
+// BT.601 full range coefficients in 1.15 fixed point. Each row sums to
+// 32768 (luma) or 0 (chroma), so white and grey map exactly.
+const int Y_R = 9798, Y_G = 19235, Y_B = 3735;
+const int U_R = -5538, U_G = -10846, U_B = 16384;
+const int V_R = 16384, V_G = -13730, V_B = -2654;
+const int CHROMA_OFFSET = 128 << 15;
+
+inline unsigned char clampByte(int v)
+{
+    return v < 0 ? 0 : (v > 255 ? 255 : (unsigned char)v);
+}
+
+inline unsigned char luma(const unsigned char *p)
+{
+    return clampByte((Y_R * p[0] + Y_G * p[1] + Y_B * p[2]) >> 15);
+}
+
+inline unsigned char chromaU(const unsigned char *p)
+{
+    return clampByte((U_R * p[0] + U_G * p[1] + U_B * p[2] + CHROMA_OFFSET) >> 15);
+}
+
+inline unsigned char chromaV(const unsigned char *p)
+{
+    return clampByte((V_R * p[0] + V_G * p[1] + V_B * p[2] + CHROMA_OFFSET) >> 15);
+}
+
+#if defined(PIXEL_CONVERT_SSE2)
+
+// Weighted sum of R, G and B for 4 RGBA pixels, in 32-bit lanes
+inline __m128i dot4(__m128i px, int cr, int cg, int cb, int offset)
+{
+    const __m128i mask = _mm_set1_epi32(0x00FF00FF);
+    const __m128i rb = _mm_and_si128(px, mask);                      // r, b as 16-bit pairs
+    const __m128i ga = _mm_and_si128(_mm_srli_epi32(px, 8), mask);   // g, a as 16-bit pairs
+    const __m128i crb = _mm_set1_epi32((int)(((unsigned)cb << 16) | (cr & 0xFFFF)));
+    const __m128i cga = _mm_set1_epi32(cg & 0xFFFF);
+    const __m128i sum = _mm_add_epi32(_mm_madd_epi16(rb, crb), _mm_madd_epi16(ga, cga));
+    return _mm_srai_epi32(_mm_add_epi32(sum, _mm_set1_epi32(offset)), 15);
+}
+
+// 8 results from two dot4 results, saturated to bytes in the low half
+inline __m128i packBytes(__m128i lo, __m128i hi)
+{
+    const __m128i words = _mm_packs_epi32(lo, hi);
+    return _mm_packus_epi16(words, words);
+}
+
+// Pixels 0, 2, 4 and 6 of 8
+inline __m128i evenPixels(__m128i lo, __m128i hi)
+{
+    return _mm_unpacklo_epi64(_mm_shuffle_epi32(lo, _MM_SHUFFLE(2, 0, 2, 0)),
+                              _mm_shuffle_epi32(hi, _MM_SHUFFLE(2, 0, 2, 0)));
+}
+
+#elif defined(PIXEL_CONVERT_NEON)
+
+inline uint8x8_t dot8(uint8x8_t r, uint8x8_t g, uint8x8_t b, int16_t cr, int16_t cg, int16_t cb, int offset)
+{
+    const int16x8_t r16 = vreinterpretq_s16_u16(vmovl_u8(r));
+    const int16x8_t g16 = vreinterpretq_s16_u16(vmovl_u8(g));
+    const int16x8_t b16 = vreinterpretq_s16_u16(vmovl_u8(b));
+    const int32x4_t off = vdupq_n_s32(offset);
+
+    int32x4_t lo = vmlal_n_s16(off, vget_low_s16(r16), cr);
+    lo = vmlal_n_s16(lo, vget_low_s16(g16), cg);
+    lo = vmlal_n_s16(lo, vget_low_s16(b16), cb);
+    int32x4_t hi = vmlal_n_s16(off, vget_high_s16(r16), cr);
+    hi = vmlal_n_s16(hi, vget_high_s16(g16), cg);
+    hi = vmlal_n_s16(hi, vget_high_s16(b16), cb);
+
+    const int16x8_t words = vcombine_s16(vqmovn_s32(vshrq_n_s32(lo, 15)), vqmovn_s32(vshrq_n_s32(hi, 15)));
+    return vqmovun_s16(words);
+}
+
+// Lanes 0, 2, 4, ... 14 of 16
+inline uint8x8_t evenLanes(uint8x16_t v)
+{
+    return vget_low_u8(vuzpq_u8(v, v).val[0]);
+}
+
+#endif
+
+void lumaRow(const unsigned char *rgba, unsigned width, unsigned char *y)
+{
+    unsigned x = 0;
+#if defined(PIXEL_CONVERT_SSE2)
+    for (; x + 8 <= width; x += 8)
+    {
+        const __m128i p0 = _mm_loadu_si128((const __m128i *)(rgba + x * 4));
+        const __m128i p1 = _mm_loadu_si128((const __m128i *)(rgba + x * 4 + 16));
+        _mm_storel_epi64((__m128i *)(y + x), packBytes(dot4(p0, Y_R, Y_G, Y_B, 0), dot4(p1, Y_R, Y_G, Y_B, 0)));
+    }
+#elif defined(PIXEL_CONVERT_NEON)
+    for (; x + 16 <= width; x += 16)
+    {
+        const uint8x16x4_t p = vld4q_u8(rgba + x * 4);
+        const uint8x8_t lo = dot8(vget_low_u8(p.val[0]), vget_low_u8(p.val[1]), vget_low_u8(p.val[2]), Y_R, Y_G, Y_B, 0);
+        const uint8x8_t hi = dot8(vget_high_u8(p.val[0]), vget_high_u8(p.val[1]), vget_high_u8(p.val[2]), Y_R, Y_G, Y_B, 0);
+        vst1q_u8(y + x, vcombine_u8(lo, hi));
+    }
+#endif
+    for (; x < width; ++x)
+    {
+        y[x] = luma(rgba + x * 4);
+    }
+}
+
+// Chroma for the even pixels of one row
+void chromaRow(const unsigned char *rgba, unsigned width, unsigned char *u, unsigned char *v, unsigned step)
+{
+    unsigned x = 0;
+#if defined(PIXEL_CONVERT_SSE2)
+    const bool interleaved = step == 2 && (v == u + 1 || u == v + 1);
+    if (step == 1 || interleaved)
+    {
+        for (; x + 16 <= width; x += 16)
+        {
+            const __m128i *src = (const __m128i *)(rgba + x * 4);
+            const __m128i e0 = evenPixels(_mm_loadu_si128(src), _mm_loadu_si128(src + 1));
+            const __m128i e1 = evenPixels(_mm_loadu_si128(src + 2), _mm_loadu_si128(src + 3));
+            const __m128i u8 = packBytes(dot4(e0, U_R, U_G, U_B, CHROMA_OFFSET), dot4(e1, U_R, U_G, U_B, CHROMA_OFFSET));
+            const __m128i v8 = packBytes(dot4(e0, V_R, V_G, V_B, CHROMA_OFFSET), dot4(e1, V_R, V_G, V_B, CHROMA_OFFSET));
+            const unsigned c = x / 2;
+            if (step == 1)
+            {
+                _mm_storel_epi64((__m128i *)(u + c), u8);
+                _mm_storel_epi64((__m128i *)(v + c), v8);
+            }
+            else if (v == u + 1)
+            {
+                _mm_storeu_si128((__m128i *)(u + c * 2), _mm_unpacklo_epi8(u8, v8));
+            }
+            else
+            {
+                _mm_storeu_si128((__m128i *)(v + c * 2), _mm_unpacklo_epi8(v8, u8));
+            }
+        }
+    }
+#elif defined(PIXEL_CONVERT_NEON)
+    const bool interleaved = step == 2 && (v == u + 1 || u == v + 1);
+    if (step == 1 || interleaved)
+    {
+        for (; x + 16 <= width; x += 16)
+        {
+            const uint8x16x4_t p = vld4q_u8(rgba + x * 4);
+            const uint8x8_t r = evenLanes(p.val[0]);
+            const uint8x8_t g = evenLanes(p.val[1]);
+            const uint8x8_t b = evenLanes(p.val[2]);
+            uint8x8x2_t uv;
+            uv.val[0] = dot8(r, g, b, U_R, U_G, U_B, CHROMA_OFFSET);
+            uv.val[1] = dot8(r, g, b, V_R, V_G, V_B, CHROMA_OFFSET);
+            const unsigned c = x / 2;
+            if (step == 1)
+            {
+                vst1_u8(u + c, uv.val[0]);
+                vst1_u8(v + c, uv.val[1]);
+            }
+            else if (v == u + 1)
+            {
+                vst2_u8(u + c * 2, uv);
+            }
+            else
+            {
+                const uint8x8_t tmp = uv.val[0];
+                uv.val[0] = uv.val[1];
+                uv.val[1] = tmp;
+                vst2_u8(v + c * 2, uv);
+            }
+        }
+    }
+#endif
+    for (; x < width; x += 2)
+    {
+        const unsigned c = (x / 2) * step;
+        u[c] = chromaU(rgba + x * 4);
+        v[c] = chromaV(rgba + x * 4);
+    }
+}
+
+} // unnamed namespace
+
+void swapRedBlue(const unsigned char *src, unsigned char *dst, unsigned pixels)
+{
+    unsigned i = 0;
+#if defined(PIXEL_CONVERT_SSE2)
+    const __m128i ga = _mm_set1_epi32(0xFF00FF00);
+    const __m128i low = _mm_set1_epi32(0x000000FF);
+    for (; i + 4 <= pixels; i += 4)
+    {
+        const __m128i p = _mm_loadu_si128((const __m128i *)(src + i * 4));
+        const __m128i r = _mm_slli_epi32(_mm_and_si128(p, low), 16);
+        const __m128i b = _mm_and_si128(_mm_srli_epi32(p, 16), low);
+        _mm_storeu_si128((__m128i *)(dst + i * 4), _mm_or_si128(_mm_and_si128(p, ga), _mm_or_si128(r, b)));
+    }
+#elif defined(PIXEL_CONVERT_NEON)
+    for (; i + 16 <= pixels; i += 16)
+    {
+        uint8x16x4_t p = vld4q_u8(src + i * 4);
+        const uint8x16_t r = p.val[0];
+        p.val[0] = p.val[2];
+        p.val[2] = r;
+        vst4q_u8(dst + i * 4, p);
+    }
+#endif
+    for (; i < pixels; ++i)
+    {
+        const unsigned char r = src[i * 4];
+        dst[i * 4 + 0] = src[i * 4 + 2];
+        dst[i * 4 + 1] = src[i * 4 + 1];
+        dst[i * 4 + 2] = r;
+        dst[i * 4 + 3] = src[i * 4 + 3];
+    }
+}
+
+void rgbaToRgb(const unsigned char *src, unsigned char *dst, unsigned pixels)
+{
+    unsigned i = 0;
+#if defined(PIXEL_CONVERT_NEON)
+    for (; i + 16 <= pixels; i += 16)
+    {
+        const uint8x16x4_t p = vld4q_u8(src + i * 4);
+        uint8x16x3_t rgb;
+        rgb.val[0] = p.val[0];
+        rgb.val[1] = p.val[1];
+        rgb.val[2] = p.val[2];
+        vst3q_u8(dst + i * 3, rgb);
+    }
+#elif !defined(__BYTE_ORDER__) || __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    // Four pixels at a time as three dwords, which is much faster than
+    // going byte by byte
+    for (; i + 4 <= pixels; i += 4)
+    {
+        uint32_t p[4], q[3];
+        memcpy(p, src + i * 4, sizeof(p));
+        const uint32_t rgba0 = p[0] & 0xffffff;
+        const uint32_t rgba1 = p[1] & 0xffffff;
+        const uint32_t rgba2 = p[2] & 0xffffff;
+        const uint32_t rgba3 = p[3] & 0xffffff;
+        q[0] = rgba0 | (rgba1 << 24);
+        q[1] = (rgba1 >> 8) | (rgba2 << 16);
+        q[2] = (rgba2 >> 16) | (rgba3 << 8);
+        memcpy(dst + i * 3, q, sizeof(q));
+    }
+#endif
+    for (; i < pixels; ++i)
+    {
+        dst[i * 3 + 0] = src[i * 4 + 0];
+        dst[i * 3 + 1] = src[i * 4 + 1];
+        dst[i * 3 + 2] = src[i * 4 + 2];
+    }
+}
+
+void rgbaToYuv420(const unsigned char *rgba, unsigned width, unsigned height,
+                  unsigned char *y, unsigned yStride,
+                  unsigned char *u, unsigned char *v, unsigned chromaStride, unsigned chromaStep)
+{
+    for (unsigned row = 0; row < height; ++row)
+    {
+        const unsigned char *src = rgba + (size_t)row * width * 4;
+        lumaRow(src, width, y + (size_t)row * yStride);
+        if ((row & 0x1) == 0)
+        {
+            const size_t offset = (size_t)(row / 2) * chromaStride;
+            chromaRow(src, width, u + offset, v + offset, chromaStep);
+        }
+    }
+}
+
+} /* namespace image */
@@ -0,0 +1,33 @@
+#ifndef _COMMON_PIXEL_CONVERT_HPP_
+#define _COMMON_PIXEL_CONVERT_HPP_
+
+/*
+ * Pixel format conversion kernels for 8-bit images.
+ *
+ * SSE2 and NEON versions are used when the compiler targets them, with a
+ * plain C++ version otherwise. All versions give exactly the same results.
+ */
+
+namespace image {
+
+// RGBA <-> BGRA. src and dst may be the same buffer.
+void swapRedBlue(const unsigned char *src, unsigned char *dst, unsigned pixels);
+
+// RGBA -> RGB, dropping the alpha channel
+void rgbaToRgb(const unsigned char *src, unsigned char *dst, unsigned pixels);
+
+/*
+ * Tightly packed RGBA -> 8-bit YUV 4:2:0, BT.601 full range.
+ *
+ * Chroma is taken from the top-left pixel of each 2x2 block. For the
+ * semi-planar layouts (NV12, NV21) u and v point into the same plane, one
+ * byte apart, and chromaStep is 2; for the planar layouts (I420, YV12)
+ * they point to separate planes and chromaStep is 1.
+ */
+void rgbaToYuv420(const unsigned char *rgba, unsigned width, unsigned height,
+                  unsigned char *y, unsigned yStride,
+                  unsigned char *u, unsigned char *v, unsigned chromaStride, unsigned chromaStep);
+
+} /* namespace image */
+
+#endif
@@ -0,0 +1,195 @@
+#include <common/read_ahead.hpp>
+#include <common/os.hpp>
+#include <common/os_time.hpp>
+#include <common/timeline.hpp>
+
+#include <algorithm>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+namespace common {
+
+// Direct I/O needs offsets, sizes and buffers aligned to the logical block
+// size of the device, which is at most a page in practice
+static const size_t ALIGNMENT = 4096;
+
+ReadAhead::ReadAhead(size_t blockSize, unsigned blocks)
+    : mBlockSize((blockSize + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT)
+    , mBytesRead(0)
+    , mError(0)
+{
+    mBlocks.resize(std::max(2u, blocks));
+    for (Block& b : mBlocks)
+    {
+        void* data = nullptr;
+        if (posix_memalign(&data, ALIGNMENT, mBlockSize) != 0)
+        {
+            DBG_LOG("Failed to allocate read-ahead buffer of %u bytes\n", (unsigned)mBlockSize);
+            os::abort();
+        }
+        b.data = (char*)data;
+        b.size = 0;
+    }
+}
+
+ReadAhead::~ReadAhead()
+{
+    Close();
+    for (Block& b : mBlocks)
+    {
+        free(b.data);
+    }
+}
+
+bool ReadAhead::Open(const char* name, long long offset, bool direct)
+{
+    Close();
+
+#ifdef O_DIRECT
+    if (direct)
+    {
+        mFd = open(name, O_RDONLY | O_DIRECT);
+        if (mFd == -1)
+        {
+            DBG_LOG("Direct I/O not possible for %s (%s) - reading through the page cache\n", name, strerror(errno));
+        }
+    }
+#else
+    if (direct)
+    {
+        DBG_LOG("Direct I/O is not supported on this platform - reading through the page cache\n");
+    }
+#endif
+    if (mFd == -1)
+    {
+        mFd = open(name, O_RDONLY);
+    }
+    if (mFd == -1)
+    {
+        DBG_LOG("Failed to open %s: %s\n", name, strerror(errno));
+        return false;
+    }
+#ifndef __APPLE__
+    posix_fadvise(mFd, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+
+    // Start at an aligned offset and skip up to the one asked for
+    mFileOffset = offset - offset % ALIGNMENT;
+    mPos = offset - mFileOffset;
+    mHead = 0;
+    mFilled = 0;
+    mEof = false;
+    mStop = false;
+    mBytesRead = 0;
+    mError = 0;
+    mStallTime = 0;
+    mStalls = 0;
+    mThread = std::thread(&ReadAhead::Run, this);
+    return true;
+}
+
+void ReadAhead::Close()
+{
+    if (mFd == -1)
+    {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mStop = true;
+    }
+    mCond.notify_all();
+    mThread.join();
+    close(mFd);
+    mFd = -1;
+}
+
+void ReadAhead::Run()
+{
+    for (;;)
+    {
+        unsigned idx;
+        {
+            std::unique_lock<std::mutex> lock(mMutex);
+            mCond.wait(lock, [this]{ return mStop || mFilled < mBlocks.size(); });
+            if (mStop) return;
+            idx = (mHead + mFilled) % mBlocks.size();
+        }
+
+        // Fill the whole block unless the file ends
+        Block& b = mBlocks[idx];
+        size_t size = 0;
+        int err = 0;
+        while (size < mBlockSize)
+        {
+            const ssize_t r = pread(mFd, b.data + size, mBlockSize - size, mFileOffset + size);
+            if (r < 0 && errno == EINTR) continue;
+            if (r < 0)
+            {
+                // Not the end of the file, so the reader must not take it as one
+                err = errno;
+                DBG_LOG("Read-ahead failed at offset %lld: %s\n", mFileOffset + (long long)size, strerror(err));
+            }
+            if (r <= 0) break;
+            size += r;
+        }
+#ifndef __APPLE__
+        // We have our own copy now
+        posix_fadvise(mFd, mFileOffset, size, POSIX_FADV_DONTNEED);
+#endif
+        mFileOffset += size;
+        mBytesRead.fetch_add(size, std::memory_order_relaxed);
+
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            b.size = size;
+            mFilled++;
+            mEof = size < mBlockSize;
+            mError = err;
+        }
+        mCond.notify_all();
+        if (size < mBlockSize) return;
+    }
+}
+
+size_t ReadAhead::Read(void* dst, size_t len)
+{
+    size_t done = 0;
+    std::unique_lock<std::mutex> lock(mMutex);
+    while (done < len)
+    {
+        if (mFilled == 0)
+        {
+            if (mEof || mFd == -1) break;
+            const long long begin = os::getTime();
+            mCond.wait(lock, [this]{ return mFilled > 0 || mEof; });
+            const long long end = os::getTime();
+            mStallTime += end - begin;
+            mStalls++;
+            if (Timeline::instance().IsEnabled()) Timeline::instance().Complete("Read-ahead stall", "io", begin, end);
+            continue;
+        }
+
+        // The thread does not touch filled blocks, so copy without the lock
+        const Block& b = mBlocks[mHead];
+        lock.unlock();
+        const size_t n = std::min(len - done, b.size > mPos ? b.size - mPos : 0);
+        memcpy((char*)dst + done, b.data + mPos, n);
+        mPos += n;
+        done += n;
+        lock.lock();
+        if (mPos >= b.size)
+        {
+            mHead = (mHead + 1) % mBlocks.size();
+            mFilled--;
+            mPos = 0;
+            mCond.notify_all();
+        }
+    }
+    return done;
+}
+
+}
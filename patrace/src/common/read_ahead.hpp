@@ -0,0 +1,75 @@
+#ifndef _COMMON_READ_AHEAD_HPP_
+#define _COMMON_READ_AHEAD_HPP_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace common {
+
+// Sequential file reader that keeps a bounded ring of large, page aligned
+// buffers filled ahead of the consumer from a background thread, so that
+// the consumer only waits if the file system cannot keep up, instead of
+// taking a page fault whenever it crosses into a new page of a mapping.
+// Data that has been read is dropped from the page cache again, or with
+// direct I/O never enters it.
+class ReadAhead
+{
+public:
+    ReadAhead(size_t blockSize = 4 * 1024 * 1024, unsigned blocks = 8);
+    ~ReadAhead();
+
+    // Start reading name from offset. If direct is set, the page cache is
+    // bypassed with O_DIRECT where the platform and file system allow it.
+    bool Open(const char* name, long long offset, bool direct);
+    void Close();
+
+    // Copy the next len bytes of the file to dst, waiting for them if
+    // needed. Returns fewer than len bytes only at the end of the file, or
+    // where reading it failed.
+    size_t Read(void* dst, size_t len);
+
+    // The errno of a failed read, which ends the data early, or 0
+    int error() const { return mError.load(std::memory_order_relaxed); }
+
+    uint64_t bytesRead() const { return mBytesRead.load(std::memory_order_relaxed); }
+    long long stallTime() const { return mStallTime; } // in os::getTime() units
+    unsigned stalls() const { return mStalls; }
+    size_t memoryUsed() const { return mBlockSize * mBlocks.size(); }
+
+private:
+    void Run();
+
+    struct Block
+    {
+        char* data;
+        size_t size; // valid bytes
+    };
+
+    const size_t mBlockSize;
+    std::vector<Block> mBlocks;
+    int mFd = -1;
+    long long mFileOffset = 0; // of the next read, owned by the thread
+
+    std::mutex mMutex;
+    std::condition_variable mCond;
+    unsigned mHead = 0;   // oldest filled block
+    unsigned mFilled = 0; // number of filled blocks from mHead on
+    bool mEof = false;
+    bool mStop = false;
+    size_t mPos = 0;      // consumer position in the head block
+
+    std::atomic<uint64_t> mBytesRead;
+    std::atomic<int> mError;
+    long long mStallTime = 0;
+    unsigned mStalls = 0;
+    std::thread mThread;
+};
+
+}
+
+#endif
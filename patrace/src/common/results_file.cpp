@@ -0,0 +1,583 @@
+#include <common/results_file.hpp>
+#include <common/os.hpp>
+
+#include <errno.h>
+#include <string.h>
+
+#include "json/reader.h"
+#include "json/writer.h"
+
+namespace common {
+
+// The trace file format already assumes a little endian host, so values
+// are copied as they are in memory.
+
+template<typename T>
+static void append(std::vector<char>& buf, T value)
+{
+    const char* p = reinterpret_cast<const char*>(&value);
+    buf.insert(buf.end(), p, p + sizeof(T));
+}
+
+static void appendString(std::vector<char>& buf, const std::string& str)
+{
+    append<uint32_t>(buf, str.size());
+    buf.insert(buf.end(), str.begin(), str.end());
+}
+
+ResultsWriter::ResultsWriter(unsigned int batchRows)
+    : mFile(NULL)
+    , mTables()
+    , mBatchRows(batchRows)
+{
+}
+
+ResultsWriter::~ResultsWriter()
+{
+    Close();
+}
+
+bool ResultsWriter::Open(const char* filename)
+{
+    Close();
+    mFile = fopen(filename, "wb");
+    if (!mFile)
+    {
+        DBG_LOG("Failed to open results file %s: %s\n", filename, strerror(errno));
+        return false;
+    }
+    fwrite(RESULTS_FILE_MAGIC, RESULTS_FILE_MAGIC_LEN, 1, mFile);
+    return true;
+}
+
+void ResultsWriter::Close()
+{
+    if (!mFile)
+    {
+        return;
+    }
+    Flush();
+    fclose(mFile);
+    mFile = NULL;
+    mTables.clear();
+}
+
+unsigned int ResultsWriter::AddTable(const std::string& name, const std::vector<ResultsColumn>& columns)
+{
+    Table table;
+    table.name = name;
+    table.columns = columns;
+    table.data.resize(columns.size());
+    table.lengths.resize(columns.size());
+    table.rows = 0;
+    mTables.push_back(table);
+
+    const unsigned int id = mTables.size() - 1;
+    std::vector<char> payload;
+    append<uint32_t>(payload, id);
+    appendString(payload, name);
+    append<uint32_t>(payload, columns.size());
+    for (const ResultsColumn& c : columns)
+    {
+        append<uint8_t>(payload, c.type);
+        appendString(payload, c.name);
+    }
+    WriteRecord(RESULTS_RECORD_SCHEMA, payload);
+    return id;
+}
+
+void ResultsWriter::SetFixed(unsigned int table, unsigned int column, ResultsColumnType type, uint64_t bits)
+{
+    Table& t = mTables.at(table);
+    if (t.columns.at(column).type != type)
+    {
+        DBG_LOG("Type mismatch for column %s of results table %s\n", t.columns[column].name.c_str(), t.name.c_str());
+        os::abort();
+    }
+    append<uint64_t>(t.data[column], bits);
+}
+
+void ResultsWriter::Set(unsigned int table, unsigned int column, uint64_t value)
+{
+    SetFixed(table, column, RESULTS_U64, value);
+}
+
+void ResultsWriter::Set(unsigned int table, unsigned int column, int64_t value)
+{
+    SetFixed(table, column, RESULTS_I64, static_cast<uint64_t>(value));
+}
+
+void ResultsWriter::Set(unsigned int table, unsigned int column, double value)
+{
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    SetFixed(table, column, RESULTS_F64, bits);
+}
+
+void ResultsWriter::Set(unsigned int table, unsigned int column, const std::string& value)
+{
+    Table& t = mTables.at(table);
+    if (t.columns.at(column).type != RESULTS_STRING)
+    {
+        DBG_LOG("Type mismatch for column %s of results table %s\n", t.columns[column].name.c_str(), t.name.c_str());
+        os::abort();
+    }
+    t.lengths[column].push_back(value.size());
+    t.data[column].insert(t.data[column].end(), value.begin(), value.end());
+}
+
+void ResultsWriter::EndRow(unsigned int table)
+{
+    Table& t = mTables.at(table);
+    t.rows++;
+    for (unsigned int i = 0; i < t.columns.size(); i++)
+    {
+        const size_t count = (t.columns[i].type == RESULTS_STRING) ? t.lengths[i].size() : t.data[i].size() / sizeof(uint64_t);
+        if (count != t.rows)
+        {
+            DBG_LOG("Column %s of results table %s was not set exactly once in row %u\n", t.columns[i].name.c_str(), t.name.c_str(), t.rows);
+            os::abort();
+        }
+    }
+    if (t.rows >= mBatchRows)
+    {
+        FlushTable(table);
+    }
+}
+
+void ResultsWriter::FlushTable(unsigned int table)
+{
+    Table& t = mTables.at(table);
+    if (t.rows == 0)
+    {
+        return;
+    }
+
+    std::vector<char> payload;
+    append<uint32_t>(payload, table);
+    append<uint32_t>(payload, t.rows);
+    for (unsigned int i = 0; i < t.columns.size(); i++)
+    {
+        if (t.columns[i].type == RESULTS_STRING)
+        {
+            const char* p = reinterpret_cast<const char*>(t.lengths[i].data());
+            payload.insert(payload.end(), p, p + t.lengths[i].size() * sizeof(uint32_t));
+            t.lengths[i].clear();
+        }
+        payload.insert(payload.end(), t.data[i].begin(), t.data[i].end());
+        t.data[i].clear();
+    }
+    t.rows = 0;
+    WriteRecord(RESULTS_RECORD_BATCH, payload);
+}
+
+void ResultsWriter::WriteJson(const std::string& name, const Json::Value& value)
+{
+    Json::FastWriter writer;
+    std::vector<char> payload;
+    appendString(payload, name);
+    appendString(payload, writer.write(value));
+    WriteRecord(RESULTS_RECORD_JSON, payload);
+}
+
+void ResultsWriter::Flush()
+{
+    if (!mFile)
+    {
+        return;
+    }
+    for (unsigned int i = 0; i < mTables.size(); i++)
+    {
+        FlushTable(i);
+    }
+    fflush(mFile);
+}
+
+void ResultsWriter::WriteRecord(ResultsRecordType type, const std::vector<char>& payload)
+{
+    if (!mFile)
+    {
+        return;
+    }
+    const uint32_t t = type;
+    const uint64_t size = payload.size();
+    fwrite(&t, sizeof(t), 1, mFile);
+    fwrite(&size, sizeof(size), 1, mFile);
+    if (size > 0 && fwrite(payload.data(), size, 1, mFile) != 1)
+    {
+        DBG_LOG("Failed to write results record: %s\n", strerror(errno));
+    }
+}
+
+void ResultsSummary::Add(const std::string& name, uint64_t value)
+{
+    mColumns.push_back(ResultsColumn(name, RESULTS_U64));
+    mValues.push_back(value);
+    mStrings.push_back(std::string());
+}
+
+void ResultsSummary::Add(const std::string& name, int64_t value)
+{
+    mColumns.push_back(ResultsColumn(name, RESULTS_I64));
+    mValues.push_back(static_cast<uint64_t>(value));
+    mStrings.push_back(std::string());
+}
+
+void ResultsSummary::Add(const std::string& name, double value)
+{
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    mColumns.push_back(ResultsColumn(name, RESULTS_F64));
+    mValues.push_back(bits);
+    mStrings.push_back(std::string());
+}
+
+void ResultsSummary::Add(const std::string& name, const std::string& value)
+{
+    mColumns.push_back(ResultsColumn(name, RESULTS_STRING));
+    mValues.push_back(0);
+    mStrings.push_back(value);
+}
+
+void ResultsSummary::Write(ResultsWriter& writer, const std::string& table) const
+{
+    const unsigned int id = writer.AddTable(table, mColumns);
+    for (unsigned int i = 0; i < mColumns.size(); i++)
+    {
+        switch (mColumns[i].type)
+        {
+        case RESULTS_U64: writer.Set(id, i, mValues[i]); break;
+        case RESULTS_I64: writer.Set(id, i, static_cast<int64_t>(mValues[i])); break;
+        case RESULTS_F64:
+        {
+            double value;
+            memcpy(&value, &mValues[i], sizeof(value));
+            writer.Set(id, i, value);
+            break;
+        }
+        case RESULTS_STRING: writer.Set(id, i, mStrings[i]); break;
+        }
+    }
+    writer.EndRow(id);
+}
+
+// Bounds checked cursor over a record payload
+class PayloadCursor
+{
+public:
+    PayloadCursor(const std::vector<char>& buf) : mBuf(buf), mPos(0), mOk(true) {}
+
+    template<typename T>
+    T read()
+    {
+        T value = T();
+        if (!check(sizeof(T)))
+            return value;
+        memcpy(&value, mBuf.data() + mPos, sizeof(T));
+        mPos += sizeof(T);
+        return value;
+    }
+
+    std::string readString()
+    {
+        const uint32_t len = read<uint32_t>();
+        return readBytes(len);
+    }
+
+    std::string readBytes(size_t len)
+    {
+        if (!check(len))
+            return std::string();
+        std::string str(mBuf.data() + mPos, len);
+        mPos += len;
+        return str;
+    }
+
+    bool ok() const { return mOk; }
+    size_t remaining() const { return mBuf.size() - mPos; }
+
+private:
+    bool check(size_t len)
+    {
+        if (mOk && mBuf.size() - mPos < len)
+            mOk = false;
+        return mOk;
+    }
+
+    const std::vector<char>& mBuf;
+    size_t mPos;
+    bool mOk;
+};
+
+bool ResultsReader::Open(const char* filename)
+{
+    mTables.clear();
+    mDocuments.clear();
+
+    FILE* fp = fopen(filename, "rb");
+    if (!fp)
+    {
+        DBG_LOG("Failed to open results file %s: %s\n", filename, strerror(errno));
+        return false;
+    }
+
+    char magic[RESULTS_FILE_MAGIC_LEN];
+    if (fread(magic, RESULTS_FILE_MAGIC_LEN, 1, fp) != 1 || memcmp(magic, RESULTS_FILE_MAGIC, RESULTS_FILE_MAGIC_LEN) != 0)
+    {
+        DBG_LOG("%s is not a results file\n", filename);
+        fclose(fp);
+        return false;
+    }
+
+    // Record sizes are checked against what is left of the file before
+    // anything is allocated for them
+    fseek(fp, 0, SEEK_END);
+    const uint64_t fileSize = ftell(fp);
+    fseek(fp, RESULTS_FILE_MAGIC_LEN, SEEK_SET);
+
+    std::map<uint32_t, size_t> tableIndex; // file table id -> mTables index
+    std::vector<char> payload;
+    bool ok = true;
+    uint32_t type;
+    while (ok && fread(&type, sizeof(type), 1, fp) == 1)
+    {
+        uint64_t size = 0;
+        if (fread(&size, sizeof(size), 1, fp) != 1)
+        {
+            DBG_LOG("Truncated results record header\n");
+            ok = false;
+            break;
+        }
+        if (size > fileSize - (uint64_t)ftell(fp))
+        {
+            DBG_LOG("Truncated results record, ignoring the rest of the file\n");
+            break;
+        }
+        payload.resize(size);
+        if (size > 0 && fread(payload.data(), size, 1, fp) != 1)
+        {
+            // A run that was killed leaves a partial last record; keep what we have
+            DBG_LOG("Truncated results record, ignoring the rest of the file\n");
+            break;
+        }
+
+        PayloadCursor cur(payload);
+        if (type == RESULTS_RECORD_SCHEMA)
+        {
+            const uint32_t id = cur.read<uint32_t>();
+            Table table;
+            table.name = cur.readString();
+            const uint32_t numColumns = cur.read<uint32_t>();
+            for (uint32_t i = 0; i < numColumns && cur.ok(); i++)
+            {
+                ResultsColumn c;
+                c.type = static_cast<ResultsColumnType>(cur.read<uint8_t>());
+                c.name = cur.readString();
+                table.columns.push_back(c);
+            }
+            table.values.resize(table.columns.size());
+            table.strings.resize(table.columns.size());
+            table.rows = 0;
+            tableIndex[id] = mTables.size();
+            mTables.push_back(table);
+        }
+        else if (type == RESULTS_RECORD_BATCH)
+        {
+            const uint32_t id = cur.read<uint32_t>();
+            const uint32_t rows = cur.read<uint32_t>();
+            auto it = tableIndex.find(id);
+            if (it == tableIndex.end())
+            {
+                DBG_LOG("Results batch for undeclared table %u\n", id);
+                ok = false;
+                break;
+            }
+            Table& table = mTables[it->second];
+            size_t rowSize = 0;
+            for (const ResultsColumn& c : table.columns)
+            {
+                rowSize += (c.type == RESULTS_STRING) ? sizeof(uint32_t) : sizeof(uint64_t);
+            }
+            if (rowSize > 0 && rows > cur.remaining() / rowSize)
+            {
+                DBG_LOG("Results batch for table %s has %u rows, more than the record holds\n", table.name.c_str(), rows);
+                ok = false;
+                break;
+            }
+            for (unsigned int i = 0; i < table.columns.size() && cur.ok(); i++)
+            {
+                if (table.columns[i].type == RESULTS_STRING)
+                {
+                    std::vector<uint32_t> lengths(rows);
+                    for (uint32_t r = 0; r < rows; r++)
+                        lengths[r] = cur.read<uint32_t>();
+                    for (uint32_t r = 0; r < rows; r++)
+                        table.strings[i].push_back(cur.readBytes(lengths[r]));
+                }
+                else
+                {
+                    for (uint32_t r = 0; r < rows; r++)
+                        table.values[i].push_back(cur.read<uint64_t>());
+                }
+            }
+            table.rows += rows;
+        }
+        else if (type == RESULTS_RECORD_JSON)
+        {
+            const std::string name = cur.readString();
+            const std::string doc = cur.readString();
+            Json::Reader reader;
+            Json::Value value;
+            if (!reader.parse(doc, value))
+            {
+                DBG_LOG("Failed to parse results document %s\n", name.c_str());
+            }
+            mDocuments[name] = value;
+        }
+
+        if (!cur.ok())
+        {
+            DBG_LOG("Malformed results record of type %u\n", type);
+            ok = false;
+        }
+    }
+
+    fclose(fp);
+    return ok;
+}
+
+const ResultsReader::Table* ResultsReader::FindTable(const std::string& name) const
+{
+    for (const Table& t : mTables)
+    {
+        if (t.name == name)
+            return &t;
+    }
+    return NULL;
+}
+
+Json::Value ResultsReader::ToJson(bool withTables) const
+{
+    Json::Value root;
+    auto it = mDocuments.find("results");
+    if (it != mDocuments.end())
+    {
+        root = it->second;
+    }
+
+    // Only runs that measured something have a result
+    const bool hasResult = root.isMember("result") && root["result"].isArray() && root["result"].size() > 0;
+    if (hasResult)
+    {
+        Json::Value& result = root["result"][0];
+        const Table* summary = FindTable("summary");
+        if (summary && summary->rows > 0)
+        {
+            const Json::Value values = summary->RowToJson(summary->rows - 1);
+            for (const std::string& name : values.getMemberNames())
+            {
+                result[name] = values[name];
+            }
+        }
+        const Table* loops = FindTable("loops");
+        if (loops)
+        {
+            result["loopFPS"] = Json::arrayValue;
+            const int fps = loops->FindColumn("fps");
+            for (size_t r = 0; fps >= 0 && r < loops->rows; r++)
+            {
+                result["loopFPS"].append(loops->GetF64(fps, r));
+            }
+        }
+    }
+
+    if (withTables)
+    {
+        Json::Value tables(Json::objectValue);
+        for (const Table& t : mTables)
+        {
+            tables[t.name] = t.ToJson();
+        }
+        if (hasResult)
+        {
+            root["result"][0]["tables"] = tables;
+        }
+        else
+        {
+            root["tables"] = tables;
+        }
+    }
+    return root;
+}
+
+int ResultsReader::Table::FindColumn(const std::string& name) const
+{
+    for (unsigned int i = 0; i < columns.size(); i++)
+    {
+        if (columns[i].name == name)
+            return i;
+    }
+    return -1;
+}
+
+uint64_t ResultsReader::Table::GetU64(unsigned int column, size_t row) const
+{
+    return values.at(column).at(row);
+}
+
+int64_t ResultsReader::Table::GetI64(unsigned int column, size_t row) const
+{
+    return static_cast<int64_t>(values.at(column).at(row));
+}
+
+double ResultsReader::Table::GetF64(unsigned int column, size_t row) const
+{
+    const uint64_t bits = values.at(column).at(row);
+    double value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+const std::string& ResultsReader::Table::GetString(unsigned int column, size_t row) const
+{
+    return strings.at(column).at(row);
+}
+
+Json::Value ResultsReader::Table::RowToJson(size_t row) const
+{
+    Json::Value value(Json::objectValue);
+    for (unsigned int i = 0; i < columns.size(); i++)
+    {
+        switch (columns[i].type)
+        {
+        case RESULTS_U64: value[columns[i].name] = Json::UInt64(GetU64(i, row)); break;
+        case RESULTS_I64: value[columns[i].name] = Json::Int64(GetI64(i, row)); break;
+        case RESULTS_F64: value[columns[i].name] = GetF64(i, row); break;
+        case RESULTS_STRING: value[columns[i].name] = GetString(i, row); break;
+        }
+    }
+    return value;
+}
+
+Json::Value ResultsReader::Table::ToJson() const
+{
+    Json::Value value(Json::objectValue);
+    for (unsigned int i = 0; i < columns.size(); i++)
+    {
+        Json::Value column(Json::arrayValue);
+        for (size_t r = 0; r < rows; r++)
+        {
+            switch (columns[i].type)
+            {
+            case RESULTS_U64: column.append(Json::UInt64(GetU64(i, r))); break;
+            case RESULTS_I64: column.append(Json::Int64(GetI64(i, r))); break;
+            case RESULTS_F64: column.append(GetF64(i, r)); break;
+            case RESULTS_STRING: column.append(GetString(i, r)); break;
+            }
+        }
+        value[columns[i].name] = column;
+    }
+    return value;
+}
+
+}
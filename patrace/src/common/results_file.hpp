@@ -0,0 +1,165 @@
+#ifndef _COMMON_RESULTS_FILE_HPP_
+#define _COMMON_RESULTS_FILE_HPP_
+
+#include <stdio.h>
+#include <stdint.h>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "json/value.h"
+
+namespace common {
+
+// Binary, columnar results file. Tables are declared once and then streamed
+// in batches while retracing, so per-frame data never has to be kept in
+// memory or turned into a JSON tree. Use ResultsReader (or the
+// results_to_json tool) to turn it back into JSON.
+//
+// Layout: RESULTS_FILE_MAGIC, then a sequence of records. Every record is
+// a u32 record type and a u64 payload size followed by the payload, so
+// readers can skip records they don't know. All integers are little endian.
+// Strings are stored as a u32 length followed by the bytes.
+//
+//   RESULTS_RECORD_SCHEMA  u32 table id, string name, u32 column count,
+//                          then for each column: u8 type, string name
+//   RESULTS_RECORD_BATCH   u32 table id, u32 row count, then each column in
+//                          schema order: row count 8 byte values, or for
+//                          string columns row count u32 lengths and the bytes
+//   RESULTS_RECORD_JSON    string name, string document
+
+#define RESULTS_FILE_MAGIC "PARESv1\n"
+#define RESULTS_FILE_MAGIC_LEN 8
+
+enum ResultsRecordType
+{
+    RESULTS_RECORD_SCHEMA = 1,
+    RESULTS_RECORD_BATCH = 2,
+    RESULTS_RECORD_JSON = 3
+};
+
+enum ResultsColumnType
+{
+    RESULTS_U64 = 0,
+    RESULTS_I64 = 1,
+    RESULTS_F64 = 2,
+    RESULTS_STRING = 3
+};
+
+struct ResultsColumn
+{
+    ResultsColumn() : name(), type(RESULTS_U64) {}
+    ResultsColumn(const std::string& _name, ResultsColumnType _type) : name(_name), type(_type) {}
+
+    std::string name;
+    ResultsColumnType type;
+};
+
+class ResultsWriter
+{
+public:
+    ResultsWriter(unsigned int batchRows = 1024);
+    ~ResultsWriter();
+
+    bool Open(const char* filename);
+    void Close();
+    bool IsOpen() const { return mFile != NULL; }
+
+    // Declare a table and return its id
+    unsigned int AddTable(const std::string& name, const std::vector<ResultsColumn>& columns);
+
+    // Set the columns of the current row in schema order, then call EndRow()
+    void Set(unsigned int table, unsigned int column, uint64_t value);
+    void Set(unsigned int table, unsigned int column, int64_t value);
+    void Set(unsigned int table, unsigned int column, double value);
+    void Set(unsigned int table, unsigned int column, const std::string& value);
+    void EndRow(unsigned int table);
+
+    // Store a JSON document, e.g. the summary that would go into results.json
+    void WriteJson(const std::string& name, const Json::Value& value);
+
+    // Write out all buffered rows
+    void Flush();
+
+private:
+    struct Table
+    {
+        std::string name;
+        std::vector<ResultsColumn> columns;
+        std::vector<std::vector<char> > data;
+        std::vector<std::vector<uint32_t> > lengths; // string columns only
+        unsigned int rows;
+    };
+
+    void SetFixed(unsigned int table, unsigned int column, ResultsColumnType type, uint64_t bits);
+    void FlushTable(unsigned int table);
+    void WriteRecord(ResultsRecordType type, const std::vector<char>& payload);
+
+    FILE* mFile;
+    std::vector<Table> mTables;
+    unsigned int mBatchRows;
+};
+
+// A single row table of named values, for the summary of a run
+class ResultsSummary
+{
+public:
+    void Add(const std::string& name, uint64_t value);
+    void Add(const std::string& name, int64_t value);
+    void Add(const std::string& name, double value);
+    void Add(const std::string& name, const std::string& value);
+    bool Empty() const { return mColumns.empty(); }
+
+    void Write(ResultsWriter& writer, const std::string& table) const;
+
+private:
+    std::vector<ResultsColumn> mColumns;
+    std::vector<uint64_t> mValues;
+    std::vector<std::string> mStrings;
+};
+
+class ResultsReader
+{
+public:
+    struct Table
+    {
+        std::string name;
+        std::vector<ResultsColumn> columns;
+        // One entry per column; 8 byte values for fixed width columns
+        std::vector<std::vector<uint64_t> > values;
+        std::vector<std::vector<std::string> > strings;
+        size_t rows;
+
+        int FindColumn(const std::string& name) const;
+        uint64_t GetU64(unsigned int column, size_t row) const;
+        int64_t GetI64(unsigned int column, size_t row) const;
+        double GetF64(unsigned int column, size_t row) const;
+        const std::string& GetString(unsigned int column, size_t row) const;
+
+        // {"column": [values...], ...}
+        Json::Value ToJson() const;
+        // {"column": value, ...} for the given row
+        Json::Value RowToJson(size_t row) const;
+    };
+
+    bool Open(const char* filename);
+
+    const std::vector<Table>& Tables() const { return mTables; }
+    const Table* FindTable(const std::string& name) const;
+    const std::map<std::string, Json::Value>& Documents() const { return mDocuments; }
+
+    // Rebuild results.json as the retracer would have written it: the stored
+    // "results" document, with the values of the "summary" table and the
+    // per loop FPS of the "loops" table merged into the first result. With
+    // withTables, every table is also added in columnar form to its "tables"
+    // member.
+    Json::Value ToJson(bool withTables = false) const;
+
+private:
+    std::vector<Table> mTables;
+    std::map<std::string, Json::Value> mDocuments;
+};
+
+}
+
+#endif
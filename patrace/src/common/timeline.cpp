@@ -0,0 +1,151 @@
+#include <common/timeline.hpp>
+#include <common/os.hpp>
+
+#include <algorithm>
+
+#include <errno.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+
+namespace common {
+
+Timeline& Timeline::instance()
+{
+    static Timeline timeline;
+    return timeline;
+}
+
+Timeline::Timeline()
+    : mEnabled(false)
+    , mLimit(0)
+    , mDropped(0)
+    , mBase(0)
+{
+}
+
+void Timeline::Enable(size_t reserve, size_t limit)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    mLimit = limit;
+    mDropped = 0;
+    mEvents.reserve(std::min(reserve, limit));
+    mBase = os::getTime();
+    mEnabled = true;
+}
+
+void Timeline::Disable()
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    mEnabled = false;
+    mEvents.clear();
+    mDropped = 0;
+}
+
+int Timeline::Track(const std::string& name)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    for (unsigned i = 0; i < mTrackNames.size(); i++)
+    {
+        if (mTrackNames[i] == name) return i;
+    }
+    mTrackNames.push_back(name);
+    return mTrackNames.size() - 1;
+}
+
+int Timeline::threadTrack()
+{
+    const std::thread::id id = std::this_thread::get_id();
+    const auto it = mThreadTracks.find(id);
+    if (it != mThreadTracks.end())
+    {
+        return it->second;
+    }
+    const int track = mTrackNames.size();
+    mTrackNames.push_back("Thread " + std::to_string(mThreadTracks.size()));
+    mThreadTracks[id] = track;
+    return track;
+}
+
+void Timeline::add(const Event& e)
+{
+    if (mEvents.size() >= mLimit)
+    {
+        if (mDropped++ == 0)
+        {
+            DBG_LOG("Timeline is full with %u events, dropping the rest\n", (unsigned)mEvents.size());
+        }
+        return;
+    }
+    mEvents.push_back(e);
+}
+
+void Timeline::SetThreadName(const std::string& name)
+{
+    if (!IsEnabled()) return;
+    std::lock_guard<std::mutex> lock(mMutex);
+    mTrackNames[threadTrack()] = name;
+}
+
+void Timeline::Complete(const char* name, const char* category, long long begin, long long end, int track, const char* argName, int64_t arg)
+{
+    if (!IsEnabled()) return;
+    std::lock_guard<std::mutex> lock(mMutex);
+    Event e = { name, category, argName, arg, begin, end, track < 0 ? threadTrack() : track };
+    add(e);
+}
+
+void Timeline::Instant(const char* name, const char* category, int track, const char* argName, int64_t arg)
+{
+    if (!IsEnabled()) return;
+    const long long now = os::getTime();
+    std::lock_guard<std::mutex> lock(mMutex);
+    Event e = { name, category, argName, arg, now, -1, track < 0 ? threadTrack() : track };
+    add(e);
+}
+
+bool Timeline::Write(const char* filename)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    FILE* fp = fopen(filename, "w");
+    if (!fp)
+    {
+        DBG_LOG("Failed to open timeline file %s: %s\n", filename, strerror(errno));
+        return false;
+    }
+    // Timestamps are in microseconds
+    const double scale = 1000000.0 / os::timeFrequency;
+    fprintf(fp, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    for (unsigned i = 0; i < mTrackNames.size(); i++)
+    {
+        fprintf(fp, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"%s\"}},\n", i, mTrackNames[i].c_str());
+    }
+    for (const Event& e : mEvents)
+    {
+        const double ts = (e.begin - mBase) * scale;
+        if (e.end == -1)
+        {
+            fprintf(fp, "{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"i\",\"s\":\"t\",\"ts\":%.3f,\"pid\":1,\"tid\":%d", e.name, e.category, ts, e.track);
+        }
+        else
+        {
+            fprintf(fp, "{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":%d", e.name, e.category, ts, (e.end - e.begin) * scale, e.track);
+        }
+        if (e.argName)
+        {
+            fprintf(fp, ",\"args\":{\"%s\":%" PRId64 "}", e.argName, e.arg);
+        }
+        fprintf(fp, "},\n");
+    }
+    // Closing metadata event so that the list needs no trailing comma handling
+    fprintf(fp, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"paretrace\"}}\n]}\n");
+    fclose(fp);
+    DBG_LOG("Wrote %u timeline events to %s\n", (unsigned)mEvents.size(), filename);
+    if (mDropped > 0)
+    {
+        DBG_LOG("%u timeline events were dropped after the timeline filled up\n", (unsigned)mDropped);
+    }
+    return true;
+}
+
+}
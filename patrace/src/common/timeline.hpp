@@ -0,0 +1,96 @@
+#ifndef _COMMON_TIMELINE_HPP_
+#define _COMMON_TIMELINE_HPP_
+
+#include <stdint.h>
+#include <atomic>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <common/os_time.hpp>
+
+namespace common {
+
+// In-memory timeline of coarse events such as frames, thread hand-offs,
+// decompression stalls and file I/O. It is written out at exit in the
+// Chrome trace event JSON format, which chrome://tracing and the Perfetto
+// UI can open. Recording is off until Enable() is called, so instrumented
+// code only pays for a flag check.
+//
+// Event names, categories and argument names are stored by pointer and
+// must be string literals. Timestamps are in os::getTime() units. At most
+// `limit` events are kept; once that is reached further events are counted
+// but dropped, so that a long run cannot grow the buffer without bound.
+class Timeline
+{
+public:
+    static Timeline& instance();
+
+    void Enable(size_t reserve = 64 * 1024, size_t limit = 4 * 1024 * 1024);
+    // Stop recording and drop the events, so that a new run starts afresh
+    void Disable();
+    bool IsEnabled() const { return mEnabled.load(std::memory_order_relaxed); }
+
+    // Named track, e.g. "Frames". Events default to a track for the calling
+    // thread, see SetThreadName().
+    int Track(const std::string& name);
+    void SetThreadName(const std::string& name);
+
+    void Complete(const char* name, const char* category, long long begin, long long end,
+                  int track = -1, const char* argName = NULL, int64_t arg = 0);
+    void Instant(const char* name, const char* category, int track = -1,
+                 const char* argName = NULL, int64_t arg = 0);
+
+    bool Write(const char* filename);
+
+private:
+    Timeline();
+
+    struct Event
+    {
+        const char* name;
+        const char* category;
+        const char* argName;
+        int64_t arg;
+        long long begin;
+        long long end; // -1 for instant events
+        int track;
+    };
+
+    int threadTrack(); // mMutex must be held
+    void add(const Event& e); // mMutex must be held
+
+    std::atomic<bool> mEnabled;
+    std::mutex mMutex;
+    std::vector<Event> mEvents;
+    size_t mLimit;
+    size_t mDropped;
+    std::vector<std::string> mTrackNames;
+    std::map<std::thread::id, int> mThreadTracks;
+    long long mBase;
+};
+
+// Records a complete event covering its own lifetime
+class TimelineScope
+{
+public:
+    TimelineScope(const char* name, const char* category, int track = -1)
+        : mName(name), mCategory(category), mTrack(track)
+        , mBegin(Timeline::instance().IsEnabled() ? os::getTime() : -1) {}
+    ~TimelineScope()
+    {
+        if (mBegin != -1) Timeline::instance().Complete(mName, mCategory, mBegin, os::getTime(), mTrack);
+    }
+
+private:
+    const char* mName;
+    const char* mCategory;
+    int mTrack;
+    long long mBegin;
+};
+
+}
+
+#endif
@@ -25,6 +25,7 @@
 
 
 #include <assert.h>
+#include <stdint.h>
 #include <stdlib.h>
 #include <cstring>
 #include <limits>
@@ -245,3 +246,41 @@ CallSet::CallSet(CallFlags freq) {
         assert(!empty());
     }
 }
+
+
+void CallSet::compile(const std::vector<std::string>& funcNames)
+{
+    funcFlags.resize(funcNames.size());
+    for (unsigned id = 0; id < funcNames.size(); id++) {
+        funcFlags[id] = GetCallFlags(funcNames[id].c_str());
+    }
+
+    allFreq = 0;
+    std::vector<uint64_t> bounds;
+    for (const CallRange& range : ranges) {
+        allFreq |= range.freq;
+        bounds.push_back(range.start);
+        bounds.push_back((uint64_t)range.stop + 1);
+    }
+    std::sort(bounds.begin(), bounds.end());
+    bounds.erase(std::unique(bounds.begin(), bounds.end()), bounds.end());
+
+    segments.clear();
+    segmentRanges.clear();
+    for (uint64_t bound : bounds) {
+        if (bound > std::numeric_limits<CallNo>::max()) {
+            break;
+        }
+        Segment seg;
+        seg.start = bound;
+        seg.first = segmentRanges.size();
+        // ranges are sorted by start
+        for (RangeList::const_iterator it = ranges.begin(); it != ranges.end() && it->start <= seg.start; ++it) {
+            if (seg.start <= it->stop) {
+                segmentRanges.push_back(*it);
+            }
+        }
+        seg.last = segmentRanges.size();
+        segments.push_back(seg);
+    }
+}
@@ -48,7 +48,10 @@
 #define _TRACE_CALLSET_HPP_
 
 #include <cstring> // for strcmp
+#include <algorithm>
 #include <list>
+#include <string>
+#include <vector>
 
 namespace common {
 
@@ -172,10 +175,52 @@ namespace common {
             return false;
         }
 
+        // Build the lookup tables used by contains(callNo, funcId). funcNames
+        // is indexed by function id, as returned by InFileBase::getFuncNames().
+        // Must be called again if ranges are added afterwards.
+        void compile(const std::vector<std::string>& funcNames);
+
+        // Same result as contains(callNo, funcName), but costs a flag lookup
+        // for most calls, and a binary search over the range boundaries for
+        // the rest.
+        inline bool
+        contains(CallNo callNo, unsigned funcId) const {
+            const unsigned flags = funcFlags[funcId];
+            if ((flags & allFreq) == 0) {
+                return false;
+            }
+            // Find the last segment starting at or before callNo
+            std::vector<Segment>::const_iterator seg = std::upper_bound(segments.begin(), segments.end(), callNo,
+                [](CallNo no, const Segment& s) { return no < s.start; });
+            if (seg == segments.begin()) {
+                return false;
+            }
+            --seg;
+            for (unsigned i = seg->first; i < seg->last; i++) {
+                const CallRange& range = segmentRanges[i];
+                if ((range.step == 1 || ((callNo - range.start) % range.step) == 0) &&
+                    (flags & range.freq) != 0) {
+                    return true;
+                }
+            }
+            return false;
+        }
+
     private:
-        // TODO: use binary tree to speed up lookups
         typedef std::list< CallRange > RangeList;
         RangeList ranges;
+
+        // Compiled form: the call numbers are split into segments at every
+        // range start and end, and each segment lists the ranges covering it.
+        struct Segment {
+            CallNo start;
+            unsigned first; // index into segmentRanges
+            unsigned last;
+        };
+        std::vector<unsigned> funcFlags; // CallFlags of each function id
+        unsigned allFreq = 0; // union of the frequencies of all ranges
+        std::vector<Segment> segments;
+        std::vector<CallRange> segmentRanges;
     };
 
     CallSet parse(const char *string);
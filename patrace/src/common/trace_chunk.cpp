@@ -0,0 +1,187 @@
+#include <common/trace_chunk.hpp>
+
+#include <snappy.h>
+#include <string.h>
+
+namespace common {
+
+static const uint64_t PRIME1 = 0x9E3779B185EBCA87ULL;
+static const uint64_t PRIME2 = 0xC2B2AE3D27D4EB4FULL;
+static const uint64_t PRIME3 = 0x165667B19E3779F9ULL;
+static const uint64_t PRIME4 = 0x85EBCA77C2B2AE63ULL;
+static const uint64_t PRIME5 = 0x27D4EB2F165667C5ULL;
+
+static inline uint64_t rotl(uint64_t x, int r)
+{
+    return (x << r) | (x >> (64 - r));
+}
+
+// Trace files are little endian, as are all platforms we run on
+static inline uint64_t read64(const unsigned char* p)
+{
+    uint64_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static inline uint32_t read32(const unsigned char* p)
+{
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static inline uint64_t round(uint64_t acc, uint64_t input)
+{
+    acc += input * PRIME2;
+    acc = rotl(acc, 31);
+    return acc * PRIME1;
+}
+
+static inline uint64_t mergeRound(uint64_t acc, uint64_t val)
+{
+    acc ^= round(0, val);
+    return acc * PRIME1 + PRIME4;
+}
+
+uint64_t xxHash64(const void* data, size_t len, uint64_t seed)
+{
+    const unsigned char* p = (const unsigned char*)data;
+    const unsigned char* end = p + len;
+    uint64_t h;
+
+    if (len >= 32)
+    {
+        const unsigned char* limit = end - 32;
+        uint64_t v1 = seed + PRIME1 + PRIME2;
+        uint64_t v2 = seed + PRIME2;
+        uint64_t v3 = seed;
+        uint64_t v4 = seed - PRIME1;
+        do
+        {
+            v1 = round(v1, read64(p));
+            v2 = round(v2, read64(p + 8));
+            v3 = round(v3, read64(p + 16));
+            v4 = round(v4, read64(p + 24));
+            p += 32;
+        } while (p <= limit);
+
+        h = rotl(v1, 1) + rotl(v2, 7) + rotl(v3, 12) + rotl(v4, 18);
+        h = mergeRound(h, v1);
+        h = mergeRound(h, v2);
+        h = mergeRound(h, v3);
+        h = mergeRound(h, v4);
+    }
+    else
+    {
+        h = seed + PRIME5;
+    }
+
+    h += (uint64_t)len;
+
+    while (p + 8 <= end)
+    {
+        h ^= round(0, read64(p));
+        h = rotl(h, 27) * PRIME1 + PRIME4;
+        p += 8;
+    }
+    if (p + 4 <= end)
+    {
+        h ^= (uint64_t)read32(p) * PRIME1;
+        h = rotl(h, 23) * PRIME2 + PRIME3;
+        p += 4;
+    }
+    while (p < end)
+    {
+        h ^= (*p) * PRIME5;
+        h = rotl(h, 11) * PRIME1;
+        p++;
+    }
+
+    h ^= h >> 33;
+    h *= PRIME2;
+    h ^= h >> 29;
+    h *= PRIME3;
+    h ^= h >> 32;
+    return h;
+}
+
+ChunkStatus parseChunk(const char* src, size_t size, ChunkRef& chunk, bool verify)
+{
+    if (size == 0)
+    {
+        return CHUNK_END;
+    }
+    if (size < 4)
+    {
+        return CHUNK_TRUNCATED;
+    }
+
+    uint32_t word = read32((const unsigned char*)src);
+    if (word == 0)
+    {
+        // Unused space at the end of a file written through a mapping
+        return CHUNK_END;
+    }
+    chunk.hasChecksum = (word & CHUNK_CHECKSUM_FLAG) != 0;
+    chunk.length = word & ~CHUNK_CHECKSUM_FLAG;
+    chunk.frameLength = 4 + chunk.length + (chunk.hasChecksum ? CHUNK_CHECKSUM_SIZE : 0);
+    chunk.data = src + 4;
+    chunk.checksum = 0;
+    if (chunk.frameLength > size)
+    {
+        return CHUNK_TRUNCATED;
+    }
+
+    if (chunk.hasChecksum)
+    {
+        chunk.checksum = read64((const unsigned char*)chunk.data + chunk.length);
+        if (verify && xxHash64(chunk.data, chunk.length) != chunk.checksum)
+        {
+            return CHUNK_BAD_CHECKSUM;
+        }
+    }
+    return CHUNK_OK;
+}
+
+const char* chunkStatusName(ChunkStatus status)
+{
+    switch (status)
+    {
+    case CHUNK_OK: return "ok";
+    case CHUNK_END: return "end of file";
+    case CHUNK_TRUNCATED: return "truncated";
+    case CHUNK_BAD_CHECKSUM: return "bad checksum";
+    }
+    return "unknown";
+}
+
+ChunkStatus findChunks(const char* begin, const char* end, std::vector<ChunkRef>& chunks)
+{
+    const char* ptr = begin;
+    for (;;)
+    {
+        ChunkRef chunk;
+        const ChunkStatus status = parseChunk(ptr, end - ptr, chunk, false);
+        if (status != CHUNK_OK)
+        {
+            return status;
+        }
+        chunks.push_back(chunk);
+        ptr += chunk.frameLength;
+    }
+}
+
+bool uncompressChunk(const ChunkRef& chunk, std::vector<char>& buffer)
+{
+    size_t length = 0;
+    if (!snappy::GetUncompressedLength(chunk.data, chunk.length, &length))
+    {
+        return false;
+    }
+    const size_t offset = buffer.size();
+    buffer.resize(offset + length);
+    return snappy::RawUncompress(chunk.data, chunk.length, buffer.data() + offset);
+}
+
+}
@@ -0,0 +1,54 @@
+#ifndef _COMMON_TRACE_CHUNK_HPP_
+#define _COMMON_TRACE_CHUNK_HPP_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+namespace common {
+
+// After the header, a trace file is a sequence of snappy compressed chunks,
+// each framed as a 4 byte little endian length followed by the compressed
+// data. If the top bit of the length is set, the compressed data is followed
+// by an 8 byte little endian xxHash64 of it. Chunks without a checksum can
+// still be checked by snappy, but not reliably. A zero length ends the
+// chunks, see OutFile::setMapped().
+#define CHUNK_CHECKSUM_FLAG 0x80000000u
+#define CHUNK_CHECKSUM_SIZE 8
+
+enum ChunkStatus
+{
+    CHUNK_OK = 0,
+    CHUNK_END,           // no more chunks
+    CHUNK_TRUNCATED,     // the chunk runs past the end of the file
+    CHUNK_BAD_CHECKSUM,  // the checksum does not match the data
+};
+
+struct ChunkRef
+{
+    const char* data = nullptr;     // compressed data
+    size_t length = 0;              // of the compressed data
+    size_t frameLength = 0;         // including length and checksum
+    bool hasChecksum = false;
+    uint64_t checksum = 0;
+};
+
+uint64_t xxHash64(const void* data, size_t len, uint64_t seed = 0);
+
+// Read the framing of the chunk at src, with size bytes left in the file.
+// The checksum is only compared if verify is set.
+ChunkStatus parseChunk(const char* src, size_t size, ChunkRef& chunk, bool verify);
+
+const char* chunkStatusName(ChunkStatus status);
+
+// Find the chunks from begin up to end from their framing alone, without
+// comparing checksums. Returns CHUNK_END, or CHUNK_TRUNCATED if the last
+// chunk runs past end.
+ChunkStatus findChunks(const char* begin, const char* end, std::vector<ChunkRef>& chunks);
+
+// Decompress the chunk, appending it to buffer
+bool uncompressChunk(const ChunkRef& chunk, std::vector<char>& buffer);
+
+}
+
+#endif
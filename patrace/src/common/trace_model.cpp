@@ -540,6 +540,7 @@ void ValueTM::SetAsClientSideBufferReference(unsigned int name, unsigned int off
     mType = Opaque_Type;
     mOpaqueType = ClientSideBufferObjectReferenceType;
     mOpaqueIns = new ValueTM();
+    mOpaqueIns->mType = MemRef_Type;
     mOpaqueIns->mClientSideBufferName = name;
     mOpaqueIns->mClientSideBufferOffset = offset;
 }
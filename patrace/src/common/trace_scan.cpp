@@ -0,0 +1,117 @@
+#include <common/trace_scan.hpp>
+
+#include <atomic>
+#include <set>
+#include <thread>
+
+namespace common {
+
+ChunkStatus TraceScanner::findChunks()
+{
+    const char* begin = mFile.chunksBegin();
+    const char* end = mFile.chunksEnd();
+    std::vector<ChunkRef> refs;
+    const ChunkStatus status = common::findChunks(begin, end, refs);
+    const char* ptr = begin;
+    mChunks.resize(refs.size());
+    for (size_t i = 0; i < refs.size(); i++)
+    {
+        mChunks[i].ref = refs[i];
+        mChunks[i].offset = ptr - begin;
+        ptr += refs[i].frameLength;
+    }
+    mTrailing = end - ptr;
+    return status;
+}
+
+void TraceScanner::walk(unsigned thread, size_t index, std::vector<char>& buffer, bool verify, const CallFunc& onCall)
+{
+    Chunk& c = mChunks[index];
+    if (verify && c.ref.hasChecksum && xxHash64(c.ref.data, c.ref.length) != c.ref.checksum)
+    {
+        c.error = "bad checksum";
+        return;
+    }
+    buffer.clear();
+    if (!uncompressChunk(c.ref, buffer))
+    {
+        c.error = "failed to decompress";
+        return;
+    }
+    c.uncompressed = buffer.size();
+
+    const int maxSigId = mFile.getMaxSigId();
+    char* p = buffer.data() + callsBegin(index);
+    const char* chunkEnd = buffer.data() + buffer.size();
+    while (p + sizeof(BCall) <= chunkEnd)
+    {
+        const BCall& call = *(const BCall*)p;
+        if (call.funcId == 0 || call.funcId > maxSigId)
+        {
+            c.error = "function id out of range";
+            return;
+        }
+        const int callLen = mFile.callLength(call.funcId);
+        const unsigned size = (callLen == 0) ? ((const BCall_vlen*)p)->toNext : callLen;
+        if (size == 0 || p + size > chunkEnd)
+        {
+            c.error = "call overruns the chunk";
+            return;
+        }
+        const InFileBase::FrameEvent event = mFile.getFrameEvent(call, p + (callLen == 0 ? sizeof(BCall_vlen) : sizeof(BCall)));
+        if (onCall)
+        {
+            onCall(thread, call, size);
+        }
+        p += size;
+        c.calls++;
+        if (event.type != InFileBase::FrameEvent::NONE)
+        {
+            FrameEnd position;
+            position.offset = p - buffer.data();
+            position.calls = c.calls;
+            c.events.emplace_back(event, position);
+        }
+    }
+}
+
+bool TraceScanner::scan(unsigned threads, bool verify, const CallFunc& onCall)
+{
+    std::atomic<size_t> next(0);
+    auto worker = [&](unsigned thread)
+    {
+        std::vector<char> buffer;
+        size_t i;
+        while ((i = next.fetch_add(1)) < mChunks.size())
+        {
+            walk(thread, i, buffer, verify, onCall);
+        }
+    };
+    std::vector<std::thread> pool;
+    for (unsigned i = 0; i < threads; i++)
+    {
+        pool.emplace_back(worker, i);
+    }
+    for (std::thread& t : pool)
+    {
+        t.join();
+    }
+
+    std::set<int> pbuffers;
+    bool intact = true;
+    for (Chunk& c : mChunks)
+    {
+        intact = intact && !c.error;
+        if (!intact) continue;
+        for (const auto& it : c.events)
+        {
+            if (InFileBase::isFrameEnd(it.first, mTid, pbuffers))
+            {
+                c.frameEnds.push_back(it.second);
+            }
+        }
+    }
+    return intact;
+}
+
+}
@@ -0,0 +1,71 @@
+#ifndef _COMMON_TRACE_SCAN_HPP_
+#define _COMMON_TRACE_SCAN_HPP_
+
+#include <common/in_file_mt.hpp>
+#include <common/trace_chunk.hpp>
+
+#include <functional>
+#include <utility>
+#include <vector>
+
+namespace common {
+
+// Walks all calls of a trace file from their headers alone, without decoding
+// any arguments. The chunks are decompressed and walked in parallel, then
+// frame ends are found in a pass over them in order, the way InFile counts
+// frames. Only for files opened without setReadAhead().
+class TraceScanner
+{
+public:
+    struct FrameEnd
+    {
+        uint64_t offset = 0;    // in the uncompressed chunk, just past the swap
+        uint64_t calls = 0;     // in the chunk, up to and including the swap
+    };
+
+    struct Chunk
+    {
+        ChunkRef ref;
+        int64_t offset = 0;             // of its framing, from the first chunk
+        const char* error = nullptr;    // why the chunk could not be walked
+        uint64_t uncompressed = 0;
+        uint64_t calls = 0;
+        // Only found up to the first bad chunk, since the pbuffer surfaces
+        // that decide them are not known after it
+        std::vector<FrameEnd> frameEnds;
+        // The swaps and surface changes in the chunk, and where they are
+        std::vector<std::pair<InFileBase::FrameEvent, FrameEnd>> events;
+    };
+
+    // Called for every call walked, with the index of the walking thread
+    typedef std::function<void(unsigned thread, const BCall& call, unsigned size)> CallFunc;
+
+    TraceScanner(InFile& file, int tid) : mFile(file), mTid(tid) {}
+
+    // Find the chunks of the file. Returns CHUNK_END, or CHUNK_TRUNCATED if
+    // the file ends in the middle of the last one.
+    ChunkStatus findChunks();
+
+    // Walk all chunks on the given number of threads, comparing checksums
+    // where the file has them if verify is set. Returns whether all chunks
+    // are intact.
+    bool scan(unsigned threads, bool verify, const CallFunc& onCall = CallFunc());
+
+    std::vector<Chunk>& chunks() { return mChunks; }
+    // Bytes after the last whole chunk
+    int64_t trailing() const { return mTrailing; }
+    // Offset of the first call in the uncompressed chunk
+    size_t callsBegin(size_t chunk) const { return chunk == 0 ? mFile.firstCallOffset() : 0; }
+
+private:
+    void walk(unsigned thread, size_t index, std::vector<char>& buffer, bool verify, const CallFunc& onCall);
+
+    InFile& mFile;
+    int mTid;
+    std::vector<Chunk> mChunks;
+    int64_t mTrailing = 0;
+};
+
+}
+
+#endif
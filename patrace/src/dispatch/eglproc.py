@@ -46,6 +46,99 @@ def ResetGLFuncPtrs():
     ResetFuncPtrsInAPI(glesapi)
     print('}')
 
+# Null driver bodies for the calls whose results the retracer depends on.
+# Everything else gets a generic body from NullBody().
+null_overrides = {
+    'eglGetError': ['return EGL_SUCCESS;'],
+    'eglGetDisplay': ['return (EGLDisplay)1;'],
+    'eglGetPlatformDisplay': ['return (EGLDisplay)1;'],
+    'eglGetPlatformDisplayEXT': ['return (EGLDisplay)1;'],
+    'eglInitialize': ['if (major) *major = 1;', 'if (minor) *minor = 5;', 'return EGL_TRUE;'],
+    'eglGetConfigs': ['if (configs && config_size > 0) configs[0] = (EGLConfig)1;', 'if (num_config) *num_config = 1;', 'return EGL_TRUE;'],
+    'eglChooseConfig': ['if (configs && config_size > 0) configs[0] = (EGLConfig)1;', 'if (num_config) *num_config = 1;', 'return EGL_TRUE;'],
+    'eglGetConfigAttrib': ['if (value) *value = nullConfigAttrib(attribute);', 'return EGL_TRUE;'],
+    'eglQueryString': ['return nullEglString(name);'],
+    'eglGetProcAddress': ['return (__eglMustCastToProperFunctionPointerType)_getNullProcAddress(procname);'],
+    'eglMakeCurrent': ['nullMakeCurrent(dpy, draw, read, ctx);', 'return EGL_TRUE;'],
+    'eglGetCurrentDisplay': ['return nullCurrentDisplay();'],
+    'eglGetCurrentSurface': ['return nullCurrentSurface(readdraw);'],
+    'eglGetCurrentContext': ['return nullCurrentContext();'],
+    'eglClientWaitSync': ['return EGL_CONDITION_SATISFIED_KHR;'],
+    'eglClientWaitSyncKHR': ['return EGL_CONDITION_SATISFIED_KHR;'],
+    'eglClientWaitSyncNV': ['return EGL_CONDITION_SATISFIED_NV;'],
+    'eglWaitSyncKHR': ['return EGL_TRUE;'],
+    'eglQueryAPI': ['return EGL_OPENGL_ES_API;'],
+    'glGetError': ['return GL_NO_ERROR;'],
+    'glGetString': ['return (const GLubyte *)nullGlString(name);'],
+    'glGetStringi': ['return (const GLubyte *)"";'],
+    'glGetIntegerv': ['nullGetIntegerv(pname, data);'],
+    'glGetShaderiv': ['if (params) *params = nullObjectParam(pname);'],
+    'glGetProgramiv': ['if (params) *params = nullObjectParam(pname);'],
+    'glCheckFramebufferStatus': ['return GL_FRAMEBUFFER_COMPLETE;'],
+    'glCheckFramebufferStatusOES': ['return GL_FRAMEBUFFER_COMPLETE;'],
+    'glClientWaitSync': ['return GL_ALREADY_SIGNALED;'],
+    'glBindBuffer': ['nullBindBuffer(target, buffer);'],
+    'glBindBufferBase': ['nullBindBuffer(target, buffer);'],
+    'glBindBufferRange': ['nullBindBuffer(target, buffer);'],
+    'glBufferData': ['nullBufferData(target, size);'],
+    'glBufferStorageEXT': ['nullBufferData(target, size);'],
+    'glDeleteBuffers': ['nullDeleteBuffers(n, buffers);'],
+    'glGetBufferParameteriv': ['if (params) *params = pname == GL_BUFFER_SIZE ? (GLint)nullBufferSize(target) : 0;'],
+    'glMapBufferRange': ['return nullMapBuffer(target, offset, length);'],
+    'glMapBufferRangeEXT': ['return nullMapBuffer(target, offset, length);'],
+    'glMapBufferOES': ['return nullMapBuffer(target, 0, nullBufferSize(target));'],
+}
+
+def NullResolve(type):
+    while isinstance(type, (stdapi.Const, stdapi.Alias)) and not isinstance(type, stdapi.Handle):
+        type = type.type
+    return type
+
+def NullIsName(type):
+    return isinstance(NullResolve(type), (stdapi.Handle, stdapi.IntPointer))
+
+# Entry points that return a new object. Their results must be unique and
+# non-zero whatever type the spec gives them, since the retracer maps them
+# to the names in the trace.
+def NullCreatesObject(function):
+    return function.name.startswith(('glCreate', 'eglCreate', 'glFenceSync', 'glGen'))
+
+def NullBody(function):
+    if function.name in null_overrides:
+        return null_overrides[function.name]
+    argNames = [arg.name for arg in function.args]
+    body = []
+    for arg in function.args:
+        if not arg.output:
+            continue
+        type = NullResolve(arg.type)
+        if isinstance(type, stdapi.Array) and NullIsName(type.type) and type.length in argNames:
+            # glGen*, glCreate* and friends
+            body.append('for (int i = 0; %s && i < (int)%s; i++) %s[i] = (%s)nullNextName();' % (arg.name, type.length, arg.name, type.type))
+        elif isinstance(type, (stdapi.Pointer, stdapi.Array, stdapi.String)) and type.type.expr not in ('void', 'GLvoid'):
+            body.append('if (%s) *%s = 0;' % (arg.name, arg.name))
+    if function.type is stdapi.Void:
+        pass
+    elif function.type.expr in ('EGLBoolean', 'GLboolean'):
+        body.append('return 1;')
+    elif NullIsName(function.type) or NullCreatesObject(function):
+        body.append('return (%s)nullNextName();' % function.type)
+    else:
+        body.append('return 0;')
+    return body
+
+def NullFunctions(api):
+    for function in api.functions:
+        print('static ' + function.prototype('null_' + function.name) + ' {')
+        for line in NullBody(function):
+            print('    ' + line)
+        print('}')
+        print()
+
+def NullProcTable(api):
+    for function in api.functions:
+        print('        { "%s", (void *)&null_%s },' % (function.name, function.name))
+
 if __name__ == '__main__':
     # glClientSideBufferData is a fake api to update client-side memory
     glesapi.delFunctionByName("glClientSideBufferData")
@@ -94,3 +187,29 @@ if __name__ == '__main__':
     print()
     ResetGLFuncPtrs()
     print()
+
+    #############################################################
+    sys.stdout = open('eglproc_null_auto.cpp', 'w')
+    print('// Generated by', sys.argv[0])
+    print('#include <dispatch/eglproc_auto.hpp>')
+    print('#include <dispatch/eglproc_null.hpp>')
+    print()
+    print('#include <string>')
+    print('#include <unordered_map>')
+    print()
+    print('#if defined(__GNUC__)')
+    print('#pragma GCC diagnostic ignored "-Wunused-parameter"')
+    print('#endif')
+    print()
+    NullFunctions(eglapi)
+    NullFunctions(glesapi)
+    print('void* _getNullProcAddress(const char* procName)')
+    print('{')
+    print('    static const std::unordered_map<std::string, void*> table = {')
+    NullProcTable(eglapi)
+    NullProcTable(glesapi)
+    print('    };')
+    print('    const auto it = table.find(procName);')
+    print('    return it != table.end() ? it->second : NULL;')
+    print('}')
+    print()
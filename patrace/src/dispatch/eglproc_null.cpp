@@ -0,0 +1,194 @@
+#include "eglproc_null.hpp"
+
+#include <atomic>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+    std::atomic<uintptr_t> gNextName(1);
+
+    std::mutex gCurrentMutex;
+    EGLDisplay gCurrentDisplay = EGL_NO_DISPLAY;
+    EGLSurface gCurrentDraw = EGL_NO_SURFACE;
+    EGLSurface gCurrentRead = EGL_NO_SURFACE;
+    EGLContext gCurrentContext = EGL_NO_CONTEXT;
+
+    std::mutex gBufferMutex;
+    std::unordered_map<GLenum, GLuint> gBoundBuffers;
+    std::unordered_map<GLuint, std::vector<char>> gBufferStorage;
+};
+
+uintptr_t nullNextName()
+{
+    return gNextName.fetch_add(1, std::memory_order_relaxed);
+}
+
+EGLint nullConfigAttrib(EGLint attribute)
+{
+    switch (attribute)
+    {
+    case EGL_RED_SIZE:
+    case EGL_GREEN_SIZE:
+    case EGL_BLUE_SIZE:
+    case EGL_ALPHA_SIZE:
+    case EGL_STENCIL_SIZE:
+        return 8;
+    case EGL_BUFFER_SIZE:
+        return 32;
+    case EGL_DEPTH_SIZE:
+        return 24;
+    case EGL_CONFIG_ID:
+        return 1;
+    case EGL_SURFACE_TYPE:
+        return EGL_WINDOW_BIT | EGL_PBUFFER_BIT;
+    case EGL_RENDERABLE_TYPE:
+    case EGL_CONFORMANT:
+        return EGL_OPENGL_ES_BIT | EGL_OPENGL_ES2_BIT | EGL_OPENGL_ES3_BIT_KHR;
+    case EGL_COLOR_BUFFER_TYPE:
+        return EGL_RGB_BUFFER;
+    case EGL_CONFIG_CAVEAT:
+    case EGL_TRANSPARENT_TYPE:
+        return EGL_NONE;
+    default:
+        return 0;
+    }
+}
+
+const char* nullEglString(EGLint name)
+{
+    switch (name)
+    {
+    case EGL_VENDOR: return "patrace null driver";
+    case EGL_VERSION: return "1.5 null";
+    case EGL_CLIENT_APIS: return "OpenGL_ES";
+    default: return "";
+    }
+}
+
+const char* nullGlString(GLenum name)
+{
+    switch (name)
+    {
+    case GL_VENDOR: return "patrace";
+    case GL_RENDERER: return "null driver";
+    case GL_VERSION: return "OpenGL ES 3.2 null";
+    case GL_SHADING_LANGUAGE_VERSION: return "OpenGL ES GLSL ES 3.20";
+    default: return "";
+    }
+}
+
+void nullGetIntegerv(GLenum pname, GLint* data)
+{
+    switch (pname)
+    {
+    case GL_MAJOR_VERSION: data[0] = 3; break;
+    case GL_MINOR_VERSION: data[0] = 2; break;
+    case GL_MAX_TEXTURE_SIZE:
+    case GL_MAX_CUBE_MAP_TEXTURE_SIZE:
+    case GL_MAX_RENDERBUFFER_SIZE:
+        data[0] = 16384;
+        break;
+    case GL_MAX_VIEWPORT_DIMS:
+        data[0] = data[1] = 16384;
+        break;
+    case GL_MAX_3D_TEXTURE_SIZE: data[0] = 2048; break;
+    case GL_MAX_ARRAY_TEXTURE_LAYERS: data[0] = 2048; break;
+    case GL_MAX_VERTEX_ATTRIBS: data[0] = 16; break;
+    case GL_MAX_TEXTURE_IMAGE_UNITS: data[0] = 16; break;
+    case GL_MAX_VERTEX_TEXTURE_IMAGE_UNITS: data[0] = 16; break;
+    case GL_MAX_COMBINED_TEXTURE_IMAGE_UNITS: data[0] = 96; break;
+    case GL_MAX_COLOR_ATTACHMENTS: data[0] = 8; break;
+    case GL_MAX_DRAW_BUFFERS: data[0] = 8; break;
+    case GL_MAX_SAMPLES: data[0] = 4; break;
+    case GL_MAX_UNIFORM_BUFFER_BINDINGS: data[0] = 36; break;
+    case GL_MAX_SHADER_STORAGE_BUFFER_BINDINGS: data[0] = 36; break;
+    case GL_MAX_ATOMIC_COUNTER_BUFFER_BINDINGS: data[0] = 1; break;
+    case GL_MAX_TRANSFORM_FEEDBACK_SEPARATE_ATTRIBS: data[0] = 4; break;
+    case GL_PACK_ALIGNMENT:
+    case GL_UNPACK_ALIGNMENT:
+        data[0] = 4;
+        break;
+    case GL_IMPLEMENTATION_COLOR_READ_FORMAT: data[0] = GL_RGBA; break;
+    case GL_IMPLEMENTATION_COLOR_READ_TYPE: data[0] = GL_UNSIGNED_BYTE; break;
+    default: data[0] = 0; break;
+    }
+}
+
+GLint nullObjectParam(GLenum pname)
+{
+    switch (pname)
+    {
+    case GL_COMPILE_STATUS:
+    case GL_LINK_STATUS:
+    case GL_VALIDATE_STATUS:
+        return GL_TRUE;
+    default:
+        return 0;
+    }
+}
+
+void nullMakeCurrent(EGLDisplay dpy, EGLSurface draw, EGLSurface read, EGLContext ctx)
+{
+    std::lock_guard<std::mutex> lock(gCurrentMutex);
+    gCurrentDisplay = dpy;
+    gCurrentDraw = draw;
+    gCurrentRead = read;
+    gCurrentContext = ctx;
+}
+
+EGLDisplay nullCurrentDisplay()
+{
+    std::lock_guard<std::mutex> lock(gCurrentMutex);
+    return gCurrentDisplay;
+}
+
+EGLSurface nullCurrentSurface(EGLint readdraw)
+{
+    std::lock_guard<std::mutex> lock(gCurrentMutex);
+    return readdraw == EGL_READ ? gCurrentRead : gCurrentDraw;
+}
+
+EGLContext nullCurrentContext()
+{
+    std::lock_guard<std::mutex> lock(gCurrentMutex);
+    return gCurrentContext;
+}
+
+void nullBindBuffer(GLenum target, GLuint buffer)
+{
+    std::lock_guard<std::mutex> lock(gBufferMutex);
+    gBoundBuffers[target] = buffer;
+}
+
+void nullBufferData(GLenum target, GLsizeiptr size)
+{
+    std::lock_guard<std::mutex> lock(gBufferMutex);
+    gBufferStorage[gBoundBuffers[target]].resize(size);
+}
+
+void nullDeleteBuffers(GLsizei n, const GLuint* buffers)
+{
+    std::lock_guard<std::mutex> lock(gBufferMutex);
+    for (GLsizei i = 0; buffers && i < n; i++)
+    {
+        gBufferStorage.erase(buffers[i]);
+    }
+}
+
+GLsizeiptr nullBufferSize(GLenum target)
+{
+    std::lock_guard<std::mutex> lock(gBufferMutex);
+    return gBufferStorage[gBoundBuffers[target]].size();
+}
+
+void* nullMapBuffer(GLenum target, GLintptr offset, GLsizeiptr length)
+{
+    std::lock_guard<std::mutex> lock(gBufferMutex);
+    std::vector<char>& storage = gBufferStorage[gBoundBuffers[target]];
+    if ((size_t)(offset + length) > storage.size())
+    {
+        storage.resize(offset + length);
+    }
+    return storage.data() + offset;
+}
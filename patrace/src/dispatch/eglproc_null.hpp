@@ -0,0 +1,40 @@
+#ifndef _DISPATCH_EGLPROC_NULL_HPP_
+#define _DISPATCH_EGLPROC_NULL_HPP_
+
+#include "eglimports.hpp"
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Null driver: EGL and GLES entry points that do nothing, so that the cost
+// of the replayer itself can be measured without a GPU or a display. The
+// entry points are generated from the API specs by eglproc.py into
+// eglproc_null_auto.cpp; the helpers below provide plausible values for
+// the few calls whose results the retracer depends on.
+
+// Look up a null driver entry point by name
+void* _getNullProcAddress(const char* procName);
+
+// Unique non-zero name for generated objects (textures, programs, contexts, ...)
+uintptr_t nullNextName();
+
+EGLint nullConfigAttrib(EGLint attribute);
+const char* nullEglString(EGLint name);
+const char* nullGlString(GLenum name);
+void nullGetIntegerv(GLenum pname, GLint* data);
+GLint nullObjectParam(GLenum pname);
+
+void nullMakeCurrent(EGLDisplay dpy, EGLSurface draw, EGLSurface read, EGLContext ctx);
+EGLDisplay nullCurrentDisplay();
+EGLSurface nullCurrentSurface(EGLint readdraw);
+EGLContext nullCurrentContext();
+
+// Buffer objects get real backing memory, since the retracer writes to
+// mapped buffers
+void nullBindBuffer(GLenum target, GLuint buffer);
+void nullBufferData(GLenum target, GLsizeiptr size);
+void nullDeleteBuffers(GLsizei n, const GLuint* buffers);
+GLsizeiptr nullBufferSize(GLenum target);
+void* nullMapBuffer(GLenum target, GLintptr offset, GLsizeiptr length);
+
+#endif
@@ -26,6 +26,7 @@
 #include "eglproc_retrace.hpp"
 
 #include "eglproc_auto.hpp"
+#include "eglproc_null.hpp"
 #include "os.hpp"
 #include "common/library.hpp"
 #include "os_string.hpp"
@@ -83,6 +84,7 @@ static struct CommandLineSettings{
     std::string libEGL_path;
     std::string libGLESv1_path;
     std::string libGLESv2_path;
+    bool nullDriver = false;
 } gCommandLineSettings;
 
 void SetCommandLineEGLPath(const std::string& libEGL_path) {
@@ -97,6 +99,10 @@ void SetCommandLineGLES2Path(const std::string& libGLESv2_path) {
     gCommandLineSettings.libGLESv2_path = libGLESv2_path;
 }
 
+void SetNullDriver(bool enable) {
+    gCommandLineSettings.nullDriver = enable;
+}
+
 namespace {
     DLL_HANDLE gEGLHandle = 0;
     DLL_HANDLE gGLES2Handle = 0;
@@ -220,6 +226,17 @@ void* _getProcAddress(const char* procName)
 {
     void* retValue = NULL;
 
+    if (gCommandLineSettings.nullDriver)
+    {
+        retValue = _getNullProcAddress(procName);
+        if (retValue == NULL && complained.count(procName) == 0)
+        {
+            DBG_LOG("Null driver has no function %s\n", procName);
+            complained.insert(procName);
+        }
+        return retValue;
+    }
+
     if (gEGLHandle == NULL || gGLES2Handle == NULL)
     {
         // for ARM GLES 3.0 emulator, a symbol needed by libEGL
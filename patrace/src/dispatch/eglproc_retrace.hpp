@@ -5,5 +5,7 @@
 extern void SetCommandLineEGLPath(const std::string& libEGL_path);
 extern void SetCommandLineGLES1Path(const std::string& libGLESv1_path);
 extern void SetCommandLineGLES2Path(const std::string& libGLESv2_path);
+// Resolve all EGL and GLES entry points to the null driver instead of loading any libraries
+extern void SetNullDriver(bool enable);
 
 #endif
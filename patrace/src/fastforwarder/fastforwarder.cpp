@@ -5,6 +5,14 @@
 #include <ctime>
 #include <unordered_set>
 #include <unordered_map>
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
 
 #include "common/out_file.hpp"
 #include "common/image.hpp"
@@ -63,6 +71,7 @@ struct FastForwardOptions
     unsigned int mEndFrame;
     unsigned int mFlags;
     unsigned int mFbo0Repeat;
+    unsigned int mSaveThreads;
     bool mResetFrameNumber;
 
     FastForwardOptions()
@@ -73,6 +82,7 @@ struct FastForwardOptions
         , mEndFrame(UINT32_MAX)
         , mFlags(FASTFORWARD_RESTORE_TEXTURES)
         , mFbo0Repeat(0)
+        , mSaveThreads(std::min(std::max(std::thread::hardware_concurrency(), 1u), 8u))
         , mResetFrameNumber(false)
     {}
 };
@@ -174,6 +184,218 @@ private:
     std::vector<char> mVector;
 };
 
+// Ordered output queue used while saving state. Readbacks are issued on the
+// GL thread, while conversion and serialisation of the read-back data run on
+// a small worker pool. Output is always written to the OutFile in the order
+// it was queued, so the generated trace does not depend on the thread count.
+// Only the GL thread may call the public methods.
+class SaveQueue
+{
+public:
+    typedef std::function<void(std::vector<char>& out)> Job;
+
+    struct Slot
+    {
+        Slot(size_t _cost) : submitted(false), ready(false), cost(_cost), data() {}
+        bool submitted;
+        bool ready;
+        size_t cost;
+        std::vector<char> data;
+    };
+    typedef std::shared_ptr<Slot> Ticket;
+
+    SaveQueue(common::OutFile& outFile, unsigned int numThreads, size_t maxPendingBytes = 512 * 1024 * 1024)
+        : mOutFile(outFile)
+        , mPendingBytes(0)
+        , mMaxPendingBytes(maxPendingBytes)
+        , mStop(false)
+    {
+        for (unsigned int i = 0; i < numThreads; ++i)
+        {
+            mWorkers.emplace_back(&SaveQueue::workerLoop, this);
+        }
+    }
+
+    ~SaveQueue()
+    {
+        finish();
+    }
+
+    // Write already serialised data after everything queued so far
+    void write(const char* data, size_t len)
+    {
+        drain(false);
+        if (mSlots.empty())
+        {
+            mOutFile.Write(data, len);
+            return;
+        }
+
+        Ticket slot = std::make_shared<Slot>(len);
+        slot->data.assign(data, data + len);
+        slot->submitted = true;
+        slot->ready = true;
+        mSlots.push_back(slot);
+        mPendingBytes += len;
+    }
+
+    // Reserve a place in the output for data that will be submitted later.
+    // Blocks while more than maxPendingBytes are waiting to be written,
+    // unless the oldest slot has not been submitted yet.
+    Ticket reserve(size_t cost)
+    {
+        drain(false);
+        while (!mSlots.empty() && mPendingBytes + cost > mMaxPendingBytes)
+        {
+            if (!drain(true))
+            {
+                break;
+            }
+        }
+
+        Ticket slot = std::make_shared<Slot>(cost);
+        mSlots.push_back(slot);
+        mPendingBytes += cost;
+        return slot;
+    }
+
+    // Fill a reserved slot by running job on a worker. An empty job cancels the slot.
+    void submit(const Ticket& slot, Job job)
+    {
+        if (mWorkers.empty() || !job)
+        {
+            if (job)
+            {
+                job(slot->data);
+            }
+            std::lock_guard<std::mutex> lock(mMutex);
+            slot->submitted = true;
+            slot->ready = true;
+            return;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            slot->submitted = true;
+            mJobs.push_back(std::make_pair(slot, job));
+        }
+        mJobCond.notify_one();
+    }
+
+    // Whether submitted jobs run on workers; if not, everything is saved on the GL thread
+    bool threaded() const
+    {
+        return !mWorkers.empty();
+    }
+
+    // Wait until everything queued so far is written. All reserved slots
+    // must have been submitted.
+    void sync()
+    {
+        while (!mSlots.empty())
+        {
+            if (!drain(true))
+            {
+                DBG_LOG("SaveQueue::sync called with a reserved slot that was never submitted\n");
+                os::abort();
+            }
+        }
+    }
+
+    // Like sync(), but also stops the workers. Later submissions run inline.
+    void finish()
+    {
+        sync();
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            mStop = true;
+        }
+        mJobCond.notify_all();
+        for (std::thread& t : mWorkers)
+        {
+            t.join();
+        }
+        mWorkers.clear();
+    }
+
+private:
+    // Noncopyable
+    SaveQueue(const SaveQueue&);
+    SaveQueue& operator=(const SaveQueue&);
+
+    // Write out finished slots from the front of the queue. If block is set,
+    // wait for the first slot to finish; returns false if it can't because
+    // it has not been submitted.
+    bool drain(bool block)
+    {
+        std::vector<Ticket> done;
+        {
+            std::unique_lock<std::mutex> lock(mMutex);
+            if (block && !mSlots.empty())
+            {
+                if (!mSlots.front()->submitted)
+                {
+                    return false;
+                }
+                mDoneCond.wait(lock, [this]{ return mSlots.front()->ready; });
+            }
+            while (!mSlots.empty() && mSlots.front()->ready)
+            {
+                done.push_back(mSlots.front());
+                mSlots.pop_front();
+            }
+        }
+
+        for (const Ticket& slot : done)
+        {
+            if (!slot->data.empty())
+            {
+                mOutFile.Write(slot->data.data(), slot->data.size());
+            }
+            mPendingBytes -= slot->cost;
+        }
+        return true;
+    }
+
+    void workerLoop()
+    {
+        for (;;)
+        {
+            std::pair<Ticket, Job> item;
+            {
+                std::unique_lock<std::mutex> lock(mMutex);
+                mJobCond.wait(lock, [this]{ return mStop || !mJobs.empty(); });
+                if (mJobs.empty())
+                {
+                    return;
+                }
+                item = mJobs.front();
+                mJobs.pop_front();
+            }
+
+            item.second(item.first->data);
+
+            {
+                std::lock_guard<std::mutex> lock(mMutex);
+                item.first->ready = true;
+            }
+            mDoneCond.notify_all();
+        }
+    }
+
+    common::OutFile& mOutFile;
+    std::vector<std::thread> mWorkers;
+    std::mutex mMutex;
+    std::condition_variable mJobCond;
+    std::condition_variable mDoneCond;
+    std::deque<std::pair<Ticket, Job>> mJobs;
+    // Touched by the GL thread only; the slots' ready flag and data are guarded by mMutex
+    std::deque<Ticket> mSlots;
+    size_t mPendingBytes;
+    size_t mMaxPendingBytes;
+    bool mStop;
+};
+
 // NOTE: This emits commands in the _V4_ trace file format!
 class TraceCommandEmitter
 {
@@ -186,6 +408,7 @@ public:
         : mScratchBuff(0)
         , mOutFile(outFile)
         , mThreadId(threadId)
+        , mQueue(NULL)
         // NOTE: getId checks that the ids are valid, and aborts if not.
         , mGlGenBuffersId(getId("glGenBuffers"))
         , mGlDeleteBuffersId(getId("glDeleteBuffers"))
@@ -239,7 +462,7 @@ public:
         dest = writeBCall(dest, mGlDisable);
         dest = common::WriteFixed<int>(dest, cap); // enum
 
-        mOutFile.Write(bufStart, dest - bufStart);
+        write(bufStart, dest - bufStart);
     }
 
     void emitEnable(GLenum cap)
@@ -251,7 +474,7 @@ public:
         dest = writeBCall(dest, mGlEnable);
         dest = common::WriteFixed<int>(dest, cap); // enum
 
-        mOutFile.Write(bufStart, dest - bufStart);
+        write(bufStart, dest - bufStart);
     }
 
     void emitClear(GLbitfield mask)
@@ -263,7 +486,7 @@ public:
         dest = writeBCall(dest, mGlClear);
         dest = common::WriteFixed<int>(dest, mask);
 
-        mOutFile.Write(bufStart, dest - bufStart);
+        write(bufStart, dest - bufStart);
     }
 
     void emitClearColor(GLfloat red, GLfloat green, GLfloat blue, GLfloat alpha)
@@ -278,14 +501,25 @@ public:
         dest = common::WriteFixed<float>(dest, blue);
         dest = common::WriteFixed<float>(dest, alpha);
 
-        mOutFile.Write(bufStart, dest - bufStart);
+        write(bufStart, dest - bufStart);
     }
 
-    void emitBufferData(GLenum target, GLsizeiptr size, const GLvoid* data, GLenum usage)
+    // Route all output through queue (or directly to the OutFile if NULL), so
+    // that commands stay ordered with data serialised on worker threads.
+    void setQueue(SaveQueue* queue)
     {
-        mScratchBuff.resizeToFit(sizeof(common::BCall_vlen) + sizeof(int) * 3 + size + 32);
+        mQueue = queue;
+    }
 
-        char* const bufStart = mScratchBuff.bufferPtr();
+    static size_t bufferDataCallSize(GLsizeiptr size)
+    {
+        return sizeof(common::BCall_vlen) + sizeof(int) * 3 + size + 32;
+    }
+
+    // Serialise glBufferData into bufStart, which must hold bufferDataCallSize(size)
+    // bytes. Safe to call from worker threads. Returns the size of the call.
+    int writeBufferData(char* const bufStart, GLenum target, GLsizeiptr size, const GLvoid* data, GLenum usage) const
+    {
         char* tmpBuf = bufStart;
 
         // Make room for BCall_vlen at start of buffer
@@ -300,20 +534,32 @@ public:
         int toNext = tmpBuf - bufStart;
         writeBCall_vlen(bufStart, mGlBufferDataId, toNext);
 
-        mOutFile.Write(bufStart, toNext);
+        return toNext;
     }
 
-    void emitTexSubImage(TexDimension dimension, GLenum target, GLint level,
-                         GLint xoffset, GLint yoffset, GLint zoffset,
-                         GLsizei width, GLsizei height, GLsizei depth,
-                         GLenum format, GLenum type, unsigned int textureSize, const char* data)
+    void emitBufferData(GLenum target, GLsizeiptr size, const GLvoid* data, GLenum usage)
     {
-        if (dimension == Tex2D)
-            mScratchBuff.resizeToFit(sizeof(common::BCall_vlen) + sizeof(int) * 9 + textureSize + 32);
-        else if (dimension == Tex3D)
-            mScratchBuff.resizeToFit(sizeof(common::BCall_vlen) + sizeof(int) * 11 + textureSize + 32);
+        mScratchBuff.resizeToFit(bufferDataCallSize(size));
 
         char* const bufStart = mScratchBuff.bufferPtr();
+        int toNext = writeBufferData(bufStart, target, size, data, usage);
+
+        write(bufStart, toNext);
+    }
+
+    static size_t texSubImageCallSize(TexDimension dimension, unsigned int textureSize)
+    {
+        return sizeof(common::BCall_vlen) + sizeof(int) * (dimension == Tex3D ? 11 : 9) + textureSize + 32;
+    }
+
+    // Serialise glTexSubImage2D/3D into bufStart, which must hold
+    // texSubImageCallSize() bytes. Safe to call from worker threads.
+    // Returns the size of the call.
+    int writeTexSubImage(char* const bufStart, TexDimension dimension, GLenum target, GLint level,
+                         GLint xoffset, GLint yoffset, GLint zoffset,
+                         GLsizei width, GLsizei height, GLsizei depth,
+                         GLenum format, GLenum type, unsigned int textureSize, const char* data) const
+    {
         char* dest = bufStart;
 
         // Written last (need to know toNext)
@@ -341,7 +587,21 @@ public:
         else if (dimension == Tex3D)
             writeBCall_vlen(bufStart, mGlTexSubImage3DId, toNext);
 
-        mOutFile.Write(bufStart, toNext);
+        return toNext;
+    }
+
+    void emitTexSubImage(TexDimension dimension, GLenum target, GLint level,
+                         GLint xoffset, GLint yoffset, GLint zoffset,
+                         GLsizei width, GLsizei height, GLsizei depth,
+                         GLenum format, GLenum type, unsigned int textureSize, const char* data)
+    {
+        mScratchBuff.resizeToFit(texSubImageCallSize(dimension, textureSize));
+
+        char* const bufStart = mScratchBuff.bufferPtr();
+        int toNext = writeTexSubImage(bufStart, dimension, target, level, xoffset, yoffset, zoffset,
+                                      width, height, depth, format, type, textureSize, data);
+
+        write(bufStart, toNext);
     }
 
     void emitPixelStorei(GLenum pname, GLint param)
@@ -354,7 +614,7 @@ public:
         dest = common::WriteFixed<int>(dest, pname); // enum
         dest = common::WriteFixed<unsigned int>(dest, param); // literal
 
-        mOutFile.Write(bufStart, dest - bufStart);
+        write(bufStart, dest - bufStart);
     }
 
     void emitTexParameteri(unsigned int target, GLenum pname, unsigned int param)
@@ -368,7 +628,7 @@ public:
         dest = common::WriteFixed<int>(dest, pname); // enum
         dest = common::WriteFixed<int>(dest, param); // literal
 
-        mOutFile.Write(bufStart, dest - bufStart);
+        write(bufStart, dest - bufStart);
     }
 
     void emitTexParameterf(unsigned int target, GLenum pname, float param)
@@ -382,7 +642,7 @@ public:
         dest = common::WriteFixed<int>(dest, pname); // enum
         dest = common::WriteFixed<float>(dest, param); // literal
 
-        mOutFile.Write(bufStart, dest - bufStart);
+        write(bufStart, dest - bufStart);
     }
 
     void emitBindTexture(GLenum target, GLuint tex)
@@ -395,7 +655,7 @@ public:
         dest = common::WriteFixed<int>(dest, target); // enum
         dest = common::WriteFixed<unsigned int>(dest, tex); // literal
 
-        mOutFile.Write(bufStart, dest - bufStart);
+        write(bufStart, dest - bufStart);
     }
 
     void emitBindFramebuffer(GLenum target, GLint id)
@@ -408,7 +668,7 @@ public:
         dest = common::WriteFixed<int>(dest, (int) target); // enum
         dest = common::WriteFixed<unsigned int>(dest, id); // literal
 
-        mOutFile.Write(bufStart, dest - bufStart);
+        write(bufStart, dest - bufStart);
     }
 
     void emitBindBuffer(GLenum target, GLint id)
@@ -421,7 +681,7 @@ public:
         dest = common::WriteFixed<int>(dest, (int) target); // enum
         dest = common::WriteFixed<unsigned int>(dest, id); // literal
 
-        mOutFile.Write(bufStart, dest - bufStart);
+        write(bufStart, dest - bufStart);
     }
 
     void emitCreateShader(GLenum type, GLuint shader)
@@ -434,7 +694,7 @@ public:
         dest = common::WriteFixed(dest, (int)type);
         dest = common::WriteFixed(dest, shader);
 
-        mOutFile.Write(bufStart, dest - bufStart);
+        write(bufStart, dest - bufStart);
     }
 
     void emitShaderSource(GLuint shader, GLsizei count, const GLchar **string, const GLint *length)
@@ -480,7 +740,7 @@ public:
         int toNext = dest - bufStart;
         writeBCall_vlen(bufStart, mGlShaderSourceId, toNext);
 
-        mOutFile.Write(bufStart, dest - bufStart);
+        write(bufStart, dest - bufStart);
     }
 
     void emitCompileShader(GLuint shader)
@@ -493,7 +753,7 @@ public:
         dest = writeBCall(dest, mGlCompileShaderId);
         dest = common::WriteFixed<unsigned int>(dest, shader);
 
-        mOutFile.Write(bufStart, dest - bufStart);
+        write(bufStart, dest - bufStart);
     }
 
     void emitCreateProgram(GLuint program)
@@ -506,7 +766,7 @@ public:
         dest = writeBCall(dest, mGlCreateProgramId);
         dest = common::WriteFixed<unsigned int>(dest, program);
 
-        mOutFile.Write(bufStart, dest - bufStart);
+        write(bufStart, dest - bufStart);
     }
 
     void emitAttachShader(GLuint program, GLuint shader)
@@ -520,7 +780,7 @@ public:
         dest = common::WriteFixed<unsigned int>(dest, program);
         dest = common::WriteFixed<unsigned int>(dest, shader);
 
-        mOutFile.Write(bufStart, dest - bufStart);
+        write(bufStart, dest - bufStart);
     }
 
     void emitLinkProgram(GLuint program)
@@ -533,7 +793,7 @@ public:
         dest = writeBCall(dest, mGlLinkProgramId);
         dest = common::WriteFixed<unsigned int>(dest, program);
 
-        mOutFile.Write(bufStart, dest - bufStart);
+        write(bufStart, dest - bufStart);
     }
 
     void emitUseProgram(GLuint program)
@@ -546,7 +806,7 @@ public:
         dest = writeBCall(dest, mGlUseProgramId);
         dest = common::WriteFixed<unsigned int>(dest, program);
 
-        mOutFile.Write(bufStart, dest - bufStart);
+        write(bufStart, dest - bufStart);
     }
 
     void emitDeleteShader(GLuint shader)
@@ -559,7 +819,7 @@ public:
         dest = writeBCall(dest, mGlDeleteShaderId);
         dest = common::WriteFixed<unsigned int>(dest, shader);
 
-        mOutFile.Write(bufStart, dest - bufStart);
+        write(bufStart, dest - bufStart);
     }
 
     void emitDeleteProgram(GLuint program)
@@ -572,7 +832,7 @@ public:
         dest = writeBCall(dest, mGlDeleteProgramId);
         dest = common::WriteFixed<unsigned int>(dest, program);
 
-        mOutFile.Write(bufStart, dest - bufStart);
+        write(bufStart, dest - bufStart);
     }
 
     void emitActiveTexture(GLenum target)
@@ -585,7 +845,7 @@ public:
         dest = writeBCall(dest, mGlActiveTextureId);
         dest = common::WriteFixed<int>(dest, target);
 
-        mOutFile.Write(bufStart, dest - bufStart);
+        write(bufStart, dest - bufStart);
     }
 
     void emitGenTextures(GLsizei n, GLuint *textures)
@@ -603,7 +863,7 @@ public:
         int toNext = dest - bufStart;
         writeBCall_vlen(bufStart, mGlGenTexturesId, toNext);
 
-        mOutFile.Write(bufStart, dest - bufStart);
+        write(bufStart, dest - bufStart);
     }
 
     void emitTexImage2D(GLenum target,
@@ -640,7 +900,7 @@ public:
         int toNext = dest - bufStart;
         writeBCall_vlen(bufStart, mGlTexImage2DId, toNext);
 
-        mOutFile.Write(bufStart, toNext);
+        write(bufStart, toNext);
     }
 
     void emitGenBuffers(GLsizei n, GLuint *buffer)
@@ -659,7 +919,7 @@ public:
         int toNext = dest - bufStart;
         writeBCall_vlen(bufStart, mGlGenBuffersId, toNext);
 
-        mOutFile.Write(bufStart, toNext);
+        write(bufStart, toNext);
     }
 
     void emitBindVertexArray(GLuint array)
@@ -672,7 +932,7 @@ public:
         dest = writeBCall(dest, mGlBindVertexArrayId);
         dest = common::WriteFixed<unsigned int>(dest, array);
 
-        mOutFile.Write(bufStart, dest - bufStart);
+        write(bufStart, dest - bufStart);
     }
 
     void emitVertexAttibPointer(GLuint index,
@@ -700,7 +960,7 @@ public:
         int toNext = dest - bufStart;
         writeBCall_vlen(bufStart, mGlVertexAttribPointerId, toNext);
 
-        mOutFile.Write(bufStart, toNext);
+        write(bufStart, toNext);
     }
 
     void emitEnableVertexAttribArray(GLuint index)
@@ -713,7 +973,7 @@ public:
         dest = writeBCall(dest, mGlEnableVertexAttribArrayId);
         dest = common::WriteFixed<unsigned int>(dest, index);
 
-        mOutFile.Write(bufStart, dest - bufStart);
+        write(bufStart, dest - bufStart);
     }
 
     void emitViewport(GLint x, GLint y, GLsizei width, GLsizei height)
@@ -729,7 +989,7 @@ public:
         dest = common::WriteFixed<int>(dest, width);  // literal
         dest = common::WriteFixed<int>(dest, height); // literal
 
-        mOutFile.Write(bufStart, dest - bufStart);
+        write(bufStart, dest - bufStart);
     }
 
     void emitColorMask(GLboolean red, GLboolean green, GLboolean blue, GLboolean alpha)
@@ -745,7 +1005,7 @@ public:
         dest = common::WriteFixed<unsigned char>(dest, blue);  // literal
         dest = common::WriteFixed<unsigned char>(dest, alpha); // literal
 
-        mOutFile.Write(bufStart, dest - bufStart);
+        write(bufStart, dest - bufStart);
     }
 
     void emitDrawElements(GLenum mode, GLsizei count, GLenum type, const GLvoid *indices)
@@ -766,7 +1026,7 @@ public:
         int toNext = dest - bufStart;
         writeBCall_vlen(bufStart, mGlDrawElements, toNext);
 
-        mOutFile.Write(bufStart, toNext);
+        write(bufStart, toNext);
     }
 
     void emitFrontFace(GLenum mode)
@@ -779,7 +1039,7 @@ public:
         dest = writeBCall(dest, mGlFrontFace);
         dest = common::WriteFixed<int>(dest, mode); // enum
 
-        mOutFile.Write(bufStart, dest - bufStart);
+        write(bufStart, dest - bufStart);
     }
 
     void emitDeleteTextures(GLsizei n, const GLuint *textures)
@@ -797,7 +1057,7 @@ public:
         int toNext = dest - bufStart;
         writeBCall_vlen(bufStart, mGlDeleteTexturesId, toNext);
 
-        mOutFile.Write(bufStart, toNext);
+        write(bufStart, toNext);
     }
 
     void emitVertexAttribIPointer(GLuint index,
@@ -823,7 +1083,7 @@ public:
         int toNext = dest - bufStart;
         writeBCall_vlen(bufStart, mGlVertexAttribIPointerId, toNext);
 
-        mOutFile.Write(bufStart, toNext);
+        write(bufStart, toNext);
     }
 
     void emitGlDisableVertexAttribArray(GLuint index)
@@ -836,7 +1096,7 @@ public:
         dest = writeBCall(dest, mGlDisableVertexAttribArrayId);
         dest = common::WriteFixed<unsigned int>(dest, index); // literal
 
-        mOutFile.Write(bufStart, dest - bufStart);
+        write(bufStart, dest - bufStart);
     }
 
     void emitDeleteBuffers(GLsizei n, const GLuint *buffers)
@@ -854,7 +1114,7 @@ public:
         int toNext = dest - bufStart;
         writeBCall_vlen(bufStart, mGlDeleteBuffersId, toNext);
 
-        mOutFile.Write(bufStart, toNext);
+        write(bufStart, toNext);
     }
 
     void emitBindSampler(GLuint unit, GLuint sampler)
@@ -868,7 +1128,7 @@ public:
         dest = common::WriteFixed<unsigned int>(dest, unit);
         dest = common::WriteFixed<unsigned int>(dest, sampler);
 
-        mOutFile.Write(bufStart, dest - bufStart);
+        write(bufStart, dest - bufStart);
     }
 
     void emitSwapBuffers(GLint dpy, GLint surface)
@@ -883,7 +1143,7 @@ public:
         dest = common::WriteFixed<GLint>(dest, surface);   // eglSurface
         dest = common::WriteFixed<int>(dest, 1); //result
 
-        mOutFile.Write(bufStart, dest - bufStart);
+        write(bufStart, dest - bufStart);
     }
 
     void emitMapBufferRange(GLenum target, GLintptr offset, GLsizeiptr length, GLbitfield access, GLvoid *result)
@@ -905,7 +1165,7 @@ public:
         int toNext = dest - bufStart;
         writeBCall_vlen(bufStart, mGlMapBufferRangeId, toNext);
 
-        mOutFile.Write(bufStart, toNext);
+        write(bufStart, toNext);
     }
 
     void emitUnmapBuffer(GLenum target)
@@ -920,13 +1180,22 @@ public:
         dest = common::WriteFixed<int>(dest, target); // enum
         dest = common::WriteFixed<unsigned char>(dest, 1); // result
 
-        mOutFile.Write(bufStart, dest - bufStart);
+        write(bufStart, dest - bufStart);
     }
 
 private:
+    void write(const char* data, size_t len)
+    {
+        if (mQueue)
+            mQueue->write(data, len);
+        else
+            mOutFile.Write(data, len);
+    }
+
     ScratchBuffer mScratchBuff;
     common::OutFile& mOutFile;
     int mThreadId;
+    SaveQueue* mQueue;
     int mGlGenBuffersId;
     int mGlDeleteBuffersId;
     int mGlBufferDataId;
@@ -997,7 +1266,7 @@ private:
         return dest + bcallSize;
     }
 
-    char* writeBCall_vlen(char* dest, int funcId, int toNext)
+    char* writeBCall_vlen(char* dest, int funcId, int toNext) const
     {
         common::BCall_vlen bcv;
         bcv.funcId = funcId;
@@ -1017,13 +1286,14 @@ private:
 class BufferSaver
 {
 public:
-    static void run(retracer::Context& retracerContext, common::OutFile& outFile, int threadId, unsigned int flags)
+    static void run(retracer::Context& retracerContext, common::OutFile& outFile, SaveQueue& queue, int threadId, unsigned int flags)
     {
         const auto buffers = retracerContext.getBufferMap().GetCopy();
         const auto revBuffers = retracerContext.getBufferRevMap().GetCopy();
 
         // Create helper which adds command to tracefile
         TraceCommandEmitter traceCommandEmitter(outFile, threadId);
+        traceCommandEmitter.setQueue(&queue);
 
         // Read buffer-id bound to GL_ARRAY_BUFFER locally (to restore when
         // done)
@@ -1132,6 +1402,8 @@ public:
                     }
 
                     // Emit glBufferData(GL_ARRAY_BUFFER, len, data, usage);
+                    // Serialised straight from the mapping: there is nothing to
+                    // convert, so handing a copy to a worker would only add copies.
                     traceCommandEmitter.emitBufferData(GL_ARRAY_BUFFER, buffLength, data, buffUsage);
                 }
                 _glUnmapBuffer(GL_ARRAY_BUFFER);
@@ -1150,6 +1422,9 @@ public:
 
         // Bind previously bound buffer locally
         _glBindBuffer(GL_ARRAY_BUFFER, oldBoundBuffer);
+
+        // Pending jobs refer to traceCommandEmitter
+        queue.sync();
     }
 };
 
@@ -1167,12 +1442,128 @@ bool checkError(const std::string &msg)
     return true;
 }
 
+// Ring of pixel pack buffers used to stage texture readbacks. glReadPixels
+// into a PBO does not wait for the GPU, so the copy of one image overlaps with
+// setting up the next. A buffer is only mapped when the ring wraps around to it
+// or on flush(), and its contents are then handed to the save queue.
+// Expects GL_PIXEL_PACK_BUFFER to be unbound, and leaves it unbound.
+class PackBufferPool
+{
+public:
+    typedef std::function<SaveQueue::Job(const std::shared_ptr<std::vector<char>>& pixels)> JobFactory;
+
+    PackBufferPool(SaveQueue& queue, unsigned int numBuffers = 4)
+        : mQueue(queue), mEntries(numBuffers), mNext(0)
+    {
+        for (Entry& e : mEntries)
+        {
+            _glGenBuffers(1, &e.pbo);
+        }
+    }
+
+    ~PackBufferPool()
+    {
+        flush();
+        for (Entry& e : mEntries)
+        {
+            _glDeleteBuffers(1, &e.pbo);
+        }
+    }
+
+    // Read pixels from the current read framebuffer. Once the data is available,
+    // the job made by factory is submitted to the queue in the position reserved
+    // now. Returns false if glReadPixels failed.
+    bool readPixels(GLsizei width, GLsizei height, GLenum format, GLenum type, size_t size, const JobFactory& factory)
+    {
+        Entry& e = mEntries[mNext];
+        mNext = (mNext + 1) % mEntries.size();
+        if (e.factory)
+        {
+            retire(e);
+        }
+
+        checkError("_glReadPixels begin");
+        _glBindBuffer(GL_PIXEL_PACK_BUFFER, e.pbo);
+        if (e.capacity < size)
+        {
+            _glBufferData(GL_PIXEL_PACK_BUFFER, size, NULL, GL_STREAM_READ);
+            e.capacity = size;
+        }
+        _glReadPixels(0, 0, width, height, format, type, 0);
+        _glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        if (checkError("_glReadPixels end"))
+        {
+            return false;
+        }
+
+        e.size = size;
+        e.ticket = mQueue.reserve(size);
+        e.factory = factory;
+        return true;
+    }
+
+    // Hand all outstanding readbacks to the queue
+    void flush()
+    {
+        for (size_t i = 0; i < mEntries.size(); ++i)
+        {
+            Entry& e = mEntries[(mNext + i) % mEntries.size()];
+            if (e.factory)
+            {
+                retire(e);
+            }
+        }
+    }
+
+private:
+    struct Entry
+    {
+        Entry() : pbo(0), capacity(0), size(0), ticket(), factory() {}
+        GLuint pbo;
+        size_t capacity;
+        size_t size;
+        SaveQueue::Ticket ticket;
+        JobFactory factory;
+    };
+
+    void retire(Entry& e)
+    {
+        SaveQueue::Job job;
+        _glBindBuffer(GL_PIXEL_PACK_BUFFER, e.pbo);
+        const char* mapped = (const char*)_glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, e.size, GL_MAP_READ_BIT);
+        if (mapped)
+        {
+            job = e.factory(std::make_shared<std::vector<char>>(mapped, mapped + e.size));
+            _glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+        }
+        else
+        {
+            DBG_LOG("---->> Failed to save the texture because glMapBufferRange of the pack buffer failed. <<-----\n");
+        }
+        _glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+        mQueue.submit(e.ticket, job);
+        e.ticket.reset();
+        e.factory = nullptr;
+    }
+
+    SaveQueue& mQueue;
+    std::vector<Entry> mEntries;
+    size_t mNext;
+};
+
 class TextureSaver
 {
 public:
-    TextureSaver(retracer::Context& retracerContext, common::OutFile& outFile, int threadId, unsigned int flags)
-        : mRetracerContext(retracerContext), mOutFile(outFile), mThreadId(threadId), mScratchBuff(), mFlags(flags)
+    TextureSaver(retracer::Context& retracerContext, common::OutFile& outFile, SaveQueue& queue, int threadId, unsigned int flags)
+        : mRetracerContext(retracerContext), mOutFile(outFile), mQueue(queue), mStaging(), mThreadId(threadId), mScratchBuff(), mFlags(flags)
     {
+        // Without workers the readback is not worth staging, so save as before
+        if (mQueue.threaded())
+        {
+            mStaging.reset(new PackBufferPool(mQueue));
+        }
+
         TexTypeInfo info2d("2D", GL_TEXTURE_2D, GL_TEXTURE_BINDING_2D, TraceCommandEmitter::Tex2D);
         TexTypeInfo info2dArray("2D_Array", GL_TEXTURE_2D_ARRAY, GL_TEXTURE_BINDING_2D_ARRAY, TraceCommandEmitter::Tex3D);
         TexTypeInfo infoCubemap("Cubemap", GL_TEXTURE_CUBE_MAP, GL_TEXTURE_BINDING_CUBE_MAP, TraceCommandEmitter::Tex2D);
@@ -1197,6 +1588,7 @@ public:
         checkError("TextureSaver::run begin");
 
         TraceCommandEmitter traceCommandEmitter(mOutFile, mThreadId);
+        traceCommandEmitter.setQueue(&mQueue);
 
         const auto textures = mRetracerContext.getTextureMap().GetCopy();
         const auto revTextures = mRetracerContext.getTextureRevMap().GetCopy();
@@ -1322,6 +1714,10 @@ public:
                 DBG_LOG("DEBUG: Texture %d (retrace-id %d) couldn't be saved.\n", traceTextureId, retraceTextureId);
             }
         }
+        if (mStaging)
+        {
+            mStaging->flush();
+        }
 
         // Restore values
         for (unsigned int i = 0; i < sizeof(storeParams)/sizeof(storeParams[0]); i++)
@@ -1340,9 +1736,71 @@ public:
         glBindBuffer(GL_PIXEL_PACK_BUFFER, oldPackBuffer);
         glBindBuffer(GL_PIXEL_UNPACK_BUFFER, oldUnpackBuffer);
 
+        // Pending jobs refer to traceCommandEmitter
+        mQueue.sync();
+
         checkError("TextureSaver::run end");
     }
 
+    // GL_DEPTH_COMPONENT16/24 is dumped as float, but restored as GL_UNSIGNED_INT
+    static void convertDepthToUnorm(std::vector<char>& pixels, int count)
+    {
+        float *fp = (float*)pixels.data();
+        unsigned int *ip = (unsigned int *)pixels.data();
+        for (int i = 0; i < count; ++i) {
+            unsigned int factor = 0xFFFFFFFFu;
+            ip[i] = (double)fp[i] * factor;
+        }
+    }
+
+    // Makes the worker job that converts one read-back image and serialises
+    // it as glTexSubImage2D/3D. The emitter must outlive the job.
+    PackBufferPool::JobFactory texSubImageJob(const TraceCommandEmitter& traceCommandEmitter, TraceCommandEmitter::TexDimension dimension,
+                                              GLenum target, GLint level, GLint zoffset, GLsizei width, GLsizei height, GLsizei depth,
+                                              GLenum format, GLenum type, unsigned int textureSize, bool unormDepth)
+    {
+        const TraceCommandEmitter* emitter = &traceCommandEmitter;
+        return [=](const std::shared_ptr<std::vector<char>>& pixels) -> SaveQueue::Job
+        {
+            return [=](std::vector<char>& out)
+            {
+                if (unormDepth)
+                {
+                    convertDepthToUnorm(*pixels, width * height);
+                }
+
+                out.resize(TraceCommandEmitter::texSubImageCallSize(dimension, textureSize));
+                out.resize(emitter->writeTexSubImage(out.data(), dimension, target, level, 0, 0, zoffset,
+                                                     width, height, depth, format, type, textureSize, pixels->data()));
+            };
+        };
+    }
+
+    // Read the current read framebuffer and emit glTexSubImage2D/3D with it. Goes
+    // through the pack buffer ring when saving on workers, otherwise reads and
+    // emits right away. Returns false if glReadPixels failed.
+    bool readTexSubImage(TraceCommandEmitter& traceCommandEmitter, TraceCommandEmitter::TexDimension dimension,
+                         GLenum target, GLint level, GLint zoffset, GLsizei width, GLsizei height, GLsizei depth,
+                         GLenum format, GLenum type, unsigned int textureSize)
+    {
+        if (mStaging)
+        {
+            return mStaging->readPixels(width, height, format, type, textureSize,
+                texSubImageJob(traceCommandEmitter, dimension, target, level, zoffset, width, height, depth, format, type, textureSize, false));
+        }
+
+        mScratchBuff.resizeToFit(textureSize);
+        checkError("_glReadPixels begin");
+        _glReadPixels(0, 0, width, height, format, type, mScratchBuff.bufferPtr());
+        if (checkError("_glReadPixels end"))
+        {
+            return false;
+        }
+        traceCommandEmitter.emitTexSubImage(dimension, target, level, 0, 0, zoffset, width, height, depth,
+                                            format, type, textureSize, mScratchBuff.bufferPtr());
+        return true;
+    }
+
     bool isArrayTex(DepthDumper::TexType type)
     {
         return !(type == DepthDumper::Tex2D || type == DepthDumper::TexCubemap || type == DepthDumper::Tex3D);
@@ -1782,7 +2240,6 @@ public:
             }
 #endif
 
-            ScratchBuffer texData(textureSize);
             bool readError = false;
 
             // Read texture data
@@ -1850,6 +2307,39 @@ public:
                     }
                 }
 
+                // Where glTexSubImage2D/3D for this layer goes
+                GLenum target = 0;
+                int zoffset = 0, depth = 0;
+                switch (texType) {
+                case DepthDumper::Tex2D:
+                    target = GL_TEXTURE_2D;
+                    zoffset = 0;
+                    depth = 0;
+                    break;
+                case DepthDumper::Tex2DArray:
+                    target = GL_TEXTURE_2D_ARRAY;
+                    zoffset = i;
+                    depth = 1;
+                    break;
+                case DepthDumper::TexCubemap:
+                    target = GL_TEXTURE_CUBE_MAP_POSITIVE_X + i;
+                    zoffset = 0;
+                    depth = 0;
+                    break;
+                case DepthDumper::TexCubemapArray:
+                    target = GL_TEXTURE_CUBE_MAP_ARRAY;
+                    zoffset = i;
+                    depth = 1;
+                    break;
+                case DepthDumper::Tex3D:
+                    target = GL_TEXTURE_3D;
+                    zoffset = i;
+                    depth = 1;
+                    break;
+                default:
+                    break;
+                }
+
 // The default support list of "format" of glReadPixels doesn't contain GL_DEPTH_COMPONENT.
 // According to my test, nvidia GPU supports it but arm GPU doesn't.
 // So we have to render the depth texture to a color texture and then glReadPixels from this color texture.
@@ -1858,91 +2348,54 @@ public:
 #ifdef ENABLE_X11
                 _glReadBuffer(GL_COLOR_ATTACHMENT0);
 
-                checkError("_glReadPixels begin");
+                if (!readError)
                 {
-                    DBG_LOG("ReadPixels: w=%d, h=%d, format=0x%X=%s, type=0x%X=%s, data=%p\n", mipmapSize.width, mipmapSize.height, readTexFormat, EnumString(readTexFormat), readTexType, EnumString(readTexType), texData.bufferPtr());
-                    _glReadPixels(0, 0, mipmapSize.width, mipmapSize.height, readTexFormat, readTexType, texData.bufferPtr());
+                    DBG_LOG("ReadPixels: w=%d, h=%d, format=0x%X=%s, type=0x%X=%s\n", mipmapSize.width, mipmapSize.height, readTexFormat, EnumString(readTexFormat), readTexType, EnumString(readTexType));
+                    readError |= !readTexSubImage(traceCommandEmitter, typeInfo.texDimension, target, curMipmapLevel, zoffset,
+                                                  mipmapSize.width, mipmapSize.height, depth, readTexFormat, readTexType, textureSize);
                 }
-                readError |= checkError("_glReadPixels end");
 #else   // ENABLE_X11 not being defined
                 if (readTexFormat == GL_DEPTH_COMPONENT || readTexFormat == GL_DEPTH_STENCIL) {
-                    depthDumper.get_depth_texture_image(retraceTextureId, mipmapSize.width, mipmapSize.height, texData.bufferPtr(), texInfo.mInternalFormat, texType, i);
-                    if (texInfo.mInternalFormat == GL_DEPTH_COMPONENT16 || texInfo.mInternalFormat == GL_DEPTH_COMPONENT24) {
-                        float *fp = (float*)texData.bufferPtr();
-                        unsigned int *ip = (unsigned int *)texData.bufferPtr();
-                        for (int i = 0; i < mipmapSize.width * mipmapSize.height; ++i) {
-                            unsigned int factor = 0xFFFFFFFFu;
-                            ip[i] = (double)fp[i] * factor;
-                        }
-                    }
-                    else if (texInfo.mInternalFormat == GL_DEPTH_COMPONENT32F) {
+                    std::shared_ptr<std::vector<char>> texData = std::make_shared<std::vector<char>>(textureSize);
+                    depthDumper.get_depth_texture_image(retraceTextureId, mipmapSize.width, mipmapSize.height, texData->data(), texInfo.mInternalFormat, texType, i);
+                    // Dumped as float; D16 and D24 are converted to GL_UNSIGNED_INT
+                    const bool unormDepth = texInfo.mInternalFormat == GL_DEPTH_COMPONENT16 || texInfo.mInternalFormat == GL_DEPTH_COMPONENT24;
+                    if (texInfo.mInternalFormat == GL_DEPTH_COMPONENT32F) {
                         DBG_LOG("WARNING: The texture of internalFormat GL_DEPTH_COMPONENT32F was never tested before. So there might be some problems!\n");
                     }
-                    DBG_LOG("depth dump: w=%d, h=%d, format=0x%X=%s, type=0x%X=%s, data=%p\n", mipmapSize.width, mipmapSize.height, readTexFormat, EnumString(readTexFormat), readTexType, EnumString(readTexType), texData.bufferPtr());
+                    DBG_LOG("depth dump: w=%d, h=%d, format=0x%X=%s, type=0x%X=%s, data=%p\n", mipmapSize.width, mipmapSize.height, readTexFormat, EnumString(readTexFormat), readTexType, EnumString(readTexType), texData->data());
+                    if (!readError && mQueue.threaded())
+                    {
+                        PackBufferPool::JobFactory factory = texSubImageJob(traceCommandEmitter, typeInfo.texDimension, target, curMipmapLevel, zoffset,
+                                                                            mipmapSize.width, mipmapSize.height, depth, readTexFormat, readTexType, textureSize, unormDepth);
+                        mQueue.submit(mQueue.reserve(textureSize), factory(texData));
+                    }
+                    else if (!readError)
+                    {
+                        if (unormDepth)
+                        {
+                            convertDepthToUnorm(*texData, mipmapSize.width * mipmapSize.height);
+                        }
+                        traceCommandEmitter.emitTexSubImage(typeInfo.texDimension, target, curMipmapLevel, 0, 0, zoffset,
+                                                            mipmapSize.width, mipmapSize.height, depth,
+                                                            readTexFormat, readTexType, textureSize, texData->data());
+                    }
                 }
                 else {
                     _glReadBuffer(GL_COLOR_ATTACHMENT0);
 
-                    checkError("_glReadPixels begin");
+                    if (!readError)
                     {
-                        DBG_LOG("ReadPixels: w=%d, h=%d, format=0x%X=%s, type=0x%X=%s, data=%p\n", mipmapSize.width, mipmapSize.height, readTexFormat, EnumString(readTexFormat), readTexType, EnumString(readTexType), texData.bufferPtr());
-                        _glReadPixels(0, 0, mipmapSize.width, mipmapSize.height, readTexFormat, readTexType, texData.bufferPtr());
+                        DBG_LOG("ReadPixels: w=%d, h=%d, format=0x%X=%s, type=0x%X=%s\n", mipmapSize.width, mipmapSize.height, readTexFormat, EnumString(readTexFormat), readTexType, EnumString(readTexType));
+                        readError |= !readTexSubImage(traceCommandEmitter, typeInfo.texDimension, target, curMipmapLevel, zoffset,
+                                                      mipmapSize.width, mipmapSize.height, depth, readTexFormat, readTexType, textureSize);
                     }
-                    readError |= checkError("_glReadPixels end");
                 }
 #endif  // ENABLE_X11 end
                 _glDeleteFramebuffers(1, &fbo);
                 checkError("Read texture data end");
 
-                // Write glTexSubImage2D for this level
-                if(!readError)
-                {
-                    GLenum target = 0;
-                    int zoffset = 0, depth = 0;
-                    switch (texType) {
-                    case DepthDumper::Tex2D:
-                        target = GL_TEXTURE_2D;
-                        zoffset = 0;
-                        depth = 0;
-                        break;
-                    case DepthDumper::Tex2DArray:
-                        target = GL_TEXTURE_2D_ARRAY;
-                        zoffset = i;
-                        depth = 1;
-                        break;
-                    case DepthDumper::TexCubemap:
-                        target = GL_TEXTURE_CUBE_MAP_POSITIVE_X + i;
-                        zoffset = 0;
-                        depth = 0;
-                        break;
-                    case DepthDumper::TexCubemapArray:
-                        target = GL_TEXTURE_CUBE_MAP_ARRAY;
-                        zoffset = i;
-                        depth = 1;
-                        break;
-                    case DepthDumper::Tex3D:
-                        target = GL_TEXTURE_3D;
-                        zoffset = i;
-                        depth = 1;
-                        break;
-                    default:
-                        break;
-                    }
-                    traceCommandEmitter.emitTexSubImage(typeInfo.texDimension, // dimension
-                        target,             // target
-                        curMipmapLevel,     // level
-                        0,                  // xoffset
-                        0,                  // yoffset
-                        zoffset,            // zoffset
-                        mipmapSize.width,   // width
-                        mipmapSize.height,  // height
-                        depth,              // depth
-                        readTexFormat,      // format
-                        readTexType,        // type
-                        textureSize,
-                        (const char*) texData.bufferPtr());
-                }
-                else
+                if (readError)
                 {
                     DBG_LOG("---->> Failed to save the texture because glReadPixels failed. <<-----\n");
                 }
@@ -1982,6 +2435,8 @@ private:
     std::map<DepthDumper::TexType, TexTypeInfo> texTypeToInfo;
     retracer::Context& mRetracerContext;
     common::OutFile& mOutFile;
+    SaveQueue& mQueue;
+    std::unique_ptr<PackBufferPool> mStaging; // only when saving on workers
     int mThreadId;
     ScratchBuffer mScratchBuff;
     unsigned int mFlags;
@@ -3340,7 +3795,7 @@ bool checkTexSubImage()
     return true;
 }
 
-static void saveData(common::OutFile &out, unsigned int flags, unsigned int repeat, Json::Value& ffJson, GLint dpy, GLint surface)
+static void saveData(common::OutFile &out, unsigned int flags, unsigned int repeat, unsigned int saveThreads, Json::Value& ffJson, GLint dpy, GLint surface)
 {
     retracer::Retracer& retracer = gRetracer;
 
@@ -3356,17 +3811,21 @@ static void saveData(common::OutFile &out, unsigned int flags, unsigned int repe
     _glMemoryBarrier(GL_ALL_BARRIER_BITS);
     _glFinish();
 
+    // Buffer and texture contents are serialised on worker threads
+    RetraceAndTrim::SaveQueue saveQueue(out, saveThreads);
+
     // Save buffers
     {
-    RetraceAndTrim::BufferSaver::run(retracer.getCurrentContext(), out, retracer.getCurTid(), flags);
+    RetraceAndTrim::BufferSaver::run(retracer.getCurrentContext(), out, saveQueue, retracer.getCurTid(), flags);
     }
 
     // Save texture
     if (flags & FASTFORWARD_RESTORE_TEXTURES)
     {
-        RetraceAndTrim::TextureSaver ts(retracer.getCurrentContext(), out, retracer.getCurTid(), flags);
+        RetraceAndTrim::TextureSaver ts(retracer.getCurrentContext(), out, saveQueue, retracer.getCurTid(), flags);
         ts.run();
     }
+    saveQueue.finish();
 
     if (flags & FASTFORWARD_RESTORE_DEFAUTL_FBO)
     {
@@ -3438,7 +3897,7 @@ static void replay_thread(common::OutFile &out, const int threadidx, const int o
                 src = common::ReadFixed(src, dpy);
                 src = common::ReadFixed(src, surface);
             }
-            saveData(out, ffOptions.mFlags, ffOptions.mFbo0Repeat, ffJson, dpy, surface);
+            saveData(out, ffOptions.mFlags, ffOptions.mFbo0Repeat, ffOptions.mSaveThreads, ffJson, dpy, surface);
             DBG_LOG("Done saving GL state\n");
         }
 
@@ -3632,6 +4091,7 @@ usage(const char *argv0)
         "  --txu Remove the unused textures,buffers and related function calls.\n"
         "  --shu Remove the unused shaders and related function calls.\n"
         "  --restartframenum Set the flag restartFrameNumbering to true.\n"
+        "  --savethreads <n> Number of worker threads used to serialise saved textures and buffers. 0 saves everything on the GL thread. (default: number of cores, at most 8)\n"
         "\n"
         , argv0);
 }
@@ -3748,6 +4208,10 @@ static bool ParseCommandLine(int argc, char** argv, FastForwardOptions& ffOption
         {
             ffOptions.mResetFrameNumber = true;
         }
+        else if (!strcmp(arg, "--savethreads"))
+        {
+            ffOptions.mSaveThreads = readValidValue(argv[++i]);
+        }
         else
         {
             DBG_LOG("error: unknown option %s\n", arg);
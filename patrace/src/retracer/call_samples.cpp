@@ -0,0 +1,139 @@
+#include "retracer/call_samples.hpp"
+
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include <inttypes.h>
+
+#include "common/os.hpp"
+
+namespace retracer {
+
+static uint64_t monotonicNs()
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC_RAW, &t);
+    return ((uint64_t)t.tv_sec * 1000000000ull + (uint64_t)t.tv_nsec);
+}
+
+static double calibrateCycleCounter()
+{
+#if defined(__aarch64__)
+    uint64_t freq;
+    asm volatile("mrs %0, cntfrq_el0" : "=r"(freq));
+    if (freq) return 1000000000.0 / freq;
+#endif
+#if defined(__x86_64__) || defined(__i386__) || defined(__aarch64__)
+    // TSC frequency is not exposed to userspace, so measure it against the
+    // monotonic clock
+    const uint64_t ns0 = monotonicNs();
+    const uint64_t t0 = readCycleCounter();
+    usleep(20000);
+    const uint64_t ns1 = monotonicNs();
+    const uint64_t t1 = readCycleCounter();
+    if (t1 > t0) return (double)(ns1 - ns0) / (t1 - t0);
+#endif
+    return 1.0;
+}
+
+double cycleCounterNsPerTick()
+{
+    static const double nsPerTick = calibrateCycleCounter();
+    return nsPerTick;
+}
+
+CallSampleRing::CallSampleRing()
+    : mFile(NULL)
+    , mMask(0)
+    , mBase(0)
+    , mHead(0)
+    , mTail(0)
+    , mDropped(0)
+    , mRunning(false)
+{
+}
+
+CallSampleRing::~CallSampleRing()
+{
+    Close();
+}
+
+bool CallSampleRing::Open(const char* filename, unsigned int capacity, const std::vector<std::string>& names)
+{
+    Close();
+    mFile = fopen(filename, "w");
+    if (!mFile)
+    {
+        DBG_LOG("Failed to open output callsamples in %s: %s\n", filename, strerror(errno));
+        return false;
+    }
+    uint64_t size = 1;
+    while (size < capacity) size <<= 1;
+    mSamples.resize(size);
+    mMask = size - 1;
+    mNames = names;
+    mHead = 0;
+    mTail = 0;
+    mDropped = 0;
+    cycleCounterNsPerTick(); // calibrate now rather than on the first conversion
+    mBase = readCycleCounter();
+    fprintf(mFile, "CallNo,Function,Thread,Start,Duration\n");
+    mRunning = true;
+    mThread = std::thread(&CallSampleRing::writerThread, this);
+    DBG_LOG("Writing call samples to %s (ring of %" PRIu64 " samples)\n", filename, size);
+    return true;
+}
+
+void CallSampleRing::Close()
+{
+    if (!mFile)
+    {
+        return;
+    }
+    mRunning = false;
+    mThread.join();
+    drain();
+    if (mDropped)
+    {
+        DBG_LOG("Dropped %" PRIu64 " call samples, the writer could not keep up. Try a larger ring.\n", mDropped.load());
+    }
+    fsync(fileno(mFile));
+    fclose(mFile);
+    mFile = NULL;
+    std::vector<CallSample>().swap(mSamples);
+}
+
+size_t CallSampleRing::drain()
+{
+    const uint64_t head = mHead.load(std::memory_order_acquire);
+    uint64_t tail = mTail.load(std::memory_order_relaxed);
+    const size_t count = head - tail;
+    for (; tail != head; ++tail)
+    {
+        const CallSample& s = mSamples[tail & mMask];
+        const char* name = s.funcId < mNames.size() ? mNames[s.funcId].c_str() : "unknown";
+        // Times in nanoseconds; start is relative to when the ring was opened
+        fprintf(mFile, "%u,%s,%u,%" PRIu64 ",%" PRIu64 "\n", s.callNo, name, (unsigned)s.tid,
+                cycleCounterToNs(s.start - mBase), cycleCounterToNs(s.end - s.start));
+        if ((tail & 1023) == 1023)
+        {
+            // Hand slots back to the producer as we go
+            mTail.store(tail + 1, std::memory_order_release);
+        }
+    }
+    mTail.store(tail, std::memory_order_release);
+    return count;
+}
+
+void CallSampleRing::writerThread()
+{
+    while (mRunning.load())
+    {
+        if (drain() == 0)
+        {
+            usleep(1000);
+        }
+    }
+}
+
+}
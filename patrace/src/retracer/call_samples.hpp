@@ -0,0 +1,106 @@
+#ifndef _RETRACER_CALL_SAMPLES_HPP_
+#define _RETRACER_CALL_SAMPLES_HPP_
+
+#include <stdint.h>
+#include <stdio.h>
+#include <time.h>
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+namespace retracer {
+
+// Cheapest monotonic timestamp available: the TSC on x86, the virtual
+// counter on AArch64, otherwise CLOCK_MONOTONIC_RAW in nanoseconds. Use
+// cycleCounterToNs() to convert differences to nanoseconds.
+static inline uint64_t readCycleCounter()
+{
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#elif defined(__aarch64__)
+    uint64_t v;
+    asm volatile("mrs %0, cntvct_el0" : "=r"(v));
+    return v;
+#else
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC_RAW, &t);
+    return ((uint64_t)t.tv_sec * 1000000000ull + (uint64_t)t.tv_nsec);
+#endif
+}
+
+// Nanoseconds per readCycleCounter() tick. Calibrated on first use.
+double cycleCounterNsPerTick();
+
+static inline uint64_t cycleCounterToNs(uint64_t ticks)
+{
+    return (uint64_t)(ticks * cycleCounterNsPerTick());
+}
+
+struct CallSample
+{
+    uint32_t callNo;
+    uint16_t funcId;
+    uint8_t tid;
+    uint64_t start; // readCycleCounter() ticks
+    uint64_t end;
+};
+
+// Single producer, single consumer ring of per-call timing samples. The
+// retracer pushes a sample after every measured call without taking any
+// locks; a background thread drains the ring and writes the samples out as
+// CSV, so no formatting or I/O happens on the retracing thread. If the
+// writer falls behind, samples are dropped and counted instead of blocking.
+// Retrace threads hand over to each other under a mutex, so there is only
+// ever one producer at a time.
+class CallSampleRing
+{
+public:
+    CallSampleRing();
+    ~CallSampleRing();
+
+    // capacity is rounded up to a power of two. names maps funcId to name.
+    bool Open(const char* filename, unsigned int capacity, const std::vector<std::string>& names);
+    void Close();
+    bool IsOpen() const { return mFile != NULL; }
+
+    inline void Push(uint32_t callNo, uint16_t funcId, uint8_t tid, uint64_t start, uint64_t end)
+    {
+        const uint64_t head = mHead.load(std::memory_order_relaxed);
+        if (head - mTail.load(std::memory_order_acquire) > mMask)
+        {
+            mDropped.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        CallSample& s = mSamples[head & mMask];
+        s.callNo = callNo;
+        s.funcId = funcId;
+        s.tid = tid;
+        s.start = start;
+        s.end = end;
+        mHead.store(head + 1, std::memory_order_release);
+    }
+
+private:
+    void writerThread();
+    size_t drain();
+
+    FILE* mFile;
+    std::vector<CallSample> mSamples;
+    uint64_t mMask;
+    std::vector<std::string> mNames;
+    uint64_t mBase;
+    std::atomic<uint64_t> mHead;
+    std::atomic<uint64_t> mTail;
+    std::atomic<uint64_t> mDropped;
+    std::atomic<bool> mRunning;
+    std::thread mThread;
+};
+
+}
+
+#endif
@@ -0,0 +1,318 @@
+#include "retracer/footprint.hpp"
+#include "retracer/retracer.hpp"
+#include "retracer/texture.hpp"
+#include "helper/eglsize.hpp"
+#include "helper/states.h"
+
+#include <algorithm>
+
+namespace retracer {
+
+static const char* kindNames[Footprint::KIND_MAX] = { "buffer", "texture", "renderbuffer" };
+
+Footprint::~Footprint()
+{
+    // The objects of a share group go away with its last context
+    for (int kind = 0; kind < KIND_MAX; kind++)
+    {
+        gRetracer.mFootprint.change((Kind)kind, -(int64_t)mTotal[kind]);
+    }
+}
+
+int64_t Footprint::set(Kind kind, GLuint id, int image, uint64_t size)
+{
+    Object& object = mObjects[kind][id];
+    const uint64_t before = object.size;
+    if (image < 0)
+    {
+        object.images.clear();
+        object.size = size;
+    }
+    else
+    {
+        if (object.images.empty())
+        {
+            object.size = 0; // respecified image by image
+        }
+        if ((size_t)image >= object.images.size())
+        {
+            object.images.resize(image + 1, 0);
+        }
+        object.size += size - object.images[image];
+        object.images[image] = size;
+    }
+    const int64_t delta = (int64_t)object.size - (int64_t)before;
+    mTotal[kind] += delta;
+    return delta;
+}
+
+int64_t Footprint::release(Kind kind, GLuint id)
+{
+    const auto it = mObjects[kind].find(id);
+    if (it == mObjects[kind].end())
+    {
+        return 0;
+    }
+    const int64_t delta = -(int64_t)it->second.size;
+    mTotal[kind] += delta;
+    mObjects[kind].erase(it);
+    return delta;
+}
+
+void Footprint::largest(std::vector<Entry>& entries) const
+{
+    for (int kind = 0; kind < KIND_MAX; kind++)
+    {
+        for (const auto& it : mObjects[kind])
+        {
+            if (it.second.size > 0)
+            {
+                entries.push_back({ (Kind)kind, it.first, it.second.size });
+            }
+        }
+    }
+}
+
+void FootprintTimeline::endFrame(unsigned frame, const std::vector<const Footprint*>& groups)
+{
+    Sample sample;
+    sample.frame = frame;
+    std::copy(mLive, mLive + Footprint::KIND_MAX, sample.live);
+    sample.peak = mFramePeak;
+    mFrames.push_back(sample);
+
+    // Only walk the live objects when the footprint reaches a new high
+    if (mFramePeak > mPeak)
+    {
+        mPeak = mFramePeak;
+        mPeakFrame = frame;
+        mLargest.clear();
+        for (const Footprint* group : groups)
+        {
+            group->largest(mLargest);
+        }
+        const size_t n = std::min<size_t>(LARGEST, mLargest.size());
+        std::partial_sort(mLargest.begin(), mLargest.begin() + n, mLargest.end(),
+                          [](const Footprint::Entry& a, const Footprint::Entry& b) { return a.size > b.size; });
+        mLargest.resize(n);
+    }
+    mFramePeak = mLive[Footprint::BUFFER] + mLive[Footprint::TEXTURE] + mLive[Footprint::RENDERBUFFER];
+}
+
+void FootprintTimeline::save(Json::Value& result) const
+{
+    Json::Value footprint;
+    Json::Value frames = Json::arrayValue;
+    Json::Value live[Footprint::KIND_MAX];
+    Json::Value peaks = Json::arrayValue;
+    for (int kind = 0; kind < Footprint::KIND_MAX; kind++)
+    {
+        live[kind] = Json::arrayValue;
+    }
+    for (const Sample& sample : mFrames)
+    {
+        frames.append(sample.frame);
+        for (int kind = 0; kind < Footprint::KIND_MAX; kind++)
+        {
+            live[kind].append((Json::UInt64)sample.live[kind]);
+        }
+        peaks.append((Json::UInt64)sample.peak);
+    }
+    footprint["frames"] = frames;
+    footprint["buffers"] = live[Footprint::BUFFER];
+    footprint["textures"] = live[Footprint::TEXTURE];
+    footprint["renderbuffers"] = live[Footprint::RENDERBUFFER];
+    footprint["frame_peak"] = peaks;
+    footprint["peak"] = (Json::UInt64)mPeak;
+    footprint["peak_frame"] = mPeakFrame;
+
+    Json::Value largest = Json::arrayValue;
+    for (const Footprint::Entry& entry : mLargest)
+    {
+        Json::Value object;
+        object["type"] = kindNames[entry.kind];
+        object["id"] = entry.id;
+        object["bytes"] = (Json::UInt64)entry.size;
+        largest.append(object);
+    }
+    footprint["largest_at_peak"] = largest;
+    result["memory_footprint"] = footprint;
+}
+
+void FootprintTimeline::clear()
+{
+    std::fill(mLive, mLive + Footprint::KIND_MAX, 0);
+    mFramePeak = 0;
+    mPeak = 0;
+    mPeakFrame = 0;
+    mFrames.clear();
+    mLargest.clear();
+}
+
+// Bits per pixel of sized internal formats, or of the uncompressed formats
+// they are commonly stored as
+static unsigned internalformatBits(GLenum internalformat)
+{
+    switch (internalformat)
+    {
+    case GL_R8: case GL_R8_SNORM: case GL_R8I: case GL_R8UI: case GL_STENCIL_INDEX8:
+    case GL_ALPHA: case GL_LUMINANCE:
+        return 8;
+    case GL_RG8: case GL_RG8_SNORM: case GL_RG8I: case GL_RG8UI:
+    case GL_R16F: case GL_R16I: case GL_R16UI:
+    case GL_RGB565: case GL_RGBA4: case GL_RGB5_A1:
+    case GL_DEPTH_COMPONENT16: case GL_LUMINANCE_ALPHA:
+        return 16;
+    case GL_RGB8: case GL_SRGB8: case GL_RGB8_SNORM: case GL_RGB8I: case GL_RGB8UI:
+    case GL_DEPTH_COMPONENT24: case GL_RGB:
+        return 24;
+    case GL_RGBA8: case GL_SRGB8_ALPHA8: case GL_RGBA8_SNORM: case GL_RGBA8I: case GL_RGBA8UI:
+    case GL_RGB10_A2: case GL_RGB10_A2UI: case GL_R11F_G11F_B10F: case GL_RGB9_E5:
+    case GL_RG16F: case GL_RG16I: case GL_RG16UI:
+    case GL_R32F: case GL_R32I: case GL_R32UI:
+    case GL_DEPTH_COMPONENT32F: case GL_DEPTH24_STENCIL8: case GL_RGBA:
+        return 32;
+    case GL_RGB16F: case GL_RGB16I: case GL_RGB16UI:
+        return 48;
+    case GL_RGBA16F: case GL_RGBA16I: case GL_RGBA16UI:
+    case GL_RG32F: case GL_RG32I: case GL_RG32UI:
+    case GL_DEPTH32F_STENCIL8:
+        return 64;
+    case GL_RGB32F: case GL_RGB32I: case GL_RGB32UI:
+        return 96;
+    case GL_RGBA32F: case GL_RGBA32I: case GL_RGBA32UI:
+        return 128;
+    default:
+        return 32;
+    }
+}
+
+// Block size of compressed formats, or false if not compressed
+static bool compressedBlock(GLenum internalformat, unsigned& blockW, unsigned& blockH, unsigned& blockBytes)
+{
+    static const unsigned astc[14][2] = { {4, 4}, {5, 4}, {5, 5}, {6, 5}, {6, 6}, {8, 5}, {8, 6}, {8, 8},
+                                          {10, 5}, {10, 6}, {10, 8}, {10, 10}, {12, 10}, {12, 12} };
+    blockW = blockH = 4;
+    switch (internalformat)
+    {
+    case GL_ETC1_RGB8_OES:
+    case GL_COMPRESSED_R11_EAC:
+    case GL_COMPRESSED_SIGNED_R11_EAC:
+    case GL_COMPRESSED_RGB8_ETC2:
+    case GL_COMPRESSED_SRGB8_ETC2:
+    case GL_COMPRESSED_RGB8_PUNCHTHROUGH_ALPHA1_ETC2:
+    case GL_COMPRESSED_SRGB8_PUNCHTHROUGH_ALPHA1_ETC2:
+    case GL_COMPRESSED_RGB_S3TC_DXT1_EXT:
+    case GL_COMPRESSED_RGBA_S3TC_DXT1_EXT:
+        blockBytes = 8;
+        return true;
+    case GL_COMPRESSED_RG11_EAC:
+    case GL_COMPRESSED_SIGNED_RG11_EAC:
+    case GL_COMPRESSED_RGBA8_ETC2_EAC:
+    case GL_COMPRESSED_SRGB8_ALPHA8_ETC2_EAC:
+    case GL_COMPRESSED_RGBA_S3TC_DXT3_EXT:
+    case GL_COMPRESSED_RGBA_S3TC_DXT5_EXT:
+        blockBytes = 16;
+        return true;
+    default:
+        break;
+    }
+    blockBytes = 16;
+    if (internalformat >= GL_COMPRESSED_RGBA_ASTC_4x4 && internalformat <= GL_COMPRESSED_RGBA_ASTC_12x12)
+    {
+        blockW = astc[internalformat - GL_COMPRESSED_RGBA_ASTC_4x4][0];
+        blockH = astc[internalformat - GL_COMPRESSED_RGBA_ASTC_4x4][1];
+        return true;
+    }
+    if (internalformat >= GL_COMPRESSED_SRGB8_ALPHA8_ASTC_4x4 && internalformat <= GL_COMPRESSED_SRGB8_ALPHA8_ASTC_12x12)
+    {
+        blockW = astc[internalformat - GL_COMPRESSED_SRGB8_ALPHA8_ASTC_4x4][0];
+        blockH = astc[internalformat - GL_COMPRESSED_SRGB8_ALPHA8_ASTC_4x4][1];
+        return true;
+    }
+    return false;
+}
+
+static uint64_t imageSize(GLenum internalformat, GLsizei width, GLsizei height, GLsizei depth)
+{
+    unsigned blockW, blockH, blockBytes;
+    if (compressedBlock(internalformat, blockW, blockH, blockBytes))
+    {
+        return (uint64_t)((width + blockW - 1) / blockW) * ((height + blockH - 1) / blockH) * depth * blockBytes;
+    }
+    return (uint64_t)width * height * depth * internalformatBits(internalformat) / 8;
+}
+
+static inline bool isCubeFace(GLenum target)
+{
+    return target >= GL_TEXTURE_CUBE_MAP_POSITIVE_X && target <= GL_TEXTURE_CUBE_MAP_NEGATIVE_Z;
+}
+
+static void setTexture(GLenum target, int image, uint64_t size)
+{
+    if (!gRetracer.hasCurrentContext()) return;
+    const GLenum binding = Texture::_targetToBinding(target);
+    if (binding == 0) return;
+    GLint id = 0;
+    _glGetIntegerv(binding, &id);
+    if (id == 0) return;
+
+    Context& context = gRetracer.getCurrentContext();
+    const GLuint oldId = context.getTextureRevMap().RValue(id);
+    gRetracer.mFootprint.change(Footprint::TEXTURE, context.getFootprint().set(Footprint::TEXTURE, oldId, image, size));
+}
+
+void footprintBufferData(GLenum target, GLsizeiptr size)
+{
+    if (!gRetracer.hasCurrentContext()) return;
+    const GLuint id = getBoundBuffer(target);
+    if (id == 0) return;
+
+    Context& context = gRetracer.getCurrentContext();
+    const GLuint oldId = context.getBufferRevMap().RValue(id);
+    gRetracer.mFootprint.change(Footprint::BUFFER, context.getFootprint().set(Footprint::BUFFER, oldId, -1, size));
+}
+
+void footprintTexImage(GLenum target, GLint level, GLenum format, GLenum type, GLsizei width, GLsizei height, GLsizei depth)
+{
+    unsigned bitsPerElement = 0;
+    unsigned bitsPerPixel = 0;
+    _gl_format_size(format, type, bitsPerElement, bitsPerPixel);
+    const int face = isCubeFace(target) ? target - GL_TEXTURE_CUBE_MAP_POSITIVE_X : 0;
+    setTexture(target, level * 6 + face, (uint64_t)width * height * depth * bitsPerPixel / 8);
+}
+
+void footprintCompressedTexImage(GLenum target, GLint level, GLsizei imageSize)
+{
+    const int face = isCubeFace(target) ? target - GL_TEXTURE_CUBE_MAP_POSITIVE_X : 0;
+    setTexture(target, level * 6 + face, imageSize);
+}
+
+void footprintTexStorage(GLenum target, GLsizei levels, GLenum internalformat, GLsizei width, GLsizei height, GLsizei depth, GLsizei samples)
+{
+    // Only 3D textures have mipmaps with fewer layers
+    const bool layered = (target != GL_TEXTURE_3D);
+    const unsigned faces = (target == GL_TEXTURE_CUBE_MAP) ? 6 : 1;
+    uint64_t size = 0;
+    for (GLsizei level = 0; level < levels; level++)
+    {
+        size += imageSize(internalformat, std::max(1, width >> level), std::max(1, height >> level),
+                          layered ? depth : std::max(1, depth >> level));
+    }
+    setTexture(target, -1, size * faces * std::max(1, samples));
+}
+
+void footprintRenderbufferStorage(GLenum target, GLsizei samples, GLenum internalformat, GLsizei width, GLsizei height)
+{
+    if (!gRetracer.hasCurrentContext()) return;
+    GLint id = 0;
+    _glGetIntegerv(GL_RENDERBUFFER_BINDING, &id);
+    if (id == 0) return;
+
+    Context& context = gRetracer.getCurrentContext();
+    const GLuint oldId = context.getRenderbufferRevMap().RValue(id);
+    const uint64_t size = imageSize(internalformat, width, height, 1) * std::max(1, samples);
+    gRetracer.mFootprint.change(Footprint::RENDERBUFFER, context.getFootprint().set(Footprint::RENDERBUFFER, oldId, -1, size));
+}
+
+}
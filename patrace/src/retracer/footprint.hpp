@@ -0,0 +1,94 @@
+#ifndef _RETRACER_FOOTPRINT_HPP_
+#define _RETRACER_FOOTPRINT_HPP_
+
+#include <stdint.h>
+#include <unordered_map>
+#include <vector>
+
+#include "dispatch/eglimports.hpp"
+#include "json/value.h"
+
+namespace retracer {
+
+// Estimated sizes of the buffers, textures and renderbuffers alive in one
+// share group, keyed by their ids in the trace. Sizes are worked out from
+// formats and dimensions, so padding, compression and mipmaps allocated by
+// the driver behind our back are not included.
+class Footprint
+{
+public:
+    enum Kind { BUFFER, TEXTURE, RENDERBUFFER, KIND_MAX };
+
+    struct Entry
+    {
+        Kind kind;
+        GLuint id;
+        uint64_t size;
+    };
+
+    ~Footprint();
+
+    // Set the size of one image of an object, where image is level * 6 + face,
+    // or with image -1 replace all its images. Returns the change in bytes.
+    int64_t set(Kind kind, GLuint id, int image, uint64_t size);
+    int64_t release(Kind kind, GLuint id);
+
+    uint64_t total(Kind kind) const { return mTotal[kind]; }
+    void largest(std::vector<Entry>& entries) const;
+
+private:
+    struct Object
+    {
+        uint64_t size = 0;
+        std::vector<uint64_t> images;
+    };
+
+    std::unordered_map<GLuint, Object> mObjects[KIND_MAX];
+    uint64_t mTotal[KIND_MAX] = {};
+};
+
+// Running total of all share groups, sampled once per frame, together with
+// the largest objects alive at the highest peak seen so far.
+class FootprintTimeline
+{
+public:
+    static const unsigned LARGEST = 20;
+
+    inline void change(Footprint::Kind kind, int64_t delta)
+    {
+        mLive[kind] += delta;
+        const uint64_t live = mLive[Footprint::BUFFER] + mLive[Footprint::TEXTURE] + mLive[Footprint::RENDERBUFFER];
+        if (live > mFramePeak) mFramePeak = live;
+    }
+
+    void endFrame(unsigned frame, const std::vector<const Footprint*>& groups);
+    void save(Json::Value& result) const;
+    void clear();
+
+private:
+    struct Sample
+    {
+        unsigned frame;
+        uint64_t live[Footprint::KIND_MAX];
+        uint64_t peak;
+    };
+
+    uint64_t mLive[Footprint::KIND_MAX] = {};
+    uint64_t mFramePeak = 0;
+    uint64_t mPeak = 0;
+    unsigned mPeakFrame = 0;
+    std::vector<Sample> mFrames;
+    std::vector<Footprint::Entry> mLargest;
+};
+
+// Called from the generated retrace code before the calls that allocate
+// storage for the object bound to target
+void footprintBufferData(GLenum target, GLsizeiptr size);
+void footprintTexImage(GLenum target, GLint level, GLenum format, GLenum type, GLsizei width, GLsizei height, GLsizei depth);
+void footprintCompressedTexImage(GLenum target, GLint level, GLsizei imageSize);
+void footprintTexStorage(GLenum target, GLsizei levels, GLenum internalformat, GLsizei width, GLsizei height, GLsizei depth, GLsizei samples);
+void footprintRenderbufferStorage(GLenum target, GLsizei samples, GLenum internalformat, GLsizei width, GLsizei height);
+
+}
+
+#endif
@@ -266,7 +266,7 @@ static void callback(EGLenum error, const char *command, EGLint messageType, EGL
     DBG_LOG("EGL callback : %s : %s\n", command, message);
 }
 
-void GlwsEgl::Init(Profile /*profile*/)
+void GlwsEgl::initDisplay()
 {
     mEglNativeDisplay = getNativeDisplay();
     if (gRetracer.mOptions.mPbufferRendering)
@@ -299,7 +299,6 @@ void GlwsEgl::Init(Profile /*profile*/)
     {
         mEglDisplay = eglGetDisplay(mEglNativeDisplay);
     }
-    gRetracer.mState.mEglDisplay = mEglDisplay;
 
     if (mEglDisplay == EGL_NO_DISPLAY)
     {
@@ -326,6 +325,16 @@ void GlwsEgl::Init(Profile /*profile*/)
     mEglJson["egl_version"] = eglQueryString(mEglDisplay, EGL_VERSION);
     mEglJson["egl_APIs"] = eglQueryString(mEglDisplay, EGL_CLIENT_APIS);
     if (mAngle) mEglJson["angle"] = true;
+}
+
+void GlwsEgl::Init(Profile /*profile*/)
+{
+    // Batch runs keep the display initialized from one job to the next
+    if (mEglDisplay == EGL_NO_DISPLAY)
+    {
+        initDisplay();
+    }
+    gRetracer.mState.mEglDisplay = mEglDisplay;
 
     RetraceOptions& o = gRetracer.mOptions;
     EGLint samples = o.mOnscreenConfig.msaa_samples;
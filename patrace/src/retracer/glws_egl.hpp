@@ -40,6 +40,8 @@ public:
     void setNativeWindow(EGLNativeWindowType window);
 
 protected:
+    void initDisplay();
+
     bool mAngle = false;
     EGLNativeDisplayType mEglNativeDisplay;
     EGLNativeWindowType mEglNativeWindow;
@@ -0,0 +1,212 @@
+#include "retracer/gpu_timer.hpp"
+#include "retracer/retracer.hpp"
+#include "common/gl_extension_supported.hpp"
+#include "common/os_time.hpp"
+
+namespace retracer {
+
+bool GpuTimer::Init()
+{
+    if (!gRetracer.hasCurrentContext())
+    {
+        return false;
+    }
+    if (!isGlesExtensionSupported("GL_EXT_disjoint_timer_query"))
+    {
+        DBG_LOG("GL_EXT_disjoint_timer_query is not supported - no GPU timing\n");
+        return false;
+    }
+    // The extension allows a counter of zero bits, which means that
+    // timestamps are not supported at all
+    GLint bits = 0;
+    _glGetQueryivEXT(GL_TIMESTAMP_EXT, GL_QUERY_COUNTER_BITS_EXT, &bits);
+    if (bits == 0)
+    {
+        DBG_LOG("GL_EXT_disjoint_timer_query has no timestamp counter - no GPU timing\n");
+        return false;
+    }
+    mQueries.resize(QUERIES);
+    mStamps.resize(QUERIES);
+    _glGenQueriesEXT(QUERIES, mQueries.data());
+    GLint disjoint = 0;
+    _glGetIntegerv(GL_GPU_DISJOINT_EXT, &disjoint); // clear it
+    mContext = &gRetracer.getCurrentContext();
+    return true;
+}
+
+void GpuTimer::Release()
+{
+    if (IsCurrent())
+    {
+        _glDeleteQueriesEXT(QUERIES, mQueries.data());
+    }
+    *this = GpuTimer();
+}
+
+bool GpuTimer::IsCurrent() const
+{
+    return mContext && gRetracer.hasCurrentContext() && &gRetracer.getCurrentContext() == mContext;
+}
+
+void GpuTimer::FrameStart(unsigned frame, GLuint fbo)
+{
+    if (!mContext) return;
+
+    const long long now = os::getTime();
+    if (!mFrames.empty() && mCpuStart != 0)
+    {
+        mFrames.back().cpu = ((double)(now - mCpuStart)) / os::timeFrequency;
+    }
+    mCpuStart = now;
+
+    if (IsCurrent())
+    {
+        Poll(false);
+    }
+    FrameTime time;
+    time.frame = frame;
+    mFrames.push_back(time);
+    mInFrame = true;
+    mFbo = fbo;
+    Issue(START, fbo);
+}
+
+void GpuTimer::FrameEnd()
+{
+    if (!mInFrame) return;
+    Issue(END, 0);
+    mInFrame = false;
+}
+
+void GpuTimer::Renderpass(GLuint fbo)
+{
+    if (!mInFrame || fbo == mFbo) return;
+    mFbo = fbo;
+    Issue(PASS, fbo);
+}
+
+void GpuTimer::Issue(StampKind kind, GLuint fbo)
+{
+    FrameTime& time = mFrames.back();
+    if (time.dropped) return;
+    if (!IsCurrent() || mCount == QUERIES)
+    {
+        // Rather lose the frame than wait for the GPU to free up queries
+        time.dropped = true;
+        mDropped++;
+        return;
+    }
+    const unsigned idx = (mHead + mCount) % QUERIES;
+    _glQueryCounterEXT(mQueries[idx], GL_TIMESTAMP_EXT);
+    mStamps[idx].kind = kind;
+    mStamps[idx].frame = mFrames.size() - 1;
+    mStamps[idx].fbo = fbo;
+    mCount++;
+}
+
+void GpuTimer::Poll(bool wait)
+{
+    GLint disjoint = 0;
+    _glGetIntegerv(GL_GPU_DISJOINT_EXT, &disjoint);
+    if (disjoint)
+    {
+        // Something like a frequency change happened while queries were
+        // outstanding, so none of them can be trusted
+        for (unsigned i = 0; i < mCount; i++)
+        {
+            mFrames[mStamps[(mHead + i) % QUERIES].frame].dropped = true;
+        }
+        mHead = (mHead + mCount) % QUERIES;
+        mCount = 0;
+        mHavePrev = false;
+        mDisjoint++;
+        return;
+    }
+
+    while (mCount > 0)
+    {
+        const Stamp& stamp = mStamps[mHead];
+        const GLuint query = mQueries[mHead];
+        if (!wait)
+        {
+            if (stamp.frame + LATENCY > mFrames.size()) break;
+            GLint available = 0;
+            _glGetQueryObjectivEXT(query, GL_QUERY_RESULT_AVAILABLE_EXT, &available);
+            if (!available) break;
+        }
+        GLuint64 time = 0;
+        _glGetQueryObjectui64vEXT(query, GL_QUERY_RESULT_EXT, &time);
+        Process(stamp, time);
+        mHead = (mHead + 1) % QUERIES;
+        mCount--;
+    }
+}
+
+void GpuTimer::Process(const Stamp& stamp, uint64_t time)
+{
+    FrameTime& frame = mFrames[stamp.frame];
+    if (frame.dropped)
+    {
+        mHavePrev = false;
+        return;
+    }
+
+    // A pass lasts until the next binding or the end of the frame
+    if (mHavePrev && mPrev.frame == stamp.frame && stamp.kind != START && time >= mPrevTime)
+    {
+        mPassFrames.push_back(frame.frame);
+        mPassFbos.push_back(mPrev.fbo);
+        mPassTimes.push_back((time - mPrevTime) / 1e9);
+    }
+    if (stamp.kind == START)
+    {
+        frame.startTime = time;
+    }
+    else if (stamp.kind == END && frame.startTime != 0 && time >= frame.startTime)
+    {
+        frame.gpu = (time - frame.startTime) / 1e9;
+    }
+    mPrev = stamp;
+    mPrevTime = time;
+    mHavePrev = (stamp.kind != END);
+}
+
+void GpuTimer::Save(Json::Value& result)
+{
+    if (IsCurrent())
+    {
+        Poll(true);
+    }
+
+    Json::Value timing;
+    Json::Value frames = Json::arrayValue;
+    Json::Value cpu = Json::arrayValue;
+    Json::Value gpu = Json::arrayValue;
+    for (const FrameTime& time : mFrames)
+    {
+        if (time.cpu == 0.0) continue; // never finished
+        frames.append(time.frame);
+        cpu.append(time.cpu);
+        gpu.append(time.gpu);
+    }
+    timing["frames"] = frames;
+    timing["cpu_time"] = cpu;
+    timing["gpu_time"] = gpu;
+
+    Json::Value passes;
+    passes["frame"] = Json::arrayValue;
+    passes["fbo"] = Json::arrayValue;
+    passes["gpu_time"] = Json::arrayValue;
+    for (unsigned i = 0; i < mPassTimes.size(); i++)
+    {
+        passes["frame"].append(mPassFrames[i]);
+        passes["fbo"].append(mPassFbos[i]);
+        passes["gpu_time"].append(mPassTimes[i]);
+    }
+    timing["renderpasses"] = passes;
+    timing["disjoint"] = mDisjoint;
+    timing["dropped_frames"] = mDropped;
+    result["gpu_timing"] = timing;
+}
+
+}
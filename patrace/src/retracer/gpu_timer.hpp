@@ -0,0 +1,89 @@
+#ifndef _RETRACER_GPU_TIMER_HPP_
+#define _RETRACER_GPU_TIMER_HPP_
+
+#include <stdint.h>
+#include <vector>
+
+#include "dispatch/eglimports.hpp"
+#include "json/value.h"
+
+namespace retracer {
+
+class Context;
+
+// GPU time per frame and per draw framebuffer binding, from timestamp
+// queries of GL_EXT_disjoint_timer_query. The queries come from a fixed
+// ring and are only read back once they are several frames old and their
+// results are available, so the retracer never waits for the GPU. If the
+// ring runs full, frames go untimed rather than stalling.
+class GpuTimer
+{
+public:
+    static const unsigned QUERIES = 512;
+    static const unsigned LATENCY = 3; // frames
+
+    // Begin timing on the current context, or return false if it cannot
+    bool Init();
+    void Release();
+    bool IsEnabled() const { return mContext != nullptr; }
+
+    // Called after the swap of the previous frame, before the swap of the
+    // current one, and when a framebuffer is bound for drawing. The ids are
+    // those of the trace.
+    void FrameStart(unsigned frame, GLuint fbo);
+    void FrameEnd();
+    void Renderpass(GLuint fbo);
+
+    // Wait for all outstanding queries, then add the results
+    void Save(Json::Value& result);
+
+private:
+    enum StampKind { START, PASS, END };
+
+    struct Stamp
+    {
+        StampKind kind;
+        unsigned frame; // index in mFrames
+        GLuint fbo;
+    };
+
+    struct FrameTime
+    {
+        unsigned frame;
+        double cpu = 0.0;
+        double gpu = -1.0; // seconds, or negative if unknown
+        uint64_t startTime = 0;
+        bool dropped = false;
+    };
+
+    bool IsCurrent() const;
+    void Issue(StampKind kind, GLuint fbo);
+    void Poll(bool wait);
+    void Process(const Stamp& stamp, uint64_t time);
+
+    Context* mContext = nullptr;
+    std::vector<GLuint> mQueries;
+    std::vector<Stamp> mStamps; // parallel to mQueries
+    unsigned mHead = 0;  // oldest outstanding query
+    unsigned mCount = 0; // outstanding queries
+
+    std::vector<FrameTime> mFrames;
+    bool mInFrame = false;
+    GLuint mFbo = 0;
+    long long mCpuStart = 0;
+
+    // Last stamp read back, to close the range it opened
+    Stamp mPrev;
+    uint64_t mPrevTime = 0;
+    bool mHavePrev = false;
+
+    std::vector<unsigned> mPassFrames;
+    std::vector<GLuint> mPassFbos;
+    std::vector<double> mPassTimes;
+    unsigned mDisjoint = 0;
+    unsigned mDropped = 0;
+};
+
+}
+
+#endif
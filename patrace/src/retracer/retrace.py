@@ -698,7 +698,7 @@ class Retracer(object):
         for arg in args:
             LookUpHandleVisitor().visit(arg.type, arg, arg.name + 'New', arg.name)
 
-        if func.name in ['glDeleteProgram', 'glDeleteShader']:
+        if func.name == 'glDeleteProgram':
             print('    %s = 0;' % lookupHandleAsL(func.args[0].type, func.args[0].name))
 
     def registerHandles(self, func):
@@ -863,6 +863,39 @@ class Retracer(object):
             print('    GLuint bufferId = getBoundBuffer(target);')
             print('    gRetracer.getCurrentContext()._bufferToData_map.erase(bufferId);')
 
+        # track the estimated memory footprint of allocated storage
+        footprint = None
+        if func.name in ['glBufferData', 'glBufferStorageEXT']:
+            footprint = 'footprintBufferData(target, size)'
+        elif func.name == 'glTexImage2D':
+            footprint = 'footprintTexImage(target, level, format, type, width, height, 1)'
+        elif func.name in ['glTexImage3D', 'glTexImage3DOES']:
+            footprint = 'footprintTexImage(target, level, format, type, width, height, depth)'
+        elif func.name in ['glCompressedTexImage2D', 'glCompressedTexImage3D', 'glCompressedTexImage3DOES']:
+            footprint = 'footprintCompressedTexImage(target, level, imageSize)'
+        elif func.name in ['glTexStorage2D', 'glTexStorage2DEXT', 'glTexStorageAttribs2DEXT']:
+            footprint = 'footprintTexStorage(target, levels, internalformat, width, height, 1, 1)'
+        elif func.name in ['glTexStorage3D', 'glTexStorage3DEXT', 'glTexStorageAttribs3DEXT']:
+            footprint = 'footprintTexStorage(target, levels, internalformat, width, height, depth, 1)'
+        elif func.name == 'glTexStorage2DMultisample':
+            footprint = 'footprintTexStorage(target, 1, internalformat, width, height, 1, samples)'
+        elif func.name in ['glTexStorage3DMultisample', 'glTexStorage3DMultisampleOES']:
+            footprint = 'footprintTexStorage(target, 1, internalformat, width, height, depth, samples)'
+        elif func.name in ['glRenderbufferStorage', 'glRenderbufferStorageOES']:
+            footprint = 'footprintRenderbufferStorage(target, 1, internalformat, width, height)'
+        elif func.name.startswith('glRenderbufferStorageMultisample'):
+            footprint = 'footprintRenderbufferStorage(target, samples, internalformat, width, height)'
+        if footprint:
+            print('    if (unlikely(gRetracer.mOptions.mFootprint)) %s;' % footprint)
+
+        # state that changes the result of linking, for interning programs
+        if func.name == 'glBindAttribLocation':
+            print('    if (unlikely(gRetracer.mOptions.mInternShaders)) intern_glBindAttribLocation(programNew, index, name);')
+        elif func.name == 'glTransformFeedbackVaryings':
+            print('    if (unlikely(gRetracer.mOptions.mInternShaders)) intern_glTransformFeedbackVaryings(programNew, count, varyings, bufferMode);')
+        elif func.name == 'glProgramParameteri':
+            print('    if (unlikely(gRetracer.mOptions.mInternShaders)) intern_glProgramParameteri(programNew, pname, value);')
+
         if func.name == 'glCreateClientSideBuffer':
             print('    unsigned int name = old_ret;')
 
@@ -1014,6 +1047,10 @@ class Retracer(object):
             print('    {')
             print('        load_from_shadercache(programNew, program, status);')
             print('    }')
+            print('    else if (gRetracer.mOptions.mInternShaders)')
+            print('    {')
+            print('        intern_glLinkProgram(programNew, program, (int)status);')
+            print('    }')
             print('    else')
             print('    {')
             print('        _glLinkProgram(programNew);')
@@ -1031,7 +1068,14 @@ class Retracer(object):
         arg_names = ", ".join(args)
 
         if func.name in shadercache_funcs:
-            print('    if (gRetracer.mOptions.mShaderCacheFile.size() == 0 || !gRetracer.mOptions.mShaderCacheLoad)')
+            if func.name == 'glCompileShader':
+                print('    if (gRetracer.mOptions.mInternShaders)')
+                print('    {')
+                print('        intern_glCompileShader(shaderNew);')
+                print('    }')
+                print('    else if (gRetracer.mOptions.mShaderCacheFile.size() == 0 || !gRetracer.mOptions.mShaderCacheLoad)')
+            else:
+                print('    if (gRetracer.mOptions.mShaderCacheFile.size() == 0 || !gRetracer.mOptions.mShaderCacheLoad)')
             print('    {')
             print('        {name}({args});'.format(name=func.name, args=arg_names))
             print('    }')
@@ -1039,6 +1083,17 @@ class Retracer(object):
                 print('    gRetracer.getCurrentContext().addShaderID(programNew, shaderNew);')
             if func.name == 'glShaderSource':
                 print('    post_glShaderSource(shaderNew, shader, count, string, length);')
+        elif func.name == 'glDeleteShader':
+            print('    if (gRetracer.mOptions.mInternShaders)')
+            print('    {')
+            print('        intern_glDeleteShader(shaderNew, shader);')
+            print('    }')
+            print('    else')
+            print('    {')
+            print('        %s = 0;' % lookupHandleAsL(func.args[0].type, func.args[0].name))
+            print('        %s(%s);' % (func.name, arg_names))
+            print('        gRetracer.getCurrentContext().deleteShader(shaderNew);')
+            print('    }')
         elif func.name == 'glTexStorage2DEXT':
             print('    if (gRetracer.mOptions.mLocalApiVersion >= PROFILE_ES3)')
             print('    {')
@@ -1080,15 +1135,18 @@ class Retracer(object):
             print('    (void)ret;')
 
         if func.name == 'glCompileShader':
-            print('    if (gRetracer.mOptions.mShaderCacheFile.size() == 0 || !gRetracer.mOptions.mShaderCacheLoad)')
+            print('    if ((gRetracer.mOptions.mShaderCacheFile.size() == 0 || !gRetracer.mOptions.mShaderCacheLoad) && !gRetracer.mOptions.mInternShaders)')
             print('    {')
             print('        post_glCompileShader(shaderNew, shader);')
             print('    }')
 
-        if func.name == 'glDeleteShader':
-            print('    gRetracer.getCurrentContext().deleteShader(shaderNew);')
+        if func.name == 'glDetachShader':
+            print('    gRetracer.getCurrentContext().detachShaderID(programNew, shaderNew);')
+            print('    if (gRetracer.mOptions.mInternShaders) intern_glDetachShader(programNew, shaderNew);')
         if func.name == 'glDeleteProgram':
+            print('    if (gRetracer.mOptions.mInternShaders) intern_glDeleteProgram(programNew);')
             print('    gRetracer.getCurrentContext().deleteShaderIDs(programNew);')
+            print('    gRetracer.getCurrentContext().deleteLinkState(programNew);')
 
     def retraceFunctionBody(self, func):
         #print '    DBG_LOG("retrace %s _src = %%p\\n", _src);' % func.name
@@ -17,6 +17,8 @@ using namespace retracer;
 
 static bool printHeaderInfo = false;
 static bool printHeaderJson = false;
+static std::string jobsFile;
+static std::string jobsTraceDir;
 
 static void
 usage(const char *argv0) {
@@ -37,7 +39,13 @@ usage(const char *argv0) {
         "  -framerange FRAME_START FRAME_END start fps timer at frame start (inclusive), stop timer and playback before frame end (exclusive).\n"
         "  -loop TIMES repeat the preloaded frames at least the given number of times\n"
         "  -looptime SECONDS repeat the preloaded frames at least the given number of seconds\n"
+        "  -predecode Used with -loop to parse the calls of the preloaded frames only once, and repeat them from the parsed calls\n"
+        "  -verifychecksums Verify the chunk checksums of trace files that have them while reading\n"
+        "  -salvage Play a truncated or damaged trace file up to the first bad chunk instead of aborting\n"
+        "  -readahead Read the trace file ahead from a background thread into a bounded set of buffers, instead of memory mapping it\n"
+        "  -directio Used with -readahead to bypass the page cache\n"
         "  -jsonParameters FILE RESULT_FILE TRACE_DIR path to a JSON file containing the parameters, the output result file and base trace path\n"
+        "  -jobs FILE TRACE_DIR Run a JSON list of jobs, each with the parameters of -jsonParameters and its own \"result\" file, one after another in this process\n"
         "  -info Show default EGL Config for playback (stored in trace file header). Do not play trace.\n"
         "  -instr Output the supported instrumentation modes as a JSON file. Do not play trace.\n"
         "  -offscreen Run in offscreen mode\n"
@@ -50,6 +58,12 @@ usage(const char *argv0) {
         "  -debugfull output all of the current invoked gl functions, with callNo, frameNo and skipped or discarded information\n"
         "  -infojson Dump the header of the trace file in json format, then exit\n"
         "  -callstats Used with -framerange to output call statistics to callstats.csv on disk, including the calling number and running time\n"
+        "  -callsamples N Used with -callstats to also write the duration of every measured call to callsamples.csv, buffered in a ring of N samples\n"
+        "  -binaryresults FILE Stream per-frame results (and call statistics, with -callstats) to a binary columnar file instead of writing results.json and callstats.csv at exit. Convert with results_to_json\n"
+        "  -legacyresults Used with -binaryresults to also write results.json and callstats.csv at exit\n"
+        "  -footprint Track the estimated memory used by buffers, textures and renderbuffers, and add it per frame, with the largest objects at the peak, to the results\n"
+        "  -gputime Time every frame and framebuffer binding on the GPU with GL_EXT_disjoint_timer_query, read back a few frames later, and add it to the results next to CPU time\n"
+        "  -timeline FILE Record frames, thread hand-offs, decompression stalls, snapshots and shader cache loads, and write them to FILE in Chrome trace event format at exit\n"
         "  -overrideEGL Red Green Blue Alpha Depth Stencil, example: overrideEGL 5 6 5 0 16 8, for 16 bit color and 16 bit depth and 8 bit stencil\n"
         "  -strict Use strict EGL mode (fail unless the specified EGL configuration is valid)\n"
         "  -strictcolor Same as -strict, but only checks color channels (RGBA). Useful for dumping when we want to be sure returned EGL is same as requested\n"
@@ -63,6 +77,7 @@ usage(const char *argv0) {
         "  -loadcache FILENAME Load shaders from this cache. Will add .bin and .idx to the given file name.\n"
         "  -savecache FILENAME Save shaders to this cache. Will add .bin and .idx to the given file name.\n"
         "  -cacheonly Used with -savecache to only populate the shader cache and do not run anything else not needed for that from the trace.\n"
+        "  -internshaders Link programs with identical shaders only once, and load the others from the binary of the first. Shaders are only compiled when needed for that.\n"
         "  -script Script_PATH FRAME Trigger script on a specific frame.\n"
 #ifndef __APPLE__
         "  -perfrange START END run Linux perf on selected frame range and save it to disk\n"
@@ -74,6 +89,7 @@ usage(const char *argv0) {
 #endif
         "  -forceanisolevel LEVEL force all anisotropic filtering levels above 1 to this level\n"
         "  -noscreen Render without visual output (using pbuffer render target)\n"
+        "  -nulldriver Replay against a built-in driver that does nothing, to measure the overhead of the retracer itself. Implies -noscreen\n"
         "  -singlesurface SURFACE Render all surfaces except the given one to pbuffer render targets instead\n"
         "  -flushonswap Call explicit flush before every call to swap the backbuffer\n"
         "  -fpslimit FPS Limit the fps of replaying\n"
@@ -175,6 +191,19 @@ bool ParseCommandLine(int argc, char** argv, RetraceOptions& mOptions)
             DBG_LOG("Override the existing MSAA for fbo attachment with new MSAA: %d\n", mOptions.mOverrideMSAA);
         } else if (!strcmp(arg, "-callstats")) {
             mOptions.mCallStats = true;
+        } else if (!strcmp(arg, "-callsamples")) {
+            mOptions.mCallSamples = readValidValue(argv[++i]);
+            mOptions.mCallStats = true;
+        } else if (!strcmp(arg, "-binaryresults")) {
+            mOptions.mBinaryResultsFile = argv[++i];
+        } else if (!strcmp(arg, "-legacyresults")) {
+            mOptions.mLegacyResults = true;
+        } else if (!strcmp(arg, "-footprint")) {
+            mOptions.mFootprint = true;
+        } else if (!strcmp(arg, "-gputime")) {
+            mOptions.mGpuTime = true;
+        } else if (!strcmp(arg, "-timeline")) {
+            mOptions.mTimelineFile = argv[++i];
         } else if (!strcmp(arg, "-perfrange")) {
             mOptions.mPerfStart = readValidValue(argv[++i]);
             mOptions.mPerfStop = readValidValue(argv[++i]);
@@ -194,7 +223,7 @@ bool ParseCommandLine(int argc, char** argv, RetraceOptions& mOptions)
         } else if (!strcmp(arg, "-perfcmd")) {
             mOptions.mPerfCmd = argv[++i];
         } else if (!strcmp(arg, "-s")) {
-            mOptions.mSnapshotCallSet = new common::CallSet(argv[++i]);
+            mOptions.mSnapshotCallSet.reset(new common::CallSet(argv[++i]));
         } else if (!strcmp(arg, "-framenamesnaps")) {
             mOptions.mSnapshotFrameNames = true;
         } else if (!strcmp(arg, "-snapshotprefix")) {
@@ -212,6 +241,16 @@ bool ParseCommandLine(int argc, char** argv, RetraceOptions& mOptions)
             mOptions.mLoopTimes = readValidValue(argv[++i]);
         } else if (!strcmp(arg, "-looptime")) {
             mOptions.mLoopSeconds = readValidValue(argv[++i]);
+        } else if (!strcmp(arg, "-predecode")) {
+            mOptions.mPredecode = true;
+        } else if (!strcmp(arg, "-verifychecksums")) {
+            mOptions.mVerifyChecksums = true;
+        } else if (!strcmp(arg, "-salvage")) {
+            mOptions.mSalvage = true;
+        } else if (!strcmp(arg, "-readahead")) {
+            mOptions.mReadAhead = true;
+        } else if (!strcmp(arg, "-directio")) {
+            mOptions.mDirectIO = true;
         } else if (!strcmp(arg, "-framerange")) {
             mOptions.mBeginMeasureFrame = readValidValue(argv[++i]);
             mOptions.mEndMeasureFrame = readValidValue(argv[++i]);
@@ -241,6 +280,9 @@ bool ParseCommandLine(int argc, char** argv, RetraceOptions& mOptions)
             std::ifstream t(jsonParameters);
             std::string str((std::istreambuf_iterator<char>(t)), std::istreambuf_iterator<char>());
             TraceExecutor::initFromJson(str, traceDir, resultFile);
+        } else if (!strcmp(arg, "-jobs")) {
+            jobsFile = argv[++i];
+            jobsTraceDir = argv[++i];
         } else if (!strcmp(arg, "-info")) {
             printHeaderInfo = true;
         } else if (!strcmp(arg, "-debug")) {
@@ -251,6 +293,10 @@ bool ParseCommandLine(int argc, char** argv, RetraceOptions& mOptions)
             mOptions.mStateLogging = true;
         } else if (!strcmp(arg, "-noscreen")) {
             mOptions.mPbufferRendering = true;
+        } else if (!strcmp(arg, "-nulldriver")) {
+            mOptions.mNullDriver = true;
+            mOptions.mPbufferRendering = true;
+            SetNullDriver(true);
         } else if (!strcmp(arg, "-singlesurface")) {
             mOptions.mSingleSurface = readValidValue(argv[++i]);
         } else if (!strcmp(arg, "-perfmon")) {
@@ -306,6 +352,8 @@ bool ParseCommandLine(int argc, char** argv, RetraceOptions& mOptions)
             mOptions.mShaderCacheLoad = false;
         } else if (!strcmp(arg, "-cacheonly")) {
             mOptions.mCacheOnly = true;
+        } else if (!strcmp(arg, "-internshaders")) {
+            mOptions.mInternShaders = true;
         } else if (!strcmp(arg, "-insequence")) {
             // nothing, this is always the case now
         } else if (!strcmp(arg, "-singleframe")) {
@@ -430,11 +478,21 @@ bool ParseCommandLine(int argc, char** argv, RetraceOptions& mOptions)
         DBG_LOG("Loop option requires preload\n");
         return false;
     }
+    if (mOptions.mPredecode && !mOptions.mLoopTimes)
+    {
+        DBG_LOG("-predecode requires -loop\n");
+        return false;
+    }
     if (mOptions.mCacheOnly && (mOptions.mShaderCacheLoad || mOptions.mShaderCacheFile.size() == 0))
     {
         DBG_LOG("-cacheonly requires -savecache\n");
         return false;
     }
+    if (mOptions.mInternShaders && mOptions.mShaderCacheFile.size() > 0)
+    {
+        DBG_LOG("-internshaders cannot be used together with -loadcache or -savecache\n");
+        return false;
+    }
 
     if (gRetracer.mCollectors)
     {
@@ -462,6 +520,93 @@ bool ParseCommandLine(int argc, char** argv, RetraceOptions& mOptions)
     return true;
 }
 
+// Run each job of the list in jobsFile like -jsonParameters would, but
+// without paying for process start, library loading and display setup
+// again. Jobs start from the default options, and only tear down the GL
+// state they created.
+static int runJobs(const std::string& cmds)
+{
+    std::ifstream t(jobsFile);
+    std::string str((std::istreambuf_iterator<char>(t)), std::istreambuf_iterator<char>());
+    Json::Value jobs;
+    Json::Reader reader;
+    if (!reader.parse(str, jobs))
+    {
+        DBG_LOG("Failed to parse job list %s: %s\n", jobsFile.c_str(), reader.getFormattedErrorMessages().c_str());
+        return 1;
+    }
+    if (!jobs.isArray() || jobs.empty())
+    {
+        DBG_LOG("Job list %s must be a non-empty JSON array\n", jobsFile.c_str());
+        return 1;
+    }
+
+    // Function entries and the libraries are set up only once
+    const bool runAll = jobs[0].get("runAllCalls", false).asBool();
+    const bool nullDriver = jobs[0].get("nullDriver", false).asBool();
+    for (const Json::Value& job : jobs)
+    {
+        if (!job.isObject() || !job.isMember("file") || !job.isMember("result"))
+        {
+            DBG_LOG("Every job needs a \"file\" and a \"result\"\n");
+            return 1;
+        }
+        if (job.get("runAllCalls", false).asBool() != runAll || job.get("nullDriver", false).asBool() != nullDriver)
+        {
+            DBG_LOG("runAllCalls and nullDriver must be the same for all jobs\n");
+            return 1;
+        }
+        if (job.get("step", false).asBool())
+        {
+            DBG_LOG("Step mode cannot be used in a job list\n");
+            return 1;
+        }
+    }
+
+    Json::FastWriter writer;
+    bool displayReady = false;
+    bool pbufferDisplay = false;
+    for (unsigned i = 0; i < jobs.size(); i++)
+    {
+        const Json::Value& job = jobs[i];
+        DBG_LOG("================== Job %u of %u: %s ==================\n", i + 1, jobs.size(), job["file"].asCString());
+
+        gRetracer.mOptions = RetraceOptions();
+        delete gRetracer.mCollectors;
+        gRetracer.mCollectors = nullptr;
+        TraceExecutor::initFromJson(writer.write(job), jobsTraceDir, job["result"].asString());
+        if (i == 0)
+        {
+            common::gApiInfo.RegisterEntries(gles_callbacks, runAll);
+            common::gApiInfo.RegisterEntries(egl_callbacks, runAll);
+        }
+
+        if (!gRetracer.OpenTraceFile(gRetracer.mOptions.mFileName.c_str()))
+        {
+            TraceExecutor::writeError("Failed to open " + gRetracer.mOptions.mFileName);
+            continue;
+        }
+
+        // Window and pbuffer rendering may need different displays
+        if (displayReady && pbufferDisplay != gRetracer.mOptions.mPbufferRendering)
+        {
+            GLWS::instance().Cleanup();
+        }
+        GLWS::instance().Init(gRetracer.mOptions.mApiVersion);
+        displayReady = true;
+        pbufferDisplay = gRetracer.mOptions.mPbufferRendering;
+
+        gRetracer.Retrace();
+        Json::Value results;
+        results["cmdline"] = cmds;
+        results["job"] = i;
+        gRetracer.saveResult(results, true);
+    }
+
+    GLWS::instance().Cleanup();
+    return 0;
+}
+
 extern "C"
 int main(int argc, char** argv)
 {
@@ -478,6 +623,11 @@ int main(int argc, char** argv)
     }
     DBG_LOG("Input cmdline : %s\n",cmds.c_str());
 
+    if (!jobsFile.empty())
+    {
+        return runJobs(cmds);
+    }
+
     if (gRetracer.mOptions.mFileName.empty())
     {
         std::cerr << "No trace file name specified.\n";
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <memory>
 #include <string>
 #include <vector>
 #include "retracer/eglconfiginfo.hpp"
@@ -28,10 +29,8 @@ struct RetraceOptions
         , mOverrideConfig(-1, -1, -1, -1, -1, -1, -1, -1)
     {}
 
-    ~RetraceOptions()
-    {
-        delete mSnapshotCallSet;
-    }
+    RetraceOptions(RetraceOptions&&) = default;
+    RetraceOptions& operator=(RetraceOptions&&) = default;
 
     std::string         mFileName;
     int                 mRetraceTid = -1;
@@ -44,6 +43,11 @@ struct RetraceOptions
     unsigned int        mEndMeasureFrame = INT32_MAX;
     int                 mLoopTimes = 0;
     int                 mLoopSeconds = 0;
+    bool                mPredecode = false;
+    bool                mVerifyChecksums = false;
+    bool                mSalvage = false;
+    bool                mReadAhead = false;
+    bool                mDirectIO = false;
     int                 mFixedFps = 0;
 
     int                 mWindowWidth = 0;
@@ -54,7 +58,7 @@ struct RetraceOptions
     float               mOverrideResRatioH = 0.0f;
 
     std::string         mSnapshotPrefix;
-    common::CallSet*    mSnapshotCallSet = nullptr;
+    std::unique_ptr<common::CallSet> mSnapshotCallSet;
     bool                mUploadSnapshots = false;
     bool                mFailOnShaderError = false;
     int                 mDebug = 0;
@@ -83,8 +87,15 @@ struct RetraceOptions
     bool                mForceSingleWindow = false;
     bool                mMultiThread = false;
     bool                mCallStats = false;
+    unsigned int        mCallSamples = 0;
+    std::string         mBinaryResultsFile;
+    bool                mLegacyResults = false; // results.json and callstats.csv as well as the binary results
+    std::string         mTimelineFile;
+    bool                mFootprint = false;
+    bool                mGpuTime = false;
 
     bool                mPbufferRendering = false;
+    bool                mNullDriver = false;
     int                 mSingleSurface = -1;
 
     int                 mForceVRS = -1;
@@ -121,6 +132,7 @@ struct RetraceOptions
     std::string         mShaderCacheFile;
     bool                mShaderCacheLoad = true;
     bool                mCacheOnly = false;
+    bool                mInternShaders = false;
 
     bool                mCollectorEnabled = false;
     Json::Value         mCollectorValue;
@@ -130,10 +142,6 @@ struct RetraceOptions
     unsigned int        mInstrumentationDelay = 0;
     bool                mSkipFence = false;
     std::vector<std::pair<unsigned int, unsigned int>> mSkipFenceRanges;
-private:
-    // Noncopyable because of owned CallSet pointer members
-    RetraceOptions(const RetraceOptions&);
-    RetraceOptions& operator=(const RetraceOptions&);
 };
 
 }
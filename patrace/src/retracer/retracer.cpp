@@ -19,6 +19,7 @@
 
 #include "common/image.hpp"
 #include "common/os_string.hpp"
+#include "common/timeline.hpp"
 #include "common/pa_exception.h"
 #include "common/gl_extension_supported.hpp"
 
@@ -60,17 +61,6 @@ namespace retracer {
 
 Retracer gRetracer;
 
-static inline uint64_t gettime()
-{
-    struct timespec t;
-    // CLOCK_MONOTONIC_COARSE is much more light-weight, but resolution is quite poor.
-    // CLOCK_PROCESS_CPUTIME_ID is another possibility, it ignores rest of system, but costs more,
-    // and also on some CPUs process migration between cores can screw up such measurements.
-    // CLOCK_MONOTONIC is therefore a reasonable and portable compromise.
-    clock_gettime(CLOCK_MONOTONIC_RAW, &t);
-    return ((uint64_t)t.tv_sec * 1000000000ull + (uint64_t)t.tv_nsec);
-}
-
 /// -- Mali HWCPipe support
 
 struct mali_hwc
@@ -466,6 +456,9 @@ Retracer::~Retracer()
 
 bool Retracer::OpenTraceFile(const char* filename)
 {
+    mFile.setVerifyChecksums(mOptions.mVerifyChecksums);
+    mFile.setSalvage(mOptions.mSalvage);
+    mFile.setReadAhead(mOptions.mReadAhead || mOptions.mDirectIO, mOptions.mDirectIO);
     if (!mFile.Open(filename))
         return false;
 
@@ -488,7 +481,9 @@ void Retracer::CloseTraceFile()
     mFile.Close();
     mFileFormatVersion = INVALID_VERSION;
     mStateLogger.close();
+    mGpuTimer.Release();
     mState.Reset();
+    mFootprint.clear();
     mCSBuffers.clear();
     mSnapshotPaths.clear();
     results.clear();
@@ -502,15 +497,25 @@ void Retracer::CloseTraceFile()
     drawBudget = INT64_MAX;
     mMosaicNeedToBeFlushed = false;
     delayedPerfmonInit = false;
-    shaderCacheFile = NULL;
+    if (shaderCacheFile)
+    {
+        fclose(shaderCacheFile);
+        shaderCacheFile = NULL;
+    }
     shaderCacheIndex.clear();
     shaderCache.clear();
+    internedPrograms.clear();
+    deferredCompiles = 0;
+    runDeferredCompiles = 0;
+    internedLinks = 0;
     conditions.clear();
     threads.clear();
     thread_remapping.clear();
     swapvals.clear();
     cachevals.clear();
     syncvals.clear();
+    mCallStats.clear();
+    mNoopStat = CallStat();
     mInitTime = 0;
     mInitTimeMono = 0;
     mInitTimeMonoRaw = 0;
@@ -524,15 +529,13 @@ void Retracer::CloseTraceFile()
     child = 0;
     mLoopTimes = 0;
     mLoopBeginTime = 0;
+    mLegacyTime = 0;
     mCurFrameNo = 0;
     mCurDrawNo = 0;
     mRollbackCallNo = 0;
-
-    if (shaderCacheFile)
-    {
-        fclose(shaderCacheFile);
-        shaderCacheFile = NULL;
-    }
+    mTimelineRenderpassDraw = 0;
+    mTimelinePerfStart = 0;
+    common::Timeline::instance().Disable();
 }
 
 bool Retracer::loadRetraceOptionsByThreadId(int tid)
@@ -788,6 +791,7 @@ void Retracer::StepShot(unsigned int callNo, unsigned int frameNo, const char *f
 
 void Retracer::TakeSnapshot(unsigned int callNo, unsigned int frameNo, const char *filename)
 {
+    common::TimelineScope scope("Snapshot", "io");
     // Only take snapshots inside the measurement range
     const bool inRange = mOptions.mBeginMeasureFrame <= frameNo && frameNo <= mOptions.mEndMeasureFrame;
     if (mOptions.mUploadSnapshots && !inRange)
@@ -1240,6 +1244,7 @@ void Retracer::RetraceThread(const int threadidx, const int our_tid)
     std::unique_lock<std::mutex> lk(mConditionMutex);
     thread_result r;
     r.our_tid = our_tid;
+    common::Timeline::instance().SetThreadName("Trace thread " + std::to_string(our_tid));
     unsigned int skip_fence_range_index = 0;
 
     while (!mFinish.load(std::memory_order_consume))
@@ -1254,7 +1259,7 @@ void Retracer::RetraceThread(const int threadidx, const int our_tid)
             }
         }
 
-        if (mOptions.mSnapshotCallSet && (mOptions.mSnapshotCallSet->contains(mCurFrameNo, mFile.ExIdToName(mCurCall.funcId))) && isSwapBuffers)
+        if (mOptions.mSnapshotCallSet && (mOptions.mSnapshotCallSet->contains(mCurFrameNo, mCurCall.funcId)) && isSwapBuffers)
         {
             TakeSnapshot(mFile.curCallNo - 1, mCurFrameNo);
         }
@@ -1289,12 +1294,13 @@ void Retracer::RetraceThread(const int threadidx, const int our_tid)
             }
             else if (mOptions.mCallStats && mCurFrameNo >= mOptions.mBeginMeasureFrame && mCurFrameNo < mOptions.mEndMeasureFrame)
             {
-                const char *funcName = mFile.ExIdToName(mCurCall.funcId);
-                uint64_t pre = gettime();
+                const uint64_t pre = readCycleCounter();
                 (*(RetraceFunc)fptr)(src);
-                uint64_t post = gettime();
-                mCallStats[funcName].count++;
-                mCallStats[funcName].time += post - pre;
+                const uint64_t post = readCycleCounter();
+                CallStat& stat = mCallStats[mCurCall.funcId];
+                stat.count++;
+                stat.time += post - pre;
+                if (mCallSamples.IsOpen()) mCallSamples.Push(mFile.curCallNo, mCurCall.funcId, mCurCall.tid, pre, post);
             }
             else if (!mOptions.mCacheOnly || cachevals[mCurCall.funcId])
             {
@@ -1321,10 +1327,17 @@ void Retracer::RetraceThread(const int threadidx, const int our_tid)
         {
             if (mOptions.mPerfStart == (int)mCurFrameNo) // before perf frame
             {
+                common::Timeline::instance().Instant("Perf start", "perf", -1, "frame", mCurFrameNo);
+                mTimelinePerfStart = os::getTime();
                 PerfStart();
             }
             else if (mOptions.mPerfStop == (int)mCurFrameNo) // last frame
             {
+                common::Timeline::instance().Instant("Perf end", "perf", -1, "frame", mCurFrameNo);
+                if (mTimelinePerfStart != 0)
+                {
+                    common::Timeline::instance().Complete("Perf range", "perf", mTimelinePerfStart, os::getTime(), mTimelineFramesTrack, "frame", mCurFrameNo);
+                }
                 PerfEnd();
             }
 
@@ -1360,7 +1373,9 @@ void Retracer::RetraceThread(const int threadidx, const int our_tid)
             {
                 DBG_LOG("Executing rollback %d / %d times - %d / %d secs\n", mLoopTimes, mOptions.mLoopTimes, secs, mOptions.mLoopSeconds);
                 if (mCollectors) mCollectors->summarize();
+                common::Timeline::instance().Instant("Rollback", "frame", -1, "loop", mLoopTimes);
                 mFile.rollback();
+                mMeasuredCalls += mFile.curCallNo - mRollbackCallNo;
                 unsigned numOfFrames = mCurFrameNo - mOptions.mBeginMeasureFrame;
                 mCurFrameNo = mOptions.mBeginMeasureFrame;
                 mFile.curCallNo = mRollbackCallNo;
@@ -1368,11 +1383,14 @@ void Retracer::RetraceThread(const int threadidx, const int our_tid)
                 const float duration = getDuration(mLoopBeginTime, &endTime);
                 const float fps = ((double)numOfFrames) / duration;
                 mLoopResults.push_back(fps);
+                if (mResults.IsOpen()) writeLoopResult(numOfFrames, duration, fps);
                 mLoopBeginTime = os::getTime();
+                mLastFrameTime = mLoopBeginTime;
+                mLastFrameCallNo = mRollbackCallNo;
                 mLoopTimes++;
             }
         }
-        else if (mOptions.mSnapshotCallSet && (mOptions.mSnapshotCallSet->contains(mFile.curCallNo, mFile.ExIdToName(mCurCall.funcId))))
+        else if (mOptions.mSnapshotCallSet && (mOptions.mSnapshotCallSet->contains(mFile.curCallNo, mCurCall.funcId)))
         {
             TakeSnapshot(mFile.curCallNo, mCurFrameNo);
         }
@@ -1420,6 +1438,7 @@ skip_call:
                 conditions.at(otheridx).notify_one();
             }
             r.handovers++;
+            common::TimelineScope scope("Wait for hand-off", "thread");
             bool success = false;
             do {
                 success = conditions.at(threadidx).wait_for(lk, std::chrono::milliseconds(50), [&]{ return our_tid == latest_call_tid || mFinish.load(std::memory_order_consume); });
@@ -1435,6 +1454,15 @@ void Retracer::Retrace()
     if (!mOptions.mCpuMask.empty()) set_cpu_mask(mOptions.mCpuMask);
     report_cpu_mask();
 
+    if (!mOptions.mTimelineFile.empty())
+    {
+        common::Timeline::instance().Enable();
+        mTimelineFramesTrack = common::Timeline::instance().Track("Frames");
+        mTimelineRenderpassTrack = common::Timeline::instance().Track("Render passes");
+        mTimelineFrameStart = os::getTime();
+        mTimelineRenderpassStart = mTimelineFrameStart;
+    }
+
     //pre-process of shader cache file if needed
     if (gRetracer.mOptions.mShaderCacheFile.size() > 0)
     {
@@ -1445,6 +1473,8 @@ void Retracer::Retrace()
     }
 
     mFile.setFrameRange(mOptions.mBeginMeasureFrame, mOptions.mEndMeasureFrame, mOptions.mMultiThread ? -1 : mOptions.mRetraceTid, mOptions.mPreload, mOptions.mLoopTimes != 0);
+    mFile.setPredecode(mOptions.mPredecode);
+    if (mOptions.mSnapshotCallSet) mOptions.mSnapshotCallSet->compile(mFile.getFuncNames());
 
     mInitTime = os::getTime();
     mInitTimeMono = os::getTimeType(CLOCK_MONOTONIC);
@@ -1465,6 +1495,7 @@ void Retracer::Retrace()
         }
     }
     syncvals.resize(mFile.getMaxSigId() + 1);
+    mCallStats.resize(mFile.getMaxSigId() + 1);
     syncvals[mFile.NameToExId("eglClientWaitSync")] = true;
     syncvals[mFile.NameToExId("eglClientWaitSyncKHR")] = true;
     syncvals[mFile.NameToExId("eglWaitSync")] = true;
@@ -1541,6 +1572,10 @@ void Retracer::OnFrameComplete()
         {
             getDuration(mEndFrameTime, &mFinishSwapTime);
         }
+        if (mGpuTimer.IsEnabled())
+        {
+            mGpuTimer.FrameEnd();
+        }
     }
 }
 
@@ -1555,12 +1590,43 @@ void Retracer::StartMeasuring()
         mCollectors->start();
     }
     mRollbackCallNo = mFile.curCallNo;
+    mMeasuredCalls = 0;
+    if (!mOptions.mBinaryResultsFile.empty() && !mResults.IsOpen())
+    {
+        if (!mResults.Open(mOptions.mBinaryResultsFile.c_str()))
+        {
+            reportAndAbort("Cannot open binary results file %s\n", mOptions.mBinaryResultsFile.c_str());
+        }
+        mResultsFramesTable = mResults.AddTable("frames", {
+            common::ResultsColumn("loop", common::RESULTS_U64),
+            common::ResultsColumn("frame", common::RESULTS_U64),
+            common::ResultsColumn("start", common::RESULTS_F64),
+            common::ResultsColumn("duration", common::RESULTS_F64),
+            common::ResultsColumn("calls", common::RESULTS_U64) });
+        mResultsLoopsTable = mResults.AddTable("loops", {
+            common::ResultsColumn("loop", common::RESULTS_U64),
+            common::ResultsColumn("frames", common::RESULTS_U64),
+            common::ResultsColumn("duration", common::RESULTS_F64),
+            common::ResultsColumn("fps", common::RESULTS_F64) });
+    }
+    if (mOptions.mCallSamples > 0 && !mCallSamples.IsOpen())
+    {
+#if ANDROID
+        const char *filename = "/sdcard/callsamples.csv";
+#else
+        const char *filename = "callsamples.csv";
+#endif
+        mCallSamples.Open(filename, mOptions.mCallSamples, mFile.getFuncNames());
+    }
     DBG_LOG("================== Start timer (Frame: %u) ==================\n", mCurFrameNo);
     mTimerBeginTime = mLoopBeginTime = os::getTime();
+    mLastFrameTime = mTimerBeginTime;
+    mLastFrameCallNo = mFile.curCallNo;
     mTimerBeginTimeMono = os::getTimeType(CLOCK_MONOTONIC);
     mTimerBeginTimeMonoRaw = os::getTimeType(CLOCK_MONOTONIC_RAW);
     mTimerBeginTimeBoot = os::getTimeType(CLOCK_BOOTTIME);
     mEndFrameTime = mTimerBeginTime;
+    common::Timeline::instance().Instant("Start timer", "frame", mTimelineFramesTrack, "frame", mCurFrameNo);
 }
 
 void Retracer::OnNewFrame()
@@ -1569,6 +1635,42 @@ void Retracer::OnNewFrame()
     {
         IncCurFrameId();
 
+        if (common::Timeline::instance().IsEnabled())
+        {
+            const long long now = os::getTime();
+            common::Timeline::instance().Complete("Frame", "frame", mTimelineFrameStart, now, mTimelineFramesTrack, "frame", mCurFrameNo - 1);
+            mTimelineFrameStart = now;
+            if (hasCurrentContext())
+            {
+                Context& context = getCurrentContext();
+                TimelineRenderpass(context._framebuffer_rev_map.RValue(context._current_framebuffer));
+            }
+        }
+
+        if (mOptions.mGpuTime && hasCurrentContext())
+        {
+            if (!mGpuTimer.IsEnabled() && !mGpuTimer.Init())
+            {
+                mOptions.mGpuTime = false;
+            }
+            else
+            {
+                Context& context = getCurrentContext();
+                mGpuTimer.FrameStart(mCurFrameNo - 1, context._framebuffer_rev_map.RValue(context._current_framebuffer));
+            }
+        }
+
+        if (mOptions.mFootprint)
+        {
+            std::vector<const Footprint*> groups;
+            for (const auto& it : mState.mContextMap)
+            {
+                const Footprint* group = &it.second->getFootprint();
+                if (std::find(groups.begin(), groups.end(), group) == groups.end()) groups.push_back(group);
+            }
+            mFootprint.endFrame(mCurFrameNo - 1, groups);
+        }
+
         if (mCurFrameNo == mOptions.mBeginMeasureFrame)
         {
             if (mOptions.mFlushWork)
@@ -1592,7 +1694,12 @@ void Retracer::OnNewFrame()
             if (mOptions.mInstrumentationDelay > 0) {
                 usleep(mOptions.mInstrumentationDelay);
             }
-            if (mCollectors) mCollectors->collect();
+            if (mCollectors)
+            {
+                common::TimelineScope scope("Collect", "collector");
+                mCollectors->collect();
+            }
+            if (mResults.IsOpen()) writeFrameResult();
         }
         if (mOptions.mFixedFps != 0) //Limited fps replay mode
         {
@@ -1610,6 +1717,44 @@ void Retracer::OnNewFrame()
     }
 }
 
+// Append the frame that just ended to the binary results
+void Retracer::writeFrameResult()
+{
+    int64_t now;
+    const float duration = getDuration(mLastFrameTime, &now);
+    mResults.Set(mResultsFramesTable, 0, (uint64_t)mLoopTimes);
+    mResults.Set(mResultsFramesTable, 1, (uint64_t)(mCurFrameNo - 1));
+    mResults.Set(mResultsFramesTable, 2, (double)ticksToSeconds(mLastFrameTime - mTimerBeginTime));
+    mResults.Set(mResultsFramesTable, 3, (double)duration);
+    mResults.Set(mResultsFramesTable, 4, (uint64_t)(mFile.curCallNo - mLastFrameCallNo));
+    mResults.EndRow(mResultsFramesTable);
+    mLastFrameTime = now;
+    mLastFrameCallNo = mFile.curCallNo;
+}
+
+void Retracer::TimelineRenderpass(unsigned framebuffer)
+{
+    const long long now = os::getTime();
+    if (mCurDrawNo != mTimelineRenderpassDraw)
+    {
+        common::Timeline::instance().Complete(mTimelineRenderpassFbo ? "Render pass" : "Render pass (default framebuffer)", "draw",
+                                              mTimelineRenderpassStart, now, mTimelineRenderpassTrack, "draws", mCurDrawNo - mTimelineRenderpassDraw);
+    }
+    mTimelineRenderpassStart = now;
+    mTimelineRenderpassDraw = mCurDrawNo;
+    mTimelineRenderpassFbo = framebuffer;
+}
+
+// Append the loop that just ended to the binary results
+void Retracer::writeLoopResult(unsigned frames, float duration, float fps)
+{
+    mResults.Set(mResultsLoopsTable, 0, (uint64_t)mLoopTimes);
+    mResults.Set(mResultsLoopsTable, 1, (uint64_t)frames);
+    mResults.Set(mResultsLoopsTable, 2, (double)duration);
+    mResults.Set(mResultsLoopsTable, 3, (double)fps);
+    mResults.EndRow(mResultsLoopsTable);
+}
+
 void Retracer::TriggerScript(const char* scriptPath)
 {
     char cmd[256];
@@ -1782,7 +1927,7 @@ void Retracer::reportAndAbort(const char *format, ...)
 #endif
 }
 
-void Retracer::saveResult(Json::Value& result)
+void Retracer::saveResult(Json::Value& result, bool keepDisplay)
 {
     int64_t endTime;
     int64_t endTimeMono = os::getTimeType(CLOCK_MONOTONIC);
@@ -1791,6 +1936,22 @@ void Retracer::saveResult(Json::Value& result)
     float duration = getDuration(mTimerBeginTime, &endTime);
     unsigned int numOfFrames = mCurFrameNo - mOptions.mBeginMeasureFrame;
 
+    // With -binaryresults the summary goes into the results file as a table,
+    // and is only built as JSON for results.json when that is asked for too
+    const bool binary = mResults.IsOpen();
+    const bool legacy = !binary || mOptions.mLegacyResults;
+    common::ResultsSummary summary;
+    auto setValue = [&](const char* name, double value)
+    {
+        if (binary) summary.Add(name, value);
+        if (legacy) result[name] = value;
+    };
+    auto setCount = [&](const char* name, uint64_t value)
+    {
+        if (binary) summary.Add(name, value);
+        if (legacy) result[name] = (Json::UInt64)value;
+    };
+
     if(mTimerBeginTime != 0) {
         if (mLegacyTime < 0) DBG_LOG("FPS requird is too high! \n");
         const float fps = ((double)numOfFrames * std::max(1, mLoopTimes)) / duration;
@@ -1799,34 +1960,57 @@ void Retracer::saveResult(Json::Value& result)
         DBG_LOG("================== End timer (Frame: %u) ==================\n", mCurFrameNo);
         DBG_LOG("Duration = %f\n", duration);
         DBG_LOG("Frame cnt = %d, FPS = %f\n", numOfFrames, fps);
-        result["fps"] = fps;
+        const uint64_t calls = mMeasuredCalls + (mFile.curCallNo - mRollbackCallNo);
+        DBG_LOG("Call cnt = %" PRIu64 ", calls/s = %f\n", calls, calls / duration);
+        setValue("fps", fps);
+        setCount("calls", calls);
+        setValue("calls_per_second", calls / duration);
         mLoopResults.push_back(loopFps);
+        if (binary) writeLoopResult(numOfFrames, loopDuration, loopFps);
     } else {
         DBG_LOG("Never rendered anything.\n");
         numOfFrames = 0;
         duration = 0;
-        result["fps"] = 0;
-    }
-
-    result["loopFPS"] = Json::arrayValue;
-    for (const auto fps : mLoopResults) result["loopFPS"].append(fps);
-    result["time"] = duration;
-    result["frames"] = numOfFrames;
-    result["init_time"] = ((double)mInitTime) / os::timeFrequency;
-    result["start_time"] = ((double)mTimerBeginTime) / os::timeFrequency;
-    result["end_time"] = ((double)endTime) / os::timeFrequency;
-    result["start_frame"] = mOptions.mBeginMeasureFrame;
-    result["end_frame"] = mOptions.mEndMeasureFrame;
-    result["init_time_monotonic"] = ((double)mInitTimeMono) / os::timeFrequency;
-    result["start_time_monotonic"] = ((double)mTimerBeginTimeMono) / os::timeFrequency;
-    result["end_time_monotonic"] = ((double)endTimeMono) / os::timeFrequency;
-    result["init_time_monotonic_raw"] = ((double)mInitTimeMonoRaw) / os::timeFrequency;
-    result["start_time_monotonic_raw"] = ((double)mTimerBeginTimeMonoRaw) / os::timeFrequency;
-    result["end_time_monotonic_raw"] = ((double)endTimeMonoRaw) / os::timeFrequency;
-    result["init_time_boot"] = ((double)mInitTimeBoot) / os::timeFrequency;
-    result["start_time_boot"] = ((double)mTimerBeginTimeBoot) / os::timeFrequency;
-    result["end_time_boot"] = ((double)endTimeBoot) / os::timeFrequency;
-    result["patrace_version"] = PATRACE_VERSION;
+        setCount("fps", 0);
+    }
+
+    if (legacy)
+    {
+        // Rebuilt from the loops table otherwise
+        result["loopFPS"] = Json::arrayValue;
+        for (const auto fps : mLoopResults) result["loopFPS"].append(fps);
+    }
+    setValue("time", duration);
+    setCount("frames", numOfFrames);
+    setValue("init_time", ((double)mInitTime) / os::timeFrequency);
+    setValue("start_time", ((double)mTimerBeginTime) / os::timeFrequency);
+    setValue("end_time", ((double)endTime) / os::timeFrequency);
+    setCount("start_frame", mOptions.mBeginMeasureFrame);
+    setCount("end_frame", mOptions.mEndMeasureFrame);
+    setValue("init_time_monotonic", ((double)mInitTimeMono) / os::timeFrequency);
+    setValue("start_time_monotonic", ((double)mTimerBeginTimeMono) / os::timeFrequency);
+    setValue("end_time_monotonic", ((double)endTimeMono) / os::timeFrequency);
+    setValue("init_time_monotonic_raw", ((double)mInitTimeMonoRaw) / os::timeFrequency);
+    setValue("start_time_monotonic_raw", ((double)mTimerBeginTimeMonoRaw) / os::timeFrequency);
+    setValue("end_time_monotonic_raw", ((double)endTimeMonoRaw) / os::timeFrequency);
+    setValue("init_time_boot", ((double)mInitTimeBoot) / os::timeFrequency);
+    setValue("start_time_boot", ((double)mTimerBeginTimeBoot) / os::timeFrequency);
+    setValue("end_time_boot", ((double)endTimeBoot) / os::timeFrequency);
+    if (binary) summary.Add("patrace_version", std::string(PATRACE_VERSION));
+    if (legacy) result["patrace_version"] = PATRACE_VERSION;
+    if (mFile.readAhead())
+    {
+        setCount("read_ahead_bytes", mFile.readAhead()->bytesRead());
+        setCount("read_ahead_stalls", mFile.readAhead()->stalls());
+        setValue("read_ahead_stall_time", ((double)mFile.readAhead()->stallTime()) / os::timeFrequency);
+    }
+    if (mOptions.mFootprint) mFootprint.save(result);
+    if (mGpuTimer.IsEnabled()) mGpuTimer.Save(result);
+    if (mOptions.mInternShaders)
+    {
+        setCount("shader_compiles_avoided", deferredCompiles - runDeferredCompiles);
+        setCount("program_links_avoided", internedLinks);
+    }
     if (mOptions.mPerfmon) perfmon_end(result);
 
     if (mCollectors)
@@ -1836,15 +2020,17 @@ void Retracer::saveResult(Json::Value& result)
 
     if (mOptions.mCallStats)
     {
+        mCallSamples.Close();
+
         // First generate some info on no-op calls as a baseline
         int c = 0;
         for (int i = 0; i < 1000; i++)
         {
-            auto pre = gettime();
+            const uint64_t pre = readCycleCounter();
             c = noop(c);
-            auto post = gettime();
-            mCallStats["NO-OP"].count++;
-            mCallStats["NO-OP"].time += post - pre;
+            const uint64_t post = readCycleCounter();
+            mNoopStat.count++;
+            mNoopStat.time += post - pre;
             usleep(c); // just to use c for something, to make 100% sure it is not optimized away
         }
 #if ANDROID
@@ -1852,17 +2038,62 @@ void Retracer::saveResult(Json::Value& result)
 #else
         const char *filename = "callstats.csv";
 #endif
-        FILE *fp = fopen(filename, "w");
-        if (fp)
+        // Gather the called functions by name, with times in nanoseconds
+        std::vector<std::pair<std::string, CallStat>> stats;
+        for (unsigned id = 0; id < mCallStats.size(); id++)
+        {
+            if (mCallStats[id].count == 0) continue;
+            CallStat stat = mCallStats[id];
+            stat.time = cycleCounterToNs(stat.time);
+            stats.push_back(std::make_pair(std::string(mFile.ExIdToName(id)), stat));
+        }
+        CallStat noopStat = mNoopStat;
+        noopStat.time = cycleCounterToNs(noopStat.time);
+        stats.push_back(std::make_pair(std::string("NO-OP"), noopStat));
+        const float noop_avg = (float)noopStat.time / noopStat.count;
+
+        // The CSV is only written when there are no binary results, or when asked to
+        FILE *fp = NULL;
+        if (legacy)
+        {
+            fp = fopen(filename, "w");
+            if (!fp)
+            {
+                DBG_LOG("Failed to open output callstats in %s: %s\n", filename, strerror(errno));
+            }
+        }
+        if (fp || binary)
         {
+            unsigned table = 0;
+            if (binary)
+            {
+                table = mResults.AddTable("callstats", {
+                    common::ResultsColumn("function", common::RESULTS_STRING),
+                    common::ResultsColumn("calls", common::RESULTS_U64),
+                    common::ResultsColumn("time", common::RESULTS_U64),
+                    common::ResultsColumn("calibrated_time", common::RESULTS_U64) });
+            }
+            if (fp)
+            {
+                fprintf(fp, "Function,Calls,Time,Calibrated_Time\n");
+            }
             uint64_t total = 0;
-            float noop_avg = (float)mCallStats["NO-OP"].time / mCallStats["NO-OP"].count;
-            fprintf(fp, "Function,Calls,Time,Calibrated_Time\n");
-            for (const auto& pair : mCallStats)
+            for (const auto& pair : stats)
             {
                 uint64_t noop = (uint64_t)(pair.second.count*noop_avg);
                 uint64_t calibrated_time = (pair.second.time > noop) ? (pair.second.time - noop) : 0;
-                fprintf(fp, "%s,%" PRIu64 ",%" PRIu64 ",%" PRIu64 "\n", pair.first.c_str(), pair.second.count, pair.second.time, calibrated_time);
+                if (fp)
+                {
+                    fprintf(fp, "%s,%" PRIu64 ",%" PRIu64 ",%" PRIu64 "\n", pair.first.c_str(), pair.second.count, pair.second.time, calibrated_time);
+                }
+                if (binary)
+                {
+                    mResults.Set(table, 0, pair.first);
+                    mResults.Set(table, 1, pair.second.count);
+                    mResults.Set(table, 2, pair.second.time);
+                    mResults.Set(table, 3, calibrated_time);
+                    mResults.EndRow(table);
+                }
                 // exclude APIs introduced from patrace
                 if (strcmp(pair.first.c_str(), "glClientSideBufferData")   && strcmp(pair.first.c_str(), "glClientSideBufferSubData") &&
                     strcmp(pair.first.c_str(), "glCreateClientSideBuffer") && strcmp(pair.first.c_str(), "glDeleteClientSideBuffer") &&
@@ -1871,21 +2102,31 @@ void Retracer::saveResult(Json::Value& result)
                     strcmp(pair.first.c_str(), "glDeleteGraphicBuffer_ARM")&& strcmp(pair.first.c_str(), "NO-OP"))
                     total += calibrated_time;
             }
-            fsync(fileno(fp));
-            fclose(fp);
+            if (fp)
+            {
+                fsync(fileno(fp));
+                fclose(fp);
+                DBG_LOG("Writing callstats to %s\n", filename);
+            }
 
             const float ddk_fps = ((float)numOfFrames * std::max(1, mLoopTimes)) / ticksToSeconds(total);
             const float ddk_mspf = (1000 * ticksToSeconds(total)) / (float)numOfFrames;
-            result["fps_ddk"] = ddk_fps;
-            result["ms/frame_ddk"] = ddk_mspf;
+            setValue("fps_ddk", ddk_fps);
+            setValue("ms/frame_ddk", ddk_mspf);
             DBG_LOG("DDK FPS = %f, ms/frame = %f\n", ddk_fps, ddk_mspf);
-            DBG_LOG("Writing callstats to %s\n", filename);
         }
-        else
-        {
-            DBG_LOG("Failed to open output callstats in %s: %s\n", filename, strerror(errno));
-        }
-        mCallStats.clear();
+        std::fill(mCallStats.begin(), mCallStats.end(), CallStat());
+        mNoopStat = CallStat();
+    }
+
+    if (common::Timeline::instance().IsEnabled())
+    {
+        common::Timeline::instance().Write(mOptions.mTimelineFile.c_str());
+    }
+
+    if (binary)
+    {
+        summary.Write(mResults, "summary");
     }
 
     DBG_LOG("Saving results...\n");
@@ -1911,7 +2152,16 @@ void Retracer::saveResult(Json::Value& result)
         }
     }
 
-    GLWS::instance().Cleanup();
+    if (keepDisplay)
+    {
+        // Nothing may be current when CloseTraceFile() destroys the contexts
+        // and surfaces, or the driver would defer freeing them
+        GLWS::instance().MakeCurrent(NULL, NULL);
+    }
+    else
+    {
+        GLWS::instance().Cleanup();
+    }
     CloseTraceFile();
 #if ANDROID
     if (!mOptions.mForceSingleWindow)
@@ -2014,7 +2264,7 @@ void post_glCompileShader(GLuint shader, GLuint originalShaderName)
 
 void post_glShaderSource(GLuint shader, GLuint originalShaderName, GLsizei count, const GLchar **string, const GLint *length)
 {
-    if (gRetracer.mOptions.mShaderCacheFile.size() > 0 && string && count)
+    if ((gRetracer.mOptions.mShaderCacheFile.size() > 0 || gRetracer.mOptions.mInternShaders) && string && count)
     {
         std::string cat;
         for (int i = 0; i < count; i++)
@@ -2034,6 +2284,7 @@ void DeleteShaderCacheFile()
 
 void OpenShaderCacheFile()
 {
+        common::TimelineScope scope("Load shader cache", "io");
         const std::string bpath = gRetracer.mOptions.mShaderCacheFile + ".bin";
         gRetracer.shaderCacheFile = fopen(bpath.c_str(), "rb");
         if (!gRetracer.shaderCacheFile)
@@ -2284,6 +2535,222 @@ void post_glLinkProgram(GLuint program, GLuint originalProgramName, int status)
     ++gRetracer.mCallCounter["glLinkProgram"];
 }
 
+static void intern_deleteShader(Context& context, GLuint shader)
+{
+    _glDeleteShader(shader);
+    context.deleteShader(shader);
+    context.getDeletedShaders().erase(shader);
+}
+
+// Forget the program for the shaders deleted while attached to it, and
+// delete those that are not attached to any other program
+static void intern_releaseShaders(Context& context, GLuint program)
+{
+    std::vector<GLuint> released;
+    for (auto& it : context.getDeletedShaders())
+    {
+        it.second.erase(program);
+        if (it.second.empty()) released.push_back(it.first);
+    }
+    for (const GLuint shader : released)
+    {
+        intern_deleteShader(context, shader);
+    }
+}
+
+// Once the program has been linked, a deleted shader attached to it is only
+// kept while it still owes its compile. GL keeps it alive for as long as it
+// stays attached, so after that it can be deleted for real.
+static void intern_releaseCompiledShaders(Context& context, GLuint program)
+{
+    std::vector<GLuint> released;
+    for (const auto& it : context.getDeletedShaders())
+    {
+        if (it.second.count(program) && !context.isCompileDeferred(it.first)) released.push_back(it.first);
+    }
+    for (const GLuint shader : released)
+    {
+        intern_deleteShader(context, shader);
+    }
+}
+
+void intern_glDeleteShader(GLuint shader, GLuint originalShaderName)
+{
+    // The compile we put off and the source that goes into the program key
+    // are still needed by the programs the shader is attached to, so keep it
+    // until its compile has run or they let go of it. Its name stays mapped,
+    // since the app may still detach it.
+    Context& context = gRetracer.getCurrentContext();
+    std::unordered_set<GLuint> programs = context.findShaderPrograms(shader);
+    if (programs.empty())
+    {
+        context.getShaderMap().LValue(originalShaderName) = 0;
+        intern_deleteShader(context, shader);
+    }
+    else
+    {
+        context.getDeletedShaders()[shader] = std::move(programs);
+    }
+}
+
+void intern_glDetachShader(GLuint program, GLuint shader)
+{
+    Context& context = gRetracer.getCurrentContext();
+    auto& deleted = context.getDeletedShaders();
+    const auto it = deleted.find(shader);
+    if (it == deleted.end()) return;
+    it->second.erase(program);
+    if (it->second.empty())
+    {
+        intern_deleteShader(context, shader);
+    }
+}
+
+void intern_glDeleteProgram(GLuint program)
+{
+    intern_releaseShaders(gRetracer.getCurrentContext(), program);
+}
+
+void intern_glCompileShader(GLuint shader)
+{
+    // Keep the source as it is now, since the app may replace it before a
+    // program that cannot be loaded from an interned binary needs the shader
+    Context& context = gRetracer.getCurrentContext();
+    const std::string* source = context.findShaderSource(shader);
+    if (!source)
+    {
+        _glCompileShader(shader);
+        post_glCompileShader(shader, context.getShaderRevMap().RValue(shader));
+        return;
+    }
+    context.deferCompile(shader, *source);
+    gRetracer.deferredCompiles++;
+}
+
+static void intern_setShaderSource(GLuint shader, const std::string& source)
+{
+    const GLchar* string = source.c_str();
+    const GLint length = source.size();
+    _glShaderSource(shader, 1, &string, &length);
+}
+
+// Compile the shader from the source it had at glCompileShader, and put back
+// whatever the app has set since
+static void intern_runDeferredCompile(Context& context, GLuint shader)
+{
+    const std::string* compiled = context.findCompiledSource(shader);
+    const std::string* current = context.findShaderSource(shader);
+    const bool changed = compiled && current && *compiled != *current;
+    if (changed)
+    {
+        intern_setShaderSource(shader, *compiled);
+    }
+    _glCompileShader(shader);
+    post_glCompileShader(shader, context.getShaderRevMap().RValue(shader));
+    if (changed)
+    {
+        intern_setShaderSource(shader, *current);
+    }
+    gRetracer.runDeferredCompiles++;
+}
+
+void intern_glLinkProgram(GLuint program, GLuint originalProgramName, int status)
+{
+    Context& context = gRetracer.getCurrentContext();
+    const std::vector<GLuint>* shaderIds = context.findShaderIDs(program);
+
+    // Key on the sources of all attached shaders and the state set up for linking
+    std::vector<std::string> sources;
+    bool known = (shaderIds != nullptr && gRetracer.mOptions.mApiVersion >= PROFILE_ES3);
+    for (unsigned i = 0; known && i < shaderIds->size(); i++)
+    {
+        const std::string* source = context.findCompiledSource(shaderIds->at(i));
+        if (source) sources.push_back(*source);
+        else known = false;
+    }
+    sources.push_back(context.getLinkState(program));
+    const std::string md5 = known ? MD5Digest(sources).text() : std::string();
+
+    const auto it = known ? gRetracer.internedPrograms.find(md5) : gRetracer.internedPrograms.end();
+    if (it != gRetracer.internedPrograms.end())
+    {
+        _glGetError(); // clear
+        _glProgramBinary(program, it->second.format, it->second.buffer.data(), it->second.buffer.size());
+        GLint linkStatus = GL_FALSE;
+        _glGetProgramiv(program, GL_LINK_STATUS, &linkStatus);
+        if (_glGetError() == GL_NO_ERROR && linkStatus == GL_TRUE)
+        {
+            gRetracer.internedLinks++;
+            if (gRetracer.mOptions.mDebug)
+            {
+                DBG_LOG("Loaded program %u from interned binary %s\n", originalProgramName, md5.c_str());
+            }
+            post_glLinkProgram(program, originalProgramName, status);
+            return;
+        }
+        DBG_LOG("Interned binary %s for program %u was rejected, linking it instead\n", md5.c_str(), originalProgramName);
+        gRetracer.internedPrograms.erase(it);
+    }
+
+    // Run the compiles this program needs, then link it as usual
+    if (shaderIds)
+    {
+        for (const GLuint shader : *shaderIds)
+        {
+            if (context.takeDeferredCompile(shader))
+            {
+                intern_runDeferredCompile(context, shader);
+            }
+        }
+    }
+    if (known)
+    {
+        _glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    }
+    _glLinkProgram(program);
+    post_glLinkProgram(program, originalProgramName, status);
+
+    GLint linkStatus = GL_FALSE;
+    GLint length = 0;
+    _glGetProgramiv(program, GL_LINK_STATUS, &linkStatus);
+    if (known && linkStatus == GL_TRUE)
+    {
+        _glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+    }
+    if (length > 0)
+    {
+        ProgramCache& interned = gRetracer.internedPrograms[md5];
+        interned.format = GL_NONE;
+        interned.buffer.resize(length);
+        _glGetProgramBinary(program, length, NULL, &interned.format, interned.buffer.data());
+        if (interned.format == GL_NONE)
+        {
+            gRetracer.internedPrograms.erase(md5);
+        }
+    }
+    intern_releaseCompiledShaders(context, program);
+}
+
+void intern_glBindAttribLocation(GLuint program, GLuint index, const GLchar *name)
+{
+    gRetracer.getCurrentContext().addLinkState(program, "attrib " + std::to_string(index) + " " + std::string(name ? name : "") + "\n");
+}
+
+void intern_glTransformFeedbackVaryings(GLuint program, GLsizei count, const GLchar *const *varyings, GLenum bufferMode)
+{
+    std::string state = "varyings " + std::to_string(bufferMode);
+    for (GLsizei i = 0; i < count; i++)
+    {
+        state += " " + std::string(varyings[i] ? varyings[i] : "");
+    }
+    gRetracer.getCurrentContext().addLinkState(program, state + "\n");
+}
+
+void intern_glProgramParameteri(GLuint program, GLenum pname, GLint value)
+{
+    gRetracer.getCurrentContext().addLinkState(program, "parameter " + std::to_string(pname) + " " + std::to_string(value) + "\n");
+}
+
 
 void hardcode_glBindFramebuffer(int target, unsigned int framebuffer)
 {
@@ -2304,6 +2771,16 @@ void hardcode_glBindFramebuffer(int target, unsigned int framebuffer)
         glBindFramebuffer(target, framebuffer);
     }
 
+    if (gRetracer.mGpuTimer.IsEnabled() && target != GL_READ_FRAMEBUFFER)
+    {
+        gRetracer.mGpuTimer.Renderpass(gRetracer.getCurrentContext()._framebuffer_rev_map.RValue(framebuffer));
+    }
+
+    if (common::Timeline::instance().IsEnabled() && target != GL_READ_FRAMEBUFFER)
+    {
+        gRetracer.TimelineRenderpass(gRetracer.getCurrentContext()._framebuffer_rev_map.RValue(framebuffer));
+    }
+
     if (gRetracer.mOptions.mForceVRS != -1)
     {
         _glShadingRateEXT(gRetracer.mOptions.mForceVRS);
@@ -2325,6 +2802,10 @@ void hardcode_glDeleteBuffers(int n, unsigned int* oldIds)
         glDeleteBuffers(1, &newId);
         idMap.LValue(oldId) = 0;
         idRevMap.LValue(newId) = 0;
+        if (unlikely(gRetracer.mOptions.mFootprint))
+        {
+            gRetracer.mFootprint.change(Footprint::BUFFER, context.getFootprint().release(Footprint::BUFFER, oldId));
+        }
     }
 }
 
@@ -2376,6 +2857,10 @@ void hardcode_glDeleteRenderbuffers(int n, unsigned int* oldIds)
         glDeleteRenderbuffers(1, &newId);
         idMap.LValue(oldId) = 0;
         idRevMap.LValue(newId) = 0;
+        if (unlikely(gRetracer.mOptions.mFootprint))
+        {
+            gRetracer.mFootprint.change(Footprint::RENDERBUFFER, context.getFootprint().release(Footprint::RENDERBUFFER, oldId));
+        }
     }
 }
 
@@ -2394,6 +2879,10 @@ void hardcode_glDeleteTextures(int n, unsigned int* oldIds)
         glDeleteTextures(1, &newId);
         idMap.LValue(oldId) = 0;
         idRevMap.LValue(newId) = 0;
+        if (unlikely(gRetracer.mOptions.mFootprint))
+        {
+            gRetracer.mFootprint.change(Footprint::TEXTURE, context.getFootprint().release(Footprint::TEXTURE, oldId));
+        }
     }
 }
 
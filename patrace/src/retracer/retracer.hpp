@@ -4,6 +4,8 @@
 #include "retracer/retrace_options.hpp"
 #include "retracer/state.hpp"
 #include "retracer/texture.hpp"
+#include "retracer/call_samples.hpp"
+#include "retracer/gpu_timer.hpp"
 #include "helper/states.h"
 #include "graphic_buffer/GraphicBuffer.hpp"
 #include "dma_buffer/dma_buffer.hpp"
@@ -13,6 +15,7 @@
 #include "common/os.hpp"
 #include "common/os_time.hpp"
 #include "common/memory.hpp"
+#include "common/results_file.hpp"
 #ifndef _WIN32
 #include "common/memoryinfo.hpp"
 #endif
@@ -63,12 +66,17 @@ public:
     void CheckGlError();
 
     void reportAndAbort(const char *format, ...) NORETURN;
-    void saveResult(Json::Value& results);
+    // With keepDisplay, only the GL state of this run is torn down, so that
+    // the next job of a batch can reuse the EGL display
+    void saveResult(Json::Value& results, bool keepDisplay = false);
     bool addResultInformation();
 
     void OnFrameComplete();
     void OnNewFrame();
     void StartMeasuring();
+    // Close the timeline's current render pass, if it had any draws, and
+    // start the next one on the given framebuffer
+    void TimelineRenderpass(unsigned framebuffer);
 
     void TriggerScript(const char* scriptPath);
 
@@ -97,6 +105,7 @@ public:
 
     common::InFile mFile;
     RetraceOptions mOptions;
+    FootprintTimeline mFootprint; // before mState, which releases into it
     StateMgr mState;
     common::BCall_vlen mCurCall;
     std::atomic_bool mFinish;
@@ -110,6 +119,8 @@ public:
     std::unordered_map<std::string, int> mCallCounter;
 
     Collection *mCollectors = nullptr;
+    GpuTimer mGpuTimer; // only enabled with -gputime
+    common::ResultsWriter mResults; // only open with -binaryresults
 
     bool mMosaicNeedToBeFlushed = false;
     bool delayedPerfmonInit = false;
@@ -125,6 +136,10 @@ public:
     std::string shaderCacheVersionMD5;
     std::map<std::string, uint64_t> shaderCacheIndex; // md5 of shader source to offset of cache file
     std::unordered_map<std::string, ProgramCache> shaderCache; // md5 of shader source to cache struct in mem
+    std::unordered_map<std::string, ProgramCache> internedPrograms; // md5 of shader sources and link state to binary, with -internshaders
+    uint64_t deferredCompiles = 0;
+    uint64_t runDeferredCompiles = 0; // that a program needed after all
+    uint64_t internedLinks = 0; // satisfied from internedPrograms
     int64_t frameBudget = INT64_MAX;
     int64_t drawBudget = INT64_MAX;
 
@@ -142,6 +157,8 @@ private:
     float getDuration(int64_t lastTime, int64_t* thisTime) const;
     float ticksToSeconds(long long t) const;
     void initializeCallCounter();
+    void writeFrameResult();
+    void writeLoopResult(unsigned frames, float duration, float fps);
 
 #ifndef _WIN32
     bool addMaliRegisterInformation();
@@ -177,7 +194,11 @@ private:
         uint64_t count = 0;
         uint64_t time = 0;
     };
-    std::unordered_map<std::string, CallStat> mCallStats;
+    // Indexed by funcId, so the measured call path does no name lookups.
+    // Times are in readCycleCounter() ticks.
+    std::vector<CallStat> mCallStats;
+    CallStat mNoopStat;
+    CallSampleRing mCallSamples;
 
     pid_t child = 0;
 
@@ -185,9 +206,22 @@ private:
     std::vector<float> mLoopResults;
     int64_t mLoopBeginTime = 0;
 
+    unsigned mResultsFramesTable = 0;
+    unsigned mResultsLoopsTable = 0;
+    int64_t mLastFrameTime = 0;
+    unsigned mLastFrameCallNo = 0;
+    int mTimelineFramesTrack = -1;
+    int64_t mTimelineFrameStart = 0;
+    int mTimelineRenderpassTrack = -1;
+    int64_t mTimelineRenderpassStart = 0;
+    unsigned mTimelineRenderpassDraw = 0;
+    unsigned mTimelineRenderpassFbo = 0;
+    int64_t mTimelinePerfStart = 0;
+
     unsigned mCurDrawNo = 0;
     unsigned mCurFrameNo = 0;
     unsigned mRollbackCallNo = 0;
+    uint64_t mMeasuredCalls = 0; // calls replayed in previous loops of the measured range
 };
 
 inline float Retracer::getDuration(int64_t lastTime, int64_t* thisTime) const
@@ -213,6 +247,14 @@ void post_glShaderSource(GLuint shader, GLuint originalshaderName, GLsizei count
 void OpenShaderCacheFile();
 void DeleteShaderCacheFile();
 bool load_from_shadercache(GLuint program, GLuint originalProgramName, int status);
+void intern_glCompileShader(GLuint shader);
+void intern_glDeleteShader(GLuint shader, GLuint originalShaderName);
+void intern_glDetachShader(GLuint program, GLuint shader);
+void intern_glDeleteProgram(GLuint program);
+void intern_glLinkProgram(GLuint program, GLuint originalProgramName, int status);
+void intern_glBindAttribLocation(GLuint program, GLuint index, const GLchar *name);
+void intern_glTransformFeedbackVaryings(GLuint program, GLsizei count, const GLchar *const *varyings, GLenum bufferMode);
+void intern_glProgramParameteri(GLuint program, GLenum pname, GLint value);
 void hardcode_glBindFramebuffer(int target, unsigned int framebuffer);
 void hardcode_glDeleteBuffers(int n, unsigned int* oldBuffers);
 void hardcode_glDeleteFramebuffers(int n, unsigned int* oldBuffers);
@@ -1,14 +1,17 @@
 #ifndef _RETRACER_STATE_HPP_
 #define _RETRACER_STATE_HPP_
 
+#include <algorithm>
 #include <unordered_map>
 #include <vector>
 #include <string>
 #include <set>
+#include <unordered_set>
 
 #include <common/trace_limits.hpp>
 #include <common/gl_utility.hpp>
 #include <retracer/value_map.hpp>
+#include <retracer/footprint.hpp>
 #include <retracer/retrace_options.hpp> // enum Profile
 #include "dispatch/eglimports.hpp"
 #include "graphic_buffer/GraphicBuffer.hpp"
@@ -216,6 +219,12 @@ public:
 
     hmap<unsigned int>& getGraphicBufferMap();
 
+    Footprint& getFootprint()
+    {
+        if (_shareContext) return _shareContext->getFootprint();
+        return _footprint;
+    }
+
     Profile _profile;
 
     hmap<unsigned int> _list_map;
@@ -261,7 +270,12 @@ public:
     inline void deleteShader(GLuint shader)
     {
         if (_shareContext) _shareContext->deleteShader(shader);
-        else mShaderSources.erase(shader);
+        else
+        {
+            mShaderSources.erase(shader);
+            mCompiledSources.erase(shader);
+            mDeferredCompiles.erase(shader);
+        }
     }
 
     inline const std::vector<GLuint>& getShaderIDs(GLuint program) const
@@ -279,11 +293,104 @@ public:
         if (_shareContext) _shareContext->deleteShaderIDs(program);
         else mProgramShaders.erase(program);
     }
+    inline void detachShaderID(GLuint program, GLuint shader)
+    {
+        if (_shareContext)
+        {
+            _shareContext->detachShaderID(program, shader);
+            return;
+        }
+        const auto it = mProgramShaders.find(program);
+        if (it != mProgramShaders.end()) it->second.erase(std::remove(it->second.begin(), it->second.end(), shader), it->second.end());
+    }
+    // Programs that the shader is attached to
+    inline std::unordered_set<GLuint> findShaderPrograms(GLuint shader) const
+    {
+        if (_shareContext) return _shareContext->findShaderPrograms(shader);
+        std::unordered_set<GLuint> programs;
+        for (const auto& it : mProgramShaders)
+        {
+            if (std::find(it.second.begin(), it.second.end(), shader) != it.second.end()) programs.insert(it.first);
+        }
+        return programs;
+    }
+
+    // Like getShaderSource() and getShaderIDs(), but return null if unknown
+    inline const std::string* findShaderSource(GLuint shader) const
+    {
+        if (_shareContext) return _shareContext->findShaderSource(shader);
+        const auto it = mShaderSources.find(shader);
+        return (it != mShaderSources.end()) ? &it->second : nullptr;
+    }
+    inline const std::vector<GLuint>* findShaderIDs(GLuint program) const
+    {
+        if (_shareContext) return _shareContext->findShaderIDs(program);
+        const auto it = mProgramShaders.find(program);
+        return (it != mProgramShaders.end()) ? &it->second : nullptr;
+    }
+
+    // Shaders whose compilation -internshaders put off until a program needs
+    // them, and the source each shader had when the app last compiled it
+    inline void deferCompile(GLuint shader, const std::string& source)
+    {
+        if (_shareContext) _shareContext->deferCompile(shader, source);
+        else
+        {
+            mCompiledSources[shader] = source;
+            mDeferredCompiles.insert(shader);
+        }
+    }
+    inline bool isCompileDeferred(GLuint shader) const
+    {
+        if (_shareContext) return _shareContext->isCompileDeferred(shader);
+        else return mDeferredCompiles.count(shader) > 0;
+    }
+    inline bool takeDeferredCompile(GLuint shader)
+    {
+        if (_shareContext) return _shareContext->takeDeferredCompile(shader);
+        else return mDeferredCompiles.erase(shader) > 0;
+    }
+    inline const std::string* findCompiledSource(GLuint shader) const
+    {
+        if (_shareContext) return _shareContext->findCompiledSource(shader);
+        const auto it = mCompiledSources.find(shader);
+        return (it != mCompiledSources.end()) ? &it->second : nullptr;
+    }
+
+    // Shaders that the app deleted while attached, to the programs they are
+    // still attached to, for -internshaders
+    inline std::unordered_map<GLuint, std::unordered_set<GLuint>>& getDeletedShaders()
+    {
+        if (_shareContext) return _shareContext->getDeletedShaders();
+        else return mDeletedShaders;
+    }
+
+    // Program state other than its shaders that affects linking, for -internshaders
+    inline void addLinkState(GLuint program, const std::string& state)
+    {
+        if (_shareContext) _shareContext->addLinkState(program, state);
+        else mLinkStates[program] += state;
+    }
+    inline std::string getLinkState(GLuint program) const
+    {
+        if (_shareContext) return _shareContext->getLinkState(program);
+        const auto it = mLinkStates.find(program);
+        return (it != mLinkStates.end()) ? it->second : std::string();
+    }
+    inline void deleteLinkState(GLuint program)
+    {
+        if (_shareContext) _shareContext->deleteLinkState(program);
+        else mLinkStates.erase(program);
+    }
 
 private:
     Context* _shareContext;
     std::unordered_map<GLuint, std::string> mShaderSources; // shader id to string; shared
     std::unordered_map<GLuint, std::vector<GLuint>> mProgramShaders; // program id to list of shader ids; shared
+    std::unordered_map<GLuint, std::string> mCompiledSources; // shader id to source at glCompileShader; shared
+    std::unordered_set<GLuint> mDeferredCompiles; // shared
+    std::unordered_map<GLuint, std::unordered_set<GLuint>> mDeletedShaders; // shared
+    std::unordered_map<GLuint, std::string> mLinkStates; // program id to link state; shared
     int refcnt;
     hmap<unsigned int> _texture_map; // shared
     hmap<unsigned int> _buffer_map; // shared
@@ -298,6 +405,7 @@ private:
     hmap<unsigned int> _program_rev_map; // shared
     hmap<unsigned int> _shader_rev_map; // shared
     hmap<unsigned int> _renderbuffer_rev_map; // shared
+    Footprint _footprint; // shared
     hmap<unsigned int> _sampler_rev_map; // shared
     hmap<unsigned int> _graphicbuffer_map; // shared
 };
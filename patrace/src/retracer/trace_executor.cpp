@@ -14,6 +14,7 @@
 #include <errno.h>
 
 #include "common/base64.hpp"
+#include "dispatch/eglproc_retrace.hpp"
 #include "common/os_string.hpp"
 #include "common/trace_callset.hpp"
 #include "retracer/afrc_enum.hpp"
@@ -53,6 +54,11 @@ void TraceExecutor::overrideDefaultsWithJson(Json::Value &value)
     {
         options.mLoopSeconds = value["loopSeconds"].asInt();
     }
+    options.mPredecode = value.get("predecode", options.mPredecode).asBool();
+    options.mVerifyChecksums = value.get("verifyChecksums", options.mVerifyChecksums).asBool();
+    options.mSalvage = value.get("salvage", options.mSalvage).asBool();
+    options.mReadAhead = value.get("readAhead", options.mReadAhead).asBool();
+    options.mDirectIO = value.get("directIO", options.mDirectIO).asBool();
 
     if (value.isMember("fpslimit"))
     {
@@ -107,6 +113,12 @@ void TraceExecutor::overrideDefaultsWithJson(Json::Value &value)
     options.mForceOffscreen = value.get("offscreen", options.mForceOffscreen).asBool();
     options.mPbufferRendering = value.get("noscreen", options.mPbufferRendering).asBool();
     options.mSingleSurface = value.get("singlesurface", options.mSingleSurface).asInt();
+    options.mNullDriver = value.get("nullDriver", options.mNullDriver).asBool();
+    if (options.mNullDriver)
+    {
+        options.mPbufferRendering = true;
+        SetNullDriver(true);
+    }
 
     options.mOverrideConfig = eglConfig;
     options.mMeasurePerFrame = value.get("measurePerFrame", false).asBool();
@@ -133,6 +145,16 @@ void TraceExecutor::overrideDefaultsWithJson(Json::Value &value)
     }
 
     options.mCallStats = value.get("callStats", options.mCallStats).asBool();
+    options.mCallSamples = value.get("callSamples", options.mCallSamples).asUInt();
+    if (options.mCallSamples > 0)
+    {
+        options.mCallStats = true;
+    }
+    options.mBinaryResultsFile = value.get("binaryResults", options.mBinaryResultsFile).asString();
+    options.mLegacyResults = value.get("legacyResults", options.mLegacyResults).asBool();
+    options.mTimelineFile = value.get("timeline", options.mTimelineFile).asString();
+    options.mFootprint = value.get("memoryFootprint", options.mFootprint).asBool();
+    options.mGpuTime = value.get("gpuTime", options.mGpuTime).asBool();
     if (options.mCallStats && !usedFramerange)
     {
         gRetracer.reportAndAbort("callStats requires frames to also be present in the JSON input!\n");
@@ -206,8 +228,7 @@ void TraceExecutor::overrideDefaultsWithJson(Json::Value &value)
 
     if (value.isMember("snapshotCallset")) {
         DBG_LOG("snapshotCallset = %s\n", value.get("snapshotCallset", "").asCString());
-        delete options.mSnapshotCallSet;
-        options.mSnapshotCallSet = new common::CallSet( value.get("snapshotCallset", "").asCString() );
+        options.mSnapshotCallSet.reset(new common::CallSet( value.get("snapshotCallset", "").asCString() ));
     }
 
     options.mStateLogging = value.get("statelog", false).asBool();
@@ -310,6 +331,9 @@ void TraceExecutor::overrideDefaultsWithJson(Json::Value &value)
     options.mCacheOnly = value.get("cacheOnly", options.mCacheOnly).asBool();
     if (value.isMember("loadShaderCache") && value.isMember("saveShaderCache")) gRetracer.reportAndAbort("loadShaderCache and saveShaderCache cannot be used at the same time in the JSON input!");
     if (!value.isMember("saveShaderCache") && value.isMember("cacheOnly")) gRetracer.reportAndAbort("cacheOnly requires saveShaderCache to also be present in the JSON input!");
+    options.mInternShaders = value.get("internShaders", options.mInternShaders).asBool();
+    if (options.mInternShaders && options.mShaderCacheFile.size() > 0) gRetracer.reportAndAbort("internShaders cannot be used together with loadShaderCache or saveShaderCache!");
+    if (options.mInternShaders && options.mRemoveUnusedVertexAttributes) gRetracer.reportAndAbort("internShaders cannot be used together with removeUnusedVertexAttributes!");
 
     options.mInstrumentationDelay = value.get("instrumentationDelay", 0).asUInt();
 
@@ -667,6 +691,18 @@ bool TraceExecutor::writeData(Json::Value result_data_value, int frames, float d
         result_value["result"] = result_list_value;
     }
 
+    if (gRetracer.mResults.IsOpen())
+    {
+        // Everything goes into the binary results file; convert with results_to_json
+        gRetracer.mResults.WriteJson("results", result_value);
+        gRetracer.mResults.Close();
+        DBG_LOG("Results written to %s\n", gRetracer.mOptions.mBinaryResultsFile.c_str());
+        if (!gRetracer.mOptions.mLegacyResults)
+        {
+            return true;
+        }
+    }
+
     Json::StyledWriter writer;
     std::string data = writer.write(result_value);
 
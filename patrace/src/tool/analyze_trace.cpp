@@ -12,8 +12,10 @@
 #include <GLES2/gl2.h>
 #include <GLES3/gl31.h>
 #include <GLES3/gl32.h>
+#include <inttypes.h>
 #include <limits.h>
 #include <iomanip>
+#include <fstream>
 #include <sstream>
 #include <sys/stat.h>
 #include <sys/types.h>
@@ -29,10 +31,14 @@
 #include "common/trace_model.hpp"
 #include "common/gl_utility.hpp"
 #include "common/os.hpp"
+#include "common/trace_chunk.hpp"
 #include "eglstate/context.hpp"
 #include "tool/config.hpp"
 #include "base/base.hpp"
 
+#include <snappy.h>
+#include <stdarg.h>
+
 #pragma GCC diagnostic ignored "-Wunused-variable"
 
 static int startframe = 0;
@@ -51,6 +57,9 @@ static std::map<int, double> heavinesses;
 static std::string iname;
 static int ipriority = -1;
 static bool write_usage = false;
+static std::string cache_dir;
+static std::string cache_file; // set if the results of this run can be cached
+static unsigned shader_threads = 0;
 
 /// Helper to prune empty lists from a JSON object
 static void prune(Json::Value& v)
@@ -233,6 +242,10 @@ static void printHelp()
         "  -iname <name> Pass this name to the result JSON\n"
         "  -iprio <p>    Pass this priority value to the result JSON\n"
         "  -txu          Write out a texture usage file that maps draw calls to textures used\n"
+        "  -cache <dir>  Keep the analysis results in this directory, and answer later runs on the\n"
+        "                same trace, frames and options from there (not with -r, -d, -S, -Z or -j).\n"
+        "                Shader parse results are kept there too, and shared between traces\n"
+        "  -shaderthreads <n> Parse all shaders of the trace up front on this many threads\n"
         "Options for per frame output:\n"
         "  -Z            Write out used shaders to disk\n"
         "  -j            Write out renderpass JSON data for selected frames\n"
@@ -522,6 +535,7 @@ public:
     void buffer_changed(GLenum target);
     void buffer_bound(GLenum target);
     Json::Value trace_json(ParseInterfaceBase& input);
+    Json::Value results(ParseInterfaceBase& input);
     Json::Value frame_json(ParseInterfaceBase& input, int frame);
     Json::Value json_program(const StateTracker::Context& context, const StateTracker::Program& program, int frame);
     double calculate_heaviness(const ParseInterfaceBase& input, int frame);
@@ -530,7 +544,7 @@ public:
     bool in_renderpass_frame = false;
 };
 
-static void write_callstats(const ParseInterfaceBase& input, const std::string& basename)
+static void write_callstats(const Json::Value& callstats, const std::string& basename)
 {
     std::string filename = basename + "_callstats.csv";
     FILE *fp = fopen(filename.c_str(), "w");
@@ -540,13 +554,157 @@ static void write_callstats(const ParseInterfaceBase& input, const std::string&
         return;
     }
     fprintf(fp, "Function,Count,Duplicates,%% dupes\n");
-    for (auto& pair : input.callstats)
+    for (const auto& name : callstats.getMemberNames())
     {
-        fprintf(fp, "%s,%ld,%ld,%f\n", pair.first.c_str(), pair.second.count, pair.second.dupes, (double)pair.second.dupes / (double)pair.second.count);
+        const long count = callstats[name][0].asInt64();
+        const long dupes = callstats[name][1].asInt64();
+        fprintf(fp, "%s,%ld,%ld,%f\n", name.c_str(), count, dupes, (double)dupes / (double)count);
     }
     fclose(fp);
 }
 
+static void csv_printf(std::string& csv, const char* format, ...)
+{
+    char line[256];
+    va_list ap;
+    va_start(ap, format);
+    vsnprintf(line, sizeof(line), format, ap);
+    va_end(ap);
+    csv += line;
+}
+
+static void write_reports(const Json::Value& results)
+{
+    const std::string basename = dump_csv_filename.empty() ? "trace" : dump_csv_filename;
+    // JSON
+    write_json(results["trace"], basename);
+    // API stats CSV
+    std::map<std::string, PerUnit> perframe;
+    for (const auto& name : results["perframe"].getMemberNames())
+    {
+        const Json::Value& v = results["perframe"][name];
+        perframe[name].csv_description = v["description"].asString();
+        for (const Json::Value& value : v["values"])
+        {
+            perframe[name].values.push_back(value.asInt64());
+        }
+    }
+    write_CSV(basename, perframe, true);
+    // Usage stats CSV
+    for (const auto& name : results["usage"].getMemberNames())
+    {
+        std::string filename = dump_csv_filename.empty() ? name : dump_csv_filename + "_" + name + ".csv";
+        FILE* fp = fopen(filename.c_str(), "w");
+        assert(fp);
+        fputs(results["usage"][name].asCString(), fp);
+        fclose(fp);
+    }
+    // Dependencies CSV
+    FILE* fp = fopen(dump_csv_filename.empty() ? "dependencies.csv" : std::string(dump_csv_filename + "_deps.csv").c_str(), "w");
+    if (fp)
+    {
+        fprintf(fp, "frame,min:frame,min:call,fb:frame,fb:call,tx:frame,tx:call,rb:frame,rb:call,samp:frame,sampl:call,query:"
+                    "frame,query:call,tf:frame,tf:call,buf:frame,buf:call,prog:frame,prog:call,shader:frame,"
+                    "shader:call,vao:frame,vao:call,pp:frame,pp:call\n");
+        int frame = 0;
+        for (const Json::Value& d : results["dependencies"])
+        {
+            fprintf(fp, "%d", frame);
+            for (const Json::Value& i : d) fprintf(fp, ",%d", i.asInt());
+            fprintf(fp, "\n");
+            frame++;
+        }
+        fclose(fp);
+    }
+    // Dump out callstats CSV
+    write_callstats(results["callstats"], basename);
+}
+
+// The cache is keyed by a digest of the trace header, the size and
+// modification time of the trace file, the frame range and the options that
+// change the results. Hashing all of a trace that may be gigabytes would
+// cost about as much as analyzing it. Output names and formats are not part
+// of the key, since all reports are made from the cached results.
+static std::string cache_filename(const std::string& trace, bool multithread)
+{
+    struct stat sb;
+    FILE* fp = fopen(trace.c_str(), "rb");
+    if (!fp || fstat(fileno(fp), &sb) != 0)
+    {
+        if (fp) fclose(fp);
+        return std::string();
+    }
+    // The fixed header, then for newer versions the JSON header it points to
+    std::vector<char> header(std::max(sizeof(common::BHeaderV2), sizeof(common::BHeaderV3)));
+    header.resize(fread(header.data(), 1, header.size(), fp));
+    if (header.size() >= sizeof(common::BHeaderV3))
+    {
+        const common::BHeaderV3 hdr = *(const common::BHeaderV3*)header.data();
+        if (hdr.version >= common::HEADER_VERSION_3 && hdr.jsonLength <= common::BHeaderV3::jsonMaxLength
+            && fseek(fp, hdr.jsonFileBegin, SEEK_SET) == 0)
+        {
+            std::vector<char> json(hdr.jsonLength);
+            json.resize(fread(json.data(), 1, json.size(), fp));
+            header.insert(header.end(), json.begin(), json.end());
+        }
+    }
+    fclose(fp);
+    const uint64_t digest = common::xxHash64(header.data(), header.size());
+
+    char name[96];
+    snprintf(name, sizeof(name), "%016" PRIx64 "_%" PRIx64 "_%" PRIx64, digest, (uint64_t)sb.st_size, (uint64_t)sb.st_mtime);
+    std::string filename = cache_dir + "/" + name + "_f" + std::to_string(startframe) + "-";
+    filename += (lastframe == INT_MAX) ? std::string("end") : std::to_string(lastframe);
+    if (multithread) filename += "_m";
+    if (report_unused_shaders) filename += "_s";
+    if (write_usage) filename += "_txu";
+    return filename + ".cache";
+}
+
+static const uint32_t CACHE_MAGIC = 0x41544150; // "PATA"
+
+static void store_cache(const std::string& filename, const Json::Value& results)
+{
+    mkdir(cache_dir.c_str(), 0755);
+    Json::FastWriter writer;
+    const std::string json = writer.write(results);
+    std::string compressed;
+    snappy::Compress(json.data(), json.size(), &compressed);
+    FILE* fp = fopen(filename.c_str(), "wb");
+    if (!fp)
+    {
+        DBG_LOG("Could not open %s for writing: %s\n", filename.c_str(), strerror(errno));
+        return;
+    }
+    fwrite(&CACHE_MAGIC, sizeof(CACHE_MAGIC), 1, fp);
+    fwrite(compressed.data(), 1, compressed.size(), fp);
+    fclose(fp);
+}
+
+static bool load_cache(const std::string& filename, Json::Value& results)
+{
+    std::ifstream t(filename, std::ios::binary);
+    std::string data((std::istreambuf_iterator<char>(t)), std::istreambuf_iterator<char>());
+    std::string json;
+    uint32_t magic = 0;
+    if (data.size() < sizeof(magic))
+    {
+        return false;
+    }
+    memcpy(&magic, data.data(), sizeof(magic));
+    if (magic != CACHE_MAGIC || !snappy::Uncompress(data.data() + sizeof(magic), data.size() - sizeof(magic), &json))
+    {
+        DBG_LOG("Ignoring damaged cache file %s\n", filename.c_str());
+        return false;
+    }
+    Json::Reader reader;
+    if (!reader.parse(json, results) || results["version"].asString() != PATRACE_VERSION)
+    {
+        return false;
+    }
+    return true;
+}
+
 // this is not 100% reliable - as the user could bind to another point to change it first
 void AnalyzeTrace::buffer_changed(GLenum target)
 {
@@ -1454,7 +1612,7 @@ void AnalyzeTrace::analyze(ParseInterfaceBase& input)
     }
 
     // Now generate reports
-    if (complexity_only_mode)
+    if (complexity_only_mode && cache_file.empty())
     {
         printf("%.04f\n", calculate_complexity(input));
         return;
@@ -1466,17 +1624,62 @@ void AnalyzeTrace::analyze(ParseInterfaceBase& input)
         filename += "_f" + std::to_string(frame);
         write_json(frame_json(input, frame), filename);
     }
-    // JSON
-    write_json(trace_json(input), dump_csv_filename.empty() ? "trace" : dump_csv_filename);
-    // API stats CSV
-    write_CSV(dump_csv_filename.empty() ? "trace" : dump_csv_filename, perframe, true);
+
+    Json::Value r = results(input);
+    if (!cache_file.empty())
+    {
+        store_cache(cache_file, r);
+    }
+    if (complexity_only_mode)
+    {
+        printf("%.04f\n", r["trace"]["complexity"].asDouble());
+        return;
+    }
+    write_reports(r);
+
+    input.cleanup(); // last since this can crash sometimes
+}
+
+// Everything that the reports of write_reports() are made from, so that
+// they can be cached
+Json::Value AnalyzeTrace::results(ParseInterfaceBase& input)
+{
+    Json::Value r;
+    r["version"] = PATRACE_VERSION;
+    r["trace"] = trace_json(input);
+    for (const auto& pair : perframe)
+    {
+        Json::Value& v = r["perframe"][pair.first];
+        v["description"] = pair.second.csv_description;
+        v["values"] = Json::arrayValue;
+        for (long value : pair.second.values)
+        {
+            v["values"].append((Json::Int64)value);
+        }
+    }
+    r["dependencies"] = Json::arrayValue;
+    for (const auto& d : input.dependencies)
+    {
+        Json::Value row = Json::arrayValue;
+        for (const auto& i : d)
+        {
+            row.append(i.frame);
+            row.append(i.call);
+        }
+        r["dependencies"].append(row);
+    }
+    r["callstats"] = Json::objectValue;
+    for (const auto& pair : input.callstats)
+    {
+        r["callstats"][pair.first].append((Json::Int64)pair.second.count);
+        r["callstats"][pair.first].append((Json::Int64)pair.second.dupes);
+    }
+
     // Usage stats CSV
+    r["usage"] = Json::objectValue;
     if (write_usage)
     {
-        std::string filename = dump_csv_filename.empty() ? "unused_mipmaps" : dump_csv_filename + "_unused_mipmaps.csv";
-        FILE* fp = fopen(filename.c_str(), "w");
-        assert(fp);
-        fprintf(fp, "Call,Context,TxIndex,TxId\n");
+        std::string csv = "Call,Context,TxIndex,TxId\n";
         for (const auto& ctx : input.contexts)
         {
             if (ctx.share_context != 0) continue;
@@ -1484,75 +1687,46 @@ void AnalyzeTrace::analyze(ParseInterfaceBase& input)
             {
                 for (const auto& mip : tx.mipmaps)
                 {
-                    if (!mip.second.used) fprintf(fp, "%d,%d,%d,%d\n", mip.first, (int)ctx.id, tx.index, (int)tx.id);
+                    if (!mip.second.used) csv_printf(csv, "%d,%d,%d,%d\n", mip.first, (int)ctx.id, tx.index, (int)tx.id);
                 }
             }
         }
-        fclose(fp);
+        r["usage"]["unused_mipmaps"] = csv;
 
-        filename = dump_csv_filename.empty() ? "unused_textures" : dump_csv_filename + "_unused_textures.csv";
-        fp = fopen(filename.c_str(), "w");
-        assert(fp);
-        fprintf(fp, "Call,Frame,TxIndex,TxId,ContextIndex,ContextId\n");
+        csv = "Call,Frame,TxIndex,TxId,ContextIndex,ContextId\n";
         for (const auto& ctx : input.contexts)
         {
             if (ctx.share_context != 0) continue;
             for (const auto& tx : ctx.textures.all())
             {
-                if (!tx.used) fprintf(fp, "%d,%d,%d,%d,%d,%d\n", tx.created.call, tx.created.frame, tx.index, (int)tx.id, ctx.index, (int)ctx.id);
+                if (!tx.used) csv_printf(csv, "%d,%d,%d,%d,%d,%d\n", tx.created.call, tx.created.frame, tx.index, (int)tx.id, ctx.index, (int)ctx.id);
             }
         }
-        fclose(fp);
+        r["usage"]["unused_textures"] = csv;
 
-        filename = dump_csv_filename.empty() ? "unused_buffers" : dump_csv_filename + "_unused_buffers.csv";
-        fp = fopen(filename.c_str(), "w");
-        assert(fp);
-        fprintf(fp, "Call,Frame,BufIndex,BufId,ContextIndex,ContextId\n");
+        csv = "Call,Frame,BufIndex,BufId,ContextIndex,ContextId\n";
         for (const auto& ctx : input.contexts)
         {
             if (ctx.share_context != 0) continue;
             for (const auto& buf : ctx.buffers.all())
             {
-                if (!buf.used) fprintf(fp, "%d,%d,%d,%d,%d,%d\n", buf.created.call, buf.created.frame, buf.index, (int)buf.id, ctx.index, (int)ctx.id);
+                if (!buf.used) csv_printf(csv, "%d,%d,%d,%d,%d,%d\n", buf.created.call, buf.created.frame, buf.index, (int)buf.id, ctx.index, (int)ctx.id);
             }
         }
-        fclose(fp);
+        r["usage"]["unused_buffers"] = csv;
 
-        filename = dump_csv_filename.empty() ? "textures_used_uninitialized" : dump_csv_filename + "_textures_used_uninitialized.csv";
-        fp = fopen(filename.c_str(), "w");
-        assert(fp);
-        fprintf(fp, "Call,Frame,TxIndex,TxId,ContextIndex,ContextId\n");
+        csv = "Call,Frame,TxIndex,TxId,ContextIndex,ContextId\n";
         for (const auto& ctx : input.contexts)
         {
             if (ctx.share_context != 0) continue;
             for (const auto& tx : ctx.textures.all())
             {
-                if (tx.uninit_usage) fprintf(fp, "%d,%d,%d,%d,%d,%d\n", tx.created.call, tx.created.frame, tx.index, (int)tx.id, ctx.index, (int)ctx.id);
+                if (tx.uninit_usage) csv_printf(csv, "%d,%d,%d,%d,%d,%d\n", tx.created.call, tx.created.frame, tx.index, (int)tx.id, ctx.index, (int)ctx.id);
             }
         }
-        fclose(fp);
-    }
-    // Dependencies CSV
-    FILE* fp = fopen(dump_csv_filename.empty() ? "dependencies.csv" : std::string(dump_csv_filename + "_deps.csv").c_str(), "w");
-    if (fp)
-    {
-        fprintf(fp, "frame,min:frame,min:call,fb:frame,fb:call,tx:frame,tx:call,rb:frame,rb:call,samp:frame,sampl:call,query:"
-                    "frame,query:call,tf:frame,tf:call,buf:frame,buf:call,prog:frame,prog:call,shader:frame,"
-                    "shader:call,vao:frame,vao:call,pp:frame,pp:call\n");
-        int frame = 0;
-        for (const auto& d : input.dependencies)
-        {
-            fprintf(fp, "%d", frame);
-            for (const auto& i : d) fprintf(fp, ",%d,%d", i.frame, i.call);
-            fprintf(fp, "\n");
-            frame++;
-        }
-        fclose(fp);
+        r["usage"]["textures_used_uninitialized"] = csv;
     }
-    // Dump out callstats CSV
-    write_callstats(input, dump_csv_filename.empty() ? "trace" : dump_csv_filename);
-
-    input.cleanup(); // last since this can crash sometimes
+    return r;
 }
 
 static double ratio_with_cap(long limit, long value)
@@ -2492,6 +2666,16 @@ int main(int argc, char **argv)
             argIndex++;
             ipriority = atoi(argv[argIndex]);
         }
+        else if (arg == "-cache" && argIndex + 1 < argc)
+        {
+            cache_dir = argv[argIndex + 1];
+            argIndex++;
+        }
+        else if (arg == "-shaderthreads" && argIndex + 1 < argc)
+        {
+            shader_threads = atoi(argv[argIndex + 1]);
+            argIndex++;
+        }
         else if (arg == "-o" && argIndex + 1 < argc)
         {
             dump_csv_filename = argv[argIndex + 1];
@@ -2511,6 +2695,36 @@ int main(int argc, char **argv)
         return 1;
     }
     std::string source_trace_filename = argv[argIndex++];
+    if (!cache_dir.empty())
+    {
+        if (!renderpassframes.empty() || dump_to_text || display_mode || write_used_shaders || renderpassjson)
+        {
+            DBG_LOG("Not using the cache, since -r, -d, -S, -Z and -j need the trace to be replayed\n");
+        }
+        else
+        {
+            cache_file = cache_filename(source_trace_filename, multithread);
+        }
+    }
+    Json::Value cached;
+    if (!cache_file.empty() && load_cache(cache_file, cached))
+    {
+        DBG_LOG("Using cached results from %s\n", cache_file.c_str());
+        if (complexity_only_mode)
+        {
+            printf("%.04f\n", cached["trace"]["complexity"].asDouble());
+            return 0;
+        }
+        Json::Value& trace = cached["trace"];
+        trace["source"] = source_trace_filename;
+        trace.removeMember("priority");
+        trace.removeMember("name");
+        if (ipriority != -1) trace["priority"] = ipriority;
+        if (!iname.empty()) trace["name"] = iname;
+        write_reports(cached);
+        return 0;
+    }
+
     ParseInterfaceRetracing inputFile;
     inputFile.setDisplayMode(display_mode);
     inputFile.setQuickMode(true);
@@ -2522,6 +2736,7 @@ int main(int argc, char **argv)
     inputFile.ff_startframe = startframe;
     inputFile.ff_endframe = lastframe;
     if (multithread) inputFile.forceMultithread();
+    inputFile.setShaderCache(cache_dir, shader_threads);
     if (!inputFile.open(source_trace_filename))
     {
         std::cerr << "Failed to open for reading: " << source_trace_filename << std::endl;
@@ -0,0 +1,359 @@
+// Rewrite client-side vertex and index arrays as buffer objects.
+//
+// The tracer records client-side arrays as client-side buffers (CSBs), which
+// the retracer keeps in memory and passes to the driver as client pointers on
+// every draw. CSBs whose contents are set once and which are only referenced
+// by vertex attribute pointers and indexed draws are instead uploaded once per
+// share group into a real buffer object, and the references are replaced by
+// buffer offsets.
+
+#include <EGL/egl.h>
+#include <GLES2/gl2.h>
+#include <GLES3/gl31.h>
+#include <GLES3/gl32.h>
+#include <map>
+#include <set>
+#include <tuple>
+#include <vector>
+
+#include "tool/parse_interface.h"
+
+#include "common/in_file.hpp"
+#include "common/file_format.hpp"
+#include "common/api_info.hpp"
+#include "common/parse_api.hpp"
+#include "common/trace_model.hpp"
+#include "common/os.hpp"
+#include "tool/config.hpp"
+#include "tool/utils.hpp"
+
+static bool debug = false;
+#define DEBUG_LOG(...) if (debug) DBG_LOG(__VA_ARGS__)
+
+typedef std::pair<unsigned, unsigned> CsbKey; // thread, client-side buffer name
+
+struct CsbUsage
+{
+    int dataCalls = 0;
+    int references = 0;
+    bool unsupported = false; // sub-data updates, copies into buffers, or references we cannot rewrite
+};
+
+static void printHelp()
+{
+    std::cout <<
+        "Usage : clientside_to_bo [OPTIONS] trace_file.pat new_file.pat\n"
+        "Upload client-side vertex and index arrays that never change into buffer objects,\n"
+        "so that they are not copied again on every draw during replay.\n"
+        "Options:\n"
+        "  -h            Print help\n"
+        "  -v            Print version\n"
+        "  -d            Print debug info\n"
+        ;
+}
+
+static void printVersion()
+{
+    std::cout << PATRACE_VERSION << std::endl;
+}
+
+static void writeout(common::OutFile &outputFile, common::CallTM *call, bool injected = false)
+{
+    const unsigned int WRITE_BUF_LEN = 150*1024*1024;
+    static char buffer[WRITE_BUF_LEN];
+    char *dest = buffer;
+    dest = call->Serialize(dest, -1, injected);
+    outputFile.Write(buffer, dest-buffer);
+}
+
+/// Buffer binding that a client-side pointer in this call is read through,
+/// or GL_NONE if references from this call cannot be rewritten
+static GLenum referenceTarget(const std::string& name)
+{
+    static const std::set<std::string> attribPointers = {
+        "glVertexAttribPointer", "glVertexAttribIPointer", "glVertexPointer", "glColorPointer",
+        "glNormalPointer", "glTexCoordPointer", "glPointSizePointerOES", "glMatrixIndexPointerOES",
+        "glWeightPointerOES",
+    };
+    if (attribPointers.count(name))
+    {
+        return GL_ARRAY_BUFFER;
+    }
+    if ((name.compare(0, 14, "glDrawElements") == 0 && name.find("Indirect") == std::string::npos)
+        || name.compare(0, 19, "glDrawRangeElements") == 0)
+    {
+        return GL_ELEMENT_ARRAY_BUFFER;
+    }
+    return GL_NONE;
+}
+
+static int clientSideArgument(const common::CallTM *call)
+{
+    for (unsigned i = 0; i < call->mArgs.size(); i++)
+    {
+        if (call->mArgs[i]->IsClientSideBufferReference())
+        {
+            return i;
+        }
+    }
+    return -1;
+}
+
+static void bindBuffer(common::OutFile &outputFile, int tid, GLenum target, GLuint buffer)
+{
+    common::CallTM bind("glBindBuffer");
+    bind.mArgs.push_back(new common::ValueTM(target));
+    bind.mArgs.push_back(new common::ValueTM(buffer));
+    bind.mTid = tid;
+    writeout(outputFile, &bind, true);
+}
+
+static void deleteBuffers(common::OutFile &outputFile, int tid, const std::vector<unsigned>& buffers)
+{
+    common::CallTM deletion("glDeleteBuffers");
+    deletion.mArgs.push_back(new common::ValueTM((int)buffers.size()));
+    deletion.mArgs.push_back(common::CreateUInt32ArrayValue(buffers));
+    deletion.mTid = tid;
+    writeout(outputFile, &deletion, true);
+}
+
+int main(int argc, char **argv)
+{
+    int argIndex = 1;
+    for (; argIndex < argc; ++argIndex)
+    {
+        std::string arg = argv[argIndex];
+
+        if (arg[0] != '-')
+        {
+            break;
+        }
+        else if (arg == "-h")
+        {
+            printHelp();
+            return 1;
+        }
+        else if (arg == "-d")
+        {
+            debug = true;
+        }
+        else if (arg == "-v")
+        {
+            printVersion();
+            return 0;
+        }
+        else
+        {
+            std::cerr << "Error: Unknown option " << arg << std::endl;
+            printHelp();
+            return 1;
+        }
+    }
+
+    if (argIndex + 2 > argc)
+    {
+        printHelp();
+        return 1;
+    }
+    std::string source_trace_filename = argv[argIndex++];
+    ParseInterface *inputFile = new ParseInterface();
+    inputFile->setQuickMode(true);
+    inputFile->setScreenshots(false);
+    if (!inputFile->open(source_trace_filename))
+    {
+        std::cerr << "Failed to open for reading: " << source_trace_filename << std::endl;
+        return 1;
+    }
+
+    common::OutFile outputFile;
+    std::string target_trace_filename = argv[argIndex++];
+    if (!outputFile.Open(target_trace_filename.c_str()))
+    {
+        std::cerr << "Failed to open for writing: " << target_trace_filename << std::endl;
+        return 1;
+    }
+
+    // First pass: find the client-side buffers that can be converted, and
+    // the highest buffer name the trace uses, so that ours do not collide
+    std::map<CsbKey, CsbUsage> usage;
+    common::CallTM *call = nullptr;
+    while ((call = inputFile->next_call()))
+    {
+        if (call->mCallName == "glClientSideBufferData")
+        {
+            usage[CsbKey(call->mTid, call->mArgs[0]->GetAsUInt())].dataCalls++;
+        }
+        else if (call->mCallName == "glClientSideBufferSubData" || call->mCallName == "glCopyClientSideBuffer")
+        {
+            const int idx = (call->mCallName == "glCopyClientSideBuffer") ? 1 : 0;
+            usage[CsbKey(call->mTid, call->mArgs[idx]->GetAsUInt())].unsupported = true;
+        }
+        else
+        {
+            const int idx = clientSideArgument(call);
+            if (idx != -1)
+            {
+                CsbUsage& u = usage[CsbKey(call->mTid, call->mArgs[idx]->mOpaqueIns->mClientSideBufferName)];
+                u.references++;
+                if (referenceTarget(call->mCallName) == GL_NONE || inputFile->context_index == UNBOUND || u.dataCalls == 0)
+                {
+                    u.unsupported = true;
+                }
+            }
+        }
+    }
+    GLuint next_buffer = 0;
+    for (const auto& ctx : inputFile->contexts)
+    {
+        for (const auto& buffer : ctx.buffers.all())
+        {
+            next_buffer = std::max(next_buffer, buffer.id);
+        }
+    }
+    next_buffer++;
+    std::set<CsbKey> convertible;
+    for (const auto& pair : usage)
+    {
+        if (pair.second.dataCalls == 1 && pair.second.references > 0 && !pair.second.unsupported)
+        {
+            convertible.insert(pair.first);
+        }
+    }
+    DBG_LOG("%d of %d client-side buffers can be converted, new buffer names start at %u\n", (int)convertible.size(), (int)usage.size(), next_buffer);
+    inputFile->close();
+    delete inputFile;
+
+    inputFile = new ParseInterface();
+    inputFile->setQuickMode(true);
+    inputFile->setScreenshots(false);
+    if (!inputFile->open(source_trace_filename))
+    {
+        std::cerr << "Failed to open for reading again: " << source_trace_filename << std::endl;
+        return 1;
+    }
+
+    // Second pass: drop the client-side buffer calls for converted buffers and
+    // upload their contents on first use in each share group. The buffers of a
+    // share group are identified by the address of their shared storage.
+    typedef std::tuple<const void*, unsigned, unsigned> UploadKey; // share group, thread, client-side buffer name
+    std::map<CsbKey, std::string> contents;
+    std::map<UploadKey, GLuint> uploaded;
+    std::map<const void*, std::vector<unsigned>> pending_deletes; // for share groups that are not current
+    int removed = 0;
+    int references = 0;
+    int buffers_created = 0;
+    uint64_t bytes_uploaded = 0;
+    while ((call = inputFile->next_call()))
+    {
+        const void *group = (inputFile->context_index != UNBOUND) ? &inputFile->contexts[inputFile->context_index].buffers.all() : nullptr;
+
+        if (call->mCallName == "glCreateClientSideBuffer" && convertible.count(CsbKey(call->mTid, call->mRet.GetAsUInt())))
+        {
+            removed++;
+            continue;
+        }
+        else if (call->mCallName == "glClientSideBufferData" && convertible.count(CsbKey(call->mTid, call->mArgs[0]->GetAsUInt())))
+        {
+            contents[CsbKey(call->mTid, call->mArgs[0]->GetAsUInt())] = call->mArgs[2]->GetAsBlob();
+            removed++;
+            continue;
+        }
+        else if (call->mCallName == "glDeleteClientSideBuffer" && convertible.count(CsbKey(call->mTid, call->mArgs[0]->GetAsUInt())))
+        {
+            const unsigned name = call->mArgs[0]->GetAsUInt();
+            contents.erase(CsbKey(call->mTid, name));
+            std::vector<unsigned> now;
+            for (auto it = uploaded.begin(); it != uploaded.end();)
+            {
+                if (std::get<1>(it->first) == call->mTid && std::get<2>(it->first) == name)
+                {
+                    if (std::get<0>(it->first) == group) now.push_back(it->second);
+                    else pending_deletes[std::get<0>(it->first)].push_back(it->second);
+                    it = uploaded.erase(it);
+                }
+                else ++it;
+            }
+            if (!now.empty())
+            {
+                deleteBuffers(outputFile, call->mTid, now);
+            }
+            removed++;
+            continue;
+        }
+
+        const int idx = clientSideArgument(call);
+        if (idx != -1)
+        {
+            const unsigned name = call->mArgs[idx]->mOpaqueIns->mClientSideBufferName;
+            const unsigned offset = call->mArgs[idx]->mOpaqueIns->mClientSideBufferOffset;
+            const CsbKey key(call->mTid, name);
+            if (convertible.count(key))
+            {
+                const GLenum target = referenceTarget(call->mCallName);
+                const UploadKey upload(group, call->mTid, name);
+                auto it = uploaded.find(upload);
+                if (it == uploaded.end())
+                {
+                    const GLuint buffer = next_buffer++;
+                    const std::string& data = contents[key];
+                    common::CallTM gen("glGenBuffers");
+                    gen.mArgs.push_back(new common::ValueTM(1));
+                    gen.mArgs.push_back(common::CreateUInt32ArrayValue({ buffer }));
+                    gen.mTid = call->mTid;
+                    writeout(outputFile, &gen, true);
+                    bindBuffer(outputFile, call->mTid, target, buffer);
+                    common::CallTM bufferData("glBufferData");
+                    bufferData.mArgs.push_back(new common::ValueTM(target));
+                    bufferData.mArgs.push_back(new common::ValueTM((int)data.size()));
+                    bufferData.mArgs.push_back(common::CreateBlobValue(data.size(), data.data()));
+                    bufferData.mArgs.push_back(new common::ValueTM(GL_STATIC_DRAW));
+                    bufferData.mTid = call->mTid;
+                    writeout(outputFile, &bufferData, true);
+                    it = uploaded.emplace(upload, buffer).first;
+                    buffers_created++;
+                    bytes_uploaded += data.size();
+                    DEBUG_LOG("call %u: uploading client-side buffer %u of thread %d (%u bytes) to buffer %u\n", call->mCallNo, name, call->mTid, (unsigned)data.size(), buffer);
+                }
+                else
+                {
+                    bindBuffer(outputFile, call->mTid, target, it->second);
+                }
+                // Client-side pointers are only used when nothing is bound to
+                // the target, so it is unbound again afterwards
+                delete call->mArgs[idx];
+                call->mArgs[idx] = common::CreateBufferReferenceOpaqueValue(offset);
+                writeout(outputFile, call);
+                bindBuffer(outputFile, call->mTid, target, 0);
+                references++;
+                continue;
+            }
+        }
+
+        writeout(outputFile, call);
+
+        if (call->mCallName == "eglMakeCurrent" && group && pending_deletes.count(group))
+        {
+            deleteBuffers(outputFile, call->mTid, pending_deletes.at(group));
+            pending_deletes.erase(group);
+        }
+    }
+
+    Json::Value header = inputFile->header;
+    Json::Value info;
+    info["client_side_buffers_converted"] = (int)convertible.size();
+    info["references_rewritten"] = references;
+    info["buffers_created"] = buffers_created;
+    info["bytes_uploaded"] = (Json::UInt64)bytes_uploaded;
+    info["calls_removed"] = removed;
+    addConversionEntry(header, "clientside_to_bo", source_trace_filename, info);
+    Json::FastWriter writer;
+    const std::string json_header = writer.write(header);
+    outputFile.mHeader.jsonLength = json_header.size();
+    outputFile.WriteHeader(json_header.c_str(), json_header.size());
+
+    inputFile->close();
+    outputFile.Close();
+    printf("Converted %d client-side buffers into %d buffer objects, rewrote %d references and removed %d calls\n",
+           (int)convertible.size(), buffers_created, references, removed);
+    return 0;
+}
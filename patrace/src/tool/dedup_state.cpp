@@ -0,0 +1,416 @@
+#include "tool/dedup_state.hpp"
+
+#include <GLES3/gl32.h>
+
+const std::unordered_map<std::string, StateSetter>& stateSetters()
+{
+    static std::unordered_map<std::string, StateSetter> setters;
+    if (!setters.empty())
+    {
+        return setters;
+    }
+    const auto add = [](const std::vector<std::string>& names, const StateSetter& s) { for (const auto& name : names) setters.emplace(name, s); };
+    const auto suffixed = [](const std::string& name) { return std::vector<std::string>{ name, name + "EXT", name + "OES" }; };
+
+    add({ "glEnable", "glDisable" }, { "enable", DEDUP_ENABLE, SCOPE_CONTEXT, 1, { "enablei" } });
+    for (const auto& name : { "glEnablei", "glDisablei" }) add(suffixed(name), { "enablei", DEDUP_ENABLE, SCOPE_CONTEXT, 2, { "enable" } });
+
+    add({ "glBlendFunc", "glBlendFuncSeparate" }, { "blendfunc", DEDUP_BLENDFUNC, SCOPE_CONTEXT, 0, { "blendfunci" } });
+    for (const auto& name : { "glBlendFunci", "glBlendFuncSeparatei" }) add(suffixed(name), { "blendfunci", DEDUP_BLENDFUNC, SCOPE_CONTEXT, 1, { "blendfunc" } });
+    add({ "glBlendEquation", "glBlendEquationSeparate" }, { "blendequation", DEDUP_BLENDFUNC, SCOPE_CONTEXT, 0, { "blendequationi" } });
+    for (const auto& name : { "glBlendEquationi", "glBlendEquationSeparatei" }) add(suffixed(name), { "blendequationi", DEDUP_BLENDFUNC, SCOPE_CONTEXT, 1, { "blendequation" } });
+    add({ "glBlendColor" }, { "blendcolor", DEDUP_BLENDFUNC, SCOPE_CONTEXT, 0, {} });
+    add({ "glDepthFunc" }, { "depthfunc", DEDUP_DEPTHFUNC, SCOPE_CONTEXT, 0, {} });
+    add({ "glScissor" }, { "scissor", DEDUP_SCISSORS, SCOPE_CONTEXT, 0, {} });
+
+    add({ "glColorMask" }, { "colormask", DEDUP_STATE, SCOPE_CONTEXT, 0, { "colormaski" } });
+    add(suffixed("glColorMaski"), { "colormaski", DEDUP_STATE, SCOPE_CONTEXT, 1, { "colormask" } });
+    // The separate stencil calls keep the face in the value, since GL_FRONT_AND_BACK overlaps the other faces
+    add({ "glStencilFunc" }, { "stencilfunc", DEDUP_STATE, SCOPE_CONTEXT, 0, { "stencilfuncseparate" } });
+    add({ "glStencilFuncSeparate" }, { "stencilfuncseparate", DEDUP_STATE, SCOPE_CONTEXT, 0, { "stencilfunc" } });
+    add({ "glStencilOp" }, { "stencilop", DEDUP_STATE, SCOPE_CONTEXT, 0, { "stencilopseparate" } });
+    add({ "glStencilOpSeparate" }, { "stencilopseparate", DEDUP_STATE, SCOPE_CONTEXT, 0, { "stencilop" } });
+    add({ "glStencilMask" }, { "stencilmask", DEDUP_STATE, SCOPE_CONTEXT, 0, { "stencilmaskseparate" } });
+    add({ "glStencilMaskSeparate" }, { "stencilmaskseparate", DEDUP_STATE, SCOPE_CONTEXT, 0, { "stencilmask" } });
+    add({ "glDepthMask" }, { "depthmask", DEDUP_STATE, SCOPE_CONTEXT, 0, {} });
+    add({ "glDepthRangef" }, { "depthrange", DEDUP_STATE, SCOPE_CONTEXT, 0, {} });
+    add({ "glViewport" }, { "viewport", DEDUP_STATE, SCOPE_CONTEXT, 0, {} });
+    add({ "glCullFace" }, { "cullface", DEDUP_STATE, SCOPE_CONTEXT, 0, {} });
+    add({ "glFrontFace" }, { "frontface", DEDUP_STATE, SCOPE_CONTEXT, 0, {} });
+    add({ "glLineWidth" }, { "linewidth", DEDUP_STATE, SCOPE_CONTEXT, 0, {} });
+    add({ "glPolygonOffset" }, { "polygonoffset", DEDUP_STATE, SCOPE_CONTEXT, 0, {} });
+    add({ "glSampleCoverage" }, { "samplecoverage", DEDUP_STATE, SCOPE_CONTEXT, 0, {} });
+    add({ "glSampleMaski" }, { "samplemask", DEDUP_STATE, SCOPE_CONTEXT, 1, {} });
+    add(suffixed("glMinSampleShading"), { "minsampleshading", DEDUP_STATE, SCOPE_CONTEXT, 0, {} });
+    add(suffixed("glPatchParameteri"), { "patchparameter", DEDUP_STATE, SCOPE_CONTEXT, 1, {} });
+    add(suffixed("glPrimitiveBoundingBox"), { "boundingbox", DEDUP_STATE, SCOPE_CONTEXT, 0, {} });
+    add({ "glClearColor" }, { "clearcolor", DEDUP_STATE, SCOPE_CONTEXT, 0, {} });
+    add({ "glClearDepthf" }, { "cleardepth", DEDUP_STATE, SCOPE_CONTEXT, 0, {} });
+    add({ "glClearStencil" }, { "clearstencil", DEDUP_STATE, SCOPE_CONTEXT, 0, {} });
+    add({ "glHint" }, { "hint", DEDUP_STATE, SCOPE_CONTEXT, 1, {} });
+    add({ "glPixelStorei" }, { "pixelstore", DEDUP_STATE, SCOPE_CONTEXT, 1, {} });
+
+    add({ "glActiveTexture" }, { "activetexture", DEDUP_TEXTURES, SCOPE_CONTEXT, 0, {} });
+    add({ "glBindTexture" }, { "bindtexture", DEDUP_TEXTURES, SCOPE_TEXTURE_UNIT, 1, {} });
+    add({ "glBindSampler" }, { "bindsampler", DEDUP_TEXTURES, SCOPE_CONTEXT, 1, {} });
+    add({ "glBindImageTexture" }, { "bindimagetexture", DEDUP_TEXTURES, SCOPE_CONTEXT, 1, {} });
+    for (const auto& name : { "glTexParameteri", "glTexParameterf", "glTexParameteriv", "glTexParameterfv", "glTexParameterIiv", "glTexParameterIuiv" })
+    {
+        add(suffixed(name), { "texparameter", DEDUP_TEXPARAMS, SCOPE_TEXTURE, 1, {} });
+    }
+    for (const auto& name : { "glSamplerParameteri", "glSamplerParameterf", "glSamplerParameteriv", "glSamplerParameterfv", "glSamplerParameterIiv", "glSamplerParameterIuiv" })
+    {
+        add(suffixed(name), { "samplerparameter", DEDUP_TEXPARAMS, SCOPE_OBJECT, 1, {} });
+    }
+
+    add({ "glBindBuffer" }, { "bindbuffer", DEDUP_BUFFERS, SCOPE_BUFFER_TARGET, 1, {} });
+    add({ "glBindBufferBase", "glBindBufferRange" }, { "bindbufferbase", DEDUP_BUFFERS, SCOPE_CONTEXT, 2, { "bindbuffer" } });
+
+    add({ "glBindFramebuffer" }, { "bindframebuffer", DEDUP_BINDINGS, SCOPE_CONTEXT, 1, {} });
+    add({ "glBindRenderbuffer" }, { "bindrenderbuffer", DEDUP_BINDINGS, SCOPE_CONTEXT, 1, {} });
+    add({ "glBindVertexArray", "glBindVertexArrayOES" }, { "bindvertexarray", DEDUP_BINDINGS, SCOPE_CONTEXT, 0, {} });
+
+    add({ "glUseProgram" }, { "useprogram", DEDUP_PROGRAMS, SCOPE_CONTEXT, 0, {} });
+    add(suffixed("glBindProgramPipeline"), { "bindprogrampipeline", DEDUP_PROGRAMS, SCOPE_CONTEXT, 0, {} });
+    add({ "glUniformBlockBinding" }, { "uniformblockbinding", DEDUP_UNIFORMS, SCOPE_OBJECT, 1, {} });
+
+    add({ "glVertexAttribPointer", "glVertexAttribIPointer" }, { "vertexattribpointer", DEDUP_VERTEXATTRIB, SCOPE_VAO, 1, { "vertexattribformat", "vertexattribbinding", "bindvertexbuffer" } });
+    add({ "glEnableVertexAttribArray", "glDisableVertexAttribArray" }, { "vertexattribarray", DEDUP_VERTEXATTRIB, SCOPE_VAO, 1, {} });
+    add({ "glVertexAttribDivisor", "glVertexAttribDivisorEXT", "glVertexAttribDivisorNV", "glVertexAttribDivisorANGLE" }, { "vertexattribdivisor", DEDUP_VERTEXATTRIB, SCOPE_VAO, 1, { "vertexbindingdivisor", "vertexattribbinding" } });
+    add({ "glVertexAttribFormat", "glVertexAttribIFormat" }, { "vertexattribformat", DEDUP_VERTEXATTRIB, SCOPE_VAO, 1, { "vertexattribpointer" } });
+    add({ "glVertexAttribBinding" }, { "vertexattribbinding", DEDUP_VERTEXATTRIB, SCOPE_VAO, 1, { "vertexattribpointer" } });
+    add({ "glBindVertexBuffer" }, { "bindvertexbuffer", DEDUP_VERTEXATTRIB, SCOPE_VAO, 1, { "vertexattribpointer" } });
+    add({ "glVertexBindingDivisor" }, { "vertexbindingdivisor", DEDUP_VERTEXATTRIB, SCOPE_VAO, 1, { "vertexattribdivisor" } });
+    for (const auto& name : { "glVertexAttrib1f", "glVertexAttrib2f", "glVertexAttrib3f", "glVertexAttrib4f",
+                              "glVertexAttrib1fv", "glVertexAttrib2fv", "glVertexAttrib3fv", "glVertexAttrib4fv",
+                              "glVertexAttribI4i", "glVertexAttribI4ui", "glVertexAttribI4iv", "glVertexAttribI4uiv" })
+    {
+        add({ name }, { "vertexattribvalue", DEDUP_VERTEXATTRIB, SCOPE_CONTEXT, 1, {} });
+    }
+    return setters;
+}
+
+/// Append a comparable encoding of an argument value. Returns false for
+/// values that cannot be compared, such as pointers into client-side memory
+/// whose contents may have changed since the previous call.
+static bool appendValue(std::string& out, const common::ValueTM& v)
+{
+    switch (v.mType)
+    {
+    case common::Float_Type:
+        out.append((const char*)&v.mFloat, sizeof(v.mFloat));
+        return true;
+    case common::String_Type:
+        out.append(v.mStr);
+        out.push_back('\0');
+        return true;
+    case common::Array_Type:
+        out.append(std::to_string(v.mArrayLen));
+        out.push_back(':');
+        for (unsigned i = 0; i < v.mArrayLen; i++)
+        {
+            if (!appendValue(out, v.mArray[i])) return false;
+        }
+        return true;
+    case common::Blob_Type:
+        out.append(std::to_string(v.mBlobLen));
+        out.push_back(':');
+        if (v.mBlobLen > 0) out.append(v.mBlob, v.mBlobLen);
+        return true;
+    case common::Opaque_Type:
+        if (v.mOpaqueType != common::BufferObjectReferenceType) return false;
+        out.push_back('B');
+        break;
+    case common::Void_Type:
+    case common::Pointer_Type:
+    case common::MemRef_Type:
+    case common::Unused_Pointer_Type:
+        return false;
+    default:
+        break;
+    }
+    const uint64_t u = v.GetAsUInt64();
+    out.append((const char*)&u, sizeof(u));
+    return true;
+}
+
+static std::string keyOf(const std::vector<uint64_t>& parts)
+{
+    std::string key;
+    for (const auto p : parts)
+    {
+        key += std::to_string(p);
+        key.push_back(':');
+    }
+    return key;
+}
+
+bool StateShadow::redundant(const common::CallTM* call, std::string& group)
+{
+    if (context_index == UNBOUND)
+    {
+        return false;
+    }
+    StateTracker::Context& ctx = tracked_contexts[context_index];
+    const void* share = &ctx.textures.all();
+    ContextState& cs = contexts[context_index];
+    ShareGroupState& gs = groups[share];
+    const std::string& name = call->mCallName;
+
+    if (name.compare(0, 8, "glDelete") == 0)
+    {
+        deleted(call, share, gs);
+        if (name == "glDeleteBuffers")
+        {
+            for (unsigned i = 0; i < call->mArgs[1]->mArrayLen; i++)
+            {
+                if (call->mArgs[1]->mArray[i].GetAsUInt() == cs.array_buffer) cs.array_buffer = 0;
+            }
+        }
+        return false;
+    }
+    else if (name == "glGenTextures" || name == "glGenSamplers")
+    {
+        // Our idea of the bound texture may be stale if a bound texture was deleted, so make sure
+        // that nothing stored for a reused name survives
+        for (unsigned i = 0; i < call->mArgs[1]->mArrayLen; i++)
+        {
+            eraseObject(gs, (name == "glGenTextures") ? 'T' : 'S', call->mArgs[1]->mArray[i].GetAsUInt());
+        }
+        return false;
+    }
+    else if (name == "glLinkProgram" || name == "glProgramBinary" || name == "glProgramBinaryOES")
+    {
+        // Uniform values and block bindings are reset by linking
+        const GLuint program = call->mArgs[0]->GetAsUInt();
+        gs.uniforms.erase(program);
+        eraseObject(gs, 'P', program);
+        return false;
+    }
+    else if (name == "eglMakeCurrent")
+    {
+        // The retracer may set its own viewport and scissor when a context is made current
+        cs.slots.erase("viewport");
+        cs.slots.erase("scissor");
+        return false;
+    }
+    else if ((name.compare(0, 9, "glUniform") == 0 && name != "glUniformBlockBinding") || name.compare(0, 16, "glProgramUniform") == 0)
+    {
+        group = "uniform";
+        return uniform(call, ctx, gs);
+    }
+
+    const auto it = stateSetters().find(name);
+    if (it == stateSetters().end())
+    {
+        return false;
+    }
+    const StateSetter& setter = it->second;
+    group = setter.group;
+
+    int arg = 0;
+    std::vector<uint64_t> parts;
+    bool shared = (setter.scope == SCOPE_TEXTURE || setter.scope == SCOPE_OBJECT);
+    switch (setter.scope)
+    {
+    case SCOPE_CONTEXT:
+        break;
+    case SCOPE_VAO:
+        parts.push_back(ctx.vaos.all().at(ctx.vao_index).id);
+        break;
+    case SCOPE_TEXTURE_UNIT:
+        parts.push_back(ctx.activeTextureUnit);
+        break;
+    case SCOPE_BUFFER_TARGET:
+        if (call->mArgs[0]->GetAsUInt() == GL_ELEMENT_ARRAY_BUFFER) parts.push_back(ctx.vaos.all().at(ctx.vao_index).id);
+        break;
+    case SCOPE_TEXTURE:
+    {
+        const GLenum target = call->mArgs[arg++]->GetAsUInt();
+        const GLuint texture = ctx.textureUnits[ctx.activeTextureUnit][target];
+        parts.push_back(texture);
+        if (texture == 0)
+        {
+            // Every context has its own default texture for each target
+            parts.push_back(target);
+            shared = false;
+        }
+        break;
+    }
+    case SCOPE_OBJECT:
+        parts.push_back(call->mArgs[arg++]->GetAsUInt());
+        break;
+    }
+    for (int i = 0; i < setter.keyArgs; i++)
+    {
+        parts.push_back(call->mArgs[arg++]->GetAsUInt64());
+    }
+    std::string value = name;
+    value.push_back('\0');
+    bool comparable = true;
+    for (unsigned i = arg; i < call->mArgs.size() && comparable; i++)
+    {
+        comparable = appendValue(value, *call->mArgs[i]);
+    }
+    if (name == "glBindBuffer" && call->mArgs[0]->GetAsUInt() == GL_ARRAY_BUFFER)
+    {
+        cs.array_buffer = call->mArgs[1]->GetAsUInt();
+    }
+    else if (name == "glVertexAttribPointer" || name == "glVertexAttribIPointer")
+    {
+        // the pointer is an offset into whichever buffer is bound when it is set
+        value += std::to_string(cs.array_buffer);
+    }
+
+    for (const auto& other : setter.invalidates)
+    {
+        cs.slots.erase(other);
+    }
+
+    if (shared)
+    {
+        const char prefix = (setter.scope == SCOPE_TEXTURE) ? 'T' : (name == "glUniformBlockBinding") ? 'P' : 'S';
+        const std::string key = std::string(1, prefix) + ":" + keyOf(parts);
+        if (!comparable)
+        {
+            gs.objects.erase(key);
+            return false;
+        }
+        auto& slot = gs.objects[key];
+        if (slot == value) return true;
+        slot = value;
+        return false;
+    }
+
+    std::map<std::string, std::string>& slots = cs.slots[setter.group];
+    if (name == "glBindFramebuffer" && call->mArgs[0]->GetAsUInt() == GL_FRAMEBUFFER)
+    {
+        // binds both the draw and the read framebuffer
+        value = std::to_string(call->mArgs[1]->GetAsUInt());
+        const std::string draw = keyOf({ GL_DRAW_FRAMEBUFFER });
+        const std::string read = keyOf({ GL_READ_FRAMEBUFFER });
+        const bool same = slots.count(draw) && slots.count(read) && slots.at(draw) == value && slots.at(read) == value;
+        slots[draw] = value;
+        slots[read] = value;
+        return same;
+    }
+    else if (name == "glBindFramebuffer")
+    {
+        value = std::to_string(call->mArgs[1]->GetAsUInt());
+    }
+    const std::string key = keyOf(parts);
+    if (!comparable)
+    {
+        slots.erase(key);
+        return false;
+    }
+    auto& slot = slots[key];
+    if (slot == value) return true;
+    slot = value;
+    return false;
+}
+
+bool StateShadow::uniform(const common::CallTM* call, StateTracker::Context& ctx, ShareGroupState& gs)
+{
+    const std::string& name = call->mCallName;
+    const bool direct = name.compare(0, 16, "glProgramUniform") == 0;
+    int arg = 0;
+    GLuint program = 0;
+    if (direct)
+    {
+        program = call->mArgs[arg++]->GetAsUInt();
+    }
+    else if (ctx.program_index != UNBOUND)
+    {
+        program = ctx.programs.all().at(ctx.program_index).id;
+    }
+    if (program == 0)
+    {
+        return false; // uniforms of the active program of a pipeline are not tracked
+    }
+    const GLint location = call->mArgs[arg++]->GetAsInt();
+    const bool vector = name.back() == 'v';
+    const int count = vector ? call->mArgs[arg]->GetAsInt() : 1;
+    std::string value = direct ? "glUniform" + name.substr(16) : name;
+    value.push_back('\0');
+    bool comparable = true;
+    for (unsigned i = arg; i < call->mArgs.size() && comparable; i++)
+    {
+        comparable = appendValue(value, *call->mArgs[i]);
+    }
+
+    // Array uniforms set several locations, so drop any stored values that overlap
+    auto& locations = gs.uniforms[program];
+    const auto existing = locations.find(location);
+    if (comparable && existing != locations.end() && existing->second.first == count && existing->second.second == value)
+    {
+        return true;
+    }
+    for (auto it = locations.begin(); it != locations.end();)
+    {
+        if (it->first < location + count && it->first + it->second.first > location) it = locations.erase(it);
+        else ++it;
+    }
+    if (comparable && location >= 0)
+    {
+        locations[location] = std::make_pair(count, value);
+    }
+    return false;
+}
+
+void StateShadow::eraseObject(ShareGroupState& gs, char prefix, GLuint id)
+{
+    const std::string key = std::string(1, prefix) + ":" + std::to_string(id) + ":";
+    auto it = gs.objects.lower_bound(key);
+    while (it != gs.objects.end() && it->first.compare(0, key.size(), key) == 0)
+    {
+        it = gs.objects.erase(it);
+    }
+}
+
+void StateShadow::deleted(const common::CallTM* call, const void* share, ShareGroupState& gs)
+{
+    static const std::map<std::string, std::vector<std::string>> affected = {
+        { "glDeleteTextures", { "bindtexture", "bindimagetexture" } },
+        { "glDeleteSamplers", { "bindsampler" } },
+        { "glDeleteBuffers", { "bindbuffer", "bindbufferbase", "vertexattribpointer", "bindvertexbuffer" } },
+        { "glDeleteFramebuffers", { "bindframebuffer" } },
+        { "glDeleteFramebuffersOES", { "bindframebuffer" } },
+        { "glDeleteRenderbuffers", { "bindrenderbuffer" } },
+        { "glDeleteRenderbuffersOES", { "bindrenderbuffer" } },
+        { "glDeleteVertexArrays", { "bindvertexarray", "bindbuffer", "vertexattribpointer", "vertexattribarray", "vertexattribdivisor",
+                                    "vertexattribformat", "vertexattribbinding", "bindvertexbuffer", "vertexbindingdivisor" } },
+        { "glDeleteVertexArraysOES", { "bindvertexarray", "bindbuffer", "vertexattribpointer", "vertexattribarray", "vertexattribdivisor",
+                                       "vertexattribformat", "vertexattribbinding", "bindvertexbuffer", "vertexbindingdivisor" } },
+        { "glDeleteProgram", { "useprogram" } },
+        { "glDeleteProgramPipelines", { "bindprogrampipeline" } },
+        { "glDeleteProgramPipelinesEXT", { "bindprogrampipeline" } },
+    };
+    const auto it = affected.find(call->mCallName);
+    if (it == affected.end())
+    {
+        return;
+    }
+    // Names may be reused for new objects, and bindings to deleted objects
+    // differ between contexts, so forget the bindings everywhere in the group
+    for (auto& pair : contexts)
+    {
+        if (&tracked_contexts[pair.first].textures.all() != share) continue;
+        for (const auto& group : it->second) pair.second.slots.erase(group);
+    }
+    std::vector<GLuint> ids;
+    if (call->mCallName == "glDeleteProgram")
+    {
+        ids.push_back(call->mArgs[0]->GetAsUInt());
+    }
+    else if (call->mArgs.size() > 1 && call->mArgs[1]->IsArray())
+    {
+        for (unsigned i = 0; i < call->mArgs[1]->mArrayLen; i++) ids.push_back(call->mArgs[1]->mArray[i].GetAsUInt());
+    }
+    for (const GLuint id : ids)
+    {
+        if (call->mCallName == "glDeleteTextures") eraseObject(gs, 'T', id);
+        else if (call->mCallName == "glDeleteSamplers") eraseObject(gs, 'S', id);
+        else if (call->mCallName == "glDeleteProgram") { eraseObject(gs, 'P', id); gs.uniforms.erase(id); }
+    }
+}
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <deque>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "tool/parse_interface.h"
+
+#define DEDUP_BUFFERS 1
+#define DEDUP_UNIFORMS 2
+#define DEDUP_TEXTURES 4
+#define DEDUP_SCISSORS 8
+#define DEDUP_BLENDFUNC 16
+#define DEDUP_ENABLE 32
+#define DEDUP_DEPTHFUNC 64
+#define DEDUP_VERTEXATTRIB 128
+#define DEDUP_MAKECURRENT 256
+#define DEDUP_PROGRAMS 512
+#define DEDUP_CSB 1024
+#define DEDUP_STATE 2048
+#define DEDUP_TEXPARAMS 4096
+#define DEDUP_BINDINGS 8192
+
+/// Where the state set by a call lives, which decides what its shadow value is keyed by
+enum SetterScope
+{
+    SCOPE_CONTEXT, // context state
+    SCOPE_VAO, // state of the bound vertex array object
+    SCOPE_TEXTURE_UNIT, // state of the active texture unit
+    SCOPE_BUFFER_TARGET, // buffer bindings, where the element array binding belongs to the VAO
+    SCOPE_TEXTURE, // state of the texture object bound to the target in the first argument
+    SCOPE_OBJECT, // state of the shared object named by the first argument
+};
+
+struct StateSetter
+{
+    const char* group; // calls in the same group set the same state
+    int flag; // option that enables deduplication of this call
+    SetterScope scope;
+    int keyArgs; // arguments after any object argument that select which state is set
+    std::vector<std::string> invalidates; // groups that this call may also change
+};
+
+/// Deduplicated calls by name
+const std::unordered_map<std::string, StateSetter>& stateSetters();
+
+/// Shadow copy of the state that the deduplicated calls have set in one context
+struct ContextState
+{
+    std::map<std::string, std::map<std::string, std::string>> slots; // group : key : value
+    GLuint array_buffer = 0; // needed since vertex attribute pointers capture it
+};
+
+/// Shadow copy of the object state that contexts in a share group see
+struct ShareGroupState
+{
+    std::map<GLuint, std::map<GLint, std::pair<int, std::string>>> uniforms; // program : location : (count, value)
+    std::map<std::string, std::string> objects; // object and state key : value
+};
+
+/// Shadow of the state set by the deduplicated calls, per context and per
+/// share group, on top of the contexts tracked while parsing the trace
+class StateShadow
+{
+public:
+    StateShadow(std::deque<StateTracker::Context>& tracked_contexts, const int& context_index)
+        : tracked_contexts(tracked_contexts), context_index(context_index) {}
+
+    /// Check whether the call only sets state to the value it already has in
+    /// the current context or share group. The shadow state is updated as a
+    /// side effect. Calls that destroy or relink objects invalidate the state
+    /// that refers to them, in every context of the share group.
+    bool redundant(const common::CallTM* call, std::string& group);
+
+private:
+    bool uniform(const common::CallTM* call, StateTracker::Context& ctx, ShareGroupState& gs);
+    static void eraseObject(ShareGroupState& gs, char prefix, GLuint id);
+    void deleted(const common::CallTM* call, const void* share, ShareGroupState& gs);
+
+    std::deque<StateTracker::Context>& tracked_contexts;
+    const int& context_index; // of the current call's thread, updated by the parser
+    std::map<int, ContextState> contexts; // by context index
+    std::map<const void*, ShareGroupState> groups; // by shared storage
+};
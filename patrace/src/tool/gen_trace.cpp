@@ -0,0 +1,671 @@
+// Generate synthetic traces of a chosen shape and size, for testing the
+// tools and the retracer at scale without real captures. All payloads
+// come from a seeded pseudo-random generator, so the same parameters
+// always produce the same call stream.
+
+#include <EGL/egl.h>
+#include <GLES3/gl32.h>
+
+#include "common/out_file.hpp"
+#include "common/api_info.hpp"
+#include "common/parse_api.hpp"
+#include "common/trace_model.hpp"
+#include "common/os.hpp"
+#include "tool/config.hpp"
+#include "tool/utils.hpp"
+
+#include "json/reader.h"
+#include "json/writer.h"
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+struct GenParams
+{
+    unsigned frames = 100;
+    uint64_t size = 0;          // stop at this many bytes of call data instead of a frame count
+    unsigned threads = 1;
+    unsigned contexts = 1;      // per thread, made current in turn each frame
+    unsigned draws = 200;       // per frame, per thread
+    unsigned textures = 16;     // per context
+    unsigned textureUploads = 1; // per frame, per thread
+    unsigned textureSize = 256;
+    unsigned bufferUploads = 4; // per frame, per thread
+    unsigned bufferSize = 64 * 1024;
+    unsigned csbDraws = 0;      // draws with client-side vertex arrays, per frame, per thread
+    unsigned csbSize = 4 * 1024;
+    unsigned width = 1920;
+    unsigned height = 1080;
+    uint64_t seed = 1;
+};
+
+static const char *vertexShader =
+    "#version 300 es\n"
+    "in vec4 pos;\n"
+    "void main() { gl_Position = pos; }\n";
+static const char *fragmentShader =
+    "#version 300 es\n"
+    "precision mediump float;\n"
+    "uniform sampler2D tex;\n"
+    "out vec4 color;\n"
+    "void main() { color = texture(tex, vec2(0.5)); }\n";
+
+// Object names used in every context; the retracer maps them per context
+enum
+{
+    VERTEX_SHADER = 1,
+    FRAGMENT_SHADER = 2,
+    PROGRAM = 3,
+    VERTEX_BUFFER = 1,
+};
+
+static const int DISPLAY = 1;
+static const int CONFIG = 1;
+
+static int surfaceName(unsigned thread) { return 0x1000 + thread; }
+static int contextName(unsigned thread, unsigned context, const GenParams &p) { return 0x2000 + thread * p.contexts + context; }
+
+static void printHelp()
+{
+    std::cout <<
+        "Usage : gen_trace [OPTIONS] <target trace>\n"
+        "Generate a synthetic trace. Parameters are read from a JSON file with -p,\n"
+        "using the option names below as keys, and can be overridden on the command line.\n"
+        "Sizes accept K, M and G suffixes.\n"
+        "Options:\n"
+        "  -p FILE            read parameters from a JSON file\n"
+        "  -frames N          number of frames (default: 100)\n"
+        "  -size N            generate frames until the call data reaches this size; overrides -frames\n"
+        "  -threads N         number of threads, each with its own surface (default: 1)\n"
+        "  -contexts N        contexts per thread, made current in turn every frame (default: 1)\n"
+        "  -draws N           draw calls per frame and thread (default: 200)\n"
+        "  -textures N        textures per context (default: 16)\n"
+        "  -textureUploads N  full texture uploads per frame and thread (default: 1)\n"
+        "  -textureSize N     width and height of the RGBA8 textures (default: 256)\n"
+        "  -bufferUploads N   buffer uploads per frame and thread (default: 4)\n"
+        "  -bufferSize N      bytes per buffer upload (default: 64K)\n"
+        "  -csbDraws N        draws using client-side buffers per frame and thread (default: 0)\n"
+        "  -csbSize N         bytes of client-side data per such draw (default: 4K)\n"
+        "  -width N           window width (default: 1920)\n"
+        "  -height N          window height (default: 1080)\n"
+        "  -seed N            seed for the payload generator (default: 1)\n"
+        "  -h                 print help\n"
+        "  -v                 print version\n"
+        ;
+}
+
+static void printVersion()
+{
+    std::cout << PATRACE_VERSION << std::endl;
+}
+
+static uint64_t parseSize(const char *str)
+{
+    char *end = nullptr;
+    uint64_t value = strtoull(str, &end, 0);
+    switch (end ? *end : 0)
+    {
+    case 'g': case 'G': value <<= 30; break;
+    case 'm': case 'M': value <<= 20; break;
+    case 'k': case 'K': value <<= 10; break;
+    default: break;
+    }
+    return value;
+}
+
+static Json::Value paramsToJson(const GenParams &p)
+{
+    Json::Value v;
+    v["frames"] = p.frames;
+    v["size"] = (Json::UInt64)p.size;
+    v["threads"] = p.threads;
+    v["contexts"] = p.contexts;
+    v["draws"] = p.draws;
+    v["textures"] = p.textures;
+    v["textureUploads"] = p.textureUploads;
+    v["textureSize"] = p.textureSize;
+    v["bufferUploads"] = p.bufferUploads;
+    v["bufferSize"] = p.bufferSize;
+    v["csbDraws"] = p.csbDraws;
+    v["csbSize"] = p.csbSize;
+    v["width"] = p.width;
+    v["height"] = p.height;
+    v["seed"] = (Json::UInt64)p.seed;
+    return v;
+}
+
+static bool readParams(const std::string &filename, GenParams &p)
+{
+    std::ifstream file(filename);
+    Json::Value v;
+    Json::Reader reader;
+    if (!file || !reader.parse(file, v))
+    {
+        DBG_LOG("Failed to read parameters from %s\n", filename.c_str());
+        return false;
+    }
+    p.frames = v.get("frames", p.frames).asUInt();
+    p.size = v.get("size", (Json::UInt64)p.size).asUInt64();
+    p.threads = v.get("threads", p.threads).asUInt();
+    p.contexts = v.get("contexts", p.contexts).asUInt();
+    p.draws = v.get("draws", p.draws).asUInt();
+    p.textures = v.get("textures", p.textures).asUInt();
+    p.textureUploads = v.get("textureUploads", p.textureUploads).asUInt();
+    p.textureSize = v.get("textureSize", p.textureSize).asUInt();
+    p.bufferUploads = v.get("bufferUploads", p.bufferUploads).asUInt();
+    p.bufferSize = v.get("bufferSize", p.bufferSize).asUInt();
+    p.csbDraws = v.get("csbDraws", p.csbDraws).asUInt();
+    p.csbSize = v.get("csbSize", p.csbSize).asUInt();
+    p.width = v.get("width", p.width).asUInt();
+    p.height = v.get("height", p.height).asUInt();
+    p.seed = v.get("seed", (Json::UInt64)p.seed).asUInt64();
+    return true;
+}
+
+class TraceGenerator
+{
+public:
+    TraceGenerator(common::OutFile &out, const GenParams &params)
+        : mOut(out)
+        , mParams(params)
+        , mRandom(params.seed ? params.seed : 1)
+    {
+        const size_t textureBytes = (size_t)params.textureSize * params.textureSize * 4;
+        mPayload.resize(std::max({ textureBytes, (size_t)params.bufferSize, (size_t)params.csbSize, (size_t)4096 }));
+        mBuffer.resize(mPayload.size() + 64 * 1024);
+        mNextCsbName.resize(params.threads, 1);
+    }
+
+    void setup()
+    {
+        for (unsigned t = 0; t < mParams.threads; ++t)
+        {
+            common::CallTM surface("eglCreateWindowSurface");
+            surface.mArgs.push_back(new common::ValueTM(DISPLAY));
+            surface.mArgs.push_back(new common::ValueTM(CONFIG));
+            surface.mArgs.push_back(new common::ValueTM(0));
+            surface.mArgs.push_back(common::CreateInt32ArrayValue(&mNoAttribs));
+            surface.mRet = common::ValueTM(surfaceName(t));
+            emit(surface, t);
+
+            for (unsigned c = 0; c < mParams.contexts; ++c)
+            {
+                common::CallTM context("eglCreateContext");
+                context.mArgs.push_back(new common::ValueTM(DISPLAY));
+                context.mArgs.push_back(new common::ValueTM(CONFIG));
+                context.mArgs.push_back(new common::ValueTM(0));
+                context.mArgs.push_back(common::CreateInt32ArrayValue(&mContextAttribs));
+                context.mRet = common::ValueTM(contextName(t, c, mParams));
+                emit(context, t);
+
+                makeCurrent(t, c);
+                setupContext(t);
+            }
+        }
+    }
+
+    void frame(unsigned number)
+    {
+        for (unsigned t = 0; t < mParams.threads; ++t)
+        {
+            if (mParams.contexts > 1)
+            {
+                makeCurrent(t, number % mParams.contexts);
+            }
+            frameCalls(t, number);
+        }
+    }
+
+    uint64_t calls() const { return mCalls; }
+    uint64_t bytes() const { return mBytes; }
+
+private:
+    void emit(common::CallTM &call, unsigned tid)
+    {
+        call.mTid = tid;
+        char *dest = call.Serialize(mBuffer.data(), -1, false);
+        mOut.Write(mBuffer.data(), dest - mBuffer.data());
+        mCalls++;
+        mBytes += dest - mBuffer.data();
+    }
+
+    /// Fill the first size bytes of the payload buffer with the next
+    /// pseudo-random bytes (xorshift64*)
+    const char *payload(size_t size)
+    {
+        for (size_t i = 0; i < size; i += 8)
+        {
+            mRandom ^= mRandom >> 12;
+            mRandom ^= mRandom << 25;
+            mRandom ^= mRandom >> 27;
+            const uint64_t r = mRandom * 2685821657736338717ull;
+            memcpy(&mPayload[i], &r, std::min((size_t)8, size - i));
+        }
+        return mPayload.data();
+    }
+
+    void makeCurrent(unsigned t, unsigned c)
+    {
+        common::CallTM call("eglMakeCurrent");
+        call.mArgs.push_back(new common::ValueTM(DISPLAY));
+        call.mArgs.push_back(new common::ValueTM(surfaceName(t)));
+        call.mArgs.push_back(new common::ValueTM(surfaceName(t)));
+        call.mArgs.push_back(new common::ValueTM(contextName(t, c, mParams)));
+        call.mRet = common::ValueTM(EGL_TRUE);
+        emit(call, t);
+    }
+
+    void shader(unsigned t, unsigned name, GLenum type, const char *source)
+    {
+        common::CallTM create("glCreateShader");
+        create.mArgs.push_back(new common::ValueTM(type));
+        create.mRet = common::ValueTM(name);
+        emit(create, t);
+
+        common::CallTM sourceCall("glShaderSource");
+        sourceCall.mArgs.push_back(new common::ValueTM(name));
+        sourceCall.mArgs.push_back(new common::ValueTM(1));
+        sourceCall.mArgs.push_back(common::CreateStringArrayValue({ source }));
+        sourceCall.mArgs.push_back(common::CreateInt32ArrayValue(NULL));
+        emit(sourceCall, t);
+
+        common::CallTM compile("glCompileShader");
+        compile.mArgs.push_back(new common::ValueTM(name));
+        emit(compile, t);
+
+        common::CallTM attach("glAttachShader");
+        attach.mArgs.push_back(new common::ValueTM(PROGRAM));
+        attach.mArgs.push_back(new common::ValueTM(name));
+        emit(attach, t);
+    }
+
+    void vertexPointer(unsigned t, common::ValueTM *pointer)
+    {
+        common::CallTM call("glVertexAttribPointer");
+        call.mArgs.push_back(new common::ValueTM(0));
+        call.mArgs.push_back(new common::ValueTM(4));
+        call.mArgs.push_back(new common::ValueTM(GL_FLOAT));
+        call.mArgs.push_back(common::CreateUInt8Value(GL_FALSE));
+        call.mArgs.push_back(new common::ValueTM(0));
+        call.mArgs.push_back(pointer);
+        emit(call, t);
+    }
+
+    void bindBuffer(unsigned t, unsigned name)
+    {
+        common::CallTM call("glBindBuffer");
+        call.mArgs.push_back(new common::ValueTM(GL_ARRAY_BUFFER));
+        call.mArgs.push_back(new common::ValueTM(name));
+        emit(call, t);
+    }
+
+    void bindTexture(unsigned t, unsigned name)
+    {
+        common::CallTM call("glBindTexture");
+        call.mArgs.push_back(new common::ValueTM(GL_TEXTURE_2D));
+        call.mArgs.push_back(new common::ValueTM(name));
+        emit(call, t);
+    }
+
+    void texImage(unsigned t)
+    {
+        const unsigned size = mParams.textureSize;
+        const unsigned bytes = size * size * 4;
+        common::CallTM call("glTexImage2D");
+        call.mArgs.push_back(new common::ValueTM(GL_TEXTURE_2D));
+        call.mArgs.push_back(new common::ValueTM(0));
+        call.mArgs.push_back(new common::ValueTM(GL_RGBA8));
+        call.mArgs.push_back(new common::ValueTM(size));
+        call.mArgs.push_back(new common::ValueTM(size));
+        call.mArgs.push_back(new common::ValueTM(0));
+        call.mArgs.push_back(new common::ValueTM(GL_RGBA));
+        call.mArgs.push_back(new common::ValueTM(GL_UNSIGNED_BYTE));
+        call.mArgs.push_back(common::CreateBlobOpaqueValue(bytes, payload(bytes)));
+        emit(call, t);
+    }
+
+    void setupContext(unsigned t)
+    {
+        common::CallTM viewport("glViewport");
+        viewport.mArgs.push_back(new common::ValueTM(0));
+        viewport.mArgs.push_back(new common::ValueTM(0));
+        viewport.mArgs.push_back(new common::ValueTM(mParams.width));
+        viewport.mArgs.push_back(new common::ValueTM(mParams.height));
+        emit(viewport, t);
+
+        common::CallTM program("glCreateProgram");
+        program.mRet = common::ValueTM(PROGRAM);
+        emit(program, t);
+        shader(t, VERTEX_SHADER, GL_VERTEX_SHADER, vertexShader);
+        shader(t, FRAGMENT_SHADER, GL_FRAGMENT_SHADER, fragmentShader);
+
+        common::CallTM bindAttrib("glBindAttribLocation");
+        bindAttrib.mArgs.push_back(new common::ValueTM(PROGRAM));
+        bindAttrib.mArgs.push_back(new common::ValueTM(0));
+        bindAttrib.mArgs.push_back(new common::ValueTM(std::string("pos")));
+        emit(bindAttrib, t);
+
+        common::CallTM link("glLinkProgram");
+        link.mArgs.push_back(new common::ValueTM(PROGRAM));
+        emit(link, t);
+
+        common::CallTM use("glUseProgram");
+        use.mArgs.push_back(new common::ValueTM(PROGRAM));
+        emit(use, t);
+
+        std::vector<unsigned> names(1, VERTEX_BUFFER);
+        common::CallTM genBuffers("glGenBuffers");
+        genBuffers.mArgs.push_back(new common::ValueTM(1));
+        genBuffers.mArgs.push_back(common::CreateUInt32ArrayValue(names));
+        emit(genBuffers, t);
+        bindBuffer(t, VERTEX_BUFFER);
+
+        const unsigned bytes = std::max(mParams.bufferSize, 64u);
+        common::CallTM bufferData("glBufferData");
+        bufferData.mArgs.push_back(new common::ValueTM(GL_ARRAY_BUFFER));
+        bufferData.mArgs.push_back(new common::ValueTM(bytes));
+        bufferData.mArgs.push_back(common::CreateBlobValue(bytes, payload(bytes)));
+        bufferData.mArgs.push_back(new common::ValueTM(GL_DYNAMIC_DRAW));
+        emit(bufferData, t);
+
+        common::CallTM enable("glEnableVertexAttribArray");
+        enable.mArgs.push_back(new common::ValueTM(0));
+        emit(enable, t);
+        vertexPointer(t, common::CreateBufferReferenceOpaqueValue(0));
+
+        names.clear();
+        for (unsigned i = 0; i < mParams.textures; ++i)
+        {
+            names.push_back(i + 1);
+        }
+        if (!names.empty())
+        {
+            common::CallTM genTextures("glGenTextures");
+            genTextures.mArgs.push_back(new common::ValueTM((unsigned)names.size()));
+            genTextures.mArgs.push_back(common::CreateUInt32ArrayValue(names));
+            emit(genTextures, t);
+        }
+        for (unsigned name : names)
+        {
+            bindTexture(t, name);
+            texImage(t);
+        }
+    }
+
+    void frameCalls(unsigned t, unsigned number)
+    {
+        common::CallTM clear("glClear");
+        clear.mArgs.push_back(new common::ValueTM(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT));
+        emit(clear, t);
+
+        for (unsigned i = 0; i < mParams.bufferUploads; ++i)
+        {
+            const unsigned bytes = mParams.bufferSize;
+            common::CallTM call("glBufferSubData");
+            call.mArgs.push_back(new common::ValueTM(GL_ARRAY_BUFFER));
+            call.mArgs.push_back(new common::ValueTM(0));
+            call.mArgs.push_back(new common::ValueTM(bytes));
+            call.mArgs.push_back(common::CreateBlobValue(bytes, payload(bytes)));
+            emit(call, t);
+        }
+
+        for (unsigned i = 0; i < mParams.textureUploads && mParams.textures; ++i)
+        {
+            bindTexture(t, 1 + (number + i) % mParams.textures);
+            texImage(t);
+        }
+
+        for (unsigned i = 0; i < mParams.draws; ++i)
+        {
+            if (mParams.textures)
+            {
+                bindTexture(t, 1 + i % mParams.textures);
+            }
+            common::CallTM draw("glDrawArrays");
+            draw.mArgs.push_back(new common::ValueTM(GL_TRIANGLES));
+            draw.mArgs.push_back(new common::ValueTM(0));
+            draw.mArgs.push_back(new common::ValueTM(3));
+            emit(draw, t);
+        }
+
+        if (mParams.csbDraws)
+        {
+            // Each draw gets its own client-side buffer, which is how the
+            // tracer records vertex arrays read from application memory
+            const unsigned bytes = std::max(mParams.csbSize, 48u);
+            bindBuffer(t, 0);
+            for (unsigned i = 0; i < mParams.csbDraws; ++i)
+            {
+                const unsigned name = mNextCsbName[t]++;
+                common::CallTM create("glCreateClientSideBuffer");
+                create.mRet = common::ValueTM(name);
+                emit(create, t);
+
+                common::CallTM data("glClientSideBufferData");
+                data.mArgs.push_back(new common::ValueTM(name));
+                data.mArgs.push_back(new common::ValueTM(bytes));
+                data.mArgs.push_back(common::CreateBlobValue(bytes, payload(bytes)));
+                emit(data, t);
+
+                common::ValueTM *pointer = new common::ValueTM;
+                pointer->SetAsClientSideBufferReference(name, 0);
+                vertexPointer(t, pointer);
+
+                common::CallTM draw("glDrawArrays");
+                draw.mArgs.push_back(new common::ValueTM(GL_TRIANGLES));
+                draw.mArgs.push_back(new common::ValueTM(0));
+                draw.mArgs.push_back(new common::ValueTM(3));
+                emit(draw, t);
+
+                common::CallTM release("glDeleteClientSideBuffer");
+                release.mArgs.push_back(new common::ValueTM(name));
+                emit(release, t);
+            }
+            bindBuffer(t, VERTEX_BUFFER);
+            vertexPointer(t, common::CreateBufferReferenceOpaqueValue(0));
+        }
+
+        common::CallTM swap("eglSwapBuffers");
+        swap.mArgs.push_back(new common::ValueTM(DISPLAY));
+        swap.mArgs.push_back(new common::ValueTM(surfaceName(t)));
+        swap.mRet = common::ValueTM(EGL_TRUE);
+        emit(swap, t);
+    }
+
+    common::OutFile &mOut;
+    const GenParams &mParams;
+    uint64_t mRandom;
+    std::vector<char> mPayload;
+    std::vector<char> mBuffer;
+    std::vector<unsigned> mNextCsbName;
+    uint64_t mCalls = 0;
+    uint64_t mBytes = 0;
+    const std::vector<int> mNoAttribs = { EGL_NONE };
+    const std::vector<int> mContextAttribs = { EGL_CONTEXT_CLIENT_VERSION, 3, EGL_NONE };
+};
+
+int main(int argc, char **argv)
+{
+    GenParams params;
+    std::string target;
+
+    // The parameter file is read first so that the other options override it
+    for (int i = 1; i < argc - 1; ++i)
+    {
+        if (!strcmp(argv[i], "-p") && !readParams(argv[i + 1], params))
+        {
+            return 1;
+        }
+    }
+
+    for (int i = 1; i < argc; ++i)
+    {
+        const char *arg = argv[i];
+        const bool hasValue = i + 1 < argc;
+
+        if (!strcmp(arg, "-h"))
+        {
+            printHelp();
+            return 0;
+        }
+        else if (!strcmp(arg, "-v"))
+        {
+            printVersion();
+            return 0;
+        }
+        else if (!strcmp(arg, "-p") && hasValue)
+        {
+            ++i;
+        }
+        else if (!strcmp(arg, "-frames") && hasValue)
+        {
+            params.frames = parseSize(argv[++i]);
+        }
+        else if (!strcmp(arg, "-size") && hasValue)
+        {
+            params.size = parseSize(argv[++i]);
+        }
+        else if (!strcmp(arg, "-threads") && hasValue)
+        {
+            params.threads = parseSize(argv[++i]);
+        }
+        else if (!strcmp(arg, "-contexts") && hasValue)
+        {
+            params.contexts = parseSize(argv[++i]);
+        }
+        else if (!strcmp(arg, "-draws") && hasValue)
+        {
+            params.draws = parseSize(argv[++i]);
+        }
+        else if (!strcmp(arg, "-textures") && hasValue)
+        {
+            params.textures = parseSize(argv[++i]);
+        }
+        else if (!strcmp(arg, "-textureUploads") && hasValue)
+        {
+            params.textureUploads = parseSize(argv[++i]);
+        }
+        else if (!strcmp(arg, "-textureSize") && hasValue)
+        {
+            params.textureSize = parseSize(argv[++i]);
+        }
+        else if (!strcmp(arg, "-bufferUploads") && hasValue)
+        {
+            params.bufferUploads = parseSize(argv[++i]);
+        }
+        else if (!strcmp(arg, "-bufferSize") && hasValue)
+        {
+            params.bufferSize = parseSize(argv[++i]);
+        }
+        else if (!strcmp(arg, "-csbDraws") && hasValue)
+        {
+            params.csbDraws = parseSize(argv[++i]);
+        }
+        else if (!strcmp(arg, "-csbSize") && hasValue)
+        {
+            params.csbSize = parseSize(argv[++i]);
+        }
+        else if (!strcmp(arg, "-width") && hasValue)
+        {
+            params.width = parseSize(argv[++i]);
+        }
+        else if (!strcmp(arg, "-height") && hasValue)
+        {
+            params.height = parseSize(argv[++i]);
+        }
+        else if (!strcmp(arg, "-seed") && hasValue)
+        {
+            params.seed = parseSize(argv[++i]);
+        }
+        else if (arg[0] == '-')
+        {
+            std::cerr << "Unknown option: " << arg << std::endl;
+            printHelp();
+            return 1;
+        }
+        else if (target.empty())
+        {
+            target = arg;
+        }
+        else
+        {
+            printHelp();
+            return 1;
+        }
+    }
+
+    if (target.empty())
+    {
+        printHelp();
+        return 1;
+    }
+    if (params.threads == 0 || params.threads > 255 || params.contexts == 0)
+    {
+        DBG_LOG("Need between 1 and 255 threads and at least one context\n");
+        return 1;
+    }
+    if ((uint64_t)params.textureSize * params.textureSize * 4 > 0x7fffffff)
+    {
+        DBG_LOG("Texture size %u is too large\n", params.textureSize);
+        return 1;
+    }
+
+    common::gApiInfo.RegisterEntries(common::parse_callbacks);
+
+    common::OutFile out;
+    if (!out.Open(target.c_str()))
+    {
+        DBG_LOG("Failed to open %s for writing\n", target.c_str());
+        return 1;
+    }
+
+    const int64_t t0 = os::getTime();
+    TraceGenerator generator(out, params);
+    generator.setup();
+    unsigned frames = 0;
+    while (params.size ? generator.bytes() < params.size : frames < params.frames)
+    {
+        generator.frame(frames++);
+    }
+
+    Json::Value header;
+    header["defaultTid"] = 0;
+    header["glesVersion"] = 3;
+    header["callCnt"] = (Json::UInt64)generator.calls();
+    header["frameCnt"] = frames;
+    header["multiThread"] = params.threads > 1;
+    header["threads"] = Json::arrayValue;
+    for (unsigned t = 0; t < params.threads; ++t)
+    {
+        Json::Value thread;
+        thread["id"] = t;
+        thread["winW"] = params.width;
+        thread["winH"] = params.height;
+        thread["EGLConfig"]["red"] = 8;
+        thread["EGLConfig"]["green"] = 8;
+        thread["EGLConfig"]["blue"] = 8;
+        thread["EGLConfig"]["alpha"] = 8;
+        thread["EGLConfig"]["depth"] = 24;
+        thread["EGLConfig"]["stencil"] = 8;
+        thread["EGLConfig"]["msaaSamples"] = 0;
+        header["threads"].append(thread);
+    }
+    addConversionEntry2(header, "gen_trace", std::vector<std::string>(), paramsToJson(params));
+    Json::FastWriter writer;
+    const std::string json_header = writer.write(header);
+    out.mHeader.jsonLength = json_header.size();
+    out.WriteHeader(json_header.c_str(), json_header.size());
+    out.Close();
+
+    const double seconds = (double)(os::getTime() - t0) / os::timeFrequency;
+    DBG_LOG("Generated %u frames, %" PRIu64 " calls, %.1f MB of call data in %.2f s\n",
+            frames, generator.calls(), generator.bytes() / (1024.0 * 1024.0), seconds);
+    return 0;
+}
@@ -0,0 +1,307 @@
+#include "tool/glsl_cache.h"
+
+#include <errno.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+#include <algorithm>
+#include <fstream>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+#include "json/reader.h"
+#include "json/writer.h"
+#include "common/in_file_mt.hpp"
+#include "common/trace_chunk.hpp"
+#include "common/trace_model.hpp"
+#include "common/os.hpp"
+#include "base/base.hpp"
+#include "tool/config.hpp"
+
+#include <snappy.h>
+
+static const uint32_t GLSL_CACHE_MAGIC = 0x4c534c47; // "GLSL"
+
+static Json::Value to_json(const GLSLRepresentation::Variable& v)
+{
+    Json::Value value;
+    // Only store what is set, since most variables have few of these
+    if (v.precision != Keyword::None) value["precision"] = (int)v.precision;
+    if (v.type != Keyword::None) value["type"] = (int)v.type;
+    if (v.storage != Keyword::None) value["storage"] = (int)v.storage;
+    if (!v.name.empty()) value["name"] = v.name;
+    if (v.size != 0) value["size"] = v.size;
+    if (!v.dimensions.empty()) value["dimensions"] = v.dimensions;
+    for (Keyword k : v.qualifiers) value["qualifiers"].append((int)k);
+    if (!v.layout.empty()) value["layout"] = v.layout;
+    for (const GLSLRepresentation::Variable& m : v.members) value["members"].append(to_json(m));
+    if (v.binding != -1) value["binding"] = v.binding;
+    return value;
+}
+
+static GLSLRepresentation::Variable from_json(const Json::Value& value)
+{
+    GLSLRepresentation::Variable v;
+    v.precision = (Keyword)value.get("precision", (int)Keyword::None).asInt();
+    v.type = (Keyword)value.get("type", (int)Keyword::None).asInt();
+    v.storage = (Keyword)value.get("storage", (int)Keyword::None).asInt();
+    v.name = value.get("name", "").asString();
+    v.size = value.get("size", 0).asInt();
+    v.dimensions = value.get("dimensions", "").asString();
+    for (const Json::Value& k : value["qualifiers"]) v.qualifiers.push_back((Keyword)k.asInt());
+    v.layout = value.get("layout", "").asString();
+    for (const Json::Value& m : value["members"]) v.members.push_back(from_json(m));
+    v.binding = value.get("binding", -1).asInt();
+    return v;
+}
+
+bool GLSLCache::open(const std::string& dir)
+{
+    mDir = dir + "/glsl";
+    mkdir(dir.c_str(), 0755);
+    if (mkdir(mDir.c_str(), 0755) != 0 && errno != EEXIST)
+    {
+        DBG_LOG("Could not create shader cache directory %s: %s\n", mDir.c_str(), strerror(errno));
+        mDir.clear();
+        return false;
+    }
+    return true;
+}
+
+std::string GLSLCache::key(const std::string& source, int shaderType)
+{
+    char name[64];
+    snprintf(name, sizeof(name), "%016" PRIx64 "_%04x", common::xxHash64(source.data(), source.size()), (unsigned)shaderType);
+    return name;
+}
+
+std::shared_ptr<const GLSLParsed> GLSLCache::parse(const std::string& source, int shaderType, const std::string& name)
+{
+    auto parsed = std::make_shared<GLSLParsed>();
+    GLSLParser parser(name);
+    std::string stripped = parser.strip_comments(source);
+    parsed->shader = parser.preprocessor(stripped, shaderType);
+    parsed->compressed = parser.compressed(parsed->shader);
+    parsed->repr = parser.parse(parsed->shader);
+    return parsed;
+}
+
+std::shared_ptr<const GLSLParsed> GLSLCache::find(const std::string& key)
+{
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        const auto it = mEntries.find(key);
+        if (it != mEntries.end())
+        {
+            return it->second;
+        }
+    }
+    if (mDir.empty())
+    {
+        return nullptr;
+    }
+    std::shared_ptr<const GLSLParsed> parsed = load(key);
+    if (parsed)
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        return mEntries.emplace(key, parsed).first->second;
+    }
+    return nullptr;
+}
+
+std::shared_ptr<const GLSLParsed> GLSLCache::get(const std::string& source, int shaderType, const std::string& name)
+{
+    const std::string k = key(source, shaderType);
+    std::shared_ptr<const GLSLParsed> parsed = find(k);
+    if (parsed)
+    {
+        mHits++;
+        return parsed;
+    }
+    mMisses++;
+    parsed = parse(source, shaderType, name);
+    if (!mDir.empty())
+    {
+        store(k, *parsed);
+    }
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mEntries.emplace(k, parsed).first->second;
+}
+
+std::shared_ptr<const GLSLParsed> GLSLCache::load(const std::string& key)
+{
+    const std::string filename = mDir + "/" + key;
+    std::ifstream t(filename, std::ios::binary);
+    if (!t)
+    {
+        return nullptr;
+    }
+    std::string data((std::istreambuf_iterator<char>(t)), std::istreambuf_iterator<char>());
+    std::string json;
+    uint32_t magic = 0;
+    if (data.size() < sizeof(magic))
+    {
+        return nullptr;
+    }
+    memcpy(&magic, data.data(), sizeof(magic));
+    Json::Value value;
+    Json::Reader reader;
+    if (magic != GLSL_CACHE_MAGIC || !snappy::Uncompress(data.data() + sizeof(magic), data.size() - sizeof(magic), &json)
+        || !reader.parse(json, value))
+    {
+        DBG_LOG("Ignoring damaged shader cache file %s\n", filename.c_str());
+        return nullptr;
+    }
+    if (value["version"].asString() != PATRACE_VERSION)
+    {
+        return nullptr; // will be overwritten with a fresh result
+    }
+
+    auto parsed = std::make_shared<GLSLParsed>();
+    const Json::Value& shader = value["shader"];
+    parsed->shader.code = shader["code"].asString();
+    for (const Json::Value& e : shader["extensions"]) parsed->shader.extensions.push_back(e.asString());
+    parsed->shader.version = shader["version"].asInt();
+    parsed->shader.contains_optimize_off_pragma = shader["optimize_off"].asBool();
+    parsed->shader.contains_debug_on_pragma = shader["debug_on"].asBool();
+    parsed->shader.contains_invariant_all_pragma = shader["invariant_all"].asBool();
+    parsed->shader.shaderType = shader["type"].asInt();
+    parsed->compressed = value["compressed"].asString();
+    parsed->repr.contains_invariants = value["invariants"].asBool();
+    parsed->repr.global = from_json(value["global"]);
+    return parsed;
+}
+
+void GLSLCache::store(const std::string& key, const GLSLParsed& parsed)
+{
+    Json::Value value;
+    value["version"] = PATRACE_VERSION;
+    Json::Value& shader = value["shader"];
+    shader["code"] = parsed.shader.code;
+    shader["extensions"] = Json::arrayValue;
+    for (const std::string& e : parsed.shader.extensions) shader["extensions"].append(e);
+    shader["version"] = parsed.shader.version;
+    shader["optimize_off"] = parsed.shader.contains_optimize_off_pragma;
+    shader["debug_on"] = parsed.shader.contains_debug_on_pragma;
+    shader["invariant_all"] = parsed.shader.contains_invariant_all_pragma;
+    shader["type"] = parsed.shader.shaderType;
+    value["compressed"] = parsed.compressed;
+    value["invariants"] = parsed.repr.contains_invariants;
+    value["global"] = to_json(parsed.repr.global);
+
+    Json::FastWriter writer;
+    const std::string json = writer.write(value);
+    std::string compressed;
+    snappy::Compress(json.data(), json.size(), &compressed);
+
+    // Write under a unique name and rename, so that concurrent runs never
+    // see a half written file
+    const std::string filename = mDir + "/" + key;
+    const std::string tmpname = filename + "." + std::to_string(getpid()) + "." + std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id()));
+    FILE* fp = fopen(tmpname.c_str(), "wb");
+    if (!fp)
+    {
+        DBG_LOG("Could not open %s for writing: %s\n", tmpname.c_str(), strerror(errno));
+        return;
+    }
+    fwrite(&GLSL_CACHE_MAGIC, sizeof(GLSL_CACHE_MAGIC), 1, fp);
+    fwrite(compressed.data(), 1, compressed.size(), fp);
+    fclose(fp);
+    if (rename(tmpname.c_str(), filename.c_str()) != 0)
+    {
+        DBG_LOG("Could not rename %s: %s\n", tmpname.c_str(), strerror(errno));
+        unlink(tmpname.c_str());
+    }
+}
+
+unsigned GLSLCache::prefetch(const std::string& trace, unsigned threads)
+{
+    // The caller must already have registered the call entries for the file
+    common::InFile inputFile;
+    if (!inputFile.Open(trace.c_str()))
+    {
+        DBG_LOG("Failed to open %s for reading shaders\n", trace.c_str());
+        return 0;
+    }
+    const unsigned short createShader = inputFile.NameToExId("glCreateShader");
+    const unsigned short shaderSource = inputFile.NameToExId("glShaderSource");
+
+    // One pass to collect the unique sources. Shader types are tracked by id
+    // alone, ignoring contexts and threads; if this goes wrong, the shader is
+    // just parsed again later when asked for.
+    struct Source
+    {
+        std::string code;
+        int shaderType;
+        std::string key;
+    };
+    std::vector<Source> sources;
+    std::unordered_set<std::string> seen;
+    std::unordered_map<unsigned, int> types;
+    void *fptr = nullptr;
+    char *src = nullptr;
+    common::BCall_vlen call;
+    unsigned callNo = 0;
+    while (inputFile.GetNextCall(fptr, call, src))
+    {
+        if ((call.funcId == createShader || call.funcId == shaderSource))
+        {
+            common::CallTM c(inputFile, callNo, call);
+            if (call.funcId == createShader)
+            {
+                types[c.mRet.GetAsUInt()] = c.mArgs[0]->GetAsUInt();
+            }
+            else if (types.count(c.mArgs[0]->GetAsUInt()))
+            {
+                Source s;
+                for (unsigned i = 0; i < c.mArgs[2]->mArrayLen; i++)
+                {
+                    int maxLen = -1;
+                    if (c.mArgs[3]->mType == common::Array_Type && c.mArgs[3]->mArrayLen > i)
+                    {
+                        maxLen = c.mArgs[3]->mArray[i].GetAsInt();
+                    }
+                    s.code += c.mArgs[2]->mArray[i].GetAsString(maxLen);
+                }
+                s.shaderType = types.at(c.mArgs[0]->GetAsUInt());
+                s.key = key(s.code, s.shaderType);
+                if (seen.insert(s.key).second)
+                {
+                    sources.push_back(std::move(s));
+                }
+            }
+        }
+        callNo++;
+    }
+    inputFile.Close();
+
+    // Then look up or parse them in parallel
+    const unsigned before = mMisses;
+    std::atomic<size_t> next(0);
+    auto worker = [&]()
+    {
+        size_t i;
+        while ((i = next.fetch_add(1)) < sources.size())
+        {
+            get(sources[i].code, sources[i].shaderType);
+        }
+    };
+    std::vector<std::thread> pool;
+    for (unsigned i = 0; i < std::max(1u, threads); i++)
+    {
+        pool.emplace_back(worker);
+    }
+    for (std::thread& t : pool)
+    {
+        t.join();
+    }
+    DBG_LOG("Found %u unique shader sources, %u of them parsed on %u threads\n", (unsigned)sources.size(), mMisses - before, std::max(1u, threads));
+    // Do not count these lookups as hits, so that the numbers tell how much the run itself saved
+    mHits = 0;
+    mMisses = 0;
+    return sources.size();
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include "glsl_parser.h"
+
+/// Everything we get out of parsing one shader source
+struct GLSLParsed
+{
+    GLSLShader shader; // preprocessed
+    std::string compressed;
+    GLSLRepresentation repr;
+};
+
+/// Parses each distinct shader source only once. Results are kept in memory
+/// for the lifetime of the cache, and if given a directory, also on disk so
+/// that later tool runs on the same or other traces can reuse them. Results
+/// are keyed by a digest of the source and the shader type, and on disk also
+/// by the tool version, since the representation may change between versions.
+class GLSLCache
+{
+public:
+    /// Store results in this directory, creating it if necessary
+    bool open(const std::string& dir);
+
+    /// Collect all shader sources from a trace file, and parse those we have
+    /// not seen before on the given number of threads. Returns the number of
+    /// unique sources found.
+    unsigned prefetch(const std::string& trace, unsigned threads);
+
+    /// Return the parse result for a shader source. This is thread safe. The
+    /// name is only used in parse errors.
+    std::shared_ptr<const GLSLParsed> get(const std::string& source, int shaderType, const std::string& name = std::string());
+
+    unsigned hits() const { return mHits; }
+    unsigned misses() const { return mMisses; }
+
+private:
+    static std::string key(const std::string& source, int shaderType);
+    std::shared_ptr<const GLSLParsed> find(const std::string& key);
+    std::shared_ptr<const GLSLParsed> load(const std::string& key);
+    void store(const std::string& key, const GLSLParsed& parsed);
+    static std::shared_ptr<const GLSLParsed> parse(const std::string& source, int shaderType, const std::string& name);
+
+    std::mutex mMutex;
+    std::unordered_map<std::string, std::shared_ptr<const GLSLParsed>> mEntries;
+    std::string mDir;
+    std::atomic<unsigned> mHits{0};
+    std::atomic<unsigned> mMisses{0};
+};
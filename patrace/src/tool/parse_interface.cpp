@@ -163,6 +163,7 @@ bool ParseInterface::open(const std::string& input, const std::string& output)
     jsonConfig.samples = eglconfig.get("msaaSamples", -1).asInt();
     if (header.isMember("multiThread")) only_default = !header.get("multiThread", false).asBool();
     if (mForceMultithread) only_default = false;
+    if (mShaderThreads > 0) shader_cache.prefetch(input, mShaderThreads);
     return true;
 }
 
@@ -1992,17 +1993,16 @@ void ParseInterfaceBase::interpret_call(common::CallTM *call)
         StateTracker::Shader& s = contexts[context_index].shaders[target_shader_index];
         s.source_code = code; // original shader
         s.call = call->mCallNo;
-        GLSLParser parser;
-        std::string stripped = parser.strip_comments(code);
-        GLSLShader sh = parser.preprocessor(stripped, s.shader_type);
+        const std::shared_ptr<const GLSLParsed> parsed = shader_cache.get(code, s.shader_type);
+        const GLSLShader& sh = parsed->shader;
         if (sh.version / 10 > highest_gles_version && highest_gles_version > 10)
         {
             DBG_LOG("The use of shader in call %d increases GLES version from %d to %d\n", (int)call->mCallNo, (int)highest_gles_version, (int)sh.version / 10);
             highest_gles_version = sh.version / 10;
         }
-        s.source_compressed = parser.compressed(sh);
+        s.source_compressed = parsed->compressed;
         s.source_preprocessed = sh.code;
-        GLSLRepresentation repr = parser.parse(sh);
+        const GLSLRepresentation& repr = parsed->repr;
         s.contains_invariants = repr.contains_invariants;
         s.contains_optimize_off_pragma = sh.contains_optimize_off_pragma;
         s.contains_debug_on_pragma = sh.contains_debug_on_pragma;
@@ -2973,6 +2973,12 @@ void ParseInterfaceBase::interpret_call(common::CallTM *call)
     }
 }
 
+void ParseInterfaceBase::setShaderCache(const std::string& dir, unsigned threads)
+{
+    if (!dir.empty()) shader_cache.open(dir);
+    mShaderThreads = threads;
+}
+
 void ParseInterface::close()
 {
     inputFile.Close();
@@ -23,6 +23,7 @@
 #include "common/os.hpp"
 #include "eglstate/context.hpp"
 #include "tool/config.hpp"
+#include "tool/glsl_cache.h"
 #include "base/base.hpp"
 
 /// Large negative index number to encourage crashing if used improperly.
@@ -730,6 +731,9 @@ public:
     void setOutputName(const std::string& name) { mOutputName = name; }
     void setRenderpassJSON(bool value) { mRenderpassJSON = value; }
     void setDebug(bool debug) { mDebug = debug; }
+    /// Keep shader parse results in this directory across runs, if not empty, and parse all
+    /// shaders of the trace on this many threads when it is opened, if not zero
+    void setShaderCache(const std::string& dir, unsigned threads);
     void interpret_call(common::CallTM *call);
     void check_enum(const std::string& callname, GLenum value);
 
@@ -769,6 +773,8 @@ public:
     };
     std::map<std::string, callstat> callstats;
 
+    GLSLCache shader_cache; // identical shader sources are only parsed once
+
 private:
     bool find_duplicate_clears(const StateTracker::FillState& f, const StateTracker::Attachment& at, GLenum type, StateTracker::Framebuffer& fbo, const std::string& call);
     void setEglConfig(StateTracker::EglConfig& config, int attribute, int value);
@@ -788,6 +794,7 @@ protected:
     bool mDumpRenderpassJson = false;
     bool mRenderpassJSON = false;
     bool mDebug = false;
+    unsigned mShaderThreads = 0;
     bool only_default; // only parse default tid calls
 };
 
@@ -392,6 +392,7 @@ bool ParseInterfaceRetracing::open(const std::string& input, const std::string&
     jsonConfig.samples = eglconfig.get("msaaSamples", -1).asInt();
     if (jsonConfig.red <= 0) DBG_LOG("Zero red bits! This trace likely has a bad header!\n");
     if (!perf_init()) DBG_LOG("Could not initialize perf subsystem\n");
+    if (mShaderThreads > 0) shader_cache.prefetch(input, mShaderThreads);
     return true;
 }
 
@@ -0,0 +1,282 @@
+#include "call_index.h"
+#include <QFile>
+#include <QFileInfo>
+
+static const qint64 BLOCK_SIZE = 4 * 1024 * 1024;
+
+static inline quint64 cacheKey(int frame, int row)
+{
+    return ((quint64)frame << 32) | (quint32)row;
+}
+
+bool CallIndex::readCalls(QFile &file, const QVector<qint64> &wanted, const std::function<bool(int, const QByteArray&)> &found)
+{
+    if (wanted.isEmpty()) return true;
+    if (!file.seek(wanted[0])) return false;
+
+    JsonObjectScanner scanner;
+    qint64 pos = wanted[0];
+    int next = 0;
+    QByteArray object;
+    bool inObject = false;
+    while (next < wanted.size())
+    {
+        const QByteArray block = file.read(BLOCK_SIZE);
+        if (block.isEmpty()) return false;
+        const char *data = block.constData();
+        int start = 0;
+        for (int i = 0; i < block.size() && next < wanted.size(); i++, pos++)
+        {
+            if (scanner.opens(data[i]))
+            {
+                inObject = (pos == wanted[next]);
+                start = i;
+                object.clear();
+            }
+            if (scanner.feed(data[i]) && inObject)
+            {
+                object.append(data + start, i + 1 - start);
+                if (!found(next, object)) return false;
+                inObject = false;
+                next++;
+            }
+        }
+        if (inObject)
+        {
+            object.append(data + start, block.size() - start); // continues in the next block
+        }
+    }
+    return true;
+}
+
+bool CallIndex::scan(const QString &filename, CallFrame &frame)
+{
+    frame.filename = filename;
+    frame.rows.clear();
+    frame.edits.clear();
+    QFile file(filename);
+    if (!file.open(QIODevice::ReadOnly))
+    {
+        return false;
+    }
+
+    JsonObjectScanner scanner;
+    qint64 pos = 0;
+    for (;;)
+    {
+        const QByteArray block = file.read(BLOCK_SIZE);
+        if (block.isEmpty()) break;
+        const char *data = block.constData();
+        for (int i = 0; i < block.size(); i++, pos++)
+        {
+            if (scanner.opens(data[i]))
+            {
+                frame.rows.append(pos);
+            }
+            scanner.feed(data[i]);
+        }
+    }
+    frame.rows.squeeze();
+    return true;
+}
+
+QString CallIndex::label(const QByteArray &call)
+{
+    // Cheaper than parsing the whole call, which may hold large arrays
+    QString callnum;
+    int i = call.indexOf("\"0 call_no\"");
+    if (i >= 0)
+    {
+        i = call.indexOf(':', i) + 1;
+        while (i > 0 && i < call.size() && call[i] == ' ') i++;
+        int end = i;
+        while (end < call.size() && (call[end] == '-' || (call[end] >= '0' && call[end] <= '9'))) end++;
+        callnum = QString::fromLatin1(call.mid(i, end - i));
+    }
+    QString functionname;
+    i = call.indexOf("\"2 func_name\"");
+    if (i >= 0)
+    {
+        i = call.indexOf('"', call.indexOf(':', i)) + 1;
+        const int end = call.indexOf('"', i);
+        if (i > 0 && end > i) functionname = QString::fromUtf8(call.mid(i, end - i));
+    }
+    return "(" + callnum + ")" + functionname;
+}
+
+void CallIndex::clear()
+{
+    frames.clear();
+    cache.clear();
+    labels.clear();
+}
+
+QByteArray CallIndex::read(int frame, int row)
+{
+    const CallFrame &f = frames[frame];
+    if (f.rows[row] < 0)
+    {
+        return f.edits[-f.rows[row] - 1];
+    }
+    const quint64 key = cacheKey(frame, row);
+    if (QByteArray *cached = cache.object(key))
+    {
+        return *cached;
+    }
+
+    // Read ahead, since the calls after this one are likely to be shown next
+    QVector<qint64> wanted;
+    QVector<int> wantedRows;
+    for (int r = row; r < f.rows.size() && r < row + PREFETCH; r++)
+    {
+        if (f.rows[r] >= 0 && (r == row || !cache.contains(cacheKey(frame, r))))
+        {
+            wanted.append(f.rows[r]);
+            wantedRows.append(r);
+        }
+    }
+    QFile file(f.filename);
+    QByteArray result;
+    if (!file.open(QIODevice::ReadOnly))
+    {
+        return result;
+    }
+    readCalls(file, wanted, [&](int i, const QByteArray &object)
+    {
+        if (wantedRows[i] == row) result = object;
+        cache.insert(cacheKey(frame, wantedRows[i]), new QByteArray(object), object.size());
+        return true;
+    });
+    return result;
+}
+
+QString CallIndex::call(int frame, int row)
+{
+    return QString::fromUtf8(read(frame, row));
+}
+
+QString CallIndex::label(int frame, int row)
+{
+    const quint64 key = cacheKey(frame, row);
+    if (QString *cached = labels.object(key))
+    {
+        return *cached;
+    }
+    // The cache deletes what it has no room for right away
+    const QString text = label(read(frame, row));
+    labels.insert(key, new QString(text), text.size() * sizeof(QChar));
+    return text;
+}
+
+void CallIndex::invalidate(int frame)
+{
+    for (const quint64 key : cache.keys())
+    {
+        if ((int)(key >> 32) == frame) cache.remove(key);
+    }
+    for (const quint64 key : labels.keys())
+    {
+        if ((int)(key >> 32) == frame) labels.remove(key);
+    }
+}
+
+void CallIndex::setCall(int frame, int row, const QString &text)
+{
+    CallFrame &f = frames[frame];
+    f.edits.append(text.toUtf8());
+    f.rows[row] = -f.edits.size();
+    f.modified = true;
+    cache.remove(cacheKey(frame, row));
+    labels.remove(cacheKey(frame, row));
+}
+
+void CallIndex::insertCall(int frame, int row, const QString &text)
+{
+    CallFrame &f = frames[frame];
+    f.edits.append(text.toUtf8());
+    f.rows.insert(row, -f.edits.size());
+    f.modified = true;
+    invalidate(frame);
+}
+
+void CallIndex::removeCall(int frame, int row)
+{
+    frames[frame].rows.remove(row);
+    frames[frame].modified = true;
+    invalidate(frame); // the text of a removed edit is only dropped when saving
+}
+
+void CallIndex::removeFrame(int frame)
+{
+    frames.remove(frame);
+    cache.clear();
+    labels.clear();
+}
+
+bool CallIndex::write(int frame, const QString &filename)
+{
+    const CallFrame &f = frames[frame];
+    QFile source(f.filename);
+    const bool sameFile = QFileInfo(filename).absoluteFilePath() == QFileInfo(f.filename).absoluteFilePath();
+    QFile target(sameFile ? filename + ".tmp" : filename);
+    if (!target.open(QIODevice::WriteOnly | QIODevice::Truncate))
+    {
+        return false;
+    }
+
+    // Unchanged calls are copied straight from the source in one pass,
+    // changed ones in between from memory
+    QVector<qint64> wanted;
+    for (const qint64 offset : f.rows)
+    {
+        if (offset >= 0) wanted.append(offset);
+    }
+    if (!wanted.isEmpty() && !source.open(QIODevice::ReadOnly))
+    {
+        return false;
+    }
+    CallFrame written;
+    written.filename = filename;
+    int row = 0;
+    bool ok = true;
+    auto put = [&](const QByteArray &object)
+    {
+        target.write(row == 0 ? "[\n" : ",\n");
+        written.rows.append(target.pos());
+        ok = ok && target.write(object) == object.size();
+        row++;
+    };
+    auto putEdits = [&]()
+    {
+        while (row < f.rows.size() && f.rows[row] < 0)
+        {
+            put(f.edits[-f.rows[row] - 1]);
+        }
+    };
+    putEdits();
+    const bool complete = readCalls(source, wanted, [&](int, const QByteArray &object)
+    {
+        put(object);
+        putEdits();
+        return true;
+    });
+    target.write(row == 0 ? "[\n\n]" : "\n]");
+    target.close();
+    if (!ok || !complete || target.error() != QFileDevice::NoError)
+    {
+        return false;
+    }
+
+    if (sameFile)
+    {
+        source.close();
+        QFile::remove(filename);
+        if (!QFile::rename(target.fileName(), filename))
+        {
+            return false;
+        }
+        frames[frame] = written;
+        invalidate(frame);
+    }
+    return true;
+}
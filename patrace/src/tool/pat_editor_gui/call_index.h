@@ -0,0 +1,107 @@
+#ifndef CALL_INDEX_H
+#define CALL_INDEX_H
+
+#include <QByteArray>
+#include <QCache>
+#include <QList>
+#include <QMetaType>
+#include <QString>
+#include <QVector>
+#include <functional>
+
+class QFile;
+
+// The calls of one extracted Json file. Calls still in the file are stored
+// as their offset in it, changed and added calls as -(n + 1) where n is the
+// index of their text in edits. Both containers are implicitly shared, so a
+// copy is a cheap snapshot.
+struct CallFrame
+{
+    QString filename;
+    QVector<qint64> rows;
+    QList<QByteArray> edits;
+    bool modified = false; // since it was read from the file
+};
+Q_DECLARE_METATYPE(CallFrame)
+
+// Finds the top level objects of a Json file, without parsing them
+class JsonObjectScanner
+{
+public:
+    // Returns true when c closes a top level object
+    inline bool feed(char c)
+    {
+        if (inString)
+        {
+            if (escape) escape = false;
+            else if (c == '\\') escape = true;
+            else if (c == '"') inString = false;
+            return false;
+        }
+        if (c == '"' && depth > 0) inString = true;
+        else if (c == '{') depth++;
+        else if (c == '}' && depth > 0) return --depth == 0;
+        return false;
+    }
+    inline bool opens(char c) const { return c == '{' && depth == 0 && !inString; }
+
+private:
+    int depth = 0;
+    bool inString = false;
+    bool escape = false;
+};
+
+// Index of the calls in the Json files extracted from a trace. Only where
+// each call is kept in memory; its text is read back from the file when it
+// is asked for, together with the calls following it, and kept in a cache
+// of bounded size. This way even huge traces open quickly.
+class CallIndex
+{
+public:
+    static const int PREFETCH = 128;                      // calls read from the file at once
+    static const int CACHE_BYTES = 64 * 1024 * 1024;      // of call text kept in the cache
+    static const int LABEL_CACHE_BYTES = 4 * 1024 * 1024; // of labels kept in the cache
+
+    // A call may hold large arrays, so the caches are bounded by size rather
+    // than by the number of calls
+    CallIndex() : cache(CACHE_BYTES), labels(LABEL_CACHE_BYTES) {}
+
+    // Find the calls in a file; this reads all of it, so better done on a worker thread
+    static bool scan(const QString &filename, CallFrame &frame);
+    // The "(call_no)func_name" text shown for a call
+    static QString label(const QByteArray &call);
+    // Pass on the calls at the given offsets of a file, which must be in
+    // order, in one pass over the file. Stops early if found returns false.
+    // Returns whether all calls were passed on.
+    static bool readCalls(QFile &file, const QVector<qint64> &offsets, const std::function<bool(int, const QByteArray&)> &found);
+
+    void append(const CallFrame &frame) { frames.append(frame); }
+    void clear();
+    const QVector<CallFrame> &snapshot() const { return frames; }
+
+    int frameCount() const { return frames.size(); }
+    int callCount(int frame) const { return frames[frame].rows.size(); }
+    QString fileName(int frame) const { return frames[frame].filename; }
+    bool isModified(int frame) const { return frames[frame].modified; }
+
+    QString call(int frame, int row);
+    QString label(int frame, int row);
+    void setCall(int frame, int row, const QString &text);
+    void insertCall(int frame, int row, const QString &text);
+    void removeCall(int frame, int row);
+    void removeFrame(int frame);
+
+    // Write a frame out as a Json file. When writing over the file it was
+    // read from, it is indexed again.
+    bool write(int frame, const QString &filename);
+
+private:
+    QByteArray read(int frame, int row);
+    void invalidate(int frame);
+
+    QVector<CallFrame> frames;
+    QCache<quint64, QByteArray> cache;
+    QCache<quint64, QString> labels;
+};
+
+#endif // CALL_INDEX_H
@@ -0,0 +1,192 @@
+#include "call_model.h"
+#include <QColor>
+#include <QFileInfo>
+
+CallModel::CallModel(QObject *parent):
+    QAbstractItemModel(parent)
+{}
+
+QModelIndex CallModel::index(int row, int column, const QModelIndex &parent) const
+{
+    if (!hasIndex(row, column, parent))
+    {
+        return QModelIndex();
+    }
+    if (!parent.isValid())
+    {
+        return createIndex(row, column, (quintptr)0);
+    }
+    return createIndex(row, column, (quintptr)parent.row() + 1);
+}
+
+QModelIndex CallModel::parent(const QModelIndex &child) const
+{
+    if (!child.isValid() || isFrame(child))
+    {
+        return QModelIndex();
+    }
+    return createIndex(frameOf(child), 0, (quintptr)0);
+}
+
+int CallModel::rowCount(const QModelIndex &parent) const
+{
+    if (!parent.isValid())
+    {
+        return mCalls.frameCount();
+    }
+    if (isFrame(parent) && parent.column() == 0)
+    {
+        return mCalls.callCount(parent.row());
+    }
+    return 0;
+}
+
+int CallModel::columnCount(const QModelIndex &) const
+{
+    return 1;
+}
+
+bool CallModel::hasChildren(const QModelIndex &parent) const
+{
+    return !parent.isValid() || isFrame(parent);
+}
+
+QVariant CallModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid())
+    {
+        return QVariant();
+    }
+    const int frame = frameOf(index);
+    const int row = isFrame(index) ? -1 : index.row();
+    if (role == Qt::DisplayRole)
+    {
+        if (row == -1)
+        {
+            return QFileInfo(mCalls.fileName(frame)).fileName();
+        }
+        return mCalls.label(frame, row);
+    }
+    else if (role == Qt::BackgroundRole)
+    {
+        if (index == mMarked)
+        {
+            return QColor(0, 255, 0, 60);
+        }
+        if (mMatches.contains(key(frame, row)))
+        {
+            return QColor(0, 0, 255, 31);
+        }
+    }
+    return QVariant();
+}
+
+QModelIndex CallModel::fromKey(quint64 key) const
+{
+    const int frame = (int)(key >> 32);
+    const int row = (int)(quint32)key;
+    if (frame >= mCalls.frameCount())
+    {
+        return QModelIndex();
+    }
+    if (row == -1)
+    {
+        return index(frame, 0);
+    }
+    return index(row, 0, index(frame, 0));
+}
+
+void CallModel::appendFrame(const CallFrame &frame)
+{
+    beginInsertRows(QModelIndex(), mCalls.frameCount(), mCalls.frameCount());
+    mCalls.append(frame);
+    endInsertRows();
+}
+
+void CallModel::clear()
+{
+    beginResetModel();
+    mCalls.clear();
+    mMatches.clear();
+    endResetModel();
+}
+
+void CallModel::setCall(int frame, int row, const QString &text)
+{
+    mCalls.setCall(frame, row, text);
+    const QModelIndex changed = index(row, 0, index(frame, 0));
+    emit dataChanged(changed, changed);
+}
+
+void CallModel::insertCall(int frame, int row, const QString &text)
+{
+    beginInsertRows(index(frame, 0), row, row);
+    mCalls.insertCall(frame, row, text);
+    mMatches.clear(); // rows have moved
+    endInsertRows();
+}
+
+void CallModel::removeCall(int frame, int row)
+{
+    beginRemoveRows(index(frame, 0), row, row);
+    mCalls.removeCall(frame, row);
+    mMatches.clear();
+    endRemoveRows();
+}
+
+void CallModel::removeFrame(int frame)
+{
+    // Calls refer to their frame by number, so indexes into the frames that
+    // follow cannot be moved along
+    beginResetModel();
+    mCalls.removeFrame(frame);
+    mMatches.clear();
+    endResetModel();
+}
+
+void CallModel::setMarked(const QModelIndex &index)
+{
+    const QModelIndex old = mMarked;
+    mMarked = index;
+    if (old.isValid()) emit dataChanged(old, old);
+    if (index.isValid()) emit dataChanged(index, index);
+}
+
+void CallModel::repaint(int frame)
+{
+    // The view only repaints the rows it shows
+    const QModelIndex parent = index(frame, 0);
+    emit dataChanged(parent, parent);
+    if (mCalls.callCount(frame) > 0)
+    {
+        emit dataChanged(index(0, 0, parent), index(mCalls.callCount(frame) - 1, 0, parent));
+    }
+}
+
+void CallModel::setMatches(const QVector<quint64> &matches)
+{
+    mMatches.clear();
+    for (const quint64 match : matches)
+    {
+        mMatches.insert(match);
+    }
+    for (int frame = 0; frame < mCalls.frameCount(); frame++)
+    {
+        repaint(frame);
+    }
+}
+
+void CallModel::addMatches(const QVector<quint64> &matches)
+{
+    int lastFrame = -1;
+    for (const quint64 match : matches)
+    {
+        mMatches.insert(match);
+        const int frame = (int)(match >> 32);
+        if (frame != lastFrame && frame < mCalls.frameCount())
+        {
+            repaint(frame);
+            lastFrame = frame;
+        }
+    }
+}
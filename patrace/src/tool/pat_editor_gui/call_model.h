@@ -0,0 +1,52 @@
+#ifndef CALL_MODEL_H
+#define CALL_MODEL_H
+
+#include <QAbstractItemModel>
+#include <QPersistentModelIndex>
+#include <QSet>
+#include "call_index.h"
+
+// Tree of Json files and the calls in them, for a QTreeView. Calls are only
+// read when the view asks for them, which is for the rows on screen.
+class CallModel : public QAbstractItemModel
+{
+    Q_OBJECT
+
+public:
+    explicit CallModel(QObject *parent = NULL);
+
+    QModelIndex index(int row, int column, const QModelIndex &parent = QModelIndex()) const override;
+    QModelIndex parent(const QModelIndex &child) const override;
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    int columnCount(const QModelIndex &parent = QModelIndex()) const override;
+    bool hasChildren(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+
+    // Json files are the top level items, calls their children
+    static bool isFrame(const QModelIndex &index) { return index.isValid() && index.internalId() == 0; }
+    static int frameOf(const QModelIndex &index) { return isFrame(index) ? index.row() : (int)index.internalId() - 1; }
+    // Search results are identified by frame and row, with row -1 for the frame itself
+    static quint64 key(int frame, int row) { return ((quint64)frame << 32) | (quint32)row; }
+    QModelIndex fromKey(quint64 key) const;
+
+    CallIndex &calls() { return mCalls; }
+    void appendFrame(const CallFrame &frame);
+    void clear();
+    void setCall(int frame, int row, const QString &text);
+    void insertCall(int frame, int row, const QString &text);
+    void removeCall(int frame, int row);
+    void removeFrame(int frame);
+
+    void setMarked(const QModelIndex &index);
+    void setMatches(const QVector<quint64> &matches);
+    void addMatches(const QVector<quint64> &matches);
+
+private:
+    void repaint(int frame);
+
+    mutable CallIndex mCalls; // reading calls updates the cache
+    QPersistentModelIndex mMarked;
+    QSet<quint64> mMatches;
+};
+
+#endif // CALL_MODEL_H
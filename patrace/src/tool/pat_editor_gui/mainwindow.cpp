@@ -1,6 +1,6 @@
 #include "mainwindow.h"
 #include "ui_mainwindow.h"
-#include <vector>
+#include <algorithm>
 
 MainWindow::MainWindow(QWidget *parent) :
     QMainWindow(parent),
@@ -9,7 +9,11 @@ MainWindow::MainWindow(QWidget *parent) :
     ui->setupUi(this);
     ui->statusBar->showMessage("Arm");
     this->setAttribute(Qt::WA_QuitOnClose, true);
+    model = new CallModel(this);
+    ui->treeJsonFile->setModel(model);
+    ui->treeJsonFile->setUniformRowHeights(true); //lets the view skip the rows it does not show
     ui->treeJsonFile->setSelectionMode(QAbstractItemView::ExtendedSelection);
+    connect(ui->treeJsonFile->selectionModel(), &QItemSelectionModel::currentChanged, this, &MainWindow::showCurrentItem);
 
     //add menu
     connect(ui->actionOpen_Pat_File,SIGNAL(triggered()), this, SLOT(openPatFile()));
@@ -111,6 +115,12 @@ MainWindow::~MainWindow()
         o_objThread->quit();
         o_objThread->wait();
     }
+    if (s_objThread)
+    {
+        s_obj->current = -1;
+        s_objThread->quit();
+        s_objThread->wait();
+    }
 }
 
 void MainWindow::showhelp()
@@ -127,6 +137,7 @@ void MainWindow::startOpenThread()
     {
         return;
     }
+    qRegisterMetaType<CallFrame>("CallFrame");
     o_objThread = new QThread();
     o_obj = new OpenJson_Worker();
     o_obj->moveToThread(o_objThread);
@@ -159,6 +170,25 @@ void MainWindow::startPercentThread()
     percentThread->start();
 }
 
+void MainWindow::startSearchThread()
+{
+    if (s_objThread)
+    {
+        return;
+    }
+    qRegisterMetaType<QVector<CallFrame>>("QVector<CallFrame>");
+    qRegisterMetaType<QVector<quint64>>("QVector<quint64>");
+    s_objThread = new QThread();
+    s_obj = new SearchWorker();
+    s_obj->moveToThread(s_objThread);
+    connect(s_objThread, &QThread::finished, s_objThread, &QObject::deleteLater);
+    connect(s_objThread, &QThread::finished, s_obj, &QObject::deleteLater);
+    connect(this, &MainWindow::startSearch, s_obj, &SearchWorker::search);
+    connect(s_obj, &SearchWorker::found, this, &MainWindow::searchFound);
+    connect(s_obj, &SearchWorker::finished, this, &MainWindow::searchFinished);
+    s_objThread->start();
+}
+
 int Qstringcompare(QString arr1, QString arr2)
 {
     QString tmp1, tmp2;
@@ -206,22 +236,19 @@ QStringList Filenames_sort(QStringList filenames)
 
 void MainWindow::openJsonFile()
 {
-    files = QFileDialog::getOpenFileNames(this, tr("Select one or more Json files"), "/home", "Json Files(*.json)");
-    if (files.isEmpty())
+    QStringList selected = QFileDialog::getOpenFileNames(this, tr("Select one or more Json files"), "/home", "Json Files(*.json)");
+    if (selected.isEmpty())
     {
         QMessageBox::warning(this, "Warning", tr("Fail to get a Json file."), QMessageBox::Yes);
         return;
     }
-    files = Filenames_sort(files);
 
     if (JsonOpened == true)
     {
-        ui->treeJsonFile->clear();
-        resave_string.clear();
-        frame_start.clear();
-        frame_end.clear();
-        files.clear();
+        stopSearch();
+        model->clear();
     } //clear the frame window when open a new json file
+    files = Filenames_sort(selected);
 
     if (!o_objThread)
     {
@@ -253,6 +280,13 @@ void MainWindow::openJsonDir()
         QMessageBox::warning(this, "Warning", tr("No Json file in the given directory."), QMessageBox::Yes);
         return;
     }
+    if (JsonOpened == true)
+    {
+        stopSearch();
+        model->clear();
+    } //clear the frame window when open a new json file
+
+    files.clear();
     for (int i = 0; i < filtered_count; i++)
     {
         QFileInfo each_json = filtered_list.at(i);
@@ -260,15 +294,6 @@ void MainWindow::openJsonDir()
     }
     files = Filenames_sort(files);
 
-    if (JsonOpened == true)
-    {
-        ui->treeJsonFile->clear();
-        resave_string.clear();
-        frame_start.clear();
-        frame_end.clear();
-        files.clear();
-    } //clear the frame window when open a new json file
-
     if (!o_objThread)
     {
         startOpenThread();
@@ -278,26 +303,9 @@ void MainWindow::openJsonDir()
     ui->statusBar->showMessage("Start reading Json files......");
 }
 
-void MainWindow::combineJsonContent(const QStringList &result, const int length, const int number)
+void MainWindow::combineJsonContent(const CallFrame &frame, const int number)
 {
-    resave_string.append(result);
-    QTreeWidgetItem *item = new QTreeWidgetItem;    //add father point
-
-    QFileInfo eachjson = QFileInfo(files[number]);
-    QString file_name = eachjson.fileName(); //get file name rather than the path
-
-    item->setText(0, file_name);//update the treewidget
-    ui->treeJsonFile->addTopLevelItem(item);
-    if (number == 0)
-    {
-        frame_start.push_back(0);
-        frame_end.push_back(length - 1);
-    }
-    else
-    {
-        frame_start.push_back(frame_end[number - 1] + 1);
-        frame_end.push_back(frame_end[number - 1] + length);
-    }
+    model->appendFrame(frame); //update the treeview
     int percent = (number + 1) * 100 / files.size();
 
     ui->statusBar->showMessage("Reading Json files......" + QString::number(percent) + "%");
@@ -325,12 +333,10 @@ void MainWindow::openPatFile()
 
     if (JsonOpened == true)
     {
-        ui->treeJsonFile->clear();
-        resave_string.clear();
-        frame_start.clear();
-        frame_end.clear();
-        files.clear();
+        stopSearch();
+        model->clear();
     } //clear the frame window when open a new pat file
+    files.clear();
 
     if (!o_objThread)
     {
@@ -407,28 +413,23 @@ void MainWindow::showTableWidget()
     }
     MainWindow::new_Dialog = new Dialog;
 
-    newitemlocation = ui->treeJsonFile->currentItem();
-    if (newitemlocation == NULL)
+    newitemlocation = ui->treeJsonFile->currentIndex();
+    if (!newitemlocation.isValid())
     {
         QMessageBox::warning(this, "Warning", "Please choose an insert location", QMessageBox::Yes);
         return;
     }
-    int addFrameNum;
-    QTreeWidgetItem *parent = newitemlocation->parent();
-    int addItemNum;
-    if (parent == NULL)
+    int addFrameNum = CallModel::frameOf(newitemlocation);
+    int addItemNum; //row of the new item in its frame
+    if (CallModel::isFrame(newitemlocation))
     {
-        addFrameNum = ui->treeJsonFile->indexOfTopLevelItem(newitemlocation);
-        addItemNum = frame_start[addFrameNum] - 1;
+        addItemNum = 0;
     }
     else {
-        addFrameNum = ui->treeJsonFile->indexOfTopLevelItem(parent);
-        int frame_start_num = frame_start[addFrameNum];
-        int row = parent->indexOfChild(newitemlocation);
-        addItemNum = frame_start_num + row;
+        addItemNum = newitemlocation.row() + 1;
     }
 
-    newitemlocation->setBackground(0, QColor(0, 255, 0, 60));
+    model->setMarked(newitemlocation);
     new_Dialog->setWindowFlags(Qt::WindowStaysOnTopHint);
     new_Dialog->setAttribute(Qt::WA_DeleteOnClose, true);
     new_Dialog->setAttribute(Qt::WA_QuitOnClose, false);
@@ -439,32 +440,21 @@ void MainWindow::showTableWidget()
 
 void MainWindow::saveasJson()
 {
+    waitForSearch();
+    // The calls are streamed from the opened files, so all of them must have been read in
     if (files.size() == 1)   //if only one json file, choose the save location and can change the file name
     {
         QString filename = QFileDialog::getSaveFileName(this, tr("Save File"), "/home", tr("Json Files(*.json)"));
-        if (resave_string.isEmpty())
+        if (filename.isEmpty() || model->calls().frameCount() != files.size())
         {
             QMessageBox::warning(this, "Warning", "Fail to save the Json file.", QMessageBox::Yes);
             return;
         }
-        QByteArray changed_byte_array;
-        changed_byte_array.append("[\xa");
-        for (int i = 0; i < resave_string.size() - 1; i++)
-        {
-            changed_byte_array.append(resave_string[i].toUtf8());
-            changed_byte_array.push_back(",\xa");
-        }
-        changed_byte_array.append(resave_string[resave_string.size() - 1].toUtf8());
-        changed_byte_array.append("\xa]");
-
-        QFile file(filename);
-        if (!file.open(QIODevice::WriteOnly | QIODevice::Text))
+        if (!model->calls().write(0, filename))
         {
             QMessageBox::warning(this, "Warning", "Fail to save the Json file.", QMessageBox::Yes);
             return;
         }
-        file.write(changed_byte_array);
-        file.close();
     }
     else if (files.size() > 1)   //if more than one json files opened, choose a directory and files name will not change
     {
@@ -474,29 +464,21 @@ void MainWindow::saveasJson()
             QMessageBox::warning(this, "Warning", tr("Fail to appoint a Directory."), QMessageBox::Yes);
             return;
         }
+        if (model->calls().frameCount() != files.size())
+        {
+            QMessageBox::warning(this, "Warning", "Fail to save the Json files before all of them are read.", QMessageBox::Yes);
+            return;
+        }
         for (int i = 0; i < files.size(); i++)
         {
-            QByteArray changed_byte_array;
-            changed_byte_array.append("[\xa");
-            for (int j = frame_start[i]; j < frame_end[i]; j++)
-            {
-                changed_byte_array.append(resave_string[j].toUtf8());
-                changed_byte_array.push_back(",\xa");
-            }
-            changed_byte_array.append(resave_string[frame_end[i]].toUtf8());
-            changed_byte_array.append("\xa]");
-
             QFileInfo eachjson = QFileInfo(files[i]);
             QString file_name = eachjson.fileName(); //get file name rather than the path
 
-            QFile file(newJsonDir + "/" + file_name);
-            if (!file.open(QIODevice::WriteOnly | QIODevice::Text))
+            if (!model->calls().write(i, newJsonDir + "/" + file_name))
             {
                 QMessageBox::warning(this, "Warning", "Fail to save the NO."+ QString::number(i + 1) + " Json file.", QMessageBox::Yes);
                 return;
             }
-            file.write(changed_byte_array);
-            file.close();
         }
     }
     else {
@@ -532,32 +514,20 @@ void MainWindow::saveasPat()
             QMessageBox::warning(this, "Warning", "The extracted pat directory missed.", QMessageBox::Yes);
             return;
         }
-        if (resave_string.isEmpty())
+        if (model->calls().frameCount() != files.size())
         {
             QMessageBox::warning(this, "Warning", "Fail to resave the Json file.", QMessageBox::Yes);
             return;
         }
-        // first step: save json
+        waitForSearch();
+        // first step: save json, only the files that were changed
         for (int i = 0; i < files.size(); i++)
         {
-            QByteArray changed_byte_array;
-            changed_byte_array.append("[\xa");
-            for (int j = frame_start[i]; j < frame_end[i]; j++)
-            {
-                changed_byte_array.append(resave_string[j].toUtf8());
-                changed_byte_array.push_back(",\xa");
-            }
-            changed_byte_array.append(resave_string[frame_end[i]].toUtf8());
-            changed_byte_array.append("\xa]");
-
-            QFile file(files[i]);
-            if (!file.open(QIODevice::WriteOnly | QIODevice::Text))
+            if (model->calls().isModified(i) && !model->calls().write(i, files[i]))
             {
                 QMessageBox::warning(this, "Warning", "Fail to save the NO." + QString::number(i + 1) +" Json file.", QMessageBox::Yes);
                 return;
             }
-            file.write(changed_byte_array);
-            file.close();
         }
         // second step: merge to pat
         if (files.size() <= 0)
@@ -614,7 +584,7 @@ void MainWindow::saveasPat()
     }
 }
 
-void MainWindow::on_treeJsonFile_itemSelectionChanged()
+void MainWindow::showCurrentItem()
 {
     disconnect(ui->ItemInformation, SIGNAL(cellChanged(int, int)), this, SLOT(flagChanged(int, int)));
     if (itemchanged == true)
@@ -623,13 +593,10 @@ void MainWindow::on_treeJsonFile_itemSelectionChanged()
         int flag = QMessageBox::warning(this, tr("Warning"), QString("Do you want to save the change?"), QMessageBox::No, QMessageBox::Yes);
         if (flag == QMessageBox::Yes)
         {
-            QTreeWidgetItem *item = changed_item;
-            QTreeWidgetItem *parent = item->parent();
-            if (parent == NULL) return;
-            int num = ui->treeJsonFile->indexOfTopLevelItem(parent);
-            int frame_start_num = frame_start[num];
-            int row=parent->indexOfChild(item);
-            int changedItemNum = frame_start_num + row;
+            QModelIndex item = changed_item;
+            if (!item.isValid() || CallModel::isFrame(item)) return;
+            int num = CallModel::frameOf(item);
+            int changedItemNum = item.row();
             int currentTableRow = 0;
 
             QJsonObject changedItemObject;
@@ -788,49 +755,26 @@ void MainWindow::on_treeJsonFile_itemSelectionChanged()
                     changedItemObject.insert("6 arg_value", changed_argvalue);
                 }
             }
-            resave_string.removeAt(changedItemNum);
             QJsonDocument document(changedItemObject);
             QString changedString = document.toJson(QJsonDocument::Indented);
             changedString.remove(changedString.size() - 1, 1);
-            resave_string.insert(changedItemNum, changedString);
+            model->setCall(num, changedItemNum, changedString);
         }
     }
 
-    QTreeWidgetItem *item = ui->treeJsonFile->currentItem();
-    QTreeWidgetItem *parent = item->parent();
+    QModelIndex item = ui->treeJsonFile->currentIndex();
 
-    if (parent == NULL)
+    if (!item.isValid() || CallModel::isFrame(item))
     {
-        int childrencount = item->childCount();
-        for (int i =0; i< childrencount; i++)
-        {
-            QTreeWidgetItem *child = item->takeChild(0);
-            delete child;
-        }
-        int num = ui->treeJsonFile->indexOfTopLevelItem(item);
-        for (int i = frame_start[num]; i<=frame_end[num]; i++)
-        {
-            QJsonDocument eachFunction = QJsonDocument::fromJson(resave_string[i].toUtf8());
-            QJsonObject eachFunction_obj = eachFunction.object();
-            QJsonValue callno = eachFunction_obj.value(QString("0 call_no"));
-            QString callnum = QString::number(callno.toInt(), 10);
-            QJsonValue functionname = eachFunction_obj.value(QString("2 func_name"));
-            QString functionname_str = functionname.toString();
-            QString abbreviation = "(" + callnum + ")" + functionname_str;
-            QTreeWidgetItem *item1=new QTreeWidgetItem;
-            item1->setText(0, abbreviation);
-            item->addChild(item1);
-        }
+        // the calls of a frame are listed by the model as they are shown
     }
     else{
         ui->ItemInformation->clear();
-        int num =ui->treeJsonFile->indexOfTopLevelItem(parent);
-        int frame_start_num = frame_start[num];
-        int row=parent->indexOfChild(item); //get the row number in father point(start from 0)
-        int currentRowNo = frame_start_num + row;
+        int num = CallModel::frameOf(item);
+        int currentRowNo = item.row(); //get the row number in father point(start from 0)
 
         int currentTableRow = 0;
-        QString selectString = resave_string[currentRowNo];
+        QString selectString = model->calls().call(num, currentRowNo);
         QJsonDocument selectItem = QJsonDocument::fromJson(selectString.toUtf8());
         QJsonObject selectItemObject = selectItem.object();
 
@@ -969,16 +913,34 @@ void MainWindow::on_treeJsonFile_itemSelectionChanged()
     emit itemOpened();
 }
 
-void MainWindow::doSearching()
+void MainWindow::stopSearch()
 {
+    searchId++; // results still coming in for the old search are dropped
+    if (s_obj)
+    {
+        s_obj->current = searchId;
+    }
     if (list.size()>0)
     {
-        for (int i = 0; i<nCount; i++)
-        {
-            list[i]->setBackground(0, QColor(0, 0, 0, 0));
-        }
         list.clear();
+        model->setMatches(list);
     }
+}
+
+// Stop the search, and wait until it has, since it reads the files we are
+// about to write
+void MainWindow::waitForSearch()
+{
+    stopSearch();
+    if (s_obj)
+    {
+        QMutexLocker lock(&s_obj->running);
+    }
+}
+
+void MainWindow::doSearching()
+{
+    stopSearch();
     findnum = 0;
     strTemplate = ui->Filter->text();
     if (strTemplate.isEmpty())
@@ -986,24 +948,66 @@ void MainWindow::doSearching()
         return;
     }
 
-    list = ui->treeJsonFile->findItems(strTemplate, Qt::MatchContains | Qt::MatchRecursive, 0);
+    if (!s_objThread)
+    {
+        startSearchThread();
+    }
+    s_obj->current = searchId;
+    ui->statusBar->showMessage("Searching......");
+    emit startSearch(model->calls().snapshot(), strTemplate, searchId);
+}
 
-    nCount = list.count();
-    if (nCount < 1)
+void MainWindow::searchFound(const QVector<quint64> &matches, int percent, int id)
+{
+    if (id != searchId)
     {
-        QMessageBox::information(this, tr("Results"), tr("No matching"));
         return;
     }
+    const bool first = list.isEmpty();
+    list += matches;
+    model->addMatches(matches);
+    ui->statusBar->showMessage("Searching......" + QString::number(percent) + "%");
+    if (first && list.size() > 0)
+    {
+        findnum = 0;
+        showMatch();
+    }
+}
 
-    for (int i = 0; i<nCount; i++)
+void MainWindow::searchFinished(int id, bool truncated)
+{
+    if (id != searchId)
     {
-        list[i]->setBackground(0, QColor(0, 0, 255, 31));
+        return;
     }
+    if (list.size() < 1)
+    {
+        ui->statusBar->showMessage("Searching finished.");
+        QMessageBox::information(this, tr("Results"), tr("No matching"));
+        return;
+    }
+    QString message = "Searching finished, " + QString::number(list.size()) + " matching.";
+    if (truncated)
+    {
+        message += " Only the first " + QString::number(SearchWorker::MAX_MATCHES) + " are shown.";
+    }
+    ui->statusBar->showMessage(message);
+}
 
-    ui->treeJsonFile->setCurrentItem(list[findnum]);
-    ui->treeJsonFile->scrollToItem(list[findnum]);
+void MainWindow::showMatch()
+{
+    QModelIndex index = model->fromKey(list[findnum]);
+    if (!index.isValid())
+    {
+        return;
+    }
+    if (index.parent().isValid())
+    {
+        ui->treeJsonFile->expand(index.parent());
+    }
+    ui->treeJsonFile->setCurrentIndex(index);
+    ui->treeJsonFile->scrollTo(index);
     ui->treeJsonFile->setFocus();
-
 }
 
 void MainWindow::on_FindNext_clicked()
@@ -1013,16 +1017,14 @@ void MainWindow::on_FindNext_clicked()
         QMessageBox::information(this, tr("Results"), tr("Keywords changed"));
         return;
     }
-    else{
-        if (findnum == nCount - 1){
+    else if (list.size() > 0) {
+        if (findnum >= list.size() - 1){
             findnum = 0;
         }
         else{
             ++findnum;
         }
-        ui->treeJsonFile->setCurrentItem(list[findnum]);
-        ui->treeJsonFile->scrollToItem(list[findnum]);
-        ui->treeJsonFile->setFocus();
+        showMatch();
     }
 }
 
@@ -1033,16 +1035,14 @@ void MainWindow::on_FindPrevious_clicked()
         QMessageBox::information(this, tr("Results"), tr("Keywords changed"));
         return;
     }
-    else {
-        if (findnum == 0) {
-            findnum = nCount - 1;
+    else if (list.size() > 0) {
+        if (findnum <= 0 || findnum > list.size() - 1) {
+            findnum = list.size() - 1;
         }
         else {
             --findnum;
         }
-        ui->treeJsonFile->setCurrentItem(list[findnum]);
-        ui->treeJsonFile->scrollToItem(list[findnum]);
-        ui->treeJsonFile->setFocus();
+        showMatch();
     }
 }
 
@@ -1054,13 +1054,10 @@ void MainWindow::on_actionSetChange_clicked()
         return;
     }
     itemchanged = false;
-    QTreeWidgetItem *item = ui->treeJsonFile->currentItem();
-    QTreeWidgetItem *parent = item->parent();
-    if (parent == NULL) return;
-    int num = ui->treeJsonFile->indexOfTopLevelItem(parent);
-    int frame_start_num = frame_start[num];
-    int row=parent->indexOfChild(item);
-    int changedItemNum = frame_start_num + row;
+    QModelIndex item = ui->treeJsonFile->currentIndex();
+    if (!item.isValid() || CallModel::isFrame(item)) return;
+    int num = CallModel::frameOf(item);
+    int changedItemNum = item.row();
     int currentTableRow = 0;
 
     QJsonObject changedItemObject;
@@ -1216,42 +1213,27 @@ void MainWindow::on_actionSetChange_clicked()
             changedItemObject.insert("6 arg_value", changed_argvalue);
         }
     }
-    resave_string.removeAt(changedItemNum);
     QJsonDocument document(changedItemObject);
     QString changedString = document.toJson(QJsonDocument::Indented);
     changedString.remove(changedString.size() - 1, 1);
-    resave_string.insert(changedItemNum, changedString);
-    ui->treeJsonFile->clearSelection();
-    ui->treeJsonFile->setCurrentItem(item, 0);
+    model->setCall(num, changedItemNum, changedString);
+    showCurrentItem(); //show the call as it was saved
 }
 
-void MainWindow::showtheChange(int framenum, int callnum, QJsonObject addItemObject, QString addText)
+void MainWindow::showtheChange(int framenum, int callnum, QJsonObject addItemObject, QString)
 {
-    newitemlocation->setBackground(0, QColor(0, 0, 0, 0));
-    frame_end[framenum] = frame_end[framenum] + 1;
-    for (int i = framenum + 1; i < int(frame_end.size()); i++)
-    {
-        frame_start[i] = frame_start[i] + 1;
-        frame_end[i] = frame_end[i] + 1;
-    }
+    model->setMarked(QModelIndex());
 
     QJsonDocument document(addItemObject);
     QString addString = document.toJson(QJsonDocument::Indented);
     addString.remove(addString.size() - 1, 1);
-    resave_string.insert(callnum, addString);
+    stopSearch(); //the results are numbered by row
+    model->insertCall(framenum, callnum, addString);
 
-    QTreeWidgetItem *item1=new QTreeWidgetItem;
-    item1->setText(0, addText);
-    if (newitemlocation->parent()==NULL)
-    {
-        newitemlocation->insertChild(0, item1);
-    }
-    else {
-        newitemlocation->parent()->insertChild(callnum - frame_start[framenum] + 1, item1);
-    }
+    QModelIndex item1 = model->index(callnum, 0, model->index(framenum, 0));
     ui->treeJsonFile->clearSelection();
-    ui->treeJsonFile->setCurrentItem(item1);
-    ui->treeJsonFile->scrollToItem(item1);
+    ui->treeJsonFile->setCurrentIndex(item1);
+    ui->treeJsonFile->scrollTo(item1);
     new_Dialog->close();    //close the subwindow
 }
 
@@ -1262,13 +1244,10 @@ void MainWindow::on_actionAdd_clicked()
         QMessageBox::warning(this, "Warning", "No Opened Json", QMessageBox::Yes);
         return;
     }
-    QTreeWidgetItem *item = ui->treeJsonFile->currentItem();
-    QTreeWidgetItem *parent = item->parent();
-    if (parent == NULL) return;
-    int num = ui->treeJsonFile->indexOfTopLevelItem(parent);
-    int frame_start_num = frame_start[num];
-    int row=parent->indexOfChild(item);
-    int addItemNum = frame_start_num + row;
+    QModelIndex item = ui->treeJsonFile->currentIndex();
+    if (!item.isValid() || CallModel::isFrame(item)) return;
+    int num = CallModel::frameOf(item);
+    int addItemNum = item.row() + 1; //added after the current call
 
     QJsonObject addItemObject;
     int currentTableRow = 0;
@@ -1428,22 +1407,12 @@ void MainWindow::on_actionAdd_clicked()
     QJsonDocument document(addItemObject);
     QString addString = document.toJson(QJsonDocument::Indented);
     addString.remove(addString.size() - 1, 1);
-    resave_string.insert(addItemNum, addString);
-
-    QTreeWidgetItem *addItem=new QTreeWidgetItem;
-    QString addText = "(" + str0 + ")" + str2;
-    addItem->setText(0, addText);
-    parent->insertChild(row + 1, addItem);
-
-    frame_end[num] = frame_end[num] + 1;
-    for (int i=num + 1; i<int(frame_end.size()); i++)
-    {
-        frame_start[i] = frame_start[i] + 1;
-        frame_end[i] = frame_end[i] + 1;
-    }
+    stopSearch(); //the results are numbered by row
+    model->insertCall(num, addItemNum, addString);
 
+    QModelIndex addItem = model->index(addItemNum, 0, model->index(num, 0));
     ui->treeJsonFile->clearSelection();
-    ui->treeJsonFile->setCurrentItem(addItem);
+    ui->treeJsonFile->setCurrentIndex(addItem);
 }
 
 void MainWindow::on_actionDelete_clicked()
@@ -1453,72 +1422,48 @@ void MainWindow::on_actionDelete_clicked()
         QMessageBox::warning(this, "Warning", "No Opened Json", QMessageBox::Yes);
         return;
     }
-    QList<QTreeWidgetItem*> selectedItemList = ui->treeJsonFile->selectedItems();
+    QModelIndexList selectedItemList = ui->treeJsonFile->selectionModel()->selectedIndexes();
     if (selectedItemList.size() < 1) return;
 
-    for (int index =0; index<selectedItemList.size(); index++)
+    // Calls first, their rows are kept up to date by the persistent indexes;
+    // then frames from the last one, as removing a frame renumbers the ones after it
+    QList<QPersistentModelIndex> calls;
+    QList<int> frames;
+    for (const QModelIndex &item : selectedItemList)
     {
-        QTreeWidgetItem *item = selectedItemList[index];
-        QTreeWidgetItem *parent = item->parent();
-        int row;
+        if (CallModel::isFrame(item)) frames.append(item.row());
+        else calls.append(item);
+    }
+    std::sort(frames.begin(), frames.end());
+    QPersistentModelIndex lastParent = selectedItemList.last().parent();
 
-        if (parent == NULL)
+    stopSearch(); //the results are numbered by row
+    for (const QPersistentModelIndex &item : calls)
+    {
+        model->removeCall(CallModel::frameOf(item), item.row());
+    }
+    for (int index = frames.size() - 1; index >= 0; index--)
+    {
+        int flag = QMessageBox::warning(this, tr("Warning"), QString("This operation will delete the Json file"), QMessageBox::Yes, QMessageBox::No);
+        if (flag == QMessageBox::Yes)
         {
-            int flag = QMessageBox::warning(this, tr("Warning"), QString("This operation will delete the Json file"), QMessageBox::Yes, QMessageBox::No);
-            if (flag == QMessageBox::Yes)
-            {
-                int FrameNum = ui->treeJsonFile->indexOfTopLevelItem(item);
-                int frame_start_num = frame_start[FrameNum];
-                int frame_end_num = frame_end[FrameNum];
-
-                for (int i = frame_start_num; i <= frame_end_num; i++)
-                {
-                  delete item->takeChild(0); //delete son point from father point
-                  resave_string.removeAt(frame_start_num - 1);
-                }
-
-                std::vector<int>::iterator i1 = frame_start.begin();
-                std::vector<int>::iterator i2 = frame_end.begin();
-                frame_start.erase(i1 + FrameNum);
-                frame_end.erase(i2 + FrameNum);
-                for (int j=FrameNum; j<int(frame_end.size()); j++)
-                {
-                    frame_start[j] = frame_start[j] - frame_end_num + frame_start_num - 1;
-                    frame_end[j] = frame_end[j] - frame_end_num + frame_start_num - 1;
-                }
-
-                delete ui->treeJsonFile->takeTopLevelItem(FrameNum); //delete father point
-                //delete item;
-                QFile::remove(files[FrameNum]);
-                files.removeAt(FrameNum);
-            }
-            else {return;}
-        }
-        else{
-            int FrameNum = ui->treeJsonFile->indexOfTopLevelItem(parent);
-            int frame_start_num = frame_start[FrameNum];
-            row = parent->indexOfChild(item);
-            int deleteItemNum = frame_start_num + row;
-            resave_string.removeAt(deleteItemNum);
-            delete parent->takeChild(row);
-            frame_end[FrameNum] = frame_end[FrameNum] - 1;
-            for (int i = FrameNum + 1; i < int(frame_end.size()); i++)
-            {
-                frame_start[i] = frame_start[i] - 1;
-                frame_end[i] = frame_end[i] - 1;
-            }
+            int FrameNum = frames[index];
+            model->removeFrame(FrameNum);
+            QFile::remove(files[FrameNum]);
+            files.removeAt(FrameNum);
         }
+        else {return;}
     }
     ui->treeJsonFile->clearSelection();
-    if (selectedItemList[selectedItemList.size() - 1]->parent() != NULL)
+    if (lastParent.isValid())
     {
-        ui->treeJsonFile->setCurrentItem(selectedItemList[selectedItemList.size() - 1]->parent());
+        ui->treeJsonFile->setCurrentIndex(lastParent);
     }
 }
 
 void MainWindow::record_itemChange()
 {
-    changed_item = ui->treeJsonFile->currentItem();
+    changed_item = ui->treeJsonFile->currentIndex();
     connect(ui->ItemInformation, SIGNAL(cellChanged(int, int)), this, SLOT(flagChanged(int, int)));
 }
 
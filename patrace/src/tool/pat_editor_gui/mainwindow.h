@@ -11,7 +11,7 @@
 #include <QJsonArray>
 #include <QJsonObject>
 #include <QJsonDocument>
-#include <QTreeWidget>
+#include <QTreeView>
 #include <QTableWidget>
 #include <QTextBlock>
 #include <QWidget>
@@ -25,6 +25,8 @@
 #include <QObject>
 #include "open_thread.h"
 #include "percentage_thread.h"
+#include "search_thread.h"
+#include "call_model.h"
 
 namespace Ui {
     class MainWindow;
@@ -39,16 +41,18 @@ public:
     ~MainWindow();
 
 private slots:
-    void combineJsonContent(const QStringList &result, const int length, const int number);
+    void combineJsonContent(const CallFrame &frame, const int number);
     void openJsonFile();
     void openPatFile();
     void openJsonDir();
     void readPatContent();
     void saveasJson();
     void saveasPat();
-    void on_treeJsonFile_itemSelectionChanged();
+    void showCurrentItem();
     void showTableWidget();
     void doSearching();
+    void searchFound(const QVector<quint64> &matches, int percent, int id);
+    void searchFinished(int id, bool truncated);
     void on_FindNext_clicked();
     void on_FindPrevious_clicked();
     void on_actionSetChange_clicked();
@@ -67,9 +71,14 @@ signals:
     void GUIupdate();
     void GUIupdate_saving();
     void itemOpened();
+    void startSearch(const QVector<CallFrame> &frames, const QString &text, int id);
 private:
     void startOpenThread();
     void startPercentThread();
+    void startSearchThread();
+    void stopSearch();
+    void waitForSearch();
+    void showMatch();
 private:
     Ui::MainWindow *ui;
     Dialog *new_Dialog;
@@ -80,9 +89,10 @@ private:
     PercentageThread *percentObj = NULL;
     QThread *percentThread = NULL;
 
-    QStringList resave_string;//save all json content
-    std::vector<int> frame_start;//save the start location of each json file
-    std::vector<int> frame_end;//save the end location of each json file
+    SearchWorker *s_obj = NULL;
+    QThread *s_objThread = NULL;
+
+    CallModel *model;//all json content, read as it is shown
 
     QStringList files;// all selected json name
     QString OriginalDir;// location of the extracted pat
@@ -90,13 +100,13 @@ private:
     bool PatOpened = false;
 
     QString strTemplate;
-    QList<QTreeWidgetItem *> list;
+    QVector<quint64> list;//search results so far
     int findnum;
-    int nCount;
+    int searchId = 0;
 
-    QTreeWidgetItem *newitemlocation;
+    QPersistentModelIndex newitemlocation;
     bool itemchanged = false;
-    QTreeWidgetItem *changed_item;
+    QPersistentModelIndex changed_item;
 };
 
 #endif // MAINWINDOW_H
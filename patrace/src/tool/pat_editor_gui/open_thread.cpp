@@ -1,7 +1,6 @@
 #include "open_thread.h"
 #include <QThread>
 #include <QStringList>
-#include <fstream>
 #include <string>
 
 bool Pat_reading = false;
@@ -19,42 +18,12 @@ OpenJson_Worker::~OpenJson_Worker()
 
 void OpenJson_Worker::openJson(const QStringList &filenames)
 {
+    // Only find where the calls are; they are read when shown
     for (int i = 0; i < filenames.size(); i++)
     {
-        QString filename = filenames[i];
-        std::ifstream fin(filename.toStdString().c_str());
-        char c;
-        QStringList result;
-        std::string s;
-        bool started = false;
-        int current_bracket_stack = 0;
-
-        while (fin.get(c))
-        {
-             if (c == '{')
-             {
-                 started = true;
-                 ++current_bracket_stack;
-             }
-             if (started == true)
-             {
-                 s.push_back(c);
-                 if (c == '}')
-                 {
-                    --current_bracket_stack;
-                    if (current_bracket_stack == 0)
-                    {
-                        started = false;
-                        QString stdtoQstring = QString::fromStdString(s);
-                        s.clear();
-                        result.append(stdtoQstring);
-                    }
-                }
-            }
-        }
-        fin.close();
-        int length = result.size();
-        emit resultReady(result, length, i);
+        CallFrame frame;
+        CallIndex::scan(filenames[i], frame);
+        emit resultReady(frame, i);
     }
 }
 
@@ -10,6 +10,7 @@
 #include "common/os_time.hpp"
 #include "eglstate/common.hpp"
 #include "tool/pat_editor/commonData.hpp"
+#include "call_index.h"
 
 extern bool Pat_reading;
 extern bool Pat_saving;
@@ -22,7 +23,7 @@ public:
     ~OpenJson_Worker();
 
 signals:
-    void resultReady(const QStringList &result, int length, int number);
+    void resultReady(const CallFrame &frame, int number);
     void extractFinish();
     void startShowingPercentage();
 
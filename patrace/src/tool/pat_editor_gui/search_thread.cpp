@@ -0,0 +1,74 @@
+#include "search_thread.h"
+#include "call_model.h"
+#include <QFile>
+#include <QFileInfo>
+#include <algorithm>
+
+SearchWorker::SearchWorker(QObject *parent):
+    QObject(parent), current(0)
+{}
+
+SearchWorker::~SearchWorker()
+{}
+
+void SearchWorker::search(const QVector<CallFrame> &frames, const QString &text, int id)
+{
+    QMutexLocker lock(&running);
+    int total = 0;
+    for (int frame = 0; frame < frames.size() && current == id; frame++)
+    {
+        const CallFrame &f = frames[frame];
+        QVector<quint64> matches;
+        QVector<qint64> offsets;
+        QVector<int> rows;
+        for (int row = 0; row < f.rows.size(); row++)
+        {
+            if (row % CHECK_INTERVAL == 0 && current != id)
+            {
+                return;
+            }
+            if (f.rows[row] >= 0)
+            {
+                offsets.append(f.rows[row]);
+                rows.append(row);
+            }
+            else if (CallIndex::label(f.edits[-f.rows[row] - 1]).contains(text, Qt::CaseInsensitive))
+            {
+                matches.append(CallModel::key(frame, row));
+            }
+        }
+        QFile file(f.filename);
+        if (!offsets.isEmpty() && file.open(QIODevice::ReadOnly))
+        {
+            // A frame file can be huge, so do not wait for its end to stop
+            CallIndex::readCalls(file, offsets, [&](int i, const QByteArray &call)
+            {
+                if (CallIndex::label(call).contains(text, Qt::CaseInsensitive))
+                {
+                    matches.append(CallModel::key(frame, rows[i]));
+                }
+                return i % CHECK_INTERVAL != 0 || current == id;
+            });
+            if (current != id)
+            {
+                return;
+            }
+        }
+        std::sort(matches.begin(), matches.end()); // edits come first
+        if (QFileInfo(f.filename).fileName().contains(text, Qt::CaseInsensitive))
+        {
+            matches.prepend(CallModel::key(frame, -1));
+        }
+
+        if (total + matches.size() > MAX_MATCHES)
+        {
+            matches.resize(MAX_MATCHES - total);
+            emit found(matches, 100, id);
+            emit finished(id, true);
+            return;
+        }
+        total += matches.size();
+        emit found(matches, (frame + 1) * 100 / frames.size(), id);
+    }
+    emit finished(id, false);
+}
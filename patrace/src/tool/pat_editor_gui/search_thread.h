@@ -0,0 +1,39 @@
+#ifndef SEARCH_THREAD_H
+#define SEARCH_THREAD_H
+
+#include <QString>
+#include <QObject>
+#include <QMutex>
+#include <QVector>
+#include <atomic>
+#include "call_index.h"
+
+// Searches the labels of all calls on its own thread, reading each Json file
+// once from start to end, so that the editor stays responsive on huge traces
+class SearchWorker : public QObject
+{
+    Q_OBJECT
+
+public:
+    static const int MAX_MATCHES = 100000;
+    static const int CHECK_INTERVAL = 1024; // calls between checks whether to stop
+
+    SearchWorker(QObject* parent = NULL);
+    ~SearchWorker();
+
+    // The search that should be running; any other one stops as soon as it notices
+    std::atomic<int> current;
+
+    // Held while a search runs, so that the files it reads are not written
+    // before it has noticed that it should stop
+    QMutex running;
+
+public slots:
+    void search(const QVector<CallFrame> &frames, const QString &text, int id);
+
+signals:
+    void found(const QVector<quint64> &matches, int percent, int id);
+    void finished(int id, bool truncated);
+};
+
+#endif // SEARCH_THREAD_H
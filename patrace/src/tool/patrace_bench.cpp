@@ -0,0 +1,549 @@
+// Benchmarks for the core trace libraries. A synthetic trace is written
+// with OutFile and then read back with InFile and parsed into CallTM, and
+// the in-memory structures the retracer and the tools depend on (handle
+// maps, MD5 digests, client-side buffer sets) are timed on their own.
+// Results can be written as JSON so that they can be compared across
+// versions.
+
+#include <common/in_file_mt.hpp>
+#include <common/out_file.hpp>
+#include <common/trace_model.hpp>
+#include <common/parse_api.hpp>
+#include <common/memory.hpp>
+#include <common/os.hpp>
+#include <retracer/value_map.hpp>
+#include "tool/config.hpp"
+#include "image/image.hpp"
+#include "image/image_compression.hpp"
+
+#include <snappy.h>
+#include "json/writer.h"
+
+#include <GLES3/gl32.h>
+#include <GLES2/gl2ext.h>
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace {
+
+struct Result
+{
+    std::string name;
+    double value;
+    std::string unit;
+};
+
+std::vector<Result> gResults;
+std::string gOnly;
+// Keeps the compiler from optimising away the work being timed
+volatile uint64_t gSink = 0;
+
+bool selected(const char *group)
+{
+    return gOnly.empty() || gOnly == group;
+}
+
+void report(const std::string &name, double value, const char *unit)
+{
+    printf("%-36s %14.2f %s\n", name.c_str(), value, unit);
+    gResults.push_back({ name, value, unit });
+}
+
+double seconds(int64_t t0)
+{
+    return std::max(1e-9, (double)(os::getTime() - t0) / os::timeFrequency);
+}
+
+double mb(uint64_t bytes)
+{
+    return (double)bytes / (1024.0 * 1024.0);
+}
+
+void fill(std::vector<char> &data, unsigned seed)
+{
+    for (size_t i = 0; i < data.size(); ++i)
+    {
+        seed = seed * 1103515245u + 12345u;
+        data[i] = (char)(seed >> 16);
+    }
+}
+
+/// A frame worth of typical calls: state changes, uniform updates, buffer
+/// uploads and draws, ending with a swap
+std::vector<char> makeFrame(unsigned drawsPerFrame, unsigned uploadSize)
+{
+    std::vector<char> frame;
+    std::vector<char> buffer(uploadSize + 1024);
+    std::vector<char> upload(uploadSize);
+    fill(upload, 1);
+
+    const auto append = [&](common::CallTM &call)
+    {
+        call.mTid = 0;
+        char *dest = call.Serialize(buffer.data(), -1, false);
+        frame.insert(frame.end(), buffer.data(), dest);
+    };
+
+    for (unsigned i = 0; i < drawsPerFrame; ++i)
+    {
+        common::CallTM bindTexture("glBindTexture");
+        bindTexture.mArgs.push_back(new common::ValueTM(GL_TEXTURE_2D));
+        bindTexture.mArgs.push_back(new common::ValueTM(1 + i % 16));
+        append(bindTexture);
+
+        common::CallTM uniform("glUniform1i");
+        uniform.mArgs.push_back(new common::ValueTM(i % 8));
+        uniform.mArgs.push_back(new common::ValueTM(i));
+        append(uniform);
+
+        if (i % 4 == 0)
+        {
+            common::CallTM subData("glBufferSubData");
+            subData.mArgs.push_back(new common::ValueTM(GL_ARRAY_BUFFER));
+            subData.mArgs.push_back(new common::ValueTM(0));
+            subData.mArgs.push_back(new common::ValueTM(uploadSize));
+            subData.mArgs.push_back(new common::ValueTM(upload.data(), uploadSize));
+            append(subData);
+        }
+
+        common::CallTM draw("glDrawArrays");
+        draw.mArgs.push_back(new common::ValueTM(GL_TRIANGLES));
+        draw.mArgs.push_back(new common::ValueTM(0));
+        draw.mArgs.push_back(new common::ValueTM(3 * (i + 1)));
+        append(draw);
+    }
+
+    common::CallTM swap("eglSwapBuffers");
+    swap.mArgs.push_back(new common::ValueTM(1));
+    swap.mArgs.push_back(new common::ValueTM(1));
+    swap.mRet = common::ValueTM(1);
+    append(swap);
+
+    return frame;
+}
+
+/// Write the synthetic trace; returns the number of uncompressed bytes
+uint64_t benchWrite(const std::string &filename, unsigned frames, unsigned drawsPerFrame, unsigned uploadSize, uint64_t &calls)
+{
+    const std::vector<char> frame = makeFrame(drawsPerFrame, uploadSize);
+    const unsigned callsPerFrame = drawsPerFrame * 3 + (drawsPerFrame + 3) / 4 + 1;
+
+    common::OutFile out;
+    if (!out.Open(filename.c_str()))
+    {
+        DBG_LOG("Failed to open %s for writing\n", filename.c_str());
+        exit(1);
+    }
+
+    const int64_t t0 = os::getTime();
+    for (unsigned i = 0; i < frames; ++i)
+    {
+        out.Write(frame.data(), frame.size());
+    }
+    out.Flush();
+    const double elapsed = seconds(t0);
+
+    calls = (uint64_t)frames * callsPerFrame;
+    const uint64_t bytes = (uint64_t)frames * frame.size();
+
+    Json::Value thread;
+    thread["id"] = 0;
+    thread["winW"] = 1920;
+    thread["winH"] = 1080;
+    thread["EGLConfig"]["red"] = 8;
+    thread["EGLConfig"]["green"] = 8;
+    thread["EGLConfig"]["blue"] = 8;
+    thread["EGLConfig"]["alpha"] = 8;
+    thread["EGLConfig"]["depth"] = 24;
+    thread["EGLConfig"]["stencil"] = 8;
+    thread["EGLConfig"]["msaaSamples"] = 0;
+    Json::Value header;
+    header["defaultTid"] = 0;
+    header["glesVersion"] = 3;
+    header["callCnt"] = (Json::UInt64)calls;
+    header["frameCnt"] = frames;
+    header["threads"].append(thread);
+    Json::FastWriter writer;
+    const std::string json = writer.write(header);
+    out.mHeader.jsonLength = json.size();
+    out.WriteHeader(json.c_str(), json.size(), false);
+    out.Close();
+
+    if (selected("write"))
+    {
+        report("outfile_write_calls", calls / elapsed, "calls/s");
+        report("outfile_write_compress", mb(bytes) / elapsed, "MB/s");
+    }
+    return bytes;
+}
+
+void benchRead(const std::string &filename, const std::string &prefix, uint64_t bytes)
+{
+    common::InFile in;
+    if (!in.Open(filename.c_str()))
+    {
+        exit(1);
+    }
+
+    void *fptr = nullptr;
+    common::BCall_vlen call;
+    char *src = nullptr;
+    uint64_t calls = 0;
+    const int64_t t0 = os::getTime();
+    while (in.GetNextCall(fptr, call, src))
+    {
+        gSink += call.funcId;
+        ++calls;
+    }
+    const double elapsed = seconds(t0);
+    in.Close();
+
+    report(prefix + "infile_next_call", calls / elapsed, "calls/s");
+    if (bytes)
+    {
+        report(prefix + "infile_decompress", mb(bytes) / elapsed, "MB/s");
+    }
+}
+
+void benchParse(const std::string &filename, const std::string &prefix)
+{
+    common::InFile in;
+    if (!in.Open(filename.c_str()))
+    {
+        exit(1);
+    }
+
+    void *fptr = nullptr;
+    common::BCall_vlen call;
+    char *src = nullptr;
+    unsigned callNo = 0;
+    const int64_t t0 = os::getTime();
+    while (in.GetNextCall(fptr, call, src))
+    {
+        common::CallTM parsed(in, callNo++, call);
+        gSink += parsed.mArgs.size();
+    }
+    const double elapsed = seconds(t0);
+    in.Close();
+
+    report(prefix + "calltm_parse", callNo / elapsed, "calls/s");
+}
+
+void benchSnappy(unsigned uploadSize)
+{
+    // The same frame layout the synthetic trace uses, in chunk-sized pieces
+    const std::vector<char> frame = makeFrame(64, uploadSize);
+    std::vector<char> chunk;
+    while (chunk.size() < 4 * 1024 * 1024)
+    {
+        chunk.insert(chunk.end(), frame.begin(), frame.end());
+    }
+    std::vector<char> compressed(snappy::MaxCompressedLength(chunk.size()));
+    std::vector<char> uncompressed(chunk.size());
+    const unsigned rounds = 16;
+
+    size_t compressedLen = 0;
+    int64_t t0 = os::getTime();
+    for (unsigned i = 0; i < rounds; ++i)
+    {
+        snappy::RawCompress(chunk.data(), chunk.size(), compressed.data(), &compressedLen);
+    }
+    report("snappy_compress", mb((uint64_t)rounds * chunk.size()) / seconds(t0), "MB/s");
+
+    t0 = os::getTime();
+    for (unsigned i = 0; i < rounds; ++i)
+    {
+        snappy::RawUncompress(compressed.data(), compressedLen, uncompressed.data());
+    }
+    report("snappy_uncompress", mb((uint64_t)rounds * chunk.size()) / seconds(t0), "MB/s");
+    report("snappy_ratio", (double)chunk.size() / compressedLen, "x");
+}
+
+void benchHmap(unsigned handles)
+{
+    const unsigned rounds = 16;
+    // Small keys live in the flat array, large ones in the hash map
+    for (unsigned base : { 1u, 1000000u })
+    {
+        const char *kind = base == 1 ? "small" : "large";
+        retracer::hmap<unsigned int> map;
+
+        int64_t t0 = os::getTime();
+        for (unsigned i = 0; i < handles; ++i)
+        {
+            map.LValue(base + i) = i + 1;
+        }
+        report(std::string("hmap_insert_") + kind, seconds(t0) * 1e9 / handles, "ns/op");
+
+        t0 = os::getTime();
+        uint64_t sum = 0;
+        for (unsigned r = 0; r < rounds; ++r)
+        {
+            for (unsigned i = 0; i < handles; ++i)
+            {
+                sum += map.RValue(base + (i * 7919u) % handles);
+            }
+        }
+        gSink += sum;
+        report(std::string("hmap_lookup_") + kind, seconds(t0) * 1e9 / ((uint64_t)rounds * handles), "ns/op");
+    }
+}
+
+void benchMd5()
+{
+    for (unsigned size : { 256u, 64u * 1024u, 4u * 1024u * 1024u })
+    {
+        std::vector<char> data(size);
+        fill(data, size);
+        const unsigned rounds = std::max(4u, (64u * 1024u * 1024u) / size);
+
+        const int64_t t0 = os::getTime();
+        for (unsigned i = 0; i < rounds; ++i)
+        {
+            data[0] = (char)i;
+            common::MD5Digest digest(data.data(), size);
+            gSink += digest.data()[0];
+        }
+        report("md5_" + std::to_string(size), mb((uint64_t)rounds * size) / seconds(t0), "MB/s");
+    }
+}
+
+void benchClientSideBuffers()
+{
+    const unsigned size = 256;
+    for (unsigned objects : { 100u, 1000u, 10000u })
+    {
+        common::ClientSideBufferObjectSet set;
+        std::vector<char> data(size);
+        for (unsigned i = 0; i < objects; ++i)
+        {
+            fill(data, i + 1);
+            const common::ClientSideBufferObjectName name = set.create_object(0);
+            set.object_data(0, name, size, data.data(), true);
+        }
+
+        // A miss has to look at every object, which is what happens for
+        // each new client-side upload
+        fill(data, objects + 1);
+        const common::ClientSideBufferObject probe(data.data(), size);
+        const unsigned rounds = std::max(16u, 1000000u / objects);
+        common::ClientSideBufferObjectName found = 0;
+
+        const int64_t t0 = os::getTime();
+        for (unsigned i = 0; i < rounds; ++i)
+        {
+            gSink += set.find(0, probe, found);
+        }
+        report("csb_find_miss_" + std::to_string(objects), seconds(t0) * 1e9 / rounds, "ns/op");
+    }
+}
+
+/// Texture decompression of a large atlas, with one thread and with all of
+/// them, and of a full mipmap chain at once
+void benchTextureDecode()
+{
+    const unsigned size = 2048;
+    const struct { const char *name; GLenum format; unsigned blockSize; } formats[] = {
+        { "etc1", GL_ETC1_RGB8_OES, 8 },
+        { "etc2_rgb8", GL_COMPRESSED_RGB8_ETC2, 8 },
+        { "etc2_rgba8", GL_COMPRESSED_RGBA8_ETC2_EAC, 16 },
+    };
+
+    for (const auto &f : formats)
+    {
+        std::vector<char> data((size / 4) * (size / 4) * f.blockSize);
+        fill(data, f.format);
+        pat::Image input(size, size, f.format, GL_NONE, data.size(), (UInt8 *)data.data(), false, false);
+
+        for (unsigned threads : { 1u, 0u })
+        {
+            pat::SetUncompressionThreadCount(threads);
+            pat::Image output;
+            const int64_t t0 = os::getTime();
+            pat::Uncompress(input, output);
+            gSink += output.Data()[0];
+            report(std::string("decode_") + f.name + (threads ? "_1t" : "_mt"), (double)size * size / 1e6 / seconds(t0), "MP/s");
+        }
+
+        std::vector<std::unique_ptr<pat::Image>> levels, outputs;
+        std::vector<const pat::Image *> in;
+        std::vector<pat::Image *> out;
+        for (unsigned dim = size; dim > 0; dim /= 2)
+        {
+            const unsigned bytes = ((dim + 3) / 4) * ((dim + 3) / 4) * f.blockSize;
+            levels.emplace_back(new pat::Image(dim, dim, f.format, GL_NONE, bytes, (UInt8 *)data.data(), false, false));
+            outputs.emplace_back(new pat::Image());
+            in.push_back(levels.back().get());
+            out.push_back(outputs.back().get());
+        }
+        const int64_t t0 = os::getTime();
+        pat::UncompressLevels(in, out);
+        gSink += outputs[0]->Data()[0];
+        report(std::string("decode_") + f.name + "_mipchain", (double)size * size * 4 / 3 / 1e6 / seconds(t0), "MP/s");
+    }
+    pat::SetUncompressionThreadCount(0);
+}
+
+void writeResults(const std::string &filename)
+{
+    Json::Value root;
+    root["patrace_version"] = PATRACE_VERSION;
+    root["benchmarks"] = Json::arrayValue;
+    for (const Result &r : gResults)
+    {
+        Json::Value v;
+        v["name"] = r.name;
+        v["value"] = r.value;
+        v["unit"] = r.unit;
+        root["benchmarks"].append(v);
+    }
+
+    Json::StreamWriterBuilder builder;
+    builder["indentation"] = "   ";
+    std::ofstream outputFileStream(filename);
+    std::unique_ptr<Json::StreamWriter> writer(builder.newStreamWriter());
+    writer->write(root, &outputFileStream);
+}
+
+void usage(const char *argv0)
+{
+    fprintf(stderr,
+        "Usage: %s [OPTIONS]\n"
+        "Benchmark the trace reading, writing and parsing code and the data structures\n"
+        "used by the retracer, using a synthetic trace.\n"
+        "\n"
+        "  -frames N  Number of frames in the synthetic trace (default: 2000)\n"
+        "  -draws N   Number of draw calls per frame (default: 200)\n"
+        "  -upload N  Size in bytes of each buffer upload (default: 4096)\n"
+        "  -trace F   Also read and parse this existing trace\n"
+        "  -only G    Only run one group: write, read, parse, snappy, hmap, md5, csb, texture\n"
+        "  -o FILE    Write the results as JSON to FILE\n"
+        "  -keep      Keep the synthetic trace instead of deleting it\n"
+        "  -h         Print this help\n"
+        "\n"
+        , argv0);
+}
+
+}
+
+int main(int argc, char **argv)
+{
+    unsigned frames = 2000;
+    unsigned draws = 200;
+    unsigned upload = 4096;
+    bool keep = false;
+    std::string traceFile;
+    std::string outputFile;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        const char *arg = argv[i];
+
+        if (!strcmp(arg, "-frames") && i + 1 < argc)
+        {
+            frames = std::max(1, atoi(argv[++i]));
+        }
+        else if (!strcmp(arg, "-draws") && i + 1 < argc)
+        {
+            draws = std::max(1, atoi(argv[++i]));
+        }
+        else if (!strcmp(arg, "-upload") && i + 1 < argc)
+        {
+            upload = std::max(1, atoi(argv[++i]));
+        }
+        else if (!strcmp(arg, "-trace") && i + 1 < argc)
+        {
+            traceFile = argv[++i];
+        }
+        else if (!strcmp(arg, "-only") && i + 1 < argc)
+        {
+            gOnly = argv[++i];
+        }
+        else if (!strcmp(arg, "-o") && i + 1 < argc)
+        {
+            outputFile = argv[++i];
+        }
+        else if (!strcmp(arg, "-keep"))
+        {
+            keep = true;
+        }
+        else if (!strcmp(arg, "-h") || !strcmp(arg, "--help"))
+        {
+            usage(argv[0]);
+            return 0;
+        }
+        else
+        {
+            DBG_LOG("error: unknown option %s\n", arg);
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    common::gApiInfo.RegisterEntries(common::parse_callbacks);
+
+    if (selected("write") || selected("read") || selected("parse"))
+    {
+        const std::string synthetic = "patrace_bench_synthetic.pat";
+        uint64_t calls = 0;
+        const uint64_t bytes = benchWrite(synthetic, frames, draws, upload, calls);
+        if (selected("read"))
+        {
+            benchRead(synthetic, "", bytes);
+        }
+        if (selected("parse"))
+        {
+            benchParse(synthetic, "");
+        }
+        if (!keep)
+        {
+            remove(synthetic.c_str());
+        }
+    }
+    if (!traceFile.empty() && (selected("read") || selected("parse")))
+    {
+        // The uncompressed size of a real trace is not known up front, so
+        // only the call rates are reported for it
+        if (selected("read"))
+        {
+            benchRead(traceFile, "trace_", 0);
+        }
+        if (selected("parse"))
+        {
+            benchParse(traceFile, "trace_");
+        }
+    }
+    if (selected("snappy"))
+    {
+        benchSnappy(upload);
+    }
+    if (selected("hmap"))
+    {
+        benchHmap(100000);
+    }
+    if (selected("md5"))
+    {
+        benchMd5();
+    }
+    if (selected("csb"))
+    {
+        benchClientSideBuffers();
+    }
+    if (selected("texture"))
+    {
+        benchTextureDecode();
+    }
+
+    if (!outputFile.empty())
+    {
+        writeResults(outputFile);
+    }
+    return 0;
+}
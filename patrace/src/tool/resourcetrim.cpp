@@ -0,0 +1,472 @@
+// Remove texture and buffer data that can never be seen during replay.
+//
+// Two kinds of uploads are removed. Uploads to textures and buffers that no
+// draw call in the selected frame range ever uses, and uploads that are
+// completely overwritten by a later upload to the same texture level or
+// buffer before anything could have read them. Calls that define storage
+// (glTexImage*, glCompressedTexImage*, glBufferData) are kept with their
+// payload emptied, so that object sizes, formats and completeness do not
+// change; partial updates and mipmap generation are dropped outright.
+
+#include <EGL/egl.h>
+#include <GLES2/gl2.h>
+#include <GLES3/gl31.h>
+#include <GLES3/gl32.h>
+#include <map>
+#include <set>
+#include <tuple>
+#include <vector>
+
+#include "tool/parse_interface.h"
+
+#include "common/in_file.hpp"
+#include "common/file_format.hpp"
+#include "common/api_info.hpp"
+#include "common/parse_api.hpp"
+#include "common/trace_model.hpp"
+#include "common/analysis_utility.hpp"
+#include "common/os.hpp"
+#include "tool/config.hpp"
+#include "tool/utils.hpp"
+
+static bool debug = false;
+#define DEBUG_LOG(...) if (debug) DBG_LOG(__VA_ARGS__)
+
+typedef std::pair<const void*, int> ResourceKey; // share group storage, resource index
+typedef std::tuple<const void*, int, GLenum, int> LevelKey; // share group storage, resource index, texture face, level
+
+struct UploadCall
+{
+    bool texture = false;
+    bool defines = false; // call (re)defines the storage as well as filling it
+    int dataArg = -1;
+};
+
+struct Upload
+{
+    unsigned call;
+    bool defines;
+    uint64_t bytes;
+};
+
+static void printHelp()
+{
+    std::cout <<
+        "Usage : resourcetrim [OPTIONS] trace_file.pat new_file.pat\n"
+        "Remove texture and buffer uploads that are never used by a draw, or that are\n"
+        "overwritten before they are used.\n"
+        "Options:\n"
+        "  -h                Print help\n"
+        "  -v                Print version\n"
+        "  -d                Print debug info\n"
+        "  -frames <s> <e>   Only count usage in this frame range as keeping a resource alive.\n"
+        "                    Frames outside the range may render incorrectly afterwards.\n"
+        "  -nodead           Do not remove uploads to unused resources\n"
+        "  -nooverwritten    Do not remove uploads that are overwritten before use\n"
+        "  -rate <MB/s>      Upload throughput assumed for the load time estimate (default 1000)\n"
+        ;
+}
+
+static void printVersion()
+{
+    std::cout << PATRACE_VERSION << std::endl;
+}
+
+static void writeout(common::OutFile &outputFile, common::CallTM *call, bool injected = false)
+{
+    const unsigned int WRITE_BUF_LEN = 150*1024*1024;
+    static char buffer[WRITE_BUF_LEN];
+    char *dest = buffer;
+    dest = call->Serialize(dest, -1, injected);
+    outputFile.Write(buffer, dest-buffer);
+}
+
+static bool classifyUpload(const common::CallTM *call, UploadCall& u)
+{
+    static const std::map<std::string, int> textureDefinitions = {
+        { "glTexImage1D", 7 }, { "glTexImage2D", 8 }, { "glTexImage3D", 9 }, { "glTexImage3DOES", 9 },
+        { "glCompressedTexImage1D", 6 }, { "glCompressedTexImage2D", 7 }, { "glCompressedTexImage3D", 8 },
+        { "glCompressedTexImage1DOES", 6 }, { "glCompressedTexImage2DOES", 7 }, { "glCompressedTexImage3DOES", 8 },
+    };
+    static const std::set<std::string> textureUpdates = {
+        "glTexSubImage1D", "glTexSubImage2D", "glTexSubImage3D", "glTexSubImage3DOES",
+        "glCompressedTexSubImage2D", "glCompressedTexSubImage3D", "glCompressedTexSubImage3DOES",
+    };
+    const auto it = textureDefinitions.find(call->mCallName);
+    if (it != textureDefinitions.end())
+    {
+        u.texture = true;
+        u.defines = true;
+        u.dataArg = it->second;
+    }
+    else if (textureUpdates.count(call->mCallName))
+    {
+        u.texture = true;
+        u.dataArg = call->mArgs.size() - 1;
+    }
+    else if (call->mCallName == "glBufferData")
+    {
+        u.defines = true;
+        u.dataArg = 2;
+    }
+    else if (call->mCallName == "glBufferSubData")
+    {
+        u.dataArg = 3;
+    }
+    return u.dataArg != -1;
+}
+
+/// Size of the payload stored in the trace, or -1 if the data is sourced from a buffer object
+static int64_t payloadSize(const common::ValueTM *value)
+{
+    if (value->mType == common::Blob_Type)
+    {
+        return value->mBlobLen;
+    }
+    else if (value->mType == common::Opaque_Type && value->mOpaqueType == common::BlobType)
+    {
+        return value->mOpaqueIns->mBlobLen;
+    }
+    return -1;
+}
+
+/// Whether a glTexSubImage or glCompressedTexSubImage call overwrites all of level zero
+static bool coversLevel(const common::CallTM *call, const StateTracker::Texture& tex)
+{
+    const bool is1d = call->mCallName.find("1D") != std::string::npos;
+    const bool is3d = call->mCallName.find("3D") != std::string::npos;
+    if (call->mArgs[1]->GetAsInt() != 0)
+    {
+        return false;
+    }
+    int i = 2;
+    const int xoffset = call->mArgs[i++]->GetAsInt();
+    const int yoffset = is1d ? 0 : call->mArgs[i++]->GetAsInt();
+    const int zoffset = is3d ? call->mArgs[i++]->GetAsInt() : 0;
+    const int width = call->mArgs[i++]->GetAsInt();
+    const int height = is1d ? 1 : call->mArgs[i++]->GetAsInt();
+    const int depth = is3d ? call->mArgs[i++]->GetAsInt() : 1;
+    return xoffset == 0 && yoffset == 0 && zoffset == 0 && width == tex.width && height == tex.height && depth == tex.depth;
+}
+
+/// Calls after which a pending upload may have been read, so it can no longer be considered overwritten
+static bool isBarrier(const std::string& name)
+{
+    static const std::vector<std::string> prefixes = {
+        "glDraw", "glDispatch", "glCopy", "glBlit", "glRead", "glGet", "glMap", "glFramebufferTexture",
+        "glEGLImageTarget", "eglCreateImage", "glGenerateMipmap", "glBindImageTexture", "glTexBuffer",
+        "glPatchClientSideBuffer",
+    };
+    for (const auto& prefix : prefixes)
+    {
+        if (name.compare(0, prefix.size(), prefix) == 0)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+static GLuint boundBuffer(StateTracker::Context& ctx, GLenum target)
+{
+    StateTracker::VertexArrayObject& vao = ctx.vaos.at(ctx.vao_index);
+    return vao.boundBufferIds[target][0].buffer;
+}
+
+int main(int argc, char **argv)
+{
+    int argIndex = 1;
+    int startframe = 0;
+    int endframe = INT32_MAX;
+    bool dead = true;
+    bool overwritten = true;
+    double rate = 1000.0;
+    for (; argIndex < argc; ++argIndex)
+    {
+        std::string arg = argv[argIndex];
+
+        if (arg[0] != '-')
+        {
+            break;
+        }
+        else if (arg == "-h")
+        {
+            printHelp();
+            return 1;
+        }
+        else if (arg == "-d")
+        {
+            debug = true;
+        }
+        else if (arg == "-frames" && argIndex + 2 < argc)
+        {
+            startframe = atoi(argv[++argIndex]);
+            endframe = atoi(argv[++argIndex]);
+        }
+        else if (arg == "-nodead")
+        {
+            dead = false;
+        }
+        else if (arg == "-nooverwritten")
+        {
+            overwritten = false;
+        }
+        else if (arg == "-rate" && argIndex + 1 < argc)
+        {
+            rate = atof(argv[++argIndex]);
+        }
+        else if (arg == "-v")
+        {
+            printVersion();
+            return 0;
+        }
+        else
+        {
+            std::cerr << "Error: Unknown option " << arg << std::endl;
+            printHelp();
+            return 1;
+        }
+    }
+
+    if (argIndex + 2 > argc || rate <= 0.0)
+    {
+        printHelp();
+        return 1;
+    }
+    std::string source_trace_filename = argv[argIndex++];
+    ParseInterface *inputFile = new ParseInterface();
+    inputFile->setQuickMode(true);
+    inputFile->setScreenshots(false);
+    inputFile->ff_startframe = startframe;
+    inputFile->ff_endframe = endframe;
+    if (!inputFile->open(source_trace_filename))
+    {
+        std::cerr << "Failed to open for reading: " << source_trace_filename << std::endl;
+        return 1;
+    }
+
+    common::OutFile outputFile;
+    std::string target_trace_filename = argv[argIndex++];
+    if (!outputFile.Open(target_trace_filename.c_str()))
+    {
+        std::cerr << "Failed to open for writing: " << target_trace_filename << std::endl;
+        return 1;
+    }
+
+    // First pass: record every upload per resource, find uploads that are
+    // overwritten before the next call that could read them, and find the
+    // resources that must be kept even though no draw call uses them
+    std::map<unsigned, uint64_t> strip; // call number : payload bytes, for calls kept without their payload
+    std::map<unsigned, uint64_t> drop; // call number : payload bytes, for calls removed entirely
+    std::map<LevelKey, std::vector<Upload>> pending;
+    std::map<ResourceKey, std::vector<Upload>> uploads;
+    std::set<ResourceKey> keep;
+    std::set<GLuint> image_textures; // textures that are EGL image sources, in any share group
+    int overwritten_uploads = 0;
+    common::CallTM *call = nullptr;
+    while ((call = inputFile->next_call()))
+    {
+        UploadCall u;
+        if (inputFile->context_index == UNBOUND)
+        {
+            continue;
+        }
+        StateTracker::Context& ctx = inputFile->contexts[inputFile->context_index];
+        if (classifyUpload(call, u))
+        {
+            const int64_t bytes = payloadSize(call->mArgs[u.dataArg]);
+            if (bytes < 0) // reads from a pixel unpack buffer
+            {
+                const GLuint id = boundBuffer(ctx, GL_PIXEL_UNPACK_BUFFER);
+                if (id != 0 && ctx.buffers.contains(id)) keep.emplace(&ctx.buffers.all(), ctx.buffers.remap(id));
+                pending.clear();
+                continue;
+            }
+            LevelKey key;
+            bool covers = u.defines;
+            if (u.texture)
+            {
+                const GLenum face = call->mArgs[0]->GetAsUInt();
+                const GLuint tex_id = ctx.textureUnits[ctx.activeTextureUnit][interpret_texture_target(face)];
+                if (tex_id == 0 || !ctx.textures.contains(tex_id)) continue;
+                const int index = ctx.textures.remap(tex_id);
+                key = LevelKey(&ctx.textures.all(), index, face, call->mArgs[1]->GetAsInt());
+                covers = covers || coversLevel(call, ctx.textures.all().at(index));
+            }
+            else
+            {
+                const GLuint id = boundBuffer(ctx, call->mArgs[0]->GetAsUInt());
+                if (id == 0 || !ctx.buffers.contains(id)) continue;
+                const int index = ctx.buffers.remap(id);
+                key = LevelKey(&ctx.buffers.all(), index, GL_NONE, 0);
+                covers = covers || (call->mArgs[1]->GetAsInt() == 0 && call->mArgs[2]->GetAsInt() == ctx.buffers.all().at(index).size);
+            }
+            std::vector<Upload>& p = pending[key];
+            if (covers && overwritten)
+            {
+                for (const Upload& prev : p)
+                {
+                    if (prev.defines && prev.bytes > 0) strip[prev.call] = prev.bytes;
+                    else if (!prev.defines) drop[prev.call] = prev.bytes;
+                    overwritten_uploads++;
+                    DEBUG_LOG("call %u: overwritten by call %u before use\n", prev.call, call->mCallNo);
+                }
+                p.clear();
+            }
+            const Upload up = { call->mCallNo, u.defines, (uint64_t)bytes };
+            p.push_back(up);
+            uploads[ResourceKey(std::get<0>(key), std::get<1>(key))].push_back(up);
+            continue;
+        }
+
+        if (isBarrier(call->mCallName))
+        {
+            pending.clear();
+        }
+        if (call->mCallName.compare(0, 11, "glMapBuffer") == 0 || call->mCallName == "glCopyBufferSubData")
+        {
+            const GLenum target = (call->mCallName == "glCopyBufferSubData") ? GL_COPY_READ_BUFFER : call->mArgs[0]->GetAsUInt();
+            const GLuint id = boundBuffer(ctx, target);
+            if (id != 0 && ctx.buffers.contains(id)) keep.emplace(&ctx.buffers.all(), ctx.buffers.remap(id));
+        }
+        else if (call->mCallName.compare(0, 11, "glTexBuffer") == 0)
+        {
+            const GLuint id = call->mArgs[2]->GetAsUInt();
+            if (id != 0 && ctx.buffers.contains(id)) keep.emplace(&ctx.buffers.all(), ctx.buffers.remap(id));
+        }
+        else if (call->mCallName == "glCopyImageSubData" || call->mCallName == "glCopyImageSubDataEXT" || call->mCallName == "glCopyImageSubDataOES")
+        {
+            const GLuint id = call->mArgs[0]->GetAsUInt();
+            if (call->mArgs[1]->GetAsUInt() != GL_RENDERBUFFER && ctx.textures.contains(id)) keep.emplace(&ctx.textures.all(), ctx.textures.remap(id));
+        }
+        else if (call->mCallName == "eglCreateImageKHR" || call->mCallName == "eglCreateImage")
+        {
+            const unsigned target = call->mArgs[2]->GetAsUInt();
+            if (target >= EGL_GL_TEXTURE_2D_KHR && target <= EGL_GL_TEXTURE_CUBE_MAP_NEGATIVE_Z_KHR) image_textures.insert(call->mArgs[3]->GetAsUInt());
+        }
+    }
+
+    // Resources never used in the frame range have all their uploads removed
+    int dead_textures = 0;
+    int dead_buffers = 0;
+    int unused_shaders = 0;
+    uint64_t unused_shader_bytes = 0;
+    std::set<const void*> groups;
+    for (const auto& ctx : inputFile->contexts)
+    {
+        if (!groups.insert(&ctx.textures.all()).second)
+        {
+            continue; // share group already handled
+        }
+        for (const auto& sh : ctx.shaders.all())
+        {
+            if (!sh.used)
+            {
+                unused_shaders++;
+                unused_shader_bytes += sh.source_code.size();
+            }
+        }
+        if (!dead)
+        {
+            continue;
+        }
+        for (const auto& tx : ctx.textures.all())
+        {
+            const ResourceKey key(&ctx.textures.all(), tx.index);
+            if (tx.used || keep.count(key) || image_textures.count(tx.id) || !uploads.count(key)) continue;
+            DEBUG_LOG("texture %u (index %d) is never used\n", tx.id, tx.index);
+            dead_textures++;
+            for (const Upload& up : uploads.at(key))
+            {
+                if (up.defines && up.bytes > 0) strip[up.call] = up.bytes;
+                else if (!up.defines) drop[up.call] = up.bytes;
+            }
+            for (const auto& mip : tx.mipmaps)
+            {
+                drop[mip.first] = 0;
+            }
+        }
+        for (const auto& bf : ctx.buffers.all())
+        {
+            const ResourceKey key(&ctx.buffers.all(), bf.index);
+            if (bf.used || keep.count(key) || !uploads.count(key)) continue;
+            DEBUG_LOG("buffer %u (index %d) is never used\n", bf.id, bf.index);
+            dead_buffers++;
+            for (const Upload& up : uploads.at(key))
+            {
+                if (up.defines && up.bytes > 0) strip[up.call] = up.bytes;
+                else if (!up.defines) drop[up.call] = up.bytes;
+            }
+        }
+    }
+    DBG_LOG("Found %d unused textures, %d unused buffers and %d overwritten uploads\n", dead_textures, dead_buffers, overwritten_uploads);
+    inputFile->close();
+    delete inputFile;
+
+    inputFile = new ParseInterface();
+    inputFile->setQuickMode(true);
+    inputFile->setScreenshots(false);
+    if (!inputFile->open(source_trace_filename))
+    {
+        std::cerr << "Failed to open for reading again: " << source_trace_filename << std::endl;
+        return 1;
+    }
+
+    // Second pass: write out the trace without the removed payloads
+    uint64_t bytes_removed = 0;
+    int stripped = 0;
+    int removed = 0;
+    while ((call = inputFile->next_call()))
+    {
+        const auto d = drop.find(call->mCallNo);
+        if (d != drop.end())
+        {
+            bytes_removed += d->second;
+            removed++;
+            continue;
+        }
+        const auto s = strip.find(call->mCallNo);
+        if (s != strip.end())
+        {
+            UploadCall u;
+            classifyUpload(call, u);
+            const bool opaque = call->mArgs[u.dataArg]->mType == common::Opaque_Type;
+            delete call->mArgs[u.dataArg];
+            call->mArgs[u.dataArg] = opaque ? common::CreateBlobOpaqueValue(0, nullptr) : common::CreateBlobValue(0, nullptr);
+            bytes_removed += s->second;
+            stripped++;
+        }
+        writeout(outputFile, call);
+    }
+
+    const double load_time_saved = bytes_removed / (rate * 1024.0 * 1024.0);
+    Json::Value header = inputFile->header;
+    Json::Value info;
+    info["frames"] = Json::arrayValue;
+    info["frames"].append(startframe);
+    info["frames"].append(endframe);
+    info["unused_textures"] = dead_textures;
+    info["unused_buffers"] = dead_buffers;
+    info["overwritten_uploads"] = overwritten_uploads;
+    info["payloads_stripped"] = stripped;
+    info["calls_removed"] = removed;
+    info["bytes_removed"] = (Json::UInt64)bytes_removed;
+    info["estimated_load_time_saved"] = load_time_saved;
+    addConversionEntry(header, "resourcetrim", source_trace_filename, info);
+    Json::FastWriter writer;
+    const std::string json_header = writer.write(header);
+    outputFile.mHeader.jsonLength = json_header.size();
+    outputFile.WriteHeader(json_header.c_str(), json_header.size());
+
+    inputFile->close();
+    outputFile.Close();
+    printf("Removed %d calls and the payload of %d more, %.2f MB in total\n", removed, stripped, bytes_removed / (1024.0 * 1024.0));
+    printf("Estimated load time saved: %.3f s at %.0f MB/s upload throughput\n", load_time_saved, rate);
+    printf("Unused textures: %d, unused buffers: %d, uploads overwritten before use: %d\n", dead_textures, dead_buffers, overwritten_uploads);
+    if (unused_shaders > 0)
+    {
+        printf("%d shaders with %.2f KB of source are never used; these are left in place since replay requires successful links\n",
+               unused_shaders, unused_shader_bytes / 1024.0);
+    }
+    return 0;
+}
@@ -0,0 +1,158 @@
+#include <common/results_file.hpp>
+#include <common/os.hpp>
+
+#include "json/writer.h"
+
+#include <errno.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+
+static bool writeCallstats(const common::ResultsReader& reader, const std::string& filename)
+{
+    const common::ResultsReader::Table *t = reader.FindTable("callstats");
+    if (!t)
+    {
+        DBG_LOG("No callstats table in the results file; was the retracer run with -callstats?\n");
+        return false;
+    }
+    const int function = t->FindColumn("function");
+    const int calls = t->FindColumn("calls");
+    const int time = t->FindColumn("time");
+    const int calibrated = t->FindColumn("calibrated_time");
+    if (function < 0 || calls < 0 || time < 0 || calibrated < 0)
+    {
+        DBG_LOG("Unexpected columns in the callstats table\n");
+        return false;
+    }
+    FILE *fp = fopen(filename.c_str(), "w");
+    if (!fp)
+    {
+        DBG_LOG("Failed to open %s: %s\n", filename.c_str(), strerror(errno));
+        return false;
+    }
+    fprintf(fp, "Function,Calls,Time,Calibrated_Time\n");
+    for (size_t r = 0; r < t->rows; r++)
+    {
+        fprintf(fp, "%s,%" PRIu64 ",%" PRIu64 ",%" PRIu64 "\n", t->GetString(function, r).c_str(),
+                t->GetU64(calls, r), t->GetU64(time, r), t->GetU64(calibrated, r));
+    }
+    fclose(fp);
+    return true;
+}
+
+static void usage(const char *argv0)
+{
+    fprintf(stderr,
+        "Usage: %s [OPTIONS] <results.bin> [results.json]\n"
+        "Convert a binary results file written by the retracer's -binaryresults option\n"
+        "to the results.json format. Writes to stdout if no output file is given.\n"
+        "\n"
+        "  -table NAME     Only output the given table, in columnar form\n"
+        "  -tables         Also add every table, in columnar form, to the first result\n"
+        "  -callstats FILE Also write the callstats table to FILE in the retracer's callstats.csv format\n"
+        "  -h              Print this help\n"
+        "\n"
+        , argv0);
+}
+
+int main(int argc, char **argv)
+{
+    std::string input;
+    std::string output;
+    std::string table;
+    std::string callstats;
+    bool tables = false;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        const char *arg = argv[i];
+
+        if (!strcmp(arg, "-table") && i + 1 < argc)
+        {
+            table = argv[++i];
+        }
+        else if (!strcmp(arg, "-tables"))
+        {
+            tables = true;
+        }
+        else if (!strcmp(arg, "-callstats") && i + 1 < argc)
+        {
+            callstats = argv[++i];
+        }
+        else if (!strcmp(arg, "-h") || !strcmp(arg, "--help"))
+        {
+            usage(argv[0]);
+            return 0;
+        }
+        else if (arg[0] == '-')
+        {
+            DBG_LOG("error: unknown option %s\n", arg);
+            usage(argv[0]);
+            return 1;
+        }
+        else if (input.empty())
+        {
+            input = arg;
+        }
+        else if (output.empty())
+        {
+            output = arg;
+        }
+        else
+        {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    if (input.empty())
+    {
+        usage(argv[0]);
+        return 1;
+    }
+
+    common::ResultsReader reader;
+    if (!reader.Open(input.c_str()))
+    {
+        return 1;
+    }
+
+    if (!callstats.empty() && !writeCallstats(reader, callstats))
+    {
+        return 1;
+    }
+
+    Json::Value value;
+    if (!table.empty())
+    {
+        const common::ResultsReader::Table *t = reader.FindTable(table);
+        if (!t)
+        {
+            DBG_LOG("No table named %s in %s\n", table.c_str(), input.c_str());
+            return 1;
+        }
+        value = t->ToJson();
+    }
+    else
+    {
+        value = reader.ToJson(tables);
+    }
+
+    Json::StyledWriter writer;
+    const std::string data = writer.write(value);
+
+    FILE *fp = output.empty() ? stdout : fopen(output.c_str(), "w");
+    if (!fp)
+    {
+        DBG_LOG("Failed to open %s: %s\n", output.c_str(), strerror(errno));
+        return 1;
+    }
+    fwrite(data.c_str(), data.size(), 1, fp);
+    if (fp != stdout)
+    {
+        fclose(fp);
+    }
+    return 0;
+}
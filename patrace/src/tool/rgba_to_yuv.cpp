@@ -48,6 +48,7 @@
 #include "retracer/dma_buffer/dma_buffer.hpp"
 #include "eglstate/common.hpp"
 #include "common/image.hpp"
+#include "common/pixel_convert.hpp"
 #include "tool/config.hpp"
 
 using namespace std;
@@ -62,6 +63,7 @@ static void printHelp()
         "     REMAIN            The pixelFormat of the target won't be converted.\n"
         "     YV12              YV12 format\n"
         "     NV12              NV12 format\n"
+        "     NV21              NV21 format\n"
         "  -u USAGE             Specify the usage of the target. USAGE must be a decimal integer.\n"
         "  -no_crop             Abandon all the attribs of eglCreateImageKHR related to EGL_ANDROID_image_crop extension"
         "  -h                   Print help.\n"
@@ -83,20 +85,12 @@ static void writeout(common::OutFile &outputFile, common::CallTM *call, bool inj
     outputFile.Write(buffer, dest-buffer);
 }
 
-int truncate(int num, int min = 0, int max = 255)
-{
-    if (num < min)
-        return min;
-    else if (num > max)
-        return max;
-    return num;
-}
-
 enum Format
 {
     REMAIN = 0,
     YV12 = 1,
     NV12 = 2,
+    NV21 = 3,
 };
 
 int NoConvert(unsigned char *rgba, unsigned char *yv12, int width, int height)
@@ -113,36 +107,15 @@ int RGBAtoYV12(unsigned char *rgba, unsigned char *yv12, int width, int height)
     int c_size = c_stride * y_height / 2;
     int yuv_size = y_size + c_size * 2;
 
-    // y =  0.299r + 0.587g + 0.114b;
-    // u = -0.169r - 0.331g + 0.500b + 128;
-    // v =  0.500r - 0.419g - 0.081b + 128;
-    for (int i = 0; i < y_stride * y_height; ++i) {
-        int y_x = i % y_stride;
-        if (y_x >= width)
-            continue;
-        int y_y = i / y_stride;
-
-        int r = rgba[(y_y * width + y_x) * 4];
-        int g = rgba[(y_y * width + y_x) * 4 + 1];
-        int b = rgba[(y_y * width + y_x) * 4 + 2];
-        int y = 0.299 * r + 0.587 * g + 0.114 * b;
-        yv12[y_y * y_stride + y_x] = truncate(y);
-        if (((y_x & 0x1) == 0) && ((y_y & 0x1) == 0)) {
-            int u = -0.169 * r - 0.331 * g + 0.500 * b + 128;
-            int v =  0.500 * r - 0.419 * g - 0.081 * b + 128;
-            int u_x = y_x / 2;
-            int u_y = y_y / 2;
-            yv12[y_size + u_y * c_stride + u_x] = truncate(v);
-            yv12[y_size + c_size + u_y * c_stride + u_x] = truncate(u);
-        }
-    }
+    // V plane first, then U
+    image::rgbaToYuv420(rgba, width, height, yv12, y_stride,
+                        yv12 + y_size + c_size, yv12 + y_size, c_stride, 1);
 
     return yuv_size;
 }
 
 int RGBAtoNV12(unsigned char *rgba, unsigned char *nv12, int width, int height)
 {
-    //int y_stride = width;
     int y_stride = (width + 15) / 16 * 16;
     int y_height= height;
     int y_size = y_stride * y_height;
@@ -150,29 +123,25 @@ int RGBAtoNV12(unsigned char *rgba, unsigned char *nv12, int width, int height)
     int c_size = c_stride * y_height / 2;
     int yuv_size = y_size + c_size;
 
-    // y =  0.299r + 0.587g + 0.114b;
-    // u = -0.169r - 0.331g + 0.500b + 128;
-    // v =  0.500r - 0.419g - 0.081b + 128;
-    for (int i = 0; i < y_stride * y_height; ++i) {
-        int y_x = i % y_stride;
-        if (y_x >= width)
-            continue;
-        int y_y = i / y_stride;
-
-        int r = rgba[(y_y * width + y_x) * 4];
-        int g = rgba[(y_y * width + y_x) * 4 + 1];
-        int b = rgba[(y_y * width + y_x) * 4 + 2];
-        int y = 0.299 * r + 0.587 * g + 0.114 * b;
-        nv12[y_y * y_stride + y_x] = truncate(y);
-        if (((y_x & 0x1) == 0) && ((y_y & 0x1) == 0)) {
-            int u = -0.169 * r - 0.331 * g + 0.500 * b + 128;
-            int v =  0.500 * r - 0.419 * g - 0.081 * b + 128;
-            int u_x = y_x / 2;
-            int u_y = y_y / 2;
-            nv12[y_size + u_y * c_stride + u_x * 2] = truncate(u);
-            nv12[y_size + u_y * c_stride + u_x * 2 + 1] = truncate(v);
-        }
-    }
+    // Interleaved UV plane
+    image::rgbaToYuv420(rgba, width, height, nv12, y_stride,
+                        nv12 + y_size, nv12 + y_size + 1, c_stride, 2);
+
+    return yuv_size;
+}
+
+int RGBAtoNV21(unsigned char *rgba, unsigned char *nv21, int width, int height)
+{
+    int y_stride = (width + 15) / 16 * 16;
+    int y_height= height;
+    int y_size = y_stride * y_height;
+    int c_stride = y_stride;
+    int c_size = c_stride * y_height / 2;
+    int yuv_size = y_size + c_size;
+
+    // Interleaved VU plane
+    image::rgbaToYuv420(rgba, width, height, nv21, y_stride,
+                        nv21 + y_size + 1, nv21 + y_size, c_stride, 2);
 
     return yuv_size;
 }
@@ -188,10 +157,12 @@ void makeMap()
     androidFormatMap[REMAIN] = PIXEL_FORMAT_NONE;
     androidFormatMap[YV12] = HAL_PIXEL_FORMAT_YV12;
     androidFormatMap[NV12] = MALI_GRALLOC_FORMAT_INTERNAL_NV12;
+    androidFormatMap[NV21] = HAL_PIXEL_FORMAT_YCRCB_420_SP;
 
     functionMap[PIXEL_FORMAT_NONE] = NoConvert;
     functionMap[HAL_PIXEL_FORMAT_YV12] = RGBAtoYV12;
     functionMap[MALI_GRALLOC_FORMAT_INTERNAL_NV12] = RGBAtoNV12;
+    functionMap[HAL_PIXEL_FORMAT_YCRCB_420_SP] = RGBAtoNV21;
 
     AndroidImageCropAttribToNameMap[0x3148] = "EGL_IMAGE_CROP_LEFT_ANDROID";
     AndroidImageCropAttribToNameMap[0x3149] = "EGL_IMAGE_CROP_TOP_ANDROID";
@@ -595,6 +566,10 @@ int main(int argc, char **argv)
             {
                 format = NV12;
             }
+            else if (format_string == "NV21")
+            {
+                format = NV21;
+            }
             else
             {
                 DBG_LOG("Invalid format: %s\n", format_string.c_str());
@@ -7,6 +7,7 @@
 
 #include "tool/parse_interface.h"
 #include "tool/glsl_parser.h"
+#include "tool/glsl_cache.h"
 #include "tool/glsl_utils.h"
 
 static void printHelp()
@@ -24,6 +25,8 @@ static void printHelp()
         "  --test        Test parser on a shader, printing only file name and shader type\n"
         "  --upgrade     Upgrade shader to at least 310 ES version\n"
         "  --tf          Upgrade shader and convert vertex shader to use transform feedback\n"
+        "  --cache <dir> Keep analysis results in this directory, and reuse them for identical shaders\n"
+        "                (ignored with --test and --debug)\n"
         "  -h            Print help\n"
         "  -v            Print version\n"
         ;
@@ -68,6 +71,7 @@ int main(int argc, char **argv)
     bool inline_includes = false;
     bool upgrade = false;
     bool tf = false;
+    std::string cache_dir;
 
     for (; argIndex < argc; ++argIndex)
     {
@@ -94,6 +98,11 @@ int main(int argc, char **argv)
         {
             tf = true;
         }
+        else if (arg == "--cache" && argIndex + 1 < argc)
+        {
+            cache_dir = argv[argIndex + 1];
+            argIndex++;
+        }
         else if (arg == "--inline")
         {
             inline_includes = true;
@@ -209,7 +218,18 @@ int main(int argc, char **argv)
     }
     else if (mode == ANALYZE || mode == TEST)
     {
-        GLSLRepresentation r = parser.parse(s);
+        GLSLRepresentation r;
+        // Testing the parser is pointless if the result comes from the cache
+        if (!cache_dir.empty() && !debug && mode != TEST)
+        {
+            GLSLCache cache;
+            cache.open(cache_dir);
+            r = cache.get(data, shaderType, filename)->repr;
+        }
+        else
+        {
+            r = parser.parse(s);
+        }
         if (mode == TEST)
         {
             return 0;
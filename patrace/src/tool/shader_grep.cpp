@@ -19,6 +19,8 @@
 #include "base/base.hpp"
 
 static bool debug = false;
+static std::string cache_dir;
+static unsigned shader_threads = 0;
 
 #define DEBUG_LOG(...) if (debug) DBG_LOG(__VA_ARGS__)
 
@@ -31,6 +33,8 @@ static void printHelp()
         "  -v            Print version\n"
         "  -t TYPE       Restrict search to shader type [VERT|FRAG|COMP|GEOM|TESE|TESC]"
         "  -D            Add debug information to stderr\n"
+        "  -cache <dir>  Keep shader parse results in this directory for later runs\n"
+        "  -threads <n>  Parse all shaders of the trace up front on this many threads\n"
         ;
 }
 
@@ -104,6 +108,16 @@ int main(int argc, char **argv)
         {
             debug = true;
         }
+        else if (arg == "-cache" && argIndex + 1 < argc)
+        {
+            cache_dir = argv[argIndex + 1];
+            argIndex++;
+        }
+        else if (arg == "-threads" && argIndex + 1 < argc)
+        {
+            shader_threads = atoi(argv[argIndex + 1]);
+            argIndex++;
+        }
         else if (arg == "-t" && argIndex + 1 < argc)
         {
             std::string arg = argv[argIndex + 1];
@@ -154,6 +168,7 @@ int main(int argc, char **argv)
     std::string match = argv[argIndex++];
     std::string source_trace_filename = argv[argIndex++];
     ParseInterface inputFile;
+    inputFile.setShaderCache(cache_dir, shader_threads);
     if (!inputFile.open(source_trace_filename))
     {
         std::cerr << "Failed to open for reading: " << source_trace_filename << std::endl;
@@ -24,6 +24,8 @@
 
 static bool split = false;
 static bool repack = false;
+static std::string cache_dir;
+static unsigned shader_threads = 0;
 
 static void printHelp()
 {
@@ -32,6 +34,8 @@ static void printHelp()
         "Options:\n"
         "  --split       Dump out shaders\n"
         "  --repack      Pack shaders back in again\n"
+        "  --cache <dir> Keep shader parse results in this directory for later runs\n"
+        "  --threads <n> Parse all shaders of the trace up front on this many threads\n"
         "  -h            Print help\n"
         "  -v            Print version\n"
         ;
@@ -146,6 +150,16 @@ int main(int argc, char **argv)
         {
             repack = true;
         }
+        else if (arg == "--cache" && argIndex + 1 < argc)
+        {
+            cache_dir = argv[argIndex + 1];
+            argIndex++;
+        }
+        else if (arg == "--threads" && argIndex + 1 < argc)
+        {
+            shader_threads = atoi(argv[argIndex + 1]);
+            argIndex++;
+        }
         else if (arg == "-v")
         {
             printVersion();
@@ -167,6 +181,7 @@ int main(int argc, char **argv)
     std::string keyword = argv[argIndex++];
     std::string source_trace_filename = argv[argIndex++];
     ParseInterface inputFile;
+    inputFile.setShaderCache(cache_dir, shader_threads);
     if (!inputFile.open(source_trace_filename))
     {
         std::cerr << "Failed to open for reading: " << source_trace_filename << std::endl;
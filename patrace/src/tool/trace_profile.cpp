@@ -0,0 +1,262 @@
+// Profile where the bytes and calls in a trace file go, without decoding
+// any call arguments. Compressed chunks are decompressed and scanned in
+// parallel, using only the call headers and the fixed call lengths from
+// the sig book.
+
+#include <common/in_file_mt.hpp>
+#include <common/os.hpp>
+#include <common/trace_scan.hpp>
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct FuncStats
+{
+    uint64_t calls = 0;
+    uint64_t bytes = 0;
+    uint64_t maxBytes = 0;
+};
+
+static void usage(const char *argv0)
+{
+    fprintf(stderr,
+        "Usage: %s [OPTIONS] <trace.pat>\n"
+        "Report per-function call counts and sizes, per-frame sizes and per-chunk\n"
+        "compression ratios for a trace, without decoding call arguments.\n"
+        "\n"
+        "  -j N       Number of scanning threads (default: number of CPUs)\n"
+        "  -tid N     Only count swaps on this thread as frame ends (default: the trace's default thread)\n"
+        "  -chunks    Print compression statistics for every chunk\n"
+        "  -frames    Print the size of every frame\n"
+        "  -top N     Number of functions and frames to list (default: 30, 0 for all)\n"
+        "  -h         Print this help\n"
+        "\n"
+        , argv0);
+}
+
+static double mb(uint64_t bytes)
+{
+    return (double)bytes / (1024.0 * 1024.0);
+}
+
+int main(int argc, char **argv)
+{
+    unsigned threads = std::max(1u, std::thread::hardware_concurrency());
+    int tid = -1;
+    bool printChunks = false;
+    bool printFrames = false;
+    unsigned top = 30;
+    std::string filename;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        const char *arg = argv[i];
+
+        if (!strcmp(arg, "-j") && i + 1 < argc)
+        {
+            threads = std::max(1, atoi(argv[++i]));
+        }
+        else if (!strcmp(arg, "-tid") && i + 1 < argc)
+        {
+            tid = atoi(argv[++i]);
+        }
+        else if (!strcmp(arg, "-chunks"))
+        {
+            printChunks = true;
+        }
+        else if (!strcmp(arg, "-frames"))
+        {
+            printFrames = true;
+        }
+        else if (!strcmp(arg, "-top") && i + 1 < argc)
+        {
+            top = atoi(argv[++i]);
+        }
+        else if (!strcmp(arg, "-h") || !strcmp(arg, "--help"))
+        {
+            usage(argv[0]);
+            return 0;
+        }
+        else if (arg[0] == '-')
+        {
+            DBG_LOG("error: unknown option %s\n", arg);
+            usage(argv[0]);
+            return 1;
+        }
+        else if (filename.empty())
+        {
+            filename = arg;
+        }
+        else
+        {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    if (filename.empty())
+    {
+        usage(argv[0]);
+        return 1;
+    }
+
+    common::InFile inputFile;
+    if (!inputFile.Open(filename.c_str()))
+    {
+        return 1;
+    }
+    if (tid == -1)
+    {
+        tid = inputFile.getDefaultThreadID();
+    }
+
+    const int maxSigId = inputFile.getMaxSigId();
+    const int64_t t0 = os::getTime();
+
+    common::TraceScanner scanner(inputFile, tid);
+    if (scanner.findChunks() == common::CHUNK_TRUNCATED)
+    {
+        DBG_LOG("Warning: the last chunk is truncated, %" PRId64 " bytes present - ignoring it\n", scanner.trailing());
+    }
+
+    // Each thread keeps its own function statistics and they are merged at
+    // the end
+    std::vector<std::vector<FuncStats>> perThread(threads, std::vector<FuncStats>(maxSigId + 1));
+    const bool intact = scanner.scan(threads, false, [&](unsigned thread, const common::BCall& call, unsigned size)
+    {
+        FuncStats& f = perThread[thread][call.funcId];
+        f.calls++;
+        f.bytes += size;
+        f.maxBytes = std::max<uint64_t>(f.maxBytes, size);
+    });
+    const std::vector<common::TraceScanner::Chunk>& chunks = scanner.chunks();
+    if (!intact)
+    {
+        for (size_t i = 0; i < chunks.size(); i++)
+        {
+            if (chunks[i].error)
+            {
+                DBG_LOG("Chunk %u is bad: %s - file is corrupt!\n", (unsigned)i, chunks[i].error);
+                return 1;
+            }
+        }
+    }
+    const double seconds = (double)(os::getTime() - t0) / os::timeFrequency;
+
+    // Merge
+    std::vector<FuncStats> funcs(maxSigId + 1);
+    for (const auto& t : perThread)
+    {
+        for (int id = 0; id <= maxSigId; id++)
+        {
+            funcs[id].calls += t[id].calls;
+            funcs[id].bytes += t[id].bytes;
+            funcs[id].maxBytes = std::max(funcs[id].maxBytes, t[id].maxBytes);
+        }
+    }
+    uint64_t totalCompressed = 0;
+    uint64_t totalUncompressed = 0;
+    uint64_t totalCalls = 0;
+    std::vector<uint64_t> frames;
+    uint64_t carry = 0;
+    for (size_t i = 0; i < chunks.size(); i++)
+    {
+        const common::TraceScanner::Chunk& c = chunks[i];
+        totalCompressed += c.ref.length;
+        totalUncompressed += c.uncompressed;
+        totalCalls += c.calls;
+        uint64_t offset = scanner.callsBegin(i);
+        for (const common::TraceScanner::FrameEnd& f : c.frameEnds)
+        {
+            frames.push_back(carry + f.offset - offset);
+            offset = f.offset;
+            carry = 0;
+        }
+        carry += c.uncompressed - offset;
+    }
+    if (carry)
+    {
+        frames.push_back(carry); // calls after the last swap
+    }
+
+    printf("File: %s\n", filename.c_str());
+    printf("Scanned %u chunks in %.2f s with %u threads (%.1f MB/s compressed, %.1f MB/s uncompressed)\n",
+           (unsigned)chunks.size(), seconds, threads, mb(totalCompressed) / seconds, mb(totalUncompressed) / seconds);
+    printf("Calls: %" PRIu64 "\n", totalCalls);
+    printf("Compressed: %.2f MB, uncompressed: %.2f MB, ratio %.2f\n", mb(totalCompressed), mb(totalUncompressed),
+           totalCompressed ? (double)totalUncompressed / totalCompressed : 0.0);
+
+    // Functions, largest total size first
+    std::vector<int> ids;
+    for (int id = 1; id <= maxSigId; id++)
+    {
+        if (funcs[id].calls) ids.push_back(id);
+    }
+    std::sort(ids.begin(), ids.end(), [&](int a, int b) { return funcs[a].bytes > funcs[b].bytes; });
+    printf("\n%-48s %12s %8s %14s %8s %12s %12s\n", "Function", "Calls", "Calls%", "Bytes", "Bytes%", "Avg bytes", "Max bytes");
+    for (unsigned i = 0; i < ids.size() && (top == 0 || i < top); i++)
+    {
+        const FuncStats& f = funcs[ids[i]];
+        printf("%-48s %12" PRIu64 " %7.2f%% %14" PRIu64 " %7.2f%% %12.1f %12" PRIu64 "\n", inputFile.ExIdToName(ids[i]),
+               f.calls, 100.0 * f.calls / totalCalls, f.bytes, 100.0 * f.bytes / totalUncompressed,
+               (double)f.bytes / f.calls, f.maxBytes);
+    }
+
+    // Frame size distribution
+    if (!frames.empty())
+    {
+        std::vector<uint64_t> sorted = frames;
+        std::sort(sorted.begin(), sorted.end());
+        auto percentile = [&](double p) { return sorted[std::min(sorted.size() - 1, (size_t)(p * sorted.size()))]; };
+        printf("\nFrames (on thread %d): %u\n", tid, (unsigned)frames.size());
+        printf("Frame bytes: min %" PRIu64 ", median %" PRIu64 ", p90 %" PRIu64 ", p99 %" PRIu64 ", max %" PRIu64 "\n",
+               sorted.front(), percentile(0.5), percentile(0.9), percentile(0.99), sorted.back());
+        std::vector<unsigned> largest(frames.size());
+        for (unsigned i = 0; i < largest.size(); i++) largest[i] = i;
+        std::sort(largest.begin(), largest.end(), [&](unsigned a, unsigned b) { return frames[a] > frames[b]; });
+        printf("Largest frames:\n");
+        for (unsigned i = 0; i < largest.size() && (top == 0 || i < top); i++)
+        {
+            printf("  frame %u: %.2f MB\n", largest[i], mb(frames[largest[i]]));
+        }
+        if (printFrames)
+        {
+            printf("\n%8s %14s\n", "Frame", "Bytes");
+            for (unsigned i = 0; i < frames.size(); i++)
+            {
+                printf("%8u %14" PRIu64 "\n", i, frames[i]);
+            }
+        }
+    }
+
+    // Chunk compression
+    if (!chunks.empty())
+    {
+        double minRatio = 1e30, maxRatio = 0.0;
+        for (const common::TraceScanner::Chunk& c : chunks)
+        {
+            const double ratio = c.ref.length ? (double)c.uncompressed / c.ref.length : 0.0;
+            minRatio = std::min(minRatio, ratio);
+            maxRatio = std::max(maxRatio, ratio);
+        }
+        printf("\nChunk compression ratio: min %.2f, max %.2f\n", minRatio, maxRatio);
+        if (printChunks)
+        {
+            printf("\n%8s %12s %14s %8s %10s %8s\n", "Chunk", "Compressed", "Uncompressed", "Ratio", "Calls", "Swaps");
+            for (unsigned i = 0; i < chunks.size(); i++)
+            {
+                const common::TraceScanner::Chunk& c = chunks[i];
+                printf("%8u %12u %14" PRIu64 " %8.2f %10" PRIu64 " %8u\n", i, (unsigned)c.ref.length, c.uncompressed,
+                       c.ref.length ? (double)c.uncompressed / c.ref.length : 0.0, c.calls, (unsigned)c.frameEnds.size());
+            }
+        }
+    }
+
+    inputFile.Close();
+    return 0;
+}
@@ -0,0 +1,230 @@
+// Check the compressed chunks of a trace file, and optionally salvage the
+// intact part of a damaged or truncated one. Chunks are checked in
+// parallel: their checksums are compared, where the trace has them, and
+// they are decompressed and their call headers walked. A salvaged copy ends
+// with the last frame-ending swap before the first bad chunk.
+
+#include <common/in_file_mt.hpp>
+#include <common/out_file.hpp>
+#include <common/os.hpp>
+#include <common/trace_scan.hpp>
+#include "tool/utils.hpp"
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <string>
+#include <thread>
+#include <vector>
+
+static void usage(const char *argv0)
+{
+    fprintf(stderr,
+        "Usage: %s [OPTIONS] <trace.pat> [<salvaged.pat>]\n"
+        "Check every chunk of a trace file. If the file is damaged or truncated and an\n"
+        "output file is given, write the frames before the first bad chunk to it.\n"
+        "\n"
+        "  -j N       Number of checking threads (default: number of CPUs)\n"
+        "  -tid N     Only count swaps on this thread as frame ends (default: the trace's default thread)\n"
+        "  -chunks    Print the result for every chunk\n"
+        "  -finalize  First cut the unused end off a trace whose writer crashed while writing it through a mapping\n"
+        "  -h         Print this help\n"
+        "\n"
+        "Exits with 0 if the whole file is intact and 1 otherwise, even if it was salvaged.\n"
+        , argv0);
+}
+
+int main(int argc, char **argv)
+{
+    unsigned threads = std::max(1u, std::thread::hardware_concurrency());
+    int tid = -1;
+    bool printChunks = false;
+    bool finalize = false;
+    std::string filename;
+    std::string outname;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        const char *arg = argv[i];
+
+        if (!strcmp(arg, "-j") && i + 1 < argc)
+        {
+            threads = std::max(1, atoi(argv[++i]));
+        }
+        else if (!strcmp(arg, "-tid") && i + 1 < argc)
+        {
+            tid = atoi(argv[++i]);
+        }
+        else if (!strcmp(arg, "-chunks"))
+        {
+            printChunks = true;
+        }
+        else if (!strcmp(arg, "-finalize"))
+        {
+            finalize = true;
+        }
+        else if (!strcmp(arg, "-h") || !strcmp(arg, "--help"))
+        {
+            usage(argv[0]);
+            return 0;
+        }
+        else if (arg[0] == '-')
+        {
+            DBG_LOG("error: unknown option %s\n", arg);
+            usage(argv[0]);
+            return 1;
+        }
+        else if (filename.empty())
+        {
+            filename = arg;
+        }
+        else if (outname.empty())
+        {
+            outname = arg;
+        }
+        else
+        {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    if (filename.empty())
+    {
+        usage(argv[0]);
+        return 1;
+    }
+
+    if (finalize && !common::OutFile::Finalize(filename.c_str()))
+    {
+        return 1;
+    }
+
+    // The header and the sig book in the first chunk must be intact for
+    // anything to be recovered.
+    common::InFile inputFile;
+    inputFile.setSalvage(true);
+    if (!inputFile.Open(filename.c_str()))
+    {
+        DBG_LOG("%s has no usable header or first chunk - nothing can be recovered\n", filename.c_str());
+        return 1;
+    }
+    if (tid == -1)
+    {
+        tid = inputFile.getDefaultThreadID();
+    }
+
+    const int64_t t0 = os::getTime();
+    common::TraceScanner scanner(inputFile, tid);
+    const common::ChunkStatus tail = scanner.findChunks();
+    scanner.scan(threads, true);
+    const std::vector<common::TraceScanner::Chunk>& chunks = scanner.chunks();
+    const double seconds = (double)(os::getTime() - t0) / os::timeFrequency;
+
+    size_t intact = 0;
+    while (intact < chunks.size() && !chunks[intact].error)
+    {
+        intact++;
+    }
+    uint64_t checksummed = 0;
+    uint64_t compressed = 0;
+    for (const common::TraceScanner::Chunk& c : chunks)
+    {
+        checksummed += c.ref.hasChecksum;
+        compressed += c.ref.frameLength;
+    }
+
+    if (printChunks)
+    {
+        printf("%8s %14s %10s %8s %6s %s\n", "chunk", "offset", "size", "calls", "swaps", "status");
+        for (size_t i = 0; i < chunks.size(); i++)
+        {
+            const common::TraceScanner::Chunk& c = chunks[i];
+            printf("%8u %14" PRId64 " %10u %8" PRIu64 " %6u %s%s\n", (unsigned)i, c.offset, (unsigned)c.ref.length,
+                   c.calls, (unsigned)c.frameEnds.size(), c.error ? c.error : "ok", c.ref.hasChecksum ? "" : " (no checksum)");
+        }
+    }
+
+    printf("Checked %u chunks (%.2f MB, %" PRIu64 " with checksums) in %.2f s\n",
+           (unsigned)chunks.size(), compressed / (1024.0 * 1024.0), checksummed, seconds);
+    bool damaged = false;
+    if (intact < chunks.size())
+    {
+        printf("Chunk %u at offset %" PRId64 " is bad: %s\n", (unsigned)intact, chunks[intact].offset, chunks[intact].error);
+        damaged = true;
+    }
+    if (tail == common::CHUNK_TRUNCATED)
+    {
+        printf("The file ends in a truncated chunk, %" PRId64 " bytes are left over\n", scanner.trailing());
+        damaged = true;
+    }
+    if (!damaged)
+    {
+        printf("All chunks are intact\n");
+        if (!outname.empty())
+        {
+            printf("Nothing to salvage, %s not written\n", outname.c_str());
+        }
+        return 0;
+    }
+    if (checksummed < chunks.size())
+    {
+        printf("Warning: not all chunks have checksums, so damage in them may go unnoticed\n");
+    }
+    if (outname.empty())
+    {
+        return 1;
+    }
+
+    // Salvage everything up to the last swap before the first bad chunk
+    size_t last = intact;
+    while (last > 0 && chunks[last - 1].frameEnds.empty())
+    {
+        last--;
+    }
+    if (last == 0)
+    {
+        printf("No complete frame before the damage - nothing to salvage\n");
+        return 1;
+    }
+    last--;
+
+    common::OutFile outputFile;
+    outputFile.setChunkChecksums(checksummed > 0);
+    if (!outputFile.Open(outname.c_str(), false))
+    {
+        return 1;
+    }
+    std::vector<char> buffer;
+    uint64_t calls = 0;
+    uint64_t frames = 0;
+    for (size_t i = 0; i <= last; i++)
+    {
+        const common::TraceScanner::Chunk& c = chunks[i];
+        buffer.clear();
+        common::uncompressChunk(c.ref, buffer);
+        const size_t size = (i == last) ? c.frameEnds.back().offset : buffer.size();
+        outputFile.Write(buffer.data(), size);
+        calls += (i == last) ? c.frameEnds.back().calls : c.calls;
+        frames += c.frameEnds.size();
+    }
+
+    Json::Value header = inputFile.getJSONHeader();
+    Json::Value info;
+    info["chunks_salvaged"] = (unsigned)(last + 1);
+    info["chunks_lost"] = (unsigned)(chunks.size() - last - 1);
+    info["bad_chunk_offset"] = (Json::Int64)(intact < chunks.size() ? chunks[intact].offset : inputFile.chunksEnd() - inputFile.chunksBegin() - scanner.trailing());
+    header["callCnt"] = (Json::UInt64)calls;
+    header["frameCnt"] = (Json::UInt64)frames;
+    addConversionEntry(header, "trace_verify", filename, info);
+    Json::FastWriter writer;
+    const std::string json_header = writer.write(header);
+    outputFile.mHeader.jsonLength = json_header.size();
+    outputFile.WriteHeader(json_header.c_str(), json_header.size());
+    outputFile.Close();
+    inputFile.Close();
+
+    printf("Salvaged %" PRIu64 " frames and %" PRIu64 " calls to %s\n", frames, calls, outname.c_str());
+    return 1;
+}
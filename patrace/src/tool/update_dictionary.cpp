@@ -13,7 +13,7 @@
 #include <map>
 #include <stdbool.h>
 
-#include <snappy.h>
+#include "common/trace_chunk.hpp"
 
 #include "common/out_file.hpp"
 #include "common/api_info.hpp"
@@ -58,26 +58,6 @@ void mywrite(const void *data, size_t size, FILE *fp)
 	}
 }
 
-// no idea why we're doing conversion stuff only here but ignore it everywhere else
-bool read_compressed_length(unsigned *length, FILE *in)
-{
-	unsigned char buf[4];
-	if (fread(buf, sizeof(buf), 1, in) != 1)
-	{
-		if (feof(in))
-		{
-			return false; // done
-		}
-		printf("Error: %s\n", strerror(ferror(in)));
-		exit(1);
-	}
-	*length  =  (size_t)buf[0];
-	*length |= ((size_t)buf[1] <<  8);
-	*length |= ((size_t)buf[2] << 16);
-	*length |= ((size_t)buf[3] << 24);
-	return true;
-}
-
 int main(int argc, char **argv)
 {
 	if (argc != 3)
@@ -136,58 +116,32 @@ int main(int argc, char **argv)
 		fseek(ra, jsonFileEnd, SEEK_SET);
 	}
 
-	// Find size of uncompressed data buffer -- parsing everything twice, which is wildly inefficient but don't care
-	uint32_t compressed_length = 0;
-	size_t size = 0;
-	size_t start_pos = ftell(in);
-	size_t uncompressed_length = 0;
-	std::vector<char> buffer_compressed;
-	for (;;)
+	// Read rest of file into memory, and uncompress it
+	std::vector<char> compressed;
+	char readbuf[64 * 1024];
+	size_t r;
+	while ((r = fread(readbuf, 1, sizeof(readbuf), in)) > 0)
 	{
-		// Read chunk length
-		if (!read_compressed_length(&compressed_length, in))
-		{
-			printf("Done reading first round\n");
-			break;
-		}
-		buffer_compressed.resize(compressed_length);
-		myread(buffer_compressed.data(), compressed_length, in, "reading chunk pass 1");
-		if (snappy::GetUncompressedLength(buffer_compressed.data(), buffer_compressed.size(), &size) == false)
-		{
-			printf("Error checking chunk size (pass 1)\n");
-			abort();
-		}
-		uncompressed_length += size;
+		compressed.insert(compressed.end(), readbuf, readbuf + r);
+	}
+	std::vector<common::ChunkRef> chunks;
+	if (common::findChunks(compressed.data(), compressed.data() + compressed.size(), chunks) != common::CHUNK_END)
+	{
+		printf("Error: the last chunk is truncated\n");
+		exit(1);
 	}
-	fseek(in, start_pos, SEEK_SET);
-
-	// Read rest of file into memory
 	std::vector<char> big_buffer;
-	big_buffer.resize(uncompressed_length);
-	size_t big_counter = 0;
-	for (;;)
+	for (const common::ChunkRef& chunk : chunks)
 	{
-		// Read chunk length
-		if (!read_compressed_length(&compressed_length, in))
-		{
-			printf("Done reading second round\n");
-			break;
-		}
-		buffer_compressed.resize(compressed_length);
-		myread(buffer_compressed.data(), compressed_length, in, "reading chunk pass 2");
-		if (snappy::GetUncompressedLength(buffer_compressed.data(), buffer_compressed.size(), &size) == false)
-		{
-			printf("Error checking chunk size (pass 2)\n");
-			abort();
-		}
-		if (snappy::RawUncompress(buffer_compressed.data(), buffer_compressed.size(), &big_buffer.data()[big_counter]) == false)
+		const size_t size = big_buffer.size();
+		if (!common::uncompressChunk(chunk, big_buffer))
 		{
-			printf("Error decompressing chunk (pass 2)\n");
+			printf("Error decompressing chunk\n");
 			abort();
 		}
-		mywrite(&big_buffer.data()[big_counter], size, ra);
-		big_counter += size;
+		mywrite(&big_buffer.data()[size], big_buffer.size() - size, ra);
 	}
+	const size_t uncompressed_length = big_buffer.size();
 	if (ra)
 	{
 		fclose(ra);
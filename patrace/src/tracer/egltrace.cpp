@@ -152,6 +152,8 @@ BinAndMeta::BinAndMeta()
     free(bn);
 
     traceFile = new OutFile;
+    traceFile->setChunkChecksums(tracerParams.ChunkChecksums);
+    traceFile->setMapped(tracerParams.MappedTraceFile);
     if (tracerParams.Timestamping) traceFile->Open(binName.str(), true, NULL, true);
     else traceFile->Open(binName.str());
 
@@ -1466,6 +1468,12 @@ void after_eglSwapBuffers()
     {
         gTraceOut->mpBinAndMeta->writeHeader(true);
     }
+    else if (gTraceOut->frameNo == 0)
+    {
+        // Write the header once the first frame has set things up, so that
+        // the file can still be salvaged if we never get to write it at exit.
+        gTraceOut->mpBinAndMeta->writeHeader(false);
+    }
     gTraceOut->frameNo++;
 }
 
@@ -45,6 +45,8 @@ TracerParams::TracerParams()
         DBG_LOG("EnableActiveAttribCheck: %s\n", EnableActiveAttribCheck ? "true" : "false");
         DBG_LOG("InteractiveIntercept: %s\n", InteractiveIntercept ? "true" : "false");
         DBG_LOG("FlushTraceFileEveryFrame: %s\n", FlushTraceFileEveryFrame ? "true" : "false");
+        DBG_LOG("ChunkChecksums: %s\n", ChunkChecksums ? "true" : "false");
+        DBG_LOG("MappedTraceFile: %s\n", MappedTraceFile ? "true" : "false");
         DBG_LOG("DisableBufferStorage: %s\n", DisableBufferStorage ? "true" : "false");
         DBG_LOG("RendererName: %s\n", RendererName.c_str());
         DBG_LOG("EnableRandomVersion: %s\n", EnableRandomVersion ? "true": "false");
@@ -135,6 +137,10 @@ void TracerParams::LoadParams()
             FilterSupportedExtension = (strParamValue.compare("true") == 0);
         } else if (strParamName.compare("FlushTraceFileEveryFrame") == 0) {
             FlushTraceFileEveryFrame = (strParamValue.compare("true") == 0);
+        } else if (strParamName.compare("ChunkChecksums") == 0) {
+            ChunkChecksums = (strParamValue.compare("true") == 0);
+        } else if (strParamName.compare("MappedTraceFile") == 0) {
+            MappedTraceFile = (strParamValue.compare("true") == 0);
         } else if (strParamName.compare("StateDumpAfterSnapshot") == 0) {
             StateDumpAfterSnapshot = (strParamValue.compare("true") == 0);
         } else if (strParamName.compare("DisableErrorReporting") == 0) {
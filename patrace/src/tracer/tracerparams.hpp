@@ -17,6 +17,8 @@ public:
     std::string RendererName = "";
     bool DisableBufferStorage = false;
     bool FlushTraceFileEveryFrame = true;           // Save trace file for each completed frame. Slower but safer.
+    bool ChunkChecksums = false;                    // Checksum each compressed chunk, so trace_verify can find damage and salvage the rest
+    bool MappedTraceFile = false;                   // Write the trace file through a memory mapping. Survives app crashes without FlushTraceFileEveryFrame
     bool StateDumpAfterSnapshot = false;            // Debugging
     bool StateDumpAfterDrawCall = false;            // Debugging
     int UniformBufferOffsetAlignment = 256;         // Enforce an alignment that works crossplatform
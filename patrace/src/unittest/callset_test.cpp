@@ -0,0 +1,41 @@
+#include "callset_test.hpp"
+#include "common/trace_callset.hpp"
+
+#include <string>
+#include <vector>
+
+using namespace common;
+
+CallSetTest::CallSetTest()
+{
+}
+
+void CallSetTest::setUp()
+{
+}
+
+void CallSetTest::tearDown()
+{
+}
+
+void CallSetTest::testCompiled()
+{
+    const std::vector<std::string> names = { "", "glClear", "eglSwapBuffers", "glDrawArrays", "glBindFramebuffer" };
+    const char* sets[] = { "*", "5", "1-10", "2-20/3", "0-100/frame", "10-30/draw,20-25,40", "*/fbo", "7,3,5-6,1000-1010/2" };
+    for (const char* str : sets)
+    {
+        CallSet set(str);
+        set.compile(names);
+        for (CallNo no = 0; no < 1100; no++)
+        {
+            for (unsigned id = 1; id < names.size(); id++)
+            {
+                CPPUNIT_ASSERT_EQUAL(set.contains(no, names[id].c_str()), set.contains(no, id));
+            }
+        }
+    }
+
+    CallSet empty("");
+    empty.compile(names);
+    CPPUNIT_ASSERT(!empty.contains(0, 1u));
+}
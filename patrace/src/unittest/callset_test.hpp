@@ -0,0 +1,23 @@
+#ifndef _INCLUDE_CALLSET_TEST_
+#define _INCLUDE_CALLSET_TEST_
+
+#include <cppunit/extensions/HelperMacros.h>
+
+class CallSetTest : public CPPUNIT_NS::TestFixture
+{
+    CPPUNIT_TEST_SUITE(CallSetTest);
+
+    CPPUNIT_TEST(testCompiled);
+
+    CPPUNIT_TEST_SUITE_END();
+
+public:
+    CallSetTest();
+
+    virtual void setUp();
+    virtual void tearDown();
+
+    void testCompiled();
+};
+
+#endif
@@ -0,0 +1,110 @@
+#include "dedup_state_test.hpp"
+#include "tool/dedup_state.hpp"
+
+#include <initializer_list>
+
+using namespace common;
+
+DedupStateTest::DedupStateTest()
+{
+}
+
+void DedupStateTest::setUp()
+{
+}
+
+void DedupStateTest::tearDown()
+{
+}
+
+static ValueTM* bufferOffset(unsigned int offset)
+{
+    ValueTM* v = new ValueTM();
+    v->SetAsBufferReference(offset);
+    return v;
+}
+
+static bool redundant(StateShadow& shadow, const char* name, std::initializer_list<ValueTM*> args)
+{
+    CallTM call(name);
+    call.mArgs.assign(args.begin(), args.end());
+    std::string group;
+    return shadow.redundant(&call, group);
+}
+
+static bool vertexAttribPointer(StateShadow& shadow)
+{
+    return redundant(shadow, "glVertexAttribPointer", { new ValueTM(0u), new ValueTM(4), new ValueTM((unsigned)GL_FLOAT),
+                                                        new ValueTM(0u), new ValueTM(16), bufferOffset(0) });
+}
+
+static bool bindVertexBuffer(StateShadow& shadow)
+{
+    return redundant(shadow, "glBindVertexBuffer", { new ValueTM(0u), new ValueTM(1u), new ValueTM(0), new ValueTM(16) });
+}
+
+void DedupStateTest::testRepeatedState()
+{
+    std::deque<StateTracker::Context> contexts;
+    contexts.emplace_back(1, 1, 0);
+    int index = 0;
+    StateShadow shadow(contexts, index);
+
+    CPPUNIT_ASSERT(!redundant(shadow, "glDepthFunc", { new ValueTM((unsigned)GL_LESS) }));
+    CPPUNIT_ASSERT(redundant(shadow, "glDepthFunc", { new ValueTM((unsigned)GL_LESS) }));
+    CPPUNIT_ASSERT(!redundant(shadow, "glDepthFunc", { new ValueTM((unsigned)GL_LEQUAL) }));
+    CPPUNIT_ASSERT(!vertexAttribPointer(shadow));
+    CPPUNIT_ASSERT(vertexAttribPointer(shadow));
+}
+
+void DedupStateTest::testVertexAttribPointerBinding()
+{
+    std::deque<StateTracker::Context> contexts;
+    contexts.emplace_back(1, 1, 0);
+    int index = 0;
+    StateShadow shadow(contexts, index);
+
+    // glVertexAttribPointer also sets the vertex buffer binding of the
+    // attribute, so neither call repeats the state of the previous one
+    CPPUNIT_ASSERT(!vertexAttribPointer(shadow));
+    CPPUNIT_ASSERT(!bindVertexBuffer(shadow));
+    CPPUNIT_ASSERT(!vertexAttribPointer(shadow));
+    CPPUNIT_ASSERT(!bindVertexBuffer(shadow));
+    CPPUNIT_ASSERT(bindVertexBuffer(shadow));
+
+    CPPUNIT_ASSERT(!redundant(shadow, "glVertexAttribBinding", { new ValueTM(0u), new ValueTM(1u) }));
+    CPPUNIT_ASSERT(!vertexAttribPointer(shadow));
+    CPPUNIT_ASSERT(!redundant(shadow, "glVertexAttribBinding", { new ValueTM(0u), new ValueTM(1u) }));
+}
+
+void DedupStateTest::testVertexAttribDivisorBinding()
+{
+    std::deque<StateTracker::Context> contexts;
+    contexts.emplace_back(1, 1, 0);
+    int index = 0;
+    StateShadow shadow(contexts, index);
+
+    // glVertexAttribDivisor also binds the attribute to the binding of the same index
+    CPPUNIT_ASSERT(!redundant(shadow, "glVertexAttribBinding", { new ValueTM(0u), new ValueTM(1u) }));
+    CPPUNIT_ASSERT(!redundant(shadow, "glVertexAttribDivisor", { new ValueTM(0u), new ValueTM(1u) }));
+    CPPUNIT_ASSERT(!redundant(shadow, "glVertexAttribBinding", { new ValueTM(0u), new ValueTM(1u) }));
+}
+
+void DedupStateTest::testDefaultTexturePerContext()
+{
+    std::deque<StateTracker::Context> contexts;
+    contexts.emplace_back(1, 1, 0);
+    contexts.emplace_back(2, 1, 1, 1, &contexts.at(0));
+    int index = 0;
+    StateShadow shadow(contexts, index);
+
+    // Texture 0 is not shared, even between contexts of one share group
+    CPPUNIT_ASSERT(!redundant(shadow, "glTexParameteri", { new ValueTM((unsigned)GL_TEXTURE_2D), new ValueTM((unsigned)GL_TEXTURE_MIN_FILTER), new ValueTM(GL_NEAREST) }));
+    CPPUNIT_ASSERT(redundant(shadow, "glTexParameteri", { new ValueTM((unsigned)GL_TEXTURE_2D), new ValueTM((unsigned)GL_TEXTURE_MIN_FILTER), new ValueTM(GL_NEAREST) }));
+    index = 1;
+    CPPUNIT_ASSERT(!redundant(shadow, "glTexParameteri", { new ValueTM((unsigned)GL_TEXTURE_2D), new ValueTM((unsigned)GL_TEXTURE_MIN_FILTER), new ValueTM(GL_NEAREST) }));
+    // nor between the targets of one context
+    CPPUNIT_ASSERT(!redundant(shadow, "glTexParameteri", { new ValueTM((unsigned)GL_TEXTURE_3D), new ValueTM((unsigned)GL_TEXTURE_MIN_FILTER), new ValueTM(GL_NEAREST) }));
+    index = 0;
+    CPPUNIT_ASSERT(redundant(shadow, "glTexParameteri", { new ValueTM((unsigned)GL_TEXTURE_2D), new ValueTM((unsigned)GL_TEXTURE_MIN_FILTER), new ValueTM(GL_NEAREST) }));
+}
@@ -0,0 +1,29 @@
+#ifndef _INCLUDE_DEDUP_STATE_TEST_
+#define _INCLUDE_DEDUP_STATE_TEST_
+
+#include <cppunit/extensions/HelperMacros.h>
+
+class DedupStateTest : public CPPUNIT_NS::TestFixture
+{
+    CPPUNIT_TEST_SUITE(DedupStateTest);
+
+    CPPUNIT_TEST(testRepeatedState);
+    CPPUNIT_TEST(testVertexAttribPointerBinding);
+    CPPUNIT_TEST(testVertexAttribDivisorBinding);
+    CPPUNIT_TEST(testDefaultTexturePerContext);
+
+    CPPUNIT_TEST_SUITE_END();
+
+public:
+    DedupStateTest();
+
+    virtual void setUp();
+    virtual void tearDown();
+
+    void testRepeatedState();
+    void testVertexAttribPointerBinding();
+    void testVertexAttribDivisorBinding();
+    void testDefaultTexturePerContext();
+};
+
+#endif
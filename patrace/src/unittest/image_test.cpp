@@ -1,5 +1,7 @@
 #include <GLES2/gl2.h>
 #include <GLES2/gl2ext.h>
+#include <stdlib.h>
+#include <vector>
 
 #include "image_test.hpp"
 #include "eglstate/common.hpp"
@@ -7,6 +9,7 @@
 #include "image/image_compression.hpp"
 #include "image/image.hpp"
 #include "image/image_io.hpp"
+#include "common/pixel_convert.hpp"
 
 using namespace pat;
 
@@ -262,6 +265,77 @@ void ImageTest::testETC2()
     //CPPUNIT_ASSERT(input.DataSize() == 24);
 }
 
+void ImageTest::testETC2Uncompress()
+{
+    // Planar mode, a red ramp from left to right
+    {
+    UInt8 comp_data[] = { 0x00, 0x00, 0x04, 0x7F, 0x00, 0x00, 0x00, 0x00 };
+    const UInt8 ramp[] = { 0, 64, 128, 191 };
+    Image input(4, 4, GL_COMPRESSED_RGB8_ETC2, GL_NONE, sizeof(comp_data), comp_data, false, false);
+    Image output;
+    CPPUNIT_ASSERT(Uncompress(input, output));
+    CPPUNIT_ASSERT(output.Format() == GL_RGB);
+    CPPUNIT_ASSERT(output.Type() == GL_UNSIGNED_BYTE);
+    CPPUNIT_ASSERT(output.DataSize() == 4 * 4 * 3);
+    for (UInt32 i = 0; i < 16; ++i)
+    {
+        CPPUNIT_ASSERT(output.Data()[i * 3] == ramp[i % 4]);
+        CPPUNIT_ASSERT(output.Data()[i * 3 + 1] == 0);
+        CPPUNIT_ASSERT(output.Data()[i * 3 + 2] == 0);
+    }
+    }
+
+    // Punchthrough alpha, non-opaque block with a transparent first column
+    {
+    UInt8 comp_data[] = { 0x80, 0x00, 0x00, 0x00, 0x00, 0x0F, 0x00, 0x00 };
+    Image input(3, 2, GL_COMPRESSED_RGB8_PUNCHTHROUGH_ALPHA1_ETC2, GL_NONE, sizeof(comp_data), comp_data, false, false);
+    Image output;
+    CPPUNIT_ASSERT(Uncompress(input, output));
+    CPPUNIT_ASSERT(output.Format() == GL_RGBA);
+    CPPUNIT_ASSERT(output.DataSize() == 3 * 2 * 4);
+    const UInt8 transparent[] = { 0, 0, 0, 0 };
+    const UInt8 opaque[] = { 132, 0, 0, 255 };
+    for (UInt32 i = 0; i < 6; ++i)
+        CPPUNIT_ASSERT(memcmp(output.Data() + i * 4, (i % 3 == 0) ? transparent : opaque, 4) == 0);
+    }
+
+    // EAC alpha followed by an individual mode colour block
+    {
+    UInt8 comp_data[] = { 0x80, 0x10, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+                          0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 };
+    Image input(1, 1, GL_COMPRESSED_RGBA8_ETC2_EAC, GL_NONE, sizeof(comp_data), comp_data, false, false);
+    Image output;
+    CPPUNIT_ASSERT(Uncompress(input, output));
+    const UInt8 pixel[] = { 2, 2, 2, 125 };
+    CPPUNIT_ASSERT(output.DataSize() == 4);
+    CPPUNIT_ASSERT(memcmp(output.Data(), pixel, 4) == 0);
+    }
+
+    // Threaded uncompression of several levels gives the same result as one thread
+    {
+    std::vector<UInt8> comp_data(256 * 256 / 2);
+    UInt32 seed = 1;
+    for (size_t i = 0; i < comp_data.size(); ++i)
+    {
+        seed = seed * 1103515245u + 12345u;
+        comp_data[i] = seed >> 16;
+    }
+    Image level0(250, 256, GL_ETC1_RGB8_OES, GL_NONE, comp_data.size(), comp_data.data(), false, false);
+    Image level1(125, 128, GL_COMPRESSED_RGB8_ETC2, GL_NONE, comp_data.size() / 4, comp_data.data(), false, false);
+    Image reference0, reference1, output0, output1;
+    SetUncompressionThreadCount(1);
+    CPPUNIT_ASSERT(Uncompress(level0, reference0));
+    CPPUNIT_ASSERT(Uncompress(level1, reference1));
+    SetUncompressionThreadCount(4);
+    CPPUNIT_ASSERT(UncompressLevels({ &level0, &level1 }, { &output0, &output1 }));
+    SetUncompressionThreadCount(0);
+    CPPUNIT_ASSERT(output0.DataSize() == 250 * 256 * 3);
+    CPPUNIT_ASSERT(memcmp(output0.Data(), reference0.Data(), output0.DataSize()) == 0);
+    CPPUNIT_ASSERT(output1.DataSize() == 125 * 128 * 3);
+    CPPUNIT_ASSERT(memcmp(output1.Data(), reference1.Data(), output1.DataSize()) == 0);
+    }
+}
+
 void ImageTest::testASTC()
 {
     std::string path_value;
@@ -325,3 +399,64 @@ void ImageTest::testMipmap()
     //CPPUNIT_ASSERT(first_level.Type() == GL_UNSIGNED_BYTE);
     //CPPUNIT_ASSERT(memcmp(first_level.Data(), first_level_data, first_level.DataSize()) == 0);
 }
+
+void ImageTest::testPixelConvert()
+{
+    // Wide enough for the vector loops and with a tail for the scalar ones
+    const UInt32 width = 37, height = 3;
+    std::vector<UInt8> rgba(width * height * 4);
+    for (UInt32 i = 0; i < width * height; ++i)
+    {
+        const UInt8 pixel[] = { (UInt8)(i * 7), (UInt8)(i * 13), (UInt8)(i * 29), (UInt8)i };
+        memcpy(&rgba[i * 4], pixel, 4);
+    }
+    // White and black must map exactly
+    memset(&rgba[0], 0xFF, 4);
+    memset(&rgba[8], 0x00, 4);
+
+    std::vector<UInt8> swapped(rgba.size());
+    image::swapRedBlue(rgba.data(), swapped.data(), width * height);
+    std::vector<UInt8> rgb(width * height * 3);
+    image::rgbaToRgb(rgba.data(), rgb.data(), width * height);
+    for (UInt32 i = 0; i < width * height; ++i)
+    {
+        CPPUNIT_ASSERT(swapped[i * 4] == rgba[i * 4 + 2] && swapped[i * 4 + 2] == rgba[i * 4]);
+        CPPUNIT_ASSERT(swapped[i * 4 + 1] == rgba[i * 4 + 1] && swapped[i * 4 + 3] == rgba[i * 4 + 3]);
+        CPPUNIT_ASSERT(memcmp(&rgb[i * 3], &rgba[i * 4], 3) == 0);
+    }
+
+    const UInt32 chromaWidth = (width + 1) / 2, chromaHeight = (height + 1) / 2;
+    std::vector<UInt8> nv12(width * height + chromaWidth * 2 * chromaHeight);
+    std::vector<UInt8> nv21(nv12.size());
+    std::vector<UInt8> i420(width * height + chromaWidth * chromaHeight * 2);
+    UInt8 *nv12_uv = nv12.data() + width * height;
+    UInt8 *nv21_vu = nv21.data() + width * height;
+    UInt8 *i420_u = i420.data() + width * height;
+    UInt8 *i420_v = i420_u + chromaWidth * chromaHeight;
+    image::rgbaToYuv420(rgba.data(), width, height, nv12.data(), width, nv12_uv, nv12_uv + 1, chromaWidth * 2, 2);
+    image::rgbaToYuv420(rgba.data(), width, height, nv21.data(), width, nv21_vu + 1, nv21_vu, chromaWidth * 2, 2);
+    image::rgbaToYuv420(rgba.data(), width, height, i420.data(), width, i420_u, i420_v, chromaWidth, 1);
+
+    CPPUNIT_ASSERT(nv12[0] == 255 && nv12_uv[0] == 128 && nv12_uv[1] == 128);
+    CPPUNIT_ASSERT(nv12[2] == 0 && nv12_uv[2] == 128 && nv12_uv[3] == 128);
+    CPPUNIT_ASSERT(memcmp(nv12.data(), nv21.data(), width * height) == 0);
+    CPPUNIT_ASSERT(memcmp(nv12.data(), i420.data(), width * height) == 0);
+    for (UInt32 y = 0; y < height; ++y)
+    {
+        for (UInt32 x = 0; x < width; ++x)
+        {
+            const UInt8 *p = &rgba[(y * width + x) * 4];
+            const int luma = (int)(0.299 * p[0] + 0.587 * p[1] + 0.114 * p[2]);
+            CPPUNIT_ASSERT(abs(luma - nv12[y * width + x]) <= 1);
+            if (x % 2 || y % 2)
+                continue;
+
+            const UInt32 c = (y / 2) * chromaWidth + x / 2;
+            const int u = (int)(-0.169 * p[0] - 0.331 * p[1] + 0.500 * p[2] + 128);
+            const int v = (int)(0.500 * p[0] - 0.419 * p[1] - 0.081 * p[2] + 128);
+            CPPUNIT_ASSERT(abs(u - nv12_uv[c * 2]) <= 1 && abs(v - nv12_uv[c * 2 + 1]) <= 1);
+            CPPUNIT_ASSERT(nv21_vu[c * 2] == nv12_uv[c * 2 + 1] && nv21_vu[c * 2 + 1] == nv12_uv[c * 2]);
+            CPPUNIT_ASSERT(i420_u[c] == nv12_uv[c * 2] && i420_v[c] == nv12_uv[c * 2 + 1]);
+        }
+    }
+}
@@ -13,8 +13,10 @@ class ImageTest : public CPPUNIT_NS::TestFixture
     CPPUNIT_TEST(testBTC);
     CPPUNIT_TEST(testETC1);
     CPPUNIT_TEST(testETC2);
+    CPPUNIT_TEST(testETC2Uncompress);
     CPPUNIT_TEST(testASTC);
     CPPUNIT_TEST(testMipmap);
+    CPPUNIT_TEST(testPixelConvert);
 
 	CPPUNIT_TEST_SUITE_END();
 
@@ -30,8 +32,10 @@ public:
     void testBTC();
     void testETC1();
     void testETC2();
+    void testETC2Uncompress();
     void testASTC();
     void testMipmap();
+    void testPixelConvert();
 
     void testFormatTypeTraits();
     void testGenerateImageViewFromRawPixels();
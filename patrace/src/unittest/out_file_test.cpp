@@ -0,0 +1,155 @@
+#include "out_file_test.hpp"
+#include "common/out_file.hpp"
+#include "common/in_file_mt.hpp"
+#include "common/trace_chunk.hpp"
+
+#include <stdio.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <string>
+#include <vector>
+
+using namespace common;
+
+static const char* testFile = "out_file_test.pat";
+static const unsigned testCalls = 100;
+
+OutFileTest::OutFileTest()
+{
+}
+
+void OutFileTest::setUp()
+{
+}
+
+void OutFileTest::tearDown()
+{
+    unlink(testFile);
+}
+
+static long long fileSize()
+{
+    struct stat sb;
+    if (stat(testFile, &sb) != 0)
+        return -1;
+    return sb.st_size;
+}
+
+// Write a trace of variable length calls into a mapped file, one chunk per
+// ten calls, and leave it open if close is not set.
+static void writeTrace(bool close)
+{
+    const std::vector<std::string> sigbook = { "", "testCall" };
+    OutFile* out = new OutFile;
+    out->setMapped(true);
+    out->setChunkChecksums(true);
+    out->Open(testFile, true, &sigbook);
+    const std::string json = "{\"defaultTid\":0,\"glesVersion\":2,\"callCnt\":100,\"frameCnt\":0,\"threads\":[]}";
+    out->WriteHeader(json.c_str(), json.size(), false);
+    for (unsigned i = 0; i < testCalls; i++)
+    {
+        BCall_vlen call;
+        call.funcId = 1;
+        call.toNext = sizeof(call) + sizeof(i);
+        out->Write(&call, sizeof(call));
+        out->Write(&i, sizeof(i));
+        if (i % 10 == 9)
+            out->Flush();
+    }
+    if (close)
+        delete out;
+}
+
+// Read the trace back, checking the calls are all there and in order
+static bool readTrace()
+{
+    InFile in;
+    in.setVerifyChecksums(true);
+    if (!in.Open(testFile))
+        return false;
+    void* fptr;
+    BCall_vlen call;
+    char* src;
+    unsigned calls = 0;
+    while (in.GetNextCall(fptr, call, src))
+    {
+        if (call.funcId != 1 || *(unsigned*)src != calls)
+            return false;
+        calls++;
+    }
+    in.Close();
+    return calls == testCalls;
+}
+
+// Offset just past the last chunk, and whether what follows it ends the chunks
+static long long chunksEnd(bool& endMarker)
+{
+    FILE* fp = fopen(testFile, "rb");
+    if (!fp)
+        return -1;
+    fseek(fp, 0, SEEK_END);
+    std::vector<char> file(ftell(fp));
+    fseek(fp, 0, SEEK_SET);
+    const size_t read = fread(file.data(), 1, file.size(), fp);
+    fclose(fp);
+    if (read != file.size())
+        return -1;
+    size_t offset = ((BHeaderV3*)file.data())->jsonFileEnd;
+    ChunkRef chunk;
+    ChunkStatus status;
+    while ((status = parseChunk(file.data() + offset, file.size() - offset, chunk, true)) == CHUNK_OK)
+        offset += chunk.frameLength;
+    endMarker = status == CHUNK_END && offset < file.size();
+    return status == CHUNK_END ? (long long)offset : -1;
+}
+
+void OutFileTest::testMappedClose()
+{
+    writeTrace(true);
+
+    // Closing cuts the file right after the last chunk
+    bool endMarker;
+    const long long end = chunksEnd(endMarker);
+    CPPUNIT_ASSERT(end > 0);
+    CPPUNIT_ASSERT(!endMarker);
+    CPPUNIT_ASSERT(fileSize() == end);
+    CPPUNIT_ASSERT(readTrace());
+
+    // So there is nothing left to finalize
+    CPPUNIT_ASSERT(OutFile::Finalize(testFile));
+    CPPUNIT_ASSERT(fileSize() == end);
+    CPPUNIT_ASSERT(readTrace());
+}
+
+void OutFileTest::testMappedCrash()
+{
+    // Let a child write the trace and exit without closing it, as if the
+    // app had crashed
+    const pid_t pid = fork();
+    CPPUNIT_ASSERT(pid != -1);
+    if (pid == 0)
+    {
+        writeTrace(false);
+        _exit(0);
+    }
+    int status = 0;
+    CPPUNIT_ASSERT(waitpid(pid, &status, 0) == pid);
+    CPPUNIT_ASSERT(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+
+    // The unused part of the segment is still there, zero filled, which
+    // readers take as the end of the chunks
+    bool endMarker;
+    const long long end = chunksEnd(endMarker);
+    CPPUNIT_ASSERT(end > 0);
+    CPPUNIT_ASSERT(endMarker);
+    CPPUNIT_ASSERT(fileSize() > end);
+    CPPUNIT_ASSERT(readTrace());
+
+    // Finalizing cuts it off without losing any chunks
+    CPPUNIT_ASSERT(OutFile::Finalize(testFile));
+    CPPUNIT_ASSERT(fileSize() == end);
+    CPPUNIT_ASSERT(chunksEnd(endMarker) == end);
+    CPPUNIT_ASSERT(!endMarker);
+    CPPUNIT_ASSERT(readTrace());
+}
@@ -0,0 +1,25 @@
+#ifndef _INCLUDE_OUT_FILE_TEST_
+#define _INCLUDE_OUT_FILE_TEST_
+
+#include <cppunit/extensions/HelperMacros.h>
+
+class OutFileTest : public CPPUNIT_NS::TestFixture
+{
+    CPPUNIT_TEST_SUITE(OutFileTest);
+
+    CPPUNIT_TEST(testMappedClose);
+    CPPUNIT_TEST(testMappedCrash);
+
+    CPPUNIT_TEST_SUITE_END();
+
+public:
+    OutFileTest();
+
+    virtual void setUp();
+    virtual void tearDown();
+
+    void testMappedClose();
+    void testMappedCrash();
+};
+
+#endif
@@ -0,0 +1,143 @@
+#include "read_ahead_test.hpp"
+#include "common/read_ahead.hpp"
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+using namespace common;
+
+static const char* testFile = "read_ahead_test.bin";
+static const char* testDir = "read_ahead_test.dir";
+
+ReadAheadTest::ReadAheadTest()
+{
+}
+
+void ReadAheadTest::setUp()
+{
+}
+
+void ReadAheadTest::tearDown()
+{
+    unlink(testFile);
+    rmdir(testDir);
+}
+
+// Write a file of the given size whose bytes depend on their offset
+static std::vector<char> writeFile(size_t size)
+{
+    std::vector<char> data(size);
+    for (size_t i = 0; i < size; i++)
+        data[i] = (char)(i * 31 + i / 4096);
+    FILE* fp = fopen(testFile, "wb");
+    if (fp)
+    {
+        fwrite(data.data(), 1, data.size(), fp);
+        fclose(fp);
+    }
+    return data;
+}
+
+void ReadAheadTest::testEof()
+{
+    const std::vector<char> data = writeFile(10000);
+
+    // The file ends inside the second block
+    ReadAhead ra(4096, 4);
+    CPPUNIT_ASSERT(ra.Open(testFile, 0, false));
+    std::vector<char> buf(20000);
+    CPPUNIT_ASSERT(ra.Read(buf.data(), buf.size()) == data.size());
+    CPPUNIT_ASSERT(memcmp(buf.data(), data.data(), data.size()) == 0);
+    CPPUNIT_ASSERT(ra.Read(buf.data(), 1) == 0);
+    CPPUNIT_ASSERT(ra.error() == 0);
+    CPPUNIT_ASSERT(ra.bytesRead() == data.size());
+    ra.Close();
+
+    // The file ends exactly at a block boundary
+    writeFile(8192);
+    CPPUNIT_ASSERT(ra.Open(testFile, 0, false));
+    CPPUNIT_ASSERT(ra.Read(buf.data(), 8192) == 8192);
+    CPPUNIT_ASSERT(ra.Read(buf.data(), 1) == 0);
+    ra.Close();
+
+    // Nothing after the offset
+    CPPUNIT_ASSERT(ra.Open(testFile, 8192, false));
+    CPPUNIT_ASSERT(ra.Read(buf.data(), 1) == 0);
+}
+
+void ReadAheadTest::testShortReads()
+{
+    const std::vector<char> data = writeFile(100000);
+
+    // Start at an unaligned offset and read in pieces that straddle the
+    // blocks, with the ring going round several times
+    const size_t offset = 1234;
+    ReadAhead ra(4096, 2);
+    CPPUNIT_ASSERT(ra.Open(testFile, offset, false));
+    std::vector<char> buf(data.size());
+    size_t pos = offset;
+    size_t piece = 1;
+    while (pos < data.size())
+    {
+        const size_t n = ra.Read(buf.data() + pos, piece);
+        CPPUNIT_ASSERT(n == std::min(piece, data.size() - pos));
+        pos += n;
+        piece = piece * 3 % 5000 + 1;
+    }
+    CPPUNIT_ASSERT(memcmp(buf.data() + offset, data.data() + offset, data.size() - offset) == 0);
+    CPPUNIT_ASSERT(ra.Read(buf.data(), 1) == 0);
+    CPPUNIT_ASSERT(ra.memoryUsed() == 2 * 4096);
+}
+
+void ReadAheadTest::testStalls()
+{
+    const std::vector<char> data = writeFile(1024 * 1024);
+    std::vector<char> buf(data.size());
+
+    // The first read always finds the ring empty, as the thread has only just
+    // been started, and has to wait for it
+    {
+        ReadAhead ra(256 * 1024, 2);
+        CPPUNIT_ASSERT(ra.Open(testFile, 0, false));
+        CPPUNIT_ASSERT(ra.Read(buf.data(), buf.size()) == buf.size());
+        CPPUNIT_ASSERT(memcmp(buf.data(), data.data(), data.size()) == 0);
+        CPPUNIT_ASSERT(ra.stalls() >= 1);
+        CPPUNIT_ASSERT(ra.stallTime() >= 0);
+    }
+
+    // A slow consumer is never more than the ring ahead of, and the thread
+    // carries on once there is room again
+    {
+        ReadAhead ra(4096, 4);
+        CPPUNIT_ASSERT(ra.Open(testFile, 0, false));
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        CPPUNIT_ASSERT(ra.bytesRead() == 4 * 4096);
+        CPPUNIT_ASSERT(ra.Read(buf.data(), buf.size()) == buf.size());
+        CPPUNIT_ASSERT(memcmp(buf.data(), data.data(), data.size()) == 0);
+        CPPUNIT_ASSERT(ra.bytesRead() == data.size());
+    }
+}
+
+void ReadAheadTest::testError()
+{
+    // Directories open, but cannot be read, which must not look like an
+    // empty file
+    CPPUNIT_ASSERT(mkdir(testDir, 0700) == 0);
+    ReadAhead ra(4096, 2);
+    CPPUNIT_ASSERT(ra.Open(testDir, 0, false));
+    char buf[16];
+    CPPUNIT_ASSERT(ra.Read(buf, sizeof(buf)) == 0);
+    CPPUNIT_ASSERT(ra.error() != 0);
+    ra.Close();
+
+    // Opening again clears it
+    writeFile(100);
+    CPPUNIT_ASSERT(ra.Open(testFile, 0, false));
+    CPPUNIT_ASSERT(ra.Read(buf, sizeof(buf)) == sizeof(buf));
+    CPPUNIT_ASSERT(ra.error() == 0);
+}
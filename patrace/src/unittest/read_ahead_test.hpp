@@ -0,0 +1,29 @@
+#ifndef _INCLUDE_READ_AHEAD_TEST_
+#define _INCLUDE_READ_AHEAD_TEST_
+
+#include <cppunit/extensions/HelperMacros.h>
+
+class ReadAheadTest : public CPPUNIT_NS::TestFixture
+{
+    CPPUNIT_TEST_SUITE(ReadAheadTest);
+
+    CPPUNIT_TEST(testEof);
+    CPPUNIT_TEST(testShortReads);
+    CPPUNIT_TEST(testStalls);
+    CPPUNIT_TEST(testError);
+
+    CPPUNIT_TEST_SUITE_END();
+
+public:
+    ReadAheadTest();
+
+    virtual void setUp();
+    virtual void tearDown();
+
+    void testEof();
+    void testShortReads();
+    void testStalls();
+    void testError();
+};
+
+#endif
@@ -0,0 +1,186 @@
+#include "results_file_test.hpp"
+#include "common/results_file.hpp"
+
+#include <stdio.h>
+#include <unistd.h>
+
+using namespace common;
+
+static const char* testFile = "results_file_test.bin";
+
+ResultsFileTest::ResultsFileTest()
+{
+}
+
+void ResultsFileTest::setUp()
+{
+}
+
+void ResultsFileTest::tearDown()
+{
+    unlink(testFile);
+}
+
+void ResultsFileTest::testRoundTrip()
+{
+    {
+        // Small batches, so that rows are spread over several batch records
+        ResultsWriter writer(3);
+        CPPUNIT_ASSERT(writer.Open(testFile));
+        const unsigned frames = writer.AddTable("frames", {
+            ResultsColumn("frame", RESULTS_U64),
+            ResultsColumn("duration", RESULTS_F64) });
+        const unsigned calls = writer.AddTable("calls", {
+            ResultsColumn("function", RESULTS_STRING),
+            ResultsColumn("delta", RESULTS_I64) });
+        for (unsigned i = 0; i < 10; i++)
+        {
+            writer.Set(frames, 0, (uint64_t)i);
+            writer.Set(frames, 1, i * 0.5);
+            writer.EndRow(frames);
+        }
+        writer.Set(calls, 0, std::string("glDrawElements"));
+        writer.Set(calls, 1, (int64_t)-7);
+        writer.EndRow(calls);
+        writer.Set(calls, 0, std::string(""));
+        writer.Set(calls, 1, (int64_t)42);
+        writer.EndRow(calls);
+
+        ResultsSummary summary;
+        summary.Add("frames", (uint64_t)10);
+        summary.Add("time", 2.5);
+        summary.Add("patrace_version", std::string("r1p0"));
+        summary.Write(writer, "summary");
+
+        Json::Value doc;
+        doc["result"][0]["fps"] = 60.0;
+        doc["result"][0]["egl_info"]["vendor"] = "test";
+        writer.WriteJson("results", doc);
+        writer.Close();
+    }
+
+    ResultsReader reader;
+    CPPUNIT_ASSERT(reader.Open(testFile));
+    CPPUNIT_ASSERT(reader.Tables().size() == 3);
+
+    const ResultsReader::Table* frames = reader.FindTable("frames");
+    CPPUNIT_ASSERT(frames != NULL);
+    CPPUNIT_ASSERT(frames->rows == 10);
+    CPPUNIT_ASSERT(frames->FindColumn("duration") == 1);
+    for (unsigned i = 0; i < 10; i++)
+    {
+        CPPUNIT_ASSERT(frames->GetU64(0, i) == i);
+        CPPUNIT_ASSERT(frames->GetF64(1, i) == i * 0.5);
+    }
+
+    const ResultsReader::Table* calls = reader.FindTable("calls");
+    CPPUNIT_ASSERT(calls != NULL);
+    CPPUNIT_ASSERT(calls->rows == 2);
+    CPPUNIT_ASSERT(calls->GetString(0, 0) == "glDrawElements");
+    CPPUNIT_ASSERT(calls->GetI64(1, 0) == -7);
+    CPPUNIT_ASSERT(calls->GetString(0, 1) == "");
+    CPPUNIT_ASSERT(calls->GetI64(1, 1) == 42);
+
+    // Same shape as the results.json the retracer writes without -binaryresults
+    const Json::Value json = reader.ToJson();
+    CPPUNIT_ASSERT(json["result"][0]["fps"].asDouble() == 60.0);
+    CPPUNIT_ASSERT(json["result"][0]["egl_info"]["vendor"].asString() == "test");
+    CPPUNIT_ASSERT(json["result"][0]["frames"].asUInt64() == 10);
+    CPPUNIT_ASSERT(json["result"][0]["time"].asDouble() == 2.5);
+    CPPUNIT_ASSERT(json["result"][0]["patrace_version"].asString() == "r1p0");
+    CPPUNIT_ASSERT(!json["result"][0].isMember("tables"));
+
+    const Json::Value withTables = reader.ToJson(true);
+    CPPUNIT_ASSERT(withTables["result"][0]["tables"]["frames"]["frame"].size() == 10);
+    CPPUNIT_ASSERT(withTables["result"][0]["tables"]["calls"]["function"][0].asString() == "glDrawElements");
+}
+
+void ResultsFileTest::testTruncated()
+{
+    {
+        ResultsWriter writer(2);
+        CPPUNIT_ASSERT(writer.Open(testFile));
+        const unsigned frames = writer.AddTable("frames", { ResultsColumn("frame", RESULTS_U64) });
+        for (unsigned i = 0; i < 5; i++)
+        {
+            writer.Set(frames, 0, (uint64_t)i);
+            writer.EndRow(frames);
+        }
+        writer.Close();
+    }
+
+    // Cut the last batch in half, as if the run had been killed
+    FILE* fp = fopen(testFile, "rb");
+    CPPUNIT_ASSERT(fp != NULL);
+    fseek(fp, 0, SEEK_END);
+    const long size = ftell(fp);
+    fclose(fp);
+    CPPUNIT_ASSERT(truncate(testFile, size - 4) == 0);
+
+    ResultsReader reader;
+    CPPUNIT_ASSERT(reader.Open(testFile));
+    const ResultsReader::Table* table = reader.FindTable("frames");
+    CPPUNIT_ASSERT(table != NULL);
+    CPPUNIT_ASSERT(table->rows == 4);
+    CPPUNIT_ASSERT(table->GetU64(0, 3) == 3);
+}
+
+// Offset of the first record of the given type, or -1
+static long findRecord(uint32_t wanted)
+{
+    FILE* fp = fopen(testFile, "rb");
+    long offset = -1;
+    fseek(fp, RESULTS_FILE_MAGIC_LEN, SEEK_SET);
+    uint32_t type;
+    uint64_t size;
+    while (fread(&type, sizeof(type), 1, fp) == 1 && fread(&size, sizeof(size), 1, fp) == 1)
+    {
+        if (type == wanted)
+        {
+            offset = ftell(fp) - sizeof(type) - sizeof(size);
+            break;
+        }
+        fseek(fp, size, SEEK_CUR);
+    }
+    fclose(fp);
+    return offset;
+}
+
+static void patch(long offset, const void* data, size_t size)
+{
+    FILE* fp = fopen(testFile, "r+b");
+    fseek(fp, offset, SEEK_SET);
+    fwrite(data, size, 1, fp);
+    fclose(fp);
+}
+
+void ResultsFileTest::testCorrupt()
+{
+    {
+        ResultsWriter writer(4);
+        CPPUNIT_ASSERT(writer.Open(testFile));
+        const unsigned frames = writer.AddTable("frames", { ResultsColumn("frame", RESULTS_U64) });
+        for (unsigned i = 0; i < 4; i++)
+        {
+            writer.Set(frames, 0, (uint64_t)i);
+            writer.EndRow(frames);
+        }
+        writer.Close();
+    }
+    const long batch = findRecord(RESULTS_RECORD_BATCH);
+    CPPUNIT_ASSERT(batch > 0);
+
+    // A row count the record cannot hold must be rejected before anything is allocated for it
+    const uint32_t rows = 0x7fffffff;
+    patch(batch + sizeof(uint32_t) + sizeof(uint64_t) + sizeof(uint32_t), &rows, sizeof(rows));
+    ResultsReader reader;
+    CPPUNIT_ASSERT(!reader.Open(testFile));
+
+    // A record size past the end of the file is a truncated record
+    const uint64_t size = 0xffffffffffffULL;
+    patch(batch + sizeof(uint32_t), &size, sizeof(size));
+    CPPUNIT_ASSERT(reader.Open(testFile));
+    const ResultsReader::Table* table = reader.FindTable("frames");
+    CPPUNIT_ASSERT(table != NULL);
+    CPPUNIT_ASSERT(table->rows == 0);
+}
@@ -0,0 +1,27 @@
+#ifndef _INCLUDE_RESULTS_FILE_TEST_
+#define _INCLUDE_RESULTS_FILE_TEST_
+
+#include <cppunit/extensions/HelperMacros.h>
+
+class ResultsFileTest : public CPPUNIT_NS::TestFixture
+{
+    CPPUNIT_TEST_SUITE(ResultsFileTest);
+
+    CPPUNIT_TEST(testRoundTrip);
+    CPPUNIT_TEST(testTruncated);
+    CPPUNIT_TEST(testCorrupt);
+
+    CPPUNIT_TEST_SUITE_END();
+
+public:
+    ResultsFileTest();
+
+    virtual void setUp();
+    virtual void tearDown();
+
+    void testRoundTrip();
+    void testTruncated();
+    void testCorrupt();
+};
+
+#endif
@@ -4,6 +4,13 @@
 #include "context_test.hpp"
 #include "system_test.hpp"
 #include "image_test.hpp"
+#include "results_file_test.hpp"
+#include "callset_test.hpp"
+#include "dedup_state_test.hpp"
+#include "trace_chunk_test.hpp"
+#include "out_file_test.hpp"
+#include "read_ahead_test.hpp"
+#include "trace_scan_test.hpp"
 
 #define TEST(name) \
 /* Registers the fixture into the "all tests" registry */ \
@@ -17,3 +24,10 @@ TEST(MemoryTest)
 TEST(ContextTest)
 TEST(SystemTest)
 TEST(ImageTest)
+TEST(ResultsFileTest)
+TEST(CallSetTest)
+TEST(DedupStateTest)
+TEST(TraceChunkTest)
+TEST(OutFileTest)
+TEST(ReadAheadTest)
+TEST(TraceScanTest)
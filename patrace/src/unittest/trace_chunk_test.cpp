@@ -0,0 +1,188 @@
+#include "trace_chunk_test.hpp"
+#include "common/trace_chunk.hpp"
+#include "common/in_file_mt.hpp"
+#include "common/out_file.hpp"
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <string>
+#include <vector>
+
+using namespace common;
+
+static const char* testFile = "trace_chunk_test.pat";
+
+TraceChunkTest::TraceChunkTest()
+{
+}
+
+void TraceChunkTest::setUp()
+{
+}
+
+void TraceChunkTest::tearDown()
+{
+    unlink(testFile);
+}
+
+// Frame the given data the way OutFile does
+static std::vector<char> makeChunk(const std::string& data, bool checksum)
+{
+    std::vector<char> frame(4);
+    uint32_t word = data.size() | (checksum ? CHUNK_CHECKSUM_FLAG : 0);
+    for (unsigned i = 0; i < 4; i++, word >>= 8)
+        frame[i] = word & 0xff;
+    frame.insert(frame.end(), data.begin(), data.end());
+    if (checksum)
+    {
+        uint64_t sum = xxHash64(data.data(), data.size());
+        for (unsigned i = 0; i < CHUNK_CHECKSUM_SIZE; i++, sum >>= 8)
+            frame.push_back(sum & 0xff);
+    }
+    return frame;
+}
+
+void TraceChunkTest::testXxHash64()
+{
+    // Reference values of the xxHash64 specification, with seed 0
+    CPPUNIT_ASSERT(xxHash64("", 0) == 0xef46db3751d8e999ull);
+    CPPUNIT_ASSERT(xxHash64("a", 1) == 0xd24ec4f1a98c6e5bull);
+    CPPUNIT_ASSERT(xxHash64("abc", 3) == 0x44bc2cf5ad770999ull);
+
+    // Long enough for the four lane loop, and not a multiple of its stride
+    std::string data;
+    for (unsigned i = 0; i < 1000; i++)
+        data += (char)(i * 7);
+    const uint64_t sum = xxHash64(data.data(), data.size());
+    CPPUNIT_ASSERT(sum == xxHash64(data.data(), data.size()));
+    data[500] ^= 1;
+    CPPUNIT_ASSERT(sum != xxHash64(data.data(), data.size()));
+    CPPUNIT_ASSERT(xxHash64("abc", 3, 1) != xxHash64("abc", 3));
+}
+
+void TraceChunkTest::testParseChunk()
+{
+    ChunkRef chunk;
+
+    const std::vector<char> plain = makeChunk("hello", false);
+    CPPUNIT_ASSERT(parseChunk(plain.data(), plain.size(), chunk, true) == CHUNK_OK);
+    CPPUNIT_ASSERT(!chunk.hasChecksum);
+    CPPUNIT_ASSERT(chunk.length == 5);
+    CPPUNIT_ASSERT(chunk.frameLength == 4 + 5);
+    CPPUNIT_ASSERT(memcmp(chunk.data, "hello", 5) == 0);
+
+    const std::vector<char> flagged = makeChunk("hello", true);
+    CPPUNIT_ASSERT(parseChunk(flagged.data(), flagged.size(), chunk, true) == CHUNK_OK);
+    CPPUNIT_ASSERT(chunk.hasChecksum);
+    CPPUNIT_ASSERT(chunk.length == 5);
+    CPPUNIT_ASSERT(chunk.frameLength == 4 + 5 + CHUNK_CHECKSUM_SIZE);
+    CPPUNIT_ASSERT(chunk.checksum == xxHash64("hello", 5));
+    CPPUNIT_ASSERT(memcmp(chunk.data, "hello", 5) == 0);
+
+    // Chunks follow each other, and a zero length or the end of the file ends them
+    std::vector<char> file = plain;
+    file.insert(file.end(), flagged.begin(), flagged.end());
+    file.resize(file.size() + 64, 0);
+    CPPUNIT_ASSERT(parseChunk(file.data(), file.size(), chunk, true) == CHUNK_OK);
+    const size_t second = chunk.frameLength;
+    CPPUNIT_ASSERT(parseChunk(file.data() + second, file.size() - second, chunk, true) == CHUNK_OK);
+    CPPUNIT_ASSERT(chunk.hasChecksum);
+    const size_t end = second + chunk.frameLength;
+    CPPUNIT_ASSERT(parseChunk(file.data() + end, file.size() - end, chunk, true) == CHUNK_END);
+    CPPUNIT_ASSERT(parseChunk(file.data(), 0, chunk, true) == CHUNK_END);
+}
+
+void TraceChunkTest::testTruncated()
+{
+    ChunkRef chunk;
+    const std::vector<char> plain = makeChunk("hello", false);
+    const std::vector<char> flagged = makeChunk("hello", true);
+
+    // Not even a whole length word
+    for (size_t size = 1; size < 4; size++)
+        CPPUNIT_ASSERT(parseChunk(plain.data(), size, chunk, true) == CHUNK_TRUNCATED);
+
+    // Data cut short, or the checksum after it
+    CPPUNIT_ASSERT(parseChunk(plain.data(), plain.size() - 1, chunk, true) == CHUNK_TRUNCATED);
+    CPPUNIT_ASSERT(parseChunk(flagged.data(), flagged.size() - 1, chunk, false) == CHUNK_TRUNCATED);
+    CPPUNIT_ASSERT(parseChunk(flagged.data(), 4 + 5, chunk, false) == CHUNK_TRUNCATED);
+}
+
+void TraceChunkTest::testBadChecksum()
+{
+    ChunkRef chunk;
+    std::vector<char> flagged = makeChunk("hello", true);
+    flagged[4 + 1] ^= 0x20;
+    CPPUNIT_ASSERT(parseChunk(flagged.data(), flagged.size(), chunk, true) == CHUNK_BAD_CHECKSUM);
+    // Only compared when asked to
+    CPPUNIT_ASSERT(parseChunk(flagged.data(), flagged.size(), chunk, false) == CHUNK_OK);
+
+    // Damage to the checksum itself is caught the same way
+    flagged = makeChunk("hello", true);
+    flagged.back() ^= 1;
+    CPPUNIT_ASSERT(parseChunk(flagged.data(), flagged.size(), chunk, true) == CHUNK_BAD_CHECKSUM);
+
+    // Without a checksum, damage goes unnoticed by the framing
+    std::vector<char> plain = makeChunk("hello", false);
+    plain[4 + 1] ^= 0x20;
+    CPPUNIT_ASSERT(parseChunk(plain.data(), plain.size(), chunk, true) == CHUNK_OK);
+}
+
+void TraceChunkTest::testSalvage()
+{
+    // A trace of three chunks with one call each, the first one also
+    // holding the sig book
+    const std::vector<std::string> sigbook = { "", "testCall" };
+    {
+        OutFile out;
+        out.setChunkChecksums(true);
+        CPPUNIT_ASSERT(out.Open(testFile, true, &sigbook));
+        for (unsigned i = 0; i < 3; i++)
+        {
+            BCall_vlen call;
+            call.funcId = 1;
+            call.toNext = sizeof(call);
+            out.Write(&call, sizeof(call));
+            out.Flush();
+        }
+        // Written last, like the tracer does, since it flushes the cache
+        const std::string json = "{\"defaultTid\":0,\"glesVersion\":2,\"callCnt\":3,\"frameCnt\":0,\"threads\":[]}";
+        out.WriteHeader(json.c_str(), json.size(), false);
+        out.Close();
+    }
+
+    // Damage the data of the second chunk
+    FILE* fp = fopen(testFile, "r+b");
+    CPPUNIT_ASSERT(fp != NULL);
+    fseek(fp, 0, SEEK_END);
+    std::vector<char> file(ftell(fp));
+    fseek(fp, 0, SEEK_SET);
+    CPPUNIT_ASSERT(fread(file.data(), 1, file.size(), fp) == file.size());
+    size_t offset = ((BHeaderV3*)file.data())->jsonFileEnd;
+    ChunkRef chunk;
+    CPPUNIT_ASSERT(parseChunk(file.data() + offset, file.size() - offset, chunk, true) == CHUNK_OK);
+    offset += chunk.frameLength;
+    CPPUNIT_ASSERT(parseChunk(file.data() + offset, file.size() - offset, chunk, true) == CHUNK_OK);
+    fseek(fp, offset + 4, SEEK_SET);
+    fputc(file[offset + 4] ^ 0xff, fp);
+    fclose(fp);
+
+    // Salvaging plays what comes before the damaged chunk, then stops there
+    // instead of aborting
+    InFile in;
+    in.setVerifyChecksums(true);
+    in.setSalvage(true);
+    CPPUNIT_ASSERT(in.Open(testFile));
+    void* fptr;
+    BCall_vlen call;
+    char* src;
+    unsigned calls = 0;
+    while (in.GetNextCall(fptr, call, src))
+    {
+        CPPUNIT_ASSERT(call.funcId == 1);
+        calls++;
+    }
+    CPPUNIT_ASSERT(calls == 1);
+    in.Close();
+}
@@ -0,0 +1,31 @@
+#ifndef _INCLUDE_TRACE_CHUNK_TEST_
+#define _INCLUDE_TRACE_CHUNK_TEST_
+
+#include <cppunit/extensions/HelperMacros.h>
+
+class TraceChunkTest : public CPPUNIT_NS::TestFixture
+{
+    CPPUNIT_TEST_SUITE(TraceChunkTest);
+
+    CPPUNIT_TEST(testXxHash64);
+    CPPUNIT_TEST(testParseChunk);
+    CPPUNIT_TEST(testTruncated);
+    CPPUNIT_TEST(testBadChecksum);
+    CPPUNIT_TEST(testSalvage);
+
+    CPPUNIT_TEST_SUITE_END();
+
+public:
+    TraceChunkTest();
+
+    virtual void setUp();
+    virtual void tearDown();
+
+    void testXxHash64();
+    void testParseChunk();
+    void testTruncated();
+    void testBadChecksum();
+    void testSalvage();
+};
+
+#endif
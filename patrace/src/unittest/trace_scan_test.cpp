@@ -0,0 +1,199 @@
+#include "trace_scan_test.hpp"
+#include "common/trace_scan.hpp"
+#include "common/api_info.hpp"
+#include "common/out_file.hpp"
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <set>
+#include <string>
+#include <vector>
+
+using namespace common;
+
+static const char* testFile = "trace_scan_test.pat";
+
+TraceScanTest::TraceScanTest()
+{
+}
+
+void TraceScanTest::setUp()
+{
+}
+
+void TraceScanTest::tearDown()
+{
+    unlink(testFile);
+}
+
+static const std::vector<std::string> sigbook = { "", "eglSwapBuffers", "eglCreatePbufferSurface", "eglDestroySurface" };
+enum { SWAP = 1, CREATE_PBUFFER, DESTROY_SURFACE };
+
+// Write a call the way the tracer serializes it, with the given arguments
+static void writeCall(OutFile& out, unsigned short id, unsigned char tid, const std::vector<int>& args)
+{
+    std::vector<char> buf(256, 0);
+    const int len = gApiInfo.NameToLen(sigbook[id].c_str());
+    BCall_vlen call;
+    call.funcId = id;
+    call.tid = tid;
+    char* dest = buf.data() + (len == 0 ? sizeof(BCall_vlen) : sizeof(BCall));
+    for (const int arg : args)
+    {
+        dest = WriteFixed(dest, arg);
+    }
+    const unsigned size = (len == 0) ? dest - buf.data() : len;
+    if (len == 0)
+    {
+        call.toNext = size;
+        memcpy(buf.data(), &call, sizeof(BCall_vlen));
+    }
+    else
+    {
+        memcpy(buf.data(), &call, sizeof(BCall));
+    }
+    out.Write(buf.data(), size);
+}
+
+// Each group of calls is flushed to a chunk of its own. Positive numbers
+// are swaps on that surface, negative ones destroy that surface, and below
+// -100 a pbuffer surface numbered from there is created.
+static void writeTrace(const std::vector<std::vector<int>>& chunks)
+{
+    OutFile out;
+    out.setChunkChecksums(true);
+    CPPUNIT_ASSERT(out.Open(testFile, true, &sigbook));
+    for (const std::vector<int>& surfaces : chunks)
+    {
+        for (const int surface : surfaces)
+        {
+            if (surface > 0)
+            {
+                writeCall(out, SWAP, 0, { 1, surface, 1 });
+            }
+            else if (surface < -100)
+            {
+                // dpy, config, empty attribute list, returned surface
+                writeCall(out, CREATE_PBUFFER, 0, { 1, 1, 0, -surface - 100 });
+            }
+            else
+            {
+                writeCall(out, DESTROY_SURFACE, 0, { 1, -surface, 1 });
+            }
+        }
+        out.Flush();
+    }
+    const std::string json = "{\"defaultTid\":0,\"glesVersion\":2,\"callCnt\":0,\"frameCnt\":0,\"threads\":[]}";
+    out.WriteHeader(json.c_str(), json.size(), false);
+    out.Close();
+}
+
+void TraceScanTest::testFindChunks()
+{
+    writeTrace({ { 1 }, { 1, 1 }, { 1 } });
+
+    InFile in;
+    CPPUNIT_ASSERT(in.Open(testFile));
+    std::vector<ChunkRef> chunks;
+    CPPUNIT_ASSERT(findChunks(in.chunksBegin(), in.chunksEnd(), chunks) == CHUNK_END);
+    CPPUNIT_ASSERT(chunks.size() == 3);
+    CPPUNIT_ASSERT(chunks[0].data == in.chunksBegin() + 4);
+    CPPUNIT_ASSERT(chunks[1].data == chunks[0].data + chunks[0].frameLength);
+
+    // Decompressed chunks are appended
+    std::vector<char> buffer;
+    CPPUNIT_ASSERT(uncompressChunk(chunks[1], buffer));
+    const size_t first = buffer.size();
+    CPPUNIT_ASSERT(first > 0);
+    CPPUNIT_ASSERT(uncompressChunk(chunks[2], buffer));
+    CPPUNIT_ASSERT(buffer.size() == first + first / 2);
+
+    // A chunk cut short ends the walk
+    chunks.clear();
+    CPPUNIT_ASSERT(findChunks(in.chunksBegin(), in.chunksEnd() - 1, chunks) == CHUNK_TRUNCATED);
+    CPPUNIT_ASSERT(chunks.size() == 2);
+    in.Close();
+}
+
+void TraceScanTest::testFrames()
+{
+    // Swaps on a pbuffer surface do not end frames, and a pbuffer created in
+    // one chunk is still one in the next until it is destroyed
+    writeTrace({ { 1, -102, 2, 1 }, { 2, -2, 2, 1 } });
+
+    InFile in;
+    CPPUNIT_ASSERT(in.Open(testFile));
+    TraceScanner scanner(in, 0);
+    CPPUNIT_ASSERT(scanner.findChunks() == CHUNK_END);
+    CPPUNIT_ASSERT(scanner.scan(2, true));
+    std::vector<TraceScanner::Chunk>& chunks = scanner.chunks();
+    CPPUNIT_ASSERT(chunks.size() == 2);
+    CPPUNIT_ASSERT(chunks[0].calls == 4);
+    CPPUNIT_ASSERT(chunks[0].frameEnds.size() == 2);
+    CPPUNIT_ASSERT(chunks[0].frameEnds[0].calls == 1);
+    CPPUNIT_ASSERT(chunks[0].frameEnds[1].calls == 4);
+    CPPUNIT_ASSERT(chunks[0].frameEnds[1].offset == chunks[0].uncompressed);
+    CPPUNIT_ASSERT(chunks[1].calls == 4);
+    CPPUNIT_ASSERT(chunks[1].frameEnds.size() == 2);
+    CPPUNIT_ASSERT(chunks[1].frameEnds[0].calls == 3);
+
+    // The same frames as when the calls are read through InFile
+    std::set<int> pbuffers;
+    void* fptr;
+    BCall_vlen call;
+    char* src;
+    unsigned frames = 0;
+    while (in.GetNextCall(fptr, call, src))
+    {
+        frames += InFileBase::isFrameEnd(in.getFrameEvent(call, src), 0, pbuffers);
+    }
+    CPPUNIT_ASSERT(frames == 4);
+    in.Close();
+
+    // Swaps on other threads do not end frames
+    InFile other;
+    CPPUNIT_ASSERT(other.Open(testFile));
+    TraceScanner otherScanner(other, 1);
+    otherScanner.findChunks();
+    CPPUNIT_ASSERT(otherScanner.scan(1, true));
+    CPPUNIT_ASSERT(otherScanner.chunks()[0].frameEnds.empty());
+    CPPUNIT_ASSERT(otherScanner.chunks()[1].frameEnds.empty());
+    other.Close();
+}
+
+void TraceScanTest::testBadChunk()
+{
+    writeTrace({ { 1 }, { 1 }, { 1 } });
+
+    // Damage the data of the second chunk
+    FILE* fp = fopen(testFile, "r+b");
+    CPPUNIT_ASSERT(fp != NULL);
+    fseek(fp, 0, SEEK_END);
+    std::vector<char> file(ftell(fp));
+    fseek(fp, 0, SEEK_SET);
+    CPPUNIT_ASSERT(fread(file.data(), 1, file.size(), fp) == file.size());
+    size_t offset = ((BHeaderV3*)file.data())->jsonFileEnd;
+    ChunkRef chunk;
+    CPPUNIT_ASSERT(parseChunk(file.data() + offset, file.size() - offset, chunk, true) == CHUNK_OK);
+    offset += chunk.frameLength;
+    fseek(fp, offset + 4, SEEK_SET);
+    fputc(file[offset + 4] ^ 0xff, fp);
+    fclose(fp);
+
+    InFile in;
+    CPPUNIT_ASSERT(in.Open(testFile));
+    TraceScanner scanner(in, 0);
+    CPPUNIT_ASSERT(scanner.findChunks() == CHUNK_END);
+    CPPUNIT_ASSERT(!scanner.scan(2, true));
+    std::vector<TraceScanner::Chunk>& chunks = scanner.chunks();
+    CPPUNIT_ASSERT(chunks.size() == 3);
+    CPPUNIT_ASSERT(chunks[0].error == nullptr);
+    CPPUNIT_ASSERT(chunks[0].frameEnds.size() == 1);
+    CPPUNIT_ASSERT(chunks[1].error != nullptr);
+    CPPUNIT_ASSERT(chunks[2].error == nullptr);
+    CPPUNIT_ASSERT(chunks[2].calls == 1);
+    // Not known after the damage
+    CPPUNIT_ASSERT(chunks[2].frameEnds.empty());
+    in.Close();
+}
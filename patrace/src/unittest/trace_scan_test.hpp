@@ -0,0 +1,27 @@
+#ifndef _INCLUDE_TRACE_SCAN_TEST_
+#define _INCLUDE_TRACE_SCAN_TEST_
+
+#include <cppunit/extensions/HelperMacros.h>
+
+class TraceScanTest : public CPPUNIT_NS::TestFixture
+{
+    CPPUNIT_TEST_SUITE(TraceScanTest);
+
+    CPPUNIT_TEST(testFindChunks);
+    CPPUNIT_TEST(testFrames);
+    CPPUNIT_TEST(testBadChunk);
+
+    CPPUNIT_TEST_SUITE_END();
+
+public:
+    TraceScanTest();
+
+    virtual void setUp();
+    virtual void tearDown();
+
+    void testFindChunks();
+    void testFrames();
+    void testBadChunk();
+};
+
+#endif